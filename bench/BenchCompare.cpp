@@ -0,0 +1,186 @@
+#include "BenchCompare.h"
+#include "BenchJson.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	// Percentile bootstrap of median(candidate) / median(baseline): both sides are resampled
+	// with replacement and the ratio of the resampled medians collected.
+	void BootstrapRatio(const std::vector<double>& baseline, const std::vector<double>& candidate, const CompareOptions& options,
+		double& low, double& high)
+	{
+		std::mt19937 rng(options.Seed);
+		std::vector<double> ratios;
+		ratios.reserve(options.Resamples);
+		std::vector<double> a(baseline.size());
+		std::vector<double> b(candidate.size());
+		std::uniform_int_distribution<size_t> pickA(0, baseline.size() - 1);
+		std::uniform_int_distribution<size_t> pickB(0, candidate.size() - 1);
+
+		for (uint32_t i = 0; i < options.Resamples; i++)
+		{
+			for (double& sample : a)
+				sample = baseline[pickA(rng)];
+			for (double& sample : b)
+				sample = candidate[pickB(rng)];
+
+			double baseMedian = Median(a);
+			if (baseMedian > 0.0)
+				ratios.push_back(Median(b) / baseMedian);
+		}
+
+		if (ratios.empty())
+		{
+			low = high = 1.0;
+			return;
+		}
+
+		std::sort(ratios.begin(), ratios.end());
+		double tail = (1.0 - options.Confidence) * 0.5;
+		size_t last = ratios.size() - 1;
+		low = ratios[(size_t)(tail * last)];
+		high = ratios[last - (size_t)(tail * last)];
+	}
+}
+
+double Median(std::vector<double> values)
+{
+	if (values.empty())
+		return 0.0;
+
+	size_t mid = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + mid, values.end());
+	double upper = values[mid];
+	if (values.size() % 2)
+		return upper;
+
+	double lower = *std::max_element(values.begin(), values.begin() + mid);
+	return 0.5 * (lower + upper);
+}
+
+bool LoadBenchRun(const std::string& path, BenchRun& run, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "cannot read " + path;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	JsonValue root;
+	if (!ParseJson(text.str(), root, error))
+	{
+		error = path + ": " + error;
+		return false;
+	}
+
+	const JsonValue* context = root.Find("context");
+	if (context && run.Context.empty())
+	{
+		for (const auto& member : context->Object)
+			run.Context.emplace_back(member.first, member.second.String);
+	}
+
+	const JsonValue* results = root.Find("results");
+	if (!results || results->Kind != JsonValue::Type::Array)
+	{
+		error = path + ": no results";
+		return false;
+	}
+
+	for (const JsonValue& result : results->Array)
+	{
+		const JsonValue* name = result.Find("name");
+		if (!name || name->Kind != JsonValue::Type::String)
+			continue;
+
+		// Older files only have the summary; the median then stands in as a single sample.
+		std::vector<double>& samples = run.SamplesMs[name->String];
+		const JsonValue* values = result.Find("samples_ms");
+		const JsonValue* median = result.Find("median_ms");
+		if (values && values->Kind == JsonValue::Type::Array)
+		{
+			for (const JsonValue& value : values->Array)
+				samples.push_back(value.Number);
+		}
+		else if (median)
+		{
+			samples.push_back(median->Number);
+		}
+	}
+	return true;
+}
+
+std::vector<BenchComparison> CompareRuns(const BenchRun& baseline, const BenchRun& candidate, const CompareOptions& options)
+{
+	std::vector<BenchComparison> comparisons;
+	for (const auto& [name, baseSamples] : baseline.SamplesMs)
+	{
+		BenchComparison c;
+		c.Name = name;
+		c.BaselineSamples = baseSamples.size();
+		c.BaselineMedianMs = Median(baseSamples);
+
+		auto found = candidate.SamplesMs.find(name);
+		if (found == candidate.SamplesMs.end() || found->second.empty() || baseSamples.empty())
+		{
+			c.Verdict = CompareVerdict::Missing;
+			comparisons.push_back(c);
+			continue;
+		}
+
+		const std::vector<double>& candSamples = found->second;
+		c.CandidateSamples = candSamples.size();
+		c.CandidateMedianMs = Median(candSamples);
+		c.Ratio = c.BaselineMedianMs > 0.0 ? c.CandidateMedianMs / c.BaselineMedianMs : 1.0;
+		c.RatioLow = c.Ratio;
+		c.RatioHigh = c.Ratio;
+
+		c.HasInterval = c.BaselineSamples >= options.MinSamples && c.CandidateSamples >= options.MinSamples;
+		if (c.HasInterval)
+			BootstrapRatio(baseSamples, candSamples, options, c.RatioLow, c.RatioHigh);
+
+		if (c.Ratio > 1.0 + options.Threshold && c.RatioLow > 1.0)
+			c.Verdict = CompareVerdict::Regressed;
+		else if (c.Ratio < 1.0 - options.Threshold && c.RatioHigh < 1.0)
+			c.Verdict = CompareVerdict::Improved;
+		comparisons.push_back(c);
+	}
+
+	for (const auto& [name, candSamples] : candidate.SamplesMs)
+	{
+		if (baseline.SamplesMs.count(name))
+			continue;
+
+		BenchComparison c;
+		c.Name = name;
+		c.CandidateSamples = candSamples.size();
+		c.CandidateMedianMs = Median(candSamples);
+		c.Verdict = CompareVerdict::New;
+		comparisons.push_back(c);
+	}
+	return comparisons;
+}
+
+bool FailsCheck(const BenchComparison& comparison, const CompareOptions& options)
+{
+	return comparison.Verdict == CompareVerdict::Regressed
+		|| (comparison.Verdict == CompareVerdict::Missing && !options.AllowMissing);
+}
+
+const char* VerdictName(CompareVerdict verdict)
+{
+	switch (verdict)
+	{
+	case CompareVerdict::Regressed: return "REGRESSED";
+	case CompareVerdict::Improved: return "improved";
+	case CompareVerdict::Missing: return "missing";
+	case CompareVerdict::New: return "new";
+	default: return "ok";
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Samples of one or more benchmark runs, by benchmark name.
+struct BenchRun
+{
+	std::vector<std::pair<std::string, std::string>> Context;
+	std::map<std::string, std::vector<double>> SamplesMs;
+};
+
+// Adds the results of a JSON file written by the benchmark executable or a replay report to
+// run. Loading several files into one run pools the samples of repeated runs by name; the
+// context is taken from the first file.
+bool LoadBenchRun(const std::string& path, BenchRun& run, std::string& error);
+
+struct CompareOptions
+{
+	// Relative change of the median below which a difference is not reported, e.g. 0.05.
+	double Threshold = 0.05;
+
+	// Confidence level of the interval around the median ratio.
+	double Confidence = 0.95;
+
+	uint32_t Resamples = 2000;
+
+	// The bootstrap is seeded, so comparing the same files always gives the same answer.
+	uint32_t Seed = 1;
+
+	// Fewer samples than this on either side give no interval; only the threshold is applied.
+	uint32_t MinSamples = 3;
+
+	// A baseline benchmark the candidate lacks fails the check unless this is set, so a
+	// renamed or broken benchmark cannot quietly drop out of the gate.
+	bool AllowMissing = false;
+};
+
+enum class CompareVerdict
+{
+	Unchanged,
+	Regressed,
+	Improved,
+	// Only in the baseline or only in the candidate.
+	Missing,
+	New
+};
+
+struct BenchComparison
+{
+	std::string Name;
+	size_t BaselineSamples = 0;
+	size_t CandidateSamples = 0;
+	double BaselineMedianMs = 0.0;
+	double CandidateMedianMs = 0.0;
+
+	// Candidate median over baseline median, and its bootstrap confidence interval.
+	double Ratio = 1.0;
+	double RatioLow = 1.0;
+	double RatioHigh = 1.0;
+	bool HasInterval = false;
+
+	CompareVerdict Verdict = CompareVerdict::Unchanged;
+};
+
+double Median(std::vector<double> values);
+
+// A benchmark regressed when its median grew by more than the threshold and the whole
+// confidence interval lies above no change, so noise alone does not fail a run; improvements
+// are the mirror image.
+std::vector<BenchComparison> CompareRuns(const BenchRun& baseline, const BenchRun& candidate, const CompareOptions& options);
+
+// Regressions always fail; Missing fails unless options.AllowMissing.
+bool FailsCheck(const BenchComparison& comparison, const CompareOptions& options);
+
+const char* VerdictName(CompareVerdict verdict);
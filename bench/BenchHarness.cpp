@@ -0,0 +1,138 @@
+#include "BenchHarness.h"
+#include "FrameArena.h"
+#include "Json.h"
+#include "SampleStats.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+namespace
+{
+	volatile const void* g_Sink = nullptr;
+
+	bool ParseCount(const char* text, uint32_t& value)
+	{
+		char* end = nullptr;
+		unsigned long parsed = std::strtoul(text, &end, 10);
+		if (end == text || *end != '\0')
+			return false;
+		value = (uint32_t)parsed;
+		return true;
+	}
+}
+
+void KeepResult(const void* value)
+{
+	g_Sink = value;
+}
+
+bool ParseBenchOptions(int argc, char** argv, BenchOptions& options, std::string& error)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg != "--warmup" && arg != "--repetitions" && arg != "--threads" && arg != "--filter" && arg != "--out")
+		{
+			error = "unknown option " + arg;
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			error = "missing value for " + arg;
+			return false;
+		}
+
+		const char* value = argv[++i];
+		bool ok = true;
+		if (arg == "--warmup")
+			ok = ParseCount(value, options.Warmup);
+		else if (arg == "--repetitions")
+			ok = ParseCount(value, options.Repetitions) && options.Repetitions > 0;
+		else if (arg == "--threads")
+			ok = ParseCount(value, options.Threads);
+		else if (arg == "--filter")
+			options.Filter = value;
+		else
+			options.OutputPath = value;
+
+		if (!ok)
+		{
+			error = "invalid value for " + arg + ": " + value;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BenchRunner::Matches(const std::string& name) const
+{
+	return m_Options.Filter.empty() || name.find(m_Options.Filter) != std::string::npos;
+}
+
+void BenchRunner::Run(const std::string& name, const std::function<void()>& setup, const std::function<void()>& body, uint64_t items)
+{
+	if (!Matches(name))
+		return;
+
+	BenchResult result;
+	result.Name = name;
+	result.ItemsPerRepetition = items;
+
+	for (uint32_t run = 0; run < m_Options.Warmup + m_Options.Repetitions; run++)
+	{
+		// Every run is a frame, so scratch from the frame arena is recycled as in the app.
+		FrameArena::BeginFrame();
+		if (setup)
+			setup();
+
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto end = std::chrono::steady_clock::now();
+
+		if (run >= m_Options.Warmup)
+			result.SamplesMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	result.Stats = ComputeSampleStats(result.SamplesMs);
+	m_Results.push_back(std::move(result));
+}
+
+void BenchRunner::WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context) const
+{
+	out << std::setprecision(6) << "{\n  \"context\": {";
+	for (size_t i = 0; i < context.size(); i++)
+	{
+		out << (i ? ",\n    " : "\n    ");
+		WriteJsonString(out, context[i].first);
+		out << ": ";
+		WriteJsonString(out, context[i].second);
+	}
+	out << "\n  },\n  \"results\": [";
+
+	for (size_t i = 0; i < m_Results.size(); i++)
+	{
+		const BenchResult& r = m_Results[i];
+		out << (i ? ",\n    {" : "\n    {");
+
+		// Every sample is written, in run order, so comparisons can estimate the noise.
+		WriteSampleStatsJson(out, r.Name, r.Stats, r.SamplesMs);
+		out << ", \"items\": " << r.ItemsPerRepetition;
+		if (r.ItemsPerRepetition && r.Stats.MedianMs > 0.0)
+			out << ", \"items_per_second\": " << r.ItemsPerRepetition / (r.Stats.MedianMs / 1000.0);
+		out << "}";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void BenchRunner::PrintSummary(std::ostream& out) const
+{
+	out << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "median ms"
+		<< std::setw(12) << "min ms" << std::setw(12) << "stddev ms" << '\n';
+	out << std::fixed << std::setprecision(3);
+	for (const BenchResult& r : m_Results)
+	{
+		out << std::left << std::setw(40) << r.Name << std::right << std::setw(12) << r.Stats.MedianMs
+			<< std::setw(12) << r.Stats.MinMs << std::setw(12) << r.Stats.StdDevMs << '\n';
+	}
+	out << std::defaultfloat;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "SampleStats.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchOptions
+{
+	uint32_t Warmup = 2;
+	uint32_t Repetitions = 10;
+
+	// Zero uses one worker per hardware thread.
+	uint32_t Threads = 0;
+
+	// Only benchmarks whose name contains this are run.
+	std::string Filter;
+
+	// JSON results go here; empty writes them to stdout.
+	std::string OutputPath;
+};
+
+// Parses --warmup N, --repetitions N, --threads N, --filter TEXT and --out PATH. Returns false
+// with a message in error for anything else.
+bool ParseBenchOptions(int argc, char** argv, BenchOptions& options, std::string& error);
+
+struct BenchResult
+{
+	std::string Name;
+	uint64_t ItemsPerRepetition = 0;
+	std::vector<double> SamplesMs;
+	SampleStats Stats;
+};
+
+// Keeps the compiler from dropping a computation whose result is otherwise unused.
+void KeepResult(const void* value);
+
+class BenchRunner
+{
+public:
+	explicit BenchRunner(const BenchOptions& options) : m_Options(options) {}
+
+	bool Matches(const std::string& name) const;
+
+	// Times body Warmup + Repetitions times and keeps the last Repetitions. setup runs before
+	// every run, untimed, so each run starts from the same state. items is the work done per
+	// run, reported as throughput.
+	void Run(const std::string& name, const std::function<void()>& setup, const std::function<void()>& body, uint64_t items = 0);
+
+	const std::vector<BenchResult>& Results() const { return m_Results; }
+
+	// context is written as string pairs next to the results, e.g. compiler and thread count.
+	void WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context) const;
+	void PrintSummary(std::ostream& out) const;
+
+private:
+	BenchOptions m_Options;
+	std::vector<BenchResult> m_Results;
+};
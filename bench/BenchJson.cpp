@@ -0,0 +1,207 @@
+#include "BenchJson.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace
+{
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string& text) : m_Text(text) {}
+
+		bool ParseDocument(JsonValue& value, std::string& error)
+		{
+			bool ok = ParseValue(value, 0);
+			SkipSpace();
+			if (ok && m_Pos != m_Text.size())
+				ok = Fail("trailing characters");
+			if (!ok)
+				error = m_Error + " at offset " + std::to_string(m_Pos);
+			return ok;
+		}
+
+	private:
+		static constexpr int MaxDepth = 64;
+
+		bool Fail(const char* message)
+		{
+			if (m_Error.empty())
+				m_Error = message;
+			return false;
+		}
+
+		void SkipSpace()
+		{
+			while (m_Pos < m_Text.size() && std::isspace((unsigned char)m_Text[m_Pos]))
+				m_Pos++;
+		}
+
+		bool Consume(char c)
+		{
+			SkipSpace();
+			if (m_Pos < m_Text.size() && m_Text[m_Pos] == c)
+			{
+				m_Pos++;
+				return true;
+			}
+			return false;
+		}
+
+		bool ConsumeWord(const char* word)
+		{
+			size_t length = std::char_traits<char>::length(word);
+			if (m_Text.compare(m_Pos, length, word) != 0)
+				return false;
+			m_Pos += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			if (depth > MaxDepth)
+				return Fail("nesting too deep");
+
+			SkipSpace();
+			if (m_Pos == m_Text.size())
+				return Fail("unexpected end");
+
+			char c = m_Text[m_Pos];
+			if (c == '{')
+				return ParseObject(value, depth);
+			if (c == '[')
+				return ParseArray(value, depth);
+			if (c == '"')
+			{
+				value.Kind = JsonValue::Type::String;
+				return ParseString(value.String);
+			}
+			if (ConsumeWord("true") || ConsumeWord("false"))
+			{
+				value.Kind = JsonValue::Type::Bool;
+				value.Bool = c == 't';
+				return true;
+			}
+			if (ConsumeWord("null"))
+			{
+				value.Kind = JsonValue::Type::Null;
+				return true;
+			}
+			return ParseNumber(value);
+		}
+
+		bool ParseObject(JsonValue& value, int depth)
+		{
+			value.Kind = JsonValue::Type::Object;
+			m_Pos++;
+			if (Consume('}'))
+				return true;
+
+			do
+			{
+				std::string key;
+				SkipSpace();
+				if (m_Pos == m_Text.size() || m_Text[m_Pos] != '"' || !ParseString(key))
+					return Fail("expected a key");
+				if (!Consume(':'))
+					return Fail("expected ':'");
+
+				value.Object.emplace_back(std::move(key), JsonValue());
+				if (!ParseValue(value.Object.back().second, depth + 1))
+					return false;
+			} while (Consume(','));
+
+			return Consume('}') || Fail("expected '}'");
+		}
+
+		bool ParseArray(JsonValue& value, int depth)
+		{
+			value.Kind = JsonValue::Type::Array;
+			m_Pos++;
+			if (Consume(']'))
+				return true;
+
+			do
+			{
+				value.Array.emplace_back();
+				if (!ParseValue(value.Array.back(), depth + 1))
+					return false;
+			} while (Consume(','));
+
+			return Consume(']') || Fail("expected ']'");
+		}
+
+		bool ParseString(std::string& out)
+		{
+			m_Pos++;
+			while (m_Pos < m_Text.size())
+			{
+				char c = m_Text[m_Pos++];
+				if (c == '"')
+					return true;
+				if (c != '\\')
+				{
+					out += c;
+					continue;
+				}
+
+				if (m_Pos == m_Text.size())
+					break;
+				char escaped = m_Text[m_Pos++];
+				switch (escaped)
+				{
+				case 'n': out += '\n'; break;
+				case 't': out += '\t'; break;
+				case 'r': out += '\r'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'u':
+				{
+					if (m_Pos + 4 > m_Text.size())
+						return Fail("bad escape");
+					unsigned long code = std::strtoul(m_Text.substr(m_Pos, 4).c_str(), nullptr, 16);
+					m_Pos += 4;
+					out += code < 0x80 ? (char)code : '?';
+					break;
+				}
+				default: out += escaped; break;
+				}
+			}
+			return Fail("unterminated string");
+		}
+
+		bool ParseNumber(JsonValue& value)
+		{
+			const char* start = m_Text.c_str() + m_Pos;
+			char* end = nullptr;
+			double number = std::strtod(start, &end);
+			if (end == start)
+				return Fail("unexpected character");
+
+			m_Pos += end - start;
+			value.Kind = JsonValue::Type::Number;
+			value.Number = number;
+			return true;
+		}
+
+		const std::string& m_Text;
+		size_t m_Pos = 0;
+		std::string m_Error;
+	};
+}
+
+const JsonValue* JsonValue::Find(const std::string& key) const
+{
+	for (const auto& member : Object)
+	{
+		if (member.first == key)
+			return &member.second;
+	}
+	return nullptr;
+}
+
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error)
+{
+	value = JsonValue();
+	JsonParser parser(text);
+	return parser.ParseDocument(value, error);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON to read benchmark results back: no \u escapes beyond ASCII, numbers as
+// doubles, objects keep their order.
+struct JsonValue
+{
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type Kind = Type::Null;
+	bool Bool = false;
+	double Number = 0.0;
+	std::string String;
+	std::vector<JsonValue> Array;
+	std::vector<std::pair<std::string, JsonValue>> Object;
+
+	// Member of an object, or nullptr if this is not an object or has no such key.
+	const JsonValue* Find(const std::string& key) const;
+};
+
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error);
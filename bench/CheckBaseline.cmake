@@ -0,0 +1,7 @@
+# Run by bench_check before the benchmarks, so a missing baseline fails at once with a hint
+# instead of after a full benchmark run.
+if(NOT EXISTS "${BASELINE}")
+    message(FATAL_ERROR "No benchmark baseline at ${BASELINE}.\n"
+        "Record one on this machine class with the bench_baseline target and commit it, "
+        "or compare against an existing class with -DBENCH_MACHINE_CLASS=<name>.")
+endif()
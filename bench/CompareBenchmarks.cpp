@@ -0,0 +1,165 @@
+// Compares benchmark results against a baseline and fails when something got slower or a
+// baseline benchmark is missing from the candidate. Either side may be several files from
+// repeated runs; their samples are pooled. Exit code 0 means the check passed, 1 a regression
+// or missing benchmark, 2 bad arguments or unreadable input.
+
+#include "BenchCompare.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	const char* Usage =
+		" --baseline FILE [--baseline FILE ...] --candidate FILE [--candidate FILE ...]"
+		" [--threshold FRACTION] [--confidence LEVEL] [--filter TEXT] [--allow-missing]";
+
+	bool ParseFraction(const char* text, double& value)
+	{
+		char* end = nullptr;
+		double parsed = std::strtod(text, &end);
+		if (end == text || *end != '\0' || !(parsed >= 0.0 && parsed < 1.0))
+			return false;
+		value = parsed;
+		return true;
+	}
+
+	std::string ContextValue(const BenchRun& run, const char* key)
+	{
+		for (const auto& [name, value] : run.Context)
+		{
+			if (name == key)
+				return value;
+		}
+		return std::string();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> baselinePaths;
+	std::vector<std::string> candidatePaths;
+	std::string filter;
+	CompareOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		if (std::strcmp(arg, "--allow-missing") == 0)
+		{
+			options.AllowMissing = true;
+			continue;
+		}
+
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool ok = value != nullptr;
+		if (ok && std::strcmp(arg, "--baseline") == 0)
+			baselinePaths.push_back(value);
+		else if (ok && std::strcmp(arg, "--candidate") == 0)
+			candidatePaths.push_back(value);
+		else if (ok && std::strcmp(arg, "--threshold") == 0)
+			ok = ParseFraction(value, options.Threshold);
+		else if (ok && std::strcmp(arg, "--confidence") == 0)
+			ok = ParseFraction(value, options.Confidence) && options.Confidence > 0.0;
+		else if (ok && std::strcmp(arg, "--filter") == 0)
+			filter = value;
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::cerr << "bad argument " << arg << "\nusage: " << argv[0] << Usage << '\n';
+			return 2;
+		}
+		i++;
+	}
+
+	if (baselinePaths.empty() || candidatePaths.empty())
+	{
+		std::cerr << "usage: " << argv[0] << Usage << '\n';
+		return 2;
+	}
+
+	BenchRun baseline;
+	BenchRun candidate;
+	std::string error;
+	for (const std::string& path : baselinePaths)
+	{
+		if (!LoadBenchRun(path, baseline, error))
+		{
+			std::cerr << error << '\n';
+			return 2;
+		}
+	}
+	for (const std::string& path : candidatePaths)
+	{
+		if (!LoadBenchRun(path, candidate, error))
+		{
+			std::cerr << error << '\n';
+			return 2;
+		}
+	}
+
+	// Numbers from a different compiler, build type or thread count are not comparable.
+	for (const char* key : { "platform", "compiler", "build", "threads" })
+	{
+		std::string a = ContextValue(baseline, key);
+		std::string b = ContextValue(candidate, key);
+		if (a != b)
+			std::cerr << "warning: " << key << " differs: baseline \"" << a << "\", candidate \"" << b << "\"\n";
+	}
+
+	std::vector<BenchComparison> comparisons = CompareRuns(baseline, candidate, options);
+
+	std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(12) << "base ms"
+		<< std::setw(12) << "new ms" << std::setw(10) << "change" << std::setw(25) << "interval" << "  verdict\n";
+	std::cout << std::fixed;
+
+	int regressions = 0;
+	int missing = 0;
+	int failures = 0;
+	for (const BenchComparison& c : comparisons)
+	{
+		if (!filter.empty() && c.Name.find(filter) == std::string::npos)
+			continue;
+
+		std::cout << std::left << std::setw(36) << c.Name << std::right << std::setprecision(3)
+			<< std::setw(12) << c.BaselineMedianMs << std::setw(12) << c.CandidateMedianMs;
+		if (c.Verdict == CompareVerdict::Missing || c.Verdict == CompareVerdict::New)
+		{
+			std::cout << std::setw(10) << "" << std::setw(25) << "";
+		}
+		else
+		{
+			std::cout << std::setprecision(1) << std::setw(9) << (c.Ratio - 1.0) * 100.0 << '%';
+			if (c.HasInterval)
+			{
+				std::cout << std::setw(10) << "[" << std::setw(5) << (c.RatioLow - 1.0) * 100.0 << "%, "
+					<< std::setw(5) << (c.RatioHigh - 1.0) * 100.0 << "%]";
+			}
+			else
+			{
+				std::cout << std::setw(25) << "(too few samples)";
+			}
+		}
+		std::cout << "  " << VerdictName(c.Verdict) << '\n';
+
+		if (c.Verdict == CompareVerdict::Regressed)
+			regressions++;
+		else if (c.Verdict == CompareVerdict::Missing)
+			missing++;
+		if (FailsCheck(c, options))
+			failures++;
+	}
+
+	std::cout << std::setprecision(0) << '\n' << regressions << " regression(s) beyond " << options.Threshold * 100.0
+		<< "% at " << options.Confidence * 100.0 << "% confidence\n";
+	if (missing)
+	{
+		std::cout << missing << " baseline benchmark(s) missing from the candidate"
+			<< (options.AllowMissing ? " (allowed by --allow-missing)\n" : "; rerun them, or refresh the baseline if they were removed on purpose\n");
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,388 @@
+// Headless benchmarks of the platform-neutral CPU kernels: the wave solver, terrain noise,
+// grid generation, mesh parsing, instance culling and event dispatch. Every fixture is built
+// from fixed sizes and seeds, so runs on the same machine and build are comparable. Results are
+// written as JSON.
+
+#include "BenchHarness.h"
+#include "GeometryGenerator.h"
+#include "HeightMapGenerator.h"
+#include "JobSystem.h"
+#include "MeshLoader.h"
+#include "Waves.h"
+#include "../src/Events/EventBus.h"
+#include "../src/Events/MouseEvent.h"
+#include "../src/Renderer/InstanceBatcher.h"
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	const uint32_t FixtureSeed = 1337;
+
+	void AddWaveBenchmarks(BenchRunner& runner, JobSystem& jobs)
+	{
+		const int stepsPerRun = 60;
+		for (int size : { 128, 256 })
+		{
+			std::unique_ptr<Waves> waves;
+			auto setup = [&]()
+				{
+					// The same disturbances every run, so every run solves the same field.
+					waves = std::make_unique<Waves>(size, size, 1.0f, 0.03f, 4.0f, 0.2f, jobs);
+					std::mt19937 rng(FixtureSeed);
+					std::uniform_int_distribution<int> cell(4, size - 5);
+					std::uniform_real_distribution<float> magnitude(0.2f, 0.5f);
+					for (int i = 0; i < 32; i++)
+						waves->Disturb(cell(rng), cell(rng), magnitude(rng));
+				};
+			auto body = [&]()
+				{
+					for (int step = 0; step < stepsPerRun; step++)
+						waves->Update(0.03f);
+					KeepResult(&waves->Position(0));
+				};
+			runner.Run("waves/step/" + std::to_string(size) + "x" + std::to_string(size), setup, body, (uint64_t)stepsPerRun * size * size);
+		}
+	}
+
+	void AddNoiseBenchmarks(BenchRunner& runner, JobSystem& jobs)
+	{
+		for (uint32_t size : { 256u, 512u, 1024u })
+		{
+			for (int octaves : { 1, 4, 8 })
+			{
+				PerlinNoiseSettings settings;
+				settings.Scale = 8.0f;
+				settings.Octaves = octaves;
+				settings.Amplitude = 1.0f;
+				settings.Persistence = 0.5f;
+				settings.Frequency = 1.0f;
+				settings.Seed = (int)FixtureSeed;
+
+				auto body = [&]()
+					{
+						HeightMap map = GeneratePerlinHeightmap(size, size, settings, jobs);
+						KeepResult(map.data.data());
+					};
+				std::string name = "noise/" + std::to_string(size) + "x" + std::to_string(size) + "/octaves" + std::to_string(octaves);
+				runner.Run(name, nullptr, body, (uint64_t)size * size);
+			}
+		}
+	}
+
+	void AddGridBenchmarks(BenchRunner& runner)
+	{
+		GeometryGenerator generator;
+		for (uint32_t size : { 64u, 256u, 512u })
+		{
+			auto body = [&]()
+				{
+					GeometryGenerator::MeshData grid = generator.CreateGrid(512.0f, 512.0f, size, size);
+					KeepResult(grid.Vertices.data());
+				};
+			runner.Run("grid/" + std::to_string(size) + "x" + std::to_string(size), nullptr, body, (uint64_t)size * size);
+		}
+	}
+
+	// Row-vector view-projection of a camera at eye looking down +z, as the renderer builds it.
+	void MakeViewProj(const float eye[3], float viewProj[16])
+	{
+		const float fovY = 0.25f * 3.14159265f;
+		const float aspect = 16.0f / 9.0f;
+		const float nearZ = 1.0f;
+		const float farZ = 1000.0f;
+		float h = 1.0f / std::tan(0.5f * fovY);
+		float w = h / aspect;
+		float q = farZ / (farZ - nearZ);
+
+		float view[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, -eye[0], -eye[1], -eye[2], 1 };
+		float proj[16] = { w, 0, 0, 0, 0, h, 0, 0, 0, 0, q, 1, 0, 0, -q * nearZ, 0 };
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++)
+					sum += view[r * 4 + k] * proj[k * 4 + c];
+				viewProj[r * 4 + c] = sum;
+			}
+		}
+	}
+
+	void AddCullBenchmarks(BenchRunner& runner)
+	{
+		// Props scattered over the terrain and seen from its edge, so a good part is culled.
+		const float eye[3] = { 0.0f, 60.0f, -500.0f };
+		float viewProj[16];
+		MakeViewProj(eye, viewProj);
+		CullFrustum frustum = FrustumFromViewProj(viewProj);
+
+		for (uint32_t count : { 10000u, 100000u })
+		{
+			struct Prop
+			{
+				InstanceBatchKey Key;
+				float World[16];
+			};
+			std::vector<Prop> props(count);
+			std::mt19937 rng(FixtureSeed);
+			std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+			std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+			static const int geometries[4] = {};
+			for (Prop& prop : props)
+			{
+				uint32_t kind = rng() % 4;
+				prop.Key.Geometry = &geometries[kind];
+				prop.Key.IndexCount = 36 * (kind + 1);
+				prop.Key.Material = kind;
+				float s = scale(rng);
+				float world[16] = { s, 0, 0, 0, 0, s, 0, 0, 0, 0, s, 0, position(rng), 0.0f, position(rng), 1 };
+				std::copy(std::begin(world), std::end(world), prop.World);
+			}
+
+			InstanceBatcher batcher;
+			const float center[3] = { 0.0f, 0.5f, 0.0f };
+			auto body = [&]()
+				{
+					batcher.Begin();
+					for (const Prop& prop : props)
+						batcher.Add(prop.Key, prop.World, center, 0.9f);
+					batcher.Build(frustum);
+					KeepResult(batcher.Instances().data());
+				};
+			runner.Run("cull/instances/" + std::to_string(count), nullptr, body, count);
+		}
+	}
+
+	// The dispatch the application used before EventBus: the window calls a std::function bound
+	// with std::bind, and every dispatch wraps its handler in another std::function.
+	class LegacyEventDispatcher
+	{
+	public:
+		explicit LegacyEventDispatcher(Event& event) : m_Event(event) {}
+
+		template<typename T>
+		bool Dispatch(std::function<bool(T&)> func)
+		{
+			if (m_Event.GetEventType() != T::GetStaticType())
+				return false;
+			m_Event.Handled = func(static_cast<T&>(m_Event));
+			return true;
+		}
+
+	private:
+		Event& m_Event;
+	};
+
+	struct MouseSink
+	{
+		float Sum = 0.0f;
+
+		bool OnMouseMoved(MouseMovedEvent& event)
+		{
+			Sum += event.GetMouseX() + event.GetMouseY();
+			return true;
+		}
+
+		void OnEvent(Event& event)
+		{
+			LegacyEventDispatcher dispatcher(event);
+			dispatcher.Dispatch<MouseMovedEvent>(std::bind(&MouseSink::OnMouseMoved, this, std::placeholders::_1));
+		}
+	};
+
+	void AddEventBenchmarks(BenchRunner& runner)
+	{
+		// An 8 kHz mouse at 60 frames per second, for 1000 frames.
+		const uint32_t frames = 1000;
+		const uint32_t movesPerFrame = 133;
+		const uint64_t moves = (uint64_t)frames * movesPerFrame;
+
+		MouseSink sink;
+		std::function<void(Event&)> callback = std::bind(&MouseSink::OnEvent, &sink, std::placeholders::_1);
+		auto legacy = [&]()
+			{
+				for (uint32_t i = 0; i < moves; i++)
+				{
+					MouseMovedEvent event((float)(i % 1920), (float)(i % 1080));
+					callback(event);
+				}
+				KeepResult(&sink.Sum);
+			};
+		runner.Run("events/mouse_moves/legacy", nullptr, legacy, moves);
+
+		EventBus bus;
+		bus.Subscribe<MouseMovedEvent, &MouseSink::OnMouseMoved>(&sink);
+		auto send = [&]()
+			{
+				for (uint32_t i = 0; i < moves; i++)
+				{
+					MouseMovedEvent event((float)(i % 1920), (float)(i % 1080));
+					bus.Send(event);
+				}
+				KeepResult(&sink.Sum);
+			};
+		runner.Run("events/mouse_moves/send", nullptr, send, moves);
+
+		// Moves between frames collapse into one, as in the application's message pump.
+		auto queued = [&]()
+			{
+				for (uint32_t frame = 0; frame < frames; frame++)
+				{
+					for (uint32_t i = 0; i < movesPerFrame; i++)
+						bus.Post(MouseMovedEvent((float)(i % 1920), (float)(frame % 1080)));
+					bus.Drain();
+				}
+				KeepResult(&sink.Sum);
+			};
+		runner.Run("events/mouse_moves/queued", nullptr, queued, moves);
+	}
+
+	// A grid in the text mesh format, so parsing can be measured without the model files.
+	std::string MakeTextMesh(uint32_t size)
+	{
+		std::mt19937 rng(FixtureSeed);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+		std::ostringstream text;
+		uint32_t quads = (size - 1) * (size - 1);
+		text << "VertexCount: " << size * size << "\nTriangleCount: " << quads * 2 << "\nVertexList (pos, normal)\n{\n";
+		for (uint32_t i = 0; i < size * size; i++)
+		{
+			text << '\t' << (float)(i % size) << ' ' << value(rng) << ' ' << (float)(i / size) << ' '
+				<< value(rng) << ' ' << value(rng) << ' ' << value(rng) << '\n';
+		}
+		text << "}\nTriangleList\n{\n";
+		for (uint32_t row = 0; row + 1 < size; row++)
+		{
+			for (uint32_t col = 0; col + 1 < size; col++)
+			{
+				uint32_t i = row * size + col;
+				text << '\t' << i << ' ' << i + size << ' ' << i + 1 << '\n';
+				text << '\t' << i + 1 << ' ' << i + size << ' ' << i + size + 1 << '\n';
+			}
+		}
+		text << "}\n";
+		return text.str();
+	}
+
+	void AddMeshParseBenchmark(BenchRunner& runner, const std::string& name, const std::string& text)
+	{
+		std::istringstream stream;
+		TextMesh mesh;
+		auto setup = [&]()
+			{
+				stream.clear();
+				stream.str(text);
+			};
+		auto body = [&]()
+			{
+				if (!ParseTextMesh(stream, mesh))
+					throw std::runtime_error(name + ": mesh did not parse");
+				KeepResult(mesh.Positions.data());
+			};
+		runner.Run(name, setup, body, text.size());
+	}
+
+	void AddMeshBenchmarks(BenchRunner& runner, const std::string& modelPath)
+	{
+		if (runner.Matches("mesh/parse/synthetic"))
+			AddMeshParseBenchmark(runner, "mesh/parse/synthetic_256x256", MakeTextMesh(256));
+
+		// The skull is only measured when the model is there, i.e. when run from the repository.
+		std::ifstream file(modelPath);
+		if (file && runner.Matches("mesh/parse/skull"))
+		{
+			std::stringstream text;
+			text << file.rdbuf();
+			AddMeshParseBenchmark(runner, "mesh/parse/skull", text.str());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	std::string error;
+	if (!ParseBenchOptions(argc, argv, options, error))
+	{
+		std::cerr << error << "\nusage: " << argv[0]
+			<< " [--warmup N] [--repetitions N] [--threads N] [--filter TEXT] [--out PATH]\n";
+		return 2;
+	}
+
+	uint32_t workers = options.Threads ? options.Threads - 1 : JobSystem::DefaultWorkerCount();
+	JobSystem jobs(workers);
+	BenchRunner runner(options);
+
+	try
+	{
+		AddWaveBenchmarks(runner, jobs);
+		AddNoiseBenchmarks(runner, jobs);
+		AddGridBenchmarks(runner);
+		AddMeshBenchmarks(runner, "Models/skull.txt");
+		AddCullBenchmarks(runner);
+		AddEventBenchmarks(runner);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "benchmark failed: " << e.what() << '\n';
+		return 1;
+	}
+
+#if defined(_MSC_VER)
+	std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+	std::string compiler = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+	std::string compiler = std::string("gcc ") + __VERSION__;
+#else
+	std::string compiler = "unknown";
+#endif
+#if defined(_WIN32)
+	std::string platform = "windows";
+#elif defined(__linux__)
+	std::string platform = "linux";
+#else
+	std::string platform = "other";
+#endif
+#ifdef NDEBUG
+	std::string build = "release";
+#else
+	std::string build = "debug";
+#endif
+
+	std::vector<std::pair<std::string, std::string>> context = {
+		{ "platform", platform },
+		{ "compiler", compiler },
+		{ "build", build },
+		{ "threads", std::to_string(jobs.ThreadCount()) },
+		{ "hardware_threads", std::to_string(std::thread::hardware_concurrency()) },
+		{ "warmup", std::to_string(options.Warmup) },
+		{ "repetitions", std::to_string(options.Repetitions) },
+	};
+
+	runner.PrintSummary(std::cerr);
+	if (options.OutputPath.empty())
+	{
+		runner.WriteJson(std::cout, context);
+	}
+	else
+	{
+		std::ofstream out(options.OutputPath);
+		if (!out)
+		{
+			std::cerr << "cannot write " << options.OutputPath << '\n';
+			return 1;
+		}
+		runner.WriteJson(out, context);
+	}
+	return 0;
+}
@@ -1308,8 +1308,13 @@ static HRESULT CreateD3DResources12(
 				// Use Heap-allocating UpdateSubresources implementation for variable number of subresources (which is the case for textures).
 				UpdateSubresources(cmdList, texture.Get(), textureUploadHeap.Get(), 0, 0, num2DSubresources, initData);
 
-				cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
-					D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+				// Copy queues cannot transition to shader resource states; the texture decays to
+				// COMMON after the copy and is promoted implicitly when first sampled.
+				if (cmdList->GetType() != D3D12_COMMAND_LIST_TYPE_COPY)
+				{
+					cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+						D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+				}
 			}
 		}
 	} break;
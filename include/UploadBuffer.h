@@ -28,6 +28,7 @@ public:
 			D3D12_RESOURCE_STATE_GENERIC_READ,
             nullptr,
             IID_PPV_ARGS(&mUploadBuffer)));
+        d3dUtil::TrackGpuMemory(mUploadBuffer.Get(), isConstantBuffer ? MemoryTag::ConstantBuffers : MemoryTag::Geometry);
 
         ThrowIfFailed(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
 
@@ -53,6 +54,41 @@ public:
     void CopyData(int elementIndex, const T& data)
     {
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
+        mBytesWritten += sizeof(T);
+    }
+
+    // Copies count consecutive elements. Constant buffer elements are padded, so this is
+    // only for plain buffers.
+    void CopyData(int firstIndex, const T* data, UINT count)
+    {
+        assert(!mIsConstantBuffer);
+        memcpy(&mMappedData[firstIndex*mElementByteSize], data, sizeof(T)*count);
+        mBytesWritten += sizeof(T)*count;
+    }
+
+    // In-place access for writers that fill elements directly; they report what they wrote
+    // through AddBytesWritten.
+    BYTE* MappedData()
+    {
+        return mMappedData;
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
+    void AddBytesWritten(UINT64 bytes)
+    {
+        mBytesWritten += bytes;
+    }
+
+    // Bytes copied in since the previous call.
+    UINT64 TakeBytesWritten()
+    {
+        UINT64 bytes = mBytesWritten;
+        mBytesWritten = 0;
+        return bytes;
     }
 
 private:
@@ -61,4 +97,5 @@ private:
 
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
+    UINT64 mBytesWritten = 0;
 };
\ No newline at end of file
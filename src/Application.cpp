@@ -1,7 +1,7 @@
 #include <assert.h>
+#include <sstream>
 #include "Application.h"
-
-#define BIND_EVENT_FN(x) std::bind(&x, this, std::placeholders::_1)
+#include "Utils/FrameArena.h"
 
 Application* Application::s_Instance = nullptr;
 
@@ -12,42 +12,204 @@ Application::Application()
 	m_GameTimer.Reset();
 	m_GameTimer.Start();
 	m_Window = std::unique_ptr<Window>(new Window(m_Camera, m_GameTimer));
-	m_Window->SetEventCallback(BIND_EVENT_FN(Application::OnEvent));
+	m_Window->SetEventBus(&m_Events);
+	m_Events.Subscribe<WindowCloseEvent, &Application::OnWindowClose>(this);
 	
 
 	m_Hwnd = m_Window->GetWindowHandle();
 
+	Profiler::Get().SetThreadName("Main");
 	m_Renderer = std::unique_ptr<Renderer>(new Renderer(m_Hwnd, m_Window->GetWidth(), m_Window->GetHeight(), m_Window->GetCamera()));
+	m_Renderer->SetVSync(m_Window->IsVSync());
 };
 
 Application::~Application()
 {
+	// Everything tracked should be gone once the renderer is; whatever is left is a leak.
+	m_Renderer.reset();
+	FrameArena::ForThread().Trim();
 
-}
-
-void Application::OnEvent(Event& event)
-{
-	EventDispatcher dispatcher(event);
-	dispatcher.Dispatch<WindowCloseEvent>(BIND_EVENT_FN(Application::OnWindowClose));
+	std::ostringstream report;
+	if (MemoryTracker::Get().WriteLeakReport(report))
+		OutputDebugStringA(("Memory still allocated at shutdown:\n" + report.str()).c_str());
 }
 
 int Application::Run()
 {
 	while (m_Running)
 	{
+		m_Renderer->BeginFrame();
+
+		// Handled before the tick, so a replay starts on a whole fixed step.
+		OnReplayCommand(m_Renderer->TakeReplayCommand());
 		m_GameTimer.Tick();
-		m_Window->OnKeyboardInput(m_GameTimer);
+		if (m_ReplayMode != ReplayMode::Playing)
+			m_Window->OnKeyboardInput(m_GameTimer);
 		if (const auto ecode = Window::ProcessMessages())
 		{
 			return *ecode;
 		}
+		m_Events.Drain();
+		BeginReplayFrame();
 		m_Renderer->Update(m_GameTimer, m_Window->GetCamera());
+		ApplyReplayFrameParameters();
 		m_Renderer->Draw();
+		EndReplayFrame();
+		Profiler::Get().EndFrame();
 	}
 
 	return 0;
 }
 
+bool Application::PlayReplay(const std::string& path, const std::string& reportPath, bool exitWhenDone)
+{
+	if (m_ReplayMode == ReplayMode::Recording)
+		StopRecording();
+
+	if (!LoadReplay(path, m_Replay) || m_Replay.Frames.empty())
+	{
+		m_Renderer->SetReplayStatus("Could not load " + path);
+		return false;
+	}
+
+	m_ReplayPath = path;
+	m_ReplayReportPath = reportPath;
+	m_ExitAfterReplay = exitWhenDone;
+	m_ReplayMode = ReplayMode::Playing;
+	m_ReplayFrame = 0;
+	m_ReplayReport.Reset(m_Replay.Frames.size());
+
+	// The recorded settings are applied before the reset, so the terrain is regenerated from them.
+	m_GameTimer.SetFixedTimeStep(m_Replay.FixedTimeStep);
+	m_Renderer->ApplyReplayParameters(m_Replay.Frames[0].Parameters);
+	m_Renderer->ResetSimulation();
+	return true;
+}
+
+void Application::OnReplayCommand(ReplayCommand command)
+{
+	switch (command)
+	{
+	case ReplayCommand::Record:
+		if (m_ReplayMode == ReplayMode::Playing)
+			StopPlayback(false);
+		if (m_ReplayMode == ReplayMode::Live)
+			StartRecording();
+		break;
+	case ReplayCommand::Play:
+		PlayReplay(m_ReplayPath, m_ReplayReportPath, false);
+		break;
+	case ReplayCommand::Stop:
+		if (m_ReplayMode == ReplayMode::Recording)
+			StopRecording();
+		else if (m_ReplayMode == ReplayMode::Playing)
+			StopPlayback(false);
+		break;
+	default:
+		break;
+	}
+}
+
+void Application::StartRecording()
+{
+	m_Replay.Frames.clear();
+	m_Replay.FixedTimeStep = 1.0f / 60.0f;
+	m_ReplayMode = ReplayMode::Recording;
+	m_GameTimer.SetFixedTimeStep(m_Replay.FixedTimeStep);
+	m_Renderer->ResetSimulation();
+}
+
+void Application::StopRecording()
+{
+	m_ReplayMode = ReplayMode::Live;
+	m_GameTimer.SetFixedTimeStep(0.0f);
+
+	if (SaveReplay(m_ReplayPath, m_Replay))
+		m_Renderer->SetReplayStatus("Saved " + std::to_string(m_Replay.Frames.size()) + " frames to " + m_ReplayPath);
+	else
+		m_Renderer->SetReplayStatus("Could not write " + m_ReplayPath);
+}
+
+void Application::StopPlayback(bool completed)
+{
+	m_ReplayMode = ReplayMode::Live;
+	m_GameTimer.SetFixedTimeStep(0.0f);
+
+	if (!completed)
+	{
+		m_Renderer->SetReplayStatus("Playback stopped at frame " + std::to_string(m_ReplayFrame));
+		return;
+	}
+
+	std::vector<std::pair<std::string, std::string>> context = {
+		{ "replay", m_ReplayPath },
+		{ "frames", std::to_string(m_Replay.Frames.size()) },
+		{ "fixed_time_step", std::to_string(m_Replay.FixedTimeStep) },
+		{ "vsync", m_Window->IsVSync() ? "on" : "off" },
+	};
+	if (m_ReplayReport.WriteJson(m_ReplayReportPath, context))
+		m_Renderer->SetReplayStatus("Report written to " + m_ReplayReportPath);
+	else
+		m_Renderer->SetReplayStatus("Could not write " + m_ReplayReportPath);
+
+	if (m_ExitAfterReplay)
+		m_Running = false;
+}
+
+void Application::BeginReplayFrame()
+{
+	if (m_ReplayMode != ReplayMode::Playing)
+	{
+		m_FrameSeed = m_SeedSource();
+		m_Renderer->SetFrameSeed(m_FrameSeed);
+		return;
+	}
+
+	const ReplayFrame& frame = m_Replay.Frames[m_ReplayFrame];
+	Camera& camera = m_Window->GetCamera();
+	camera.SetPosition(frame.Camera.Position);
+	camera.SetBasis(frame.Camera.Right, frame.Camera.Up, frame.Camera.Look);
+	camera.UpdateViewMatrix();
+	m_Renderer->SetFrameSeed(frame.Seed);
+}
+
+void Application::ApplyReplayFrameParameters()
+{
+	// Applied where the UI would have changed them while recording: after the update, before
+	// the draw that regenerates the terrain.
+	if (m_ReplayMode == ReplayMode::Playing)
+		m_Renderer->ApplyReplayParameters(m_Replay.Frames[m_ReplayFrame].Parameters);
+}
+
+void Application::EndReplayFrame()
+{
+	int64_t now = Profiler::NowNs();
+	double intervalMs = m_LastFrameEndNs ? (now - m_LastFrameEndNs) / 1e6 : 0.0;
+	m_LastFrameEndNs = now;
+
+	if (m_ReplayMode == ReplayMode::Recording)
+	{
+		const Camera& camera = m_Window->GetCamera();
+		ReplayFrame frame;
+		frame.Camera.Position = camera.GetPosition3f();
+		frame.Camera.Right = camera.GetRight3f();
+		frame.Camera.Up = camera.GetUp3f();
+		frame.Camera.Look = camera.GetLook3f();
+		frame.Seed = m_FrameSeed;
+		frame.Parameters = m_Renderer->GetReplayParameters();
+		m_Replay.Frames.push_back(frame);
+		m_Renderer->SetReplayStatus("Recording: " + std::to_string(m_Replay.Frames.size()) + " frames");
+	}
+	else if (m_ReplayMode == ReplayMode::Playing)
+	{
+		m_ReplayReport.AddFrame(intervalMs, m_Renderer->LastCpuFrameMs(), m_Renderer->LastGpuFrameMs());
+		m_ReplayFrame++;
+		m_Renderer->SetReplayStatus("Playing: frame " + std::to_string(m_ReplayFrame) + " of " + std::to_string(m_Replay.Frames.size()));
+		if (m_ReplayFrame == m_Replay.Frames.size())
+			StopPlayback(true);
+	}
+}
+
 bool Application::OnWindowClose(WindowCloseEvent& event)
 {
 	m_Running = false;
@@ -2,13 +2,15 @@
 #include <memory>
 #include <Windows.h>
 
-#include "Events/Event.h"
+#include "Events/EventBus.h"
 #include "Events/ApplicationEvent.h"
 #include "Events/MouseEvent.h"
 #include "Window.h"
 #include "Renderer/Renderer.h"
 #include "Camera.h"
 #include "Utils/GameTimer.h"
+#include "Utils/Replay.h"
+#include <random>
 
 class Application
 {
@@ -17,8 +19,6 @@ public:
 	virtual ~Application();
 
 	int Run();
-	
-	void OnEvent(Event& event);
 
 	inline static Application& Get() { return *s_Instance; }
 
@@ -28,11 +28,31 @@ public:
 	
 	inline Camera& GetCamera() { return m_Camera; }
 
+	// Plays a recorded camera path at its fixed time step and writes the frame-time report to
+	// reportPath when it ends, optionally closing the application afterwards.
+	bool PlayReplay(const std::string& path, const std::string& reportPath, bool exitWhenDone);
+
 	GameTimer m_GameTimer;
 private:
 	bool m_Running = true;
 	bool OnWindowClose(WindowCloseEvent& event);
 
+	enum class ReplayMode
+	{
+		Live,
+		Recording,
+		Playing
+	};
+
+	void OnReplayCommand(ReplayCommand command);
+	void StartRecording();
+	void StopRecording();
+	void StopPlayback(bool completed);
+	void BeginReplayFrame();
+	void ApplyReplayFrameParameters();
+	void EndReplayFrame();
+
+	EventBus m_Events;
 	std::unique_ptr<Window> m_Window;
 	HWND m_Hwnd;
 
@@ -40,4 +60,15 @@ private:
 	static Application* s_Instance;
 
 	Camera m_Camera;
+
+	ReplayMode m_ReplayMode = ReplayMode::Live;
+	ReplayFile m_Replay;
+	size_t m_ReplayFrame = 0;
+	uint32_t m_FrameSeed = 0;
+	std::mt19937 m_SeedSource;
+	std::string m_ReplayPath = "replay.aqr";
+	std::string m_ReplayReportPath = "replay_report.json";
+	bool m_ExitAfterReplay = false;
+	FrameTimeReport m_ReplayReport;
+	int64_t m_LastFrameEndNs = 0;
 };
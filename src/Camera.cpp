@@ -38,6 +38,14 @@ void Camera::SetPosition(const XMFLOAT3& v)
 	mViewDirty = true;
 }
 
+void Camera::SetBasis(const XMFLOAT3& right, const XMFLOAT3& up, const XMFLOAT3& look)
+{
+	mRight = right;
+	mUp = up;
+	mLook = look;
+	mViewDirty = true;
+}
+
 XMVECTOR Camera::GetRight()const
 {
 	return XMLoadFloat3(&mRight);
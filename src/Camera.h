@@ -14,6 +14,9 @@ public:
 	void SetPosition(float x, float y, float z);
 	void SetPosition(const DirectX::XMFLOAT3& v);
 
+	// Set the camera basis directly; the vectors must be orthonormal.
+	void SetBasis(const DirectX::XMFLOAT3& right, const DirectX::XMFLOAT3& up, const DirectX::XMFLOAT3& look);
+
 	// Get camera basis vectors.
 	DirectX::XMVECTOR GetRight()const;
 	DirectX::XMFLOAT3 GetRight3f()const;
@@ -23,7 +23,7 @@ enum EventCategory
 	EventCategoryMouseButton = BIT(4)
 };
 
-#define EVENT_CLASS_TYPE(type) static EventType GetStaticType() {return EventType::##type;} virtual EventType GetEventType() const override { return GetStaticType(); } virtual const char* GetName() const override { return #type; }
+#define EVENT_CLASS_TYPE(type) static EventType GetStaticType() {return EventType::type;} virtual EventType GetEventType() const override { return GetStaticType(); } virtual const char* GetName() const override { return #type; }
 
 #define EVENT_CLASS_CATEGORY(category) virtual int GetCategoryFlags() const override { return category; }
 
@@ -47,9 +47,6 @@ public:
 
 class EventDispatcher
 {
-	template<typename T>
-	using EventFn = std::function<bool(T&)>;
-
 public:
 	EventDispatcher(Event& event)
 		:
@@ -57,8 +54,9 @@ public:
 	{
 	}
 
-	template<typename T>
-		bool Dispatch(EventFn<T> func)
+	// func is any callable taking T&; it is called in place rather than wrapped.
+	template<typename T, typename F>
+		bool Dispatch(const F& func)
 		{
 			if (m_Event.GetEventType() == T::GetStaticType())
 			{
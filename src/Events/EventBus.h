@@ -0,0 +1,192 @@
+#pragma once
+#include "Event.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+constexpr size_t EventTypeCount = (size_t)EventType::MouseScrolled + 1;
+
+// Non-owning reference to a handler: an object pointer and a plain function pointer that casts
+// the event back to its type. Binding allocates nothing; the object must outlive it.
+class EventHandler
+{
+public:
+	EventHandler() = default;
+
+	template<typename T, auto Method, typename Owner>
+	static EventHandler Bind(Owner* owner)
+	{
+		return EventHandler(owner, [](void* object, Event& event) { return (static_cast<Owner*>(object)->*Method)(static_cast<T&>(event)); });
+	}
+
+	template<typename T, typename F>
+	static EventHandler BindCallable(F& callable)
+	{
+		return EventHandler(&callable, [](void* object, Event& event) { return (*static_cast<F*>(object))(static_cast<T&>(event)); });
+	}
+
+	bool operator()(Event& event) const { return m_Thunk(m_Object, event); }
+
+private:
+	using Thunk = bool(*)(void*, Event&);
+
+	EventHandler(void* object, Thunk thunk) : m_Object(object), m_Thunk(thunk) {}
+
+	void* m_Object = nullptr;
+	Thunk m_Thunk = nullptr;
+};
+
+// Handlers indexed by event type, and a queue of events posted while messages are pumped and
+// dispatched together once per frame. Neither subscribing nor dispatching allocates: handlers
+// live in fixed arrays and queued events in a fixed ring.
+class EventBus
+{
+public:
+	static constexpr size_t MaxHandlersPerType = 4;
+	static constexpr size_t QueueCapacity = 256;
+	static constexpr size_t MaxEventSize = 32;
+
+	// e.g. Subscribe<WindowCloseEvent, &Application::OnWindowClose>(this). A handler returns
+	// true when it handled the event, which stops the handlers after it. Throws
+	// std::length_error past MaxHandlersPerType handlers for one type.
+	template<typename T, auto Method, typename Owner>
+	void Subscribe(Owner* owner)
+	{
+		Add(T::GetStaticType(), EventHandler::Bind<T, Method>(owner));
+	}
+
+	// A lambda or other callable, which must outlive the bus.
+	template<typename T, typename F>
+	void Subscribe(F& callable)
+	{
+		Add(T::GetStaticType(), EventHandler::BindCallable<T>(callable));
+	}
+
+	// Dispatches right away, for events that cannot wait for the end of the message pump. The
+	// handler list is picked at compile time; the overload below looks it up from the event.
+	template<typename T>
+	bool Send(T& event)
+	{
+		return Dispatch((size_t)T::GetStaticType(), event);
+	}
+
+	bool Send(Event& event)
+	{
+		return Dispatch((size_t)event.GetEventType(), event);
+	}
+
+	// Queues a copy for the next Drain. A mouse move replaces a mouse move queued directly
+	// before it, so a burst of movement between frames costs one dispatch.
+	//
+	// Posting to a full queue drains it first. Inside a handler that would break the order, but
+	// an event leaves the queue before its handlers run, so the queue is only full there when
+	// handlers have posted QueueCapacity events that are still waiting. The event is then sent
+	// at once, ahead of those, and counted in OverflowSends().
+	template<typename T>
+	void Post(const T& event)
+	{
+		static_assert(sizeof(T) <= MaxEventSize && alignof(T) <= alignof(std::max_align_t), "event does not fit a queue slot");
+		static_assert(std::is_trivially_destructible_v<T>, "queued events are never destroyed");
+
+		if (T::GetStaticType() == EventType::MouseMoved && !m_Draining && m_QueueCount > 0
+			&& Slot(m_QueueCount - 1).Queued->GetEventType() == EventType::MouseMoved)
+		{
+			QueuedEvent& last = Slot(m_QueueCount - 1);
+			last.Queued = new (last.Storage) T(event);
+			last.CopyTo = &CopyEvent<T>;
+			return;
+		}
+
+		if (m_QueueCount == QueueCapacity)
+		{
+			if (m_Draining)
+			{
+				m_OverflowSends++;
+				T copy = event;
+				Send(copy);
+				return;
+			}
+			Drain();
+		}
+
+		QueuedEvent& slot = Slot(m_QueueCount++);
+		slot.Queued = new (slot.Storage) T(event);
+		slot.CopyTo = &CopyEvent<T>;
+	}
+
+	// Dispatches the queued events in the order they were posted, including any that handlers
+	// post meanwhile. Call once per frame; a call from inside a handler does nothing, as the
+	// running Drain dispatches everything anyway.
+	void Drain()
+	{
+		if (m_Draining)
+			return;
+
+		m_Draining = true;
+		while (m_QueueCount > 0)
+		{
+			// Copied out first, so its slot is free again while the handlers run.
+			QueuedEvent& slot = m_Queue[m_QueueHead];
+			Event* event = slot.CopyTo(m_Dispatching, *slot.Queued);
+			m_QueueHead = (m_QueueHead + 1) % QueueCapacity;
+			m_QueueCount--;
+			Send(*event);
+		}
+		m_Draining = false;
+	}
+
+	size_t Pending() const { return m_QueueCount; }
+	uint64_t OverflowSends() const { return m_OverflowSends; }
+
+private:
+	struct HandlerList
+	{
+		std::array<EventHandler, MaxHandlersPerType> Handlers;
+		size_t Count = 0;
+	};
+
+	using CopyFn = Event* (*)(void* to, const Event& from);
+
+	struct QueuedEvent
+	{
+		alignas(std::max_align_t) unsigned char Storage[MaxEventSize];
+		Event* Queued = nullptr;
+		CopyFn CopyTo = nullptr;
+	};
+
+	template<typename T>
+	static Event* CopyEvent(void* to, const Event& from)
+	{
+		return new (to) T(static_cast<const T&>(from));
+	}
+
+	// The index-th queued event, oldest first.
+	QueuedEvent& Slot(size_t index) { return m_Queue[(m_QueueHead + index) % QueueCapacity]; }
+
+	bool Dispatch(size_t type, Event& event)
+	{
+		const HandlerList& list = m_Handlers[type];
+		for (size_t i = 0; i < list.Count && !event.Handled; i++)
+			event.Handled = list.Handlers[i](event);
+		return event.Handled;
+	}
+
+	void Add(EventType type, EventHandler handler)
+	{
+		HandlerList& list = m_Handlers[(size_t)type];
+		if (list.Count == MaxHandlersPerType)
+			throw std::length_error("EventBus: too many handlers for one event type; raise MaxHandlersPerType");
+		list.Handlers[list.Count++] = handler;
+	}
+
+	std::array<HandlerList, EventTypeCount> m_Handlers;
+	std::array<QueuedEvent, QueueCapacity> m_Queue;
+	alignas(std::max_align_t) unsigned char m_Dispatching[MaxEventSize];
+	size_t m_QueueHead = 0;
+	size_t m_QueueCount = 0;
+	uint64_t m_OverflowSends = 0;
+	bool m_Draining = false;
+};
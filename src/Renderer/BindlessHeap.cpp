@@ -0,0 +1,61 @@
+#include "BindlessHeap.h"
+
+BindlessHeap::BindlessHeap(ID3D12Device* device, UINT capacity)
+	: m_Device(device),
+	m_Allocator(capacity)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+	desc.NumDescriptors = capacity;
+	desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	desc.NodeMask = 0;
+	ThrowIfFailed(m_Device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(m_Heap.GetAddressOf())));
+	d3dSetDebugName(m_Heap.Get(), "BindlessHeap");
+
+	m_CpuStart = m_Heap->GetCPUDescriptorHandleForHeapStart();
+	m_GpuStart = m_Heap->GetGPUDescriptorHandleForHeapStart();
+	m_DescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+DescriptorHandle BindlessHeap::Allocate()
+{
+	DescriptorHandle handle = m_Allocator.Allocate();
+	if (!handle.IsValid())
+	{
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+	return handle;
+}
+
+DescriptorHandle BindlessHeap::CreateSrv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+	DescriptorHandle handle = Allocate();
+	m_Device->CreateShaderResourceView(resource, desc, CpuHandle(handle));
+	return handle;
+}
+
+void BindlessHeap::Free(DescriptorHandle handle, UINT64 fenceValue)
+{
+	m_Allocator.Free(handle, fenceValue);
+}
+
+void BindlessHeap::Free(D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle, UINT64 fenceValue)
+{
+	UINT index = (UINT)((gpuHandle.ptr - m_GpuStart.ptr) / m_DescriptorSize);
+	m_Allocator.Free(m_Allocator.HandleAt(index), fenceValue);
+}
+
+void BindlessHeap::CollectFrees(UINT64 completedFence)
+{
+	m_Allocator.CollectFrees(completedFence);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessHeap::CpuHandle(DescriptorHandle handle) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CpuStart, (INT)handle.Index, m_DescriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessHeap::GpuHandle(DescriptorHandle handle) const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_GpuStart, (INT)handle.Index, m_DescriptorSize);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+// The single shader-visible CBV/SRV/UAV heap. It is bound once per frame and shaders index
+// it directly with DescriptorHandle::Index (see Shaders/DescriptorHeap.hlsl).
+class BindlessHeap
+{
+public:
+	BindlessHeap(ID3D12Device* device, UINT capacity);
+	BindlessHeap(const BindlessHeap& rhs) = delete;
+	BindlessHeap& operator=(const BindlessHeap& rhs) = delete;
+
+	DescriptorHandle Allocate();
+	DescriptorHandle CreateSrv(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+
+	// The slot is recycled once the direct queue fence reaches fenceValue.
+	void Free(DescriptorHandle handle, UINT64 fenceValue);
+	void Free(D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle, UINT64 fenceValue);
+	void CollectFrees(UINT64 completedFence);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(DescriptorHandle handle) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(DescriptorHandle handle) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuStart() const { return m_GpuStart; }
+
+	ID3D12DescriptorHeap* Heap() const { return m_Heap.Get(); }
+	const DescriptorAllocator& Allocator() const { return m_Allocator; }
+
+private:
+	ID3D12Device* m_Device = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_CpuStart = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE m_GpuStart = {};
+	UINT m_DescriptorSize = 0;
+
+	DescriptorAllocator m_Allocator;
+};
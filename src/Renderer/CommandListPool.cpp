@@ -0,0 +1,48 @@
+#include "CommandListPool.h"
+
+CommandListPool::CommandListPool(ID3D12Device* device)
+	: m_Device(device)
+{
+}
+
+void CommandListPool::BeginFrame(ID3D12DescriptorHeap* descriptorHeap)
+{
+	m_Used = 0;
+	m_DescriptorHeap = descriptorHeap;
+}
+
+ID3D12GraphicsCommandList* CommandListPool::AcquireList()
+{
+	if (m_Used == m_Entries.size())
+	{
+		Entry entry;
+		ThrowIfFailed(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(entry.Allocator.GetAddressOf())));
+		ThrowIfFailed(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, entry.Allocator.Get(), nullptr, IID_PPV_ARGS(entry.List.GetAddressOf())));
+		ThrowIfFailed(entry.List->Close());
+		m_Entries.push_back(std::move(entry));
+	}
+
+	Entry& entry = m_Entries[m_Used++];
+	ThrowIfFailed(entry.Allocator->Reset());
+	ThrowIfFailed(entry.List->Reset(entry.Allocator.Get(), nullptr));
+
+	// Changing heaps can flush the GPU's descriptor caches, so each list binds it only once.
+	if (m_DescriptorHeap)
+		entry.List->SetDescriptorHeaps(1, &m_DescriptorHeap);
+	return entry.List.Get();
+}
+
+void CommandListPool::Close(void* list)
+{
+	ThrowIfFailed(((ID3D12GraphicsCommandList*)list)->Close());
+}
+
+void CommandListPool::Execute(ID3D12CommandQueue* queue)
+{
+	m_Submission.clear();
+	for (UINT i = 0; i < m_Used; i++)
+		m_Submission.push_back(m_Entries[i].List.Get());
+
+	if (!m_Submission.empty())
+		queue->ExecuteCommandLists((UINT)m_Submission.size(), m_Submission.data());
+}
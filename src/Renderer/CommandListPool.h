@@ -0,0 +1,42 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+#include "ParallelRecorder.h"
+
+// Direct command lists for one frame resource, each with its own allocator so they can be
+// recorded on different threads. Lists are handed out in submission order and all of them
+// go to the queue in a single ExecuteCommandLists call.
+class CommandListPool : public CommandListSource
+{
+public:
+	explicit CommandListPool(ID3D12Device* device);
+	CommandListPool(const CommandListPool& rhs) = delete;
+	CommandListPool& operator=(const CommandListPool& rhs) = delete;
+
+	// The frame that last used this pool must have finished on the GPU. Every list acquired
+	// this frame comes back with descriptorHeap already bound.
+	void BeginFrame(ID3D12DescriptorHeap* descriptorHeap);
+
+	ID3D12GraphicsCommandList* AcquireList();
+
+	void* Acquire() override { return AcquireList(); }
+	void Close(void* list) override;
+
+	// Every acquired list must be closed by now.
+	void Execute(ID3D12CommandQueue* queue);
+
+	UINT ListsUsed() const { return m_Used; }
+	UINT ListsCreated() const { return (UINT)m_Entries.size(); }
+
+private:
+	struct Entry
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> List;
+	};
+
+	ID3D12Device* m_Device = nullptr;
+	ID3D12DescriptorHeap* m_DescriptorHeap = nullptr;
+	std::vector<Entry> m_Entries;
+	UINT m_Used = 0;
+	std::vector<ID3D12CommandList*> m_Submission;
+};
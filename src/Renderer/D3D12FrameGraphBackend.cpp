@@ -0,0 +1,174 @@
+#include "D3D12FrameGraphBackend.h"
+#include "GpuPassTimer.h"
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+D3D12FrameGraphBackend::D3D12FrameGraphBackend(ID3D12Device* device)
+	: m_Device(device)
+{
+}
+
+void D3D12FrameGraphBackend::BeginFrame(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT64 completedFence)
+{
+	m_CommandList = cmdList;
+	m_FrameFence = frameFence;
+
+	m_Retired.erase(std::remove_if(m_Retired.begin(), m_Retired.end(),
+		[completedFence](const Retired& r) { return r.Fence <= completedFence; }), m_Retired.end());
+}
+
+D3D12_RESOURCE_STATES D3D12FrameGraphBackend::ToD3D12(FgState state)
+{
+	D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_COMMON;
+	if (HasAnyState(state, FgState::Present))                result |= D3D12_RESOURCE_STATE_PRESENT;
+	if (HasAnyState(state, FgState::RenderTarget))           result |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	if (HasAnyState(state, FgState::DepthWrite))             result |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	if (HasAnyState(state, FgState::DepthRead))              result |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	if (HasAnyState(state, FgState::PixelShaderResource))    result |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	if (HasAnyState(state, FgState::NonPixelShaderResource)) result |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	if (HasAnyState(state, FgState::UnorderedAccess))        result |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	if (HasAnyState(state, FgState::CopySource))             result |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	if (HasAnyState(state, FgState::CopyDest))               result |= D3D12_RESOURCE_STATE_COPY_DEST;
+	return result;
+}
+
+D3D12_RESOURCE_DESC D3D12FrameGraphBackend::ToResourceDesc(const FgTextureDesc& desc) const
+{
+	D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+	if (desc.RenderTarget)
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+	if (desc.DepthStencil)
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+	if (desc.UnorderedAccess)
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+	return CD3DX12_RESOURCE_DESC::Tex2D((DXGI_FORMAT)desc.Format, desc.Width, desc.Height, 1, 1, 1, 0, flags);
+}
+
+FgAllocationInfo D3D12FrameGraphBackend::GetAllocationInfo(const FgTextureDesc& desc)
+{
+	D3D12_RESOURCE_DESC resourceDesc = ToResourceDesc(desc);
+	D3D12_RESOURCE_ALLOCATION_INFO info = m_Device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+
+	FgAllocationInfo result;
+	result.Size = info.SizeInBytes;
+	result.Alignment = info.Alignment;
+	return result;
+}
+
+void D3D12FrameGraphBackend::Retire(ComPtr<ID3D12Pageable> object)
+{
+	if (object)
+		m_Retired.push_back({ m_FrameFence, std::move(object) });
+}
+
+void D3D12FrameGraphBackend::CreateTransients(uint64_t heapSize, const std::vector<FgPlacement>& placements, std::vector<void*>& outNatives)
+{
+	if (heapSize > m_HeapSize)
+	{
+		for (Transient& t : m_Transients)
+			Retire(std::move(t.Resource));
+		m_Transients.clear();
+		Retire(std::move(m_Heap));
+
+		CD3DX12_HEAP_DESC heapDesc(heapSize, D3D12_HEAP_TYPE_DEFAULT, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+		ThrowIfFailed(m_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(m_Heap.GetAddressOf())));
+		d3dSetDebugName(m_Heap.Get(), "FrameGraph::TransientHeap");
+		d3dUtil::TrackGpuMemory(m_Heap.Get(), MemoryTag::FrameGraph);
+		m_HeapSize = heapSize;
+	}
+
+	if (m_Transients.size() > placements.size())
+	{
+		for (size_t i = placements.size(); i < m_Transients.size(); i++)
+			Retire(std::move(m_Transients[i].Resource));
+	}
+	m_Transients.resize(placements.size());
+
+	for (size_t i = 0; i < placements.size(); i++)
+	{
+		const FgPlacement& placement = placements[i];
+		Transient& t = m_Transients[i];
+
+		bool reusable = t.Resource && t.Offset == placement.Offset && t.Desc == placement.Desc;
+		if (!reusable)
+		{
+			Retire(std::move(t.Resource));
+
+			D3D12_RESOURCE_DESC resourceDesc = ToResourceDesc(placement.Desc);
+			t.Desc = placement.Desc;
+			t.Offset = placement.Offset;
+			t.State = placement.Desc.DepthStencil ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET;
+			ThrowIfFailed(m_Device->CreatePlacedResource(m_Heap.Get(), placement.Offset, &resourceDesc, t.State, nullptr, IID_PPV_ARGS(t.Resource.GetAddressOf())));
+		}
+
+		outNatives.push_back(t.Resource.Get());
+	}
+}
+
+void D3D12FrameGraphBackend::SubmitBarriers(const FgBarrier* barriers, const void* const* natives, const void* const* aliasNatives, size_t count)
+{
+	m_Barriers.clear();
+	m_Discards.clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const FgBarrier& b = barriers[i];
+		ID3D12Resource* resource = (ID3D12Resource*)natives[i];
+
+		if (b.BarrierType == FgBarrier::Type::Aliasing)
+		{
+			m_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing((ID3D12Resource*)aliasNatives[i], resource));
+			continue;
+		}
+
+		D3D12_RESOURCE_STATES after = ToD3D12(b.After);
+		D3D12_RESOURCE_STATES before = ToD3D12(b.Before);
+
+		Transient* transient = nullptr;
+		for (Transient& t : m_Transients)
+		{
+			if (t.Resource.Get() == resource)
+			{
+				transient = &t;
+				break;
+			}
+		}
+
+		// First use of a transient this frame: its real state is whatever it was left in,
+		// and its contents are undefined, so render and depth targets get discarded.
+		if (b.Before == FgState::Undefined)
+		{
+			if (transient)
+				before = transient->State;
+			if (HasAnyState(b.After, FgState::RenderTarget | FgState::DepthWrite))
+				m_Discards.push_back(resource);
+		}
+
+		if (transient)
+			transient->State = after;
+
+		if (before != after)
+			m_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after));
+	}
+
+	if (!m_Barriers.empty())
+		m_CommandList->ResourceBarrier((UINT)m_Barriers.size(), m_Barriers.data());
+
+	for (ID3D12Resource* resource : m_Discards)
+		m_CommandList->DiscardResource(resource, nullptr);
+}
+
+void D3D12FrameGraphBackend::BeginPass(const char* name)
+{
+	if (m_PassTimer)
+		m_PassTimer->BeginPass(m_CommandList, name);
+}
+
+void D3D12FrameGraphBackend::EndPass()
+{
+	// Passes that recorded on worker lists have moved m_CommandList on to the list after them.
+	if (m_PassTimer)
+		m_PassTimer->EndPass(m_CommandList);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+#include "FrameGraph.h"
+
+class GpuPassTimer;
+
+// Runs a FrameGraph on a D3D12 direct command list. Transient textures are placed resources
+// in one heap sized by the graph compiler; they are kept across frames and only recreated
+// when the compiled layout changes.
+//
+// Transient textures must be render targets or depth buffers, since the heap is created with
+// D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES to work on resource heap tier 1 hardware.
+class D3D12FrameGraphBackend : public FrameGraphBackend
+{
+public:
+	explicit D3D12FrameGraphBackend(ID3D12Device* device);
+	D3D12FrameGraphBackend(const D3D12FrameGraphBackend& rhs) = delete;
+	D3D12FrameGraphBackend& operator=(const D3D12FrameGraphBackend& rhs) = delete;
+
+	// frameFence is the fence value the frame being recorded will signal; heaps and
+	// resources replaced during it are released once completedFence catches up.
+	void BeginFrame(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT64 completedFence);
+
+	// Later barriers go to cmdList, for passes that continue the frame on a new list.
+	void SetCommandList(ID3D12GraphicsCommandList* cmdList) { m_CommandList = cmdList; }
+
+	// Every pass is timed on the GPU when a timer is set.
+	void SetPassTimer(GpuPassTimer* timer) { m_PassTimer = timer; }
+
+	static D3D12_RESOURCE_STATES ToD3D12(FgState state);
+
+	FgAllocationInfo GetAllocationInfo(const FgTextureDesc& desc) override;
+	void CreateTransients(uint64_t heapSize, const std::vector<FgPlacement>& placements, std::vector<void*>& outNatives) override;
+	void SubmitBarriers(const FgBarrier* barriers, const void* const* natives, const void* const* aliasNatives, size_t count) override;
+	void BeginPass(const char* name) override;
+	void EndPass() override;
+
+private:
+	struct Transient
+	{
+		FgTextureDesc Desc;
+		UINT64 Offset = 0;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+	};
+
+	struct Retired
+	{
+		UINT64 Fence = 0;
+		Microsoft::WRL::ComPtr<ID3D12Pageable> Object;
+	};
+
+	D3D12_RESOURCE_DESC ToResourceDesc(const FgTextureDesc& desc) const;
+	void Retire(Microsoft::WRL::ComPtr<ID3D12Pageable> object);
+
+	ID3D12Device* m_Device = nullptr;
+	ID3D12GraphicsCommandList* m_CommandList = nullptr;
+	GpuPassTimer* m_PassTimer = nullptr;
+	UINT64 m_FrameFence = 0;
+
+	Microsoft::WRL::ComPtr<ID3D12Heap> m_Heap;
+	UINT64 m_HeapSize = 0;
+	std::vector<Transient> m_Transients;
+	std::vector<Retired> m_Retired;
+
+	std::vector<D3D12_RESOURCE_BARRIER> m_Barriers;
+	std::vector<ID3D12Resource*> m_Discards;
+};
@@ -0,0 +1,264 @@
+#include "D3D12PipelineCache.h"
+#include "../Utils/JobSystem.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// The pipeline library is one blob, under a fixed key.
+	uint64_t PipelineLibraryKey()
+	{
+		CacheHasher hasher;
+		hasher.Add(std::string("D3D12PipelineLibrary"));
+		return hasher.Value();
+	}
+
+	// Runs fn(0) .. fn(count - 1), one index per job when there is a job system.
+	void ForEachRequest(JobSystem* jobs, uint32_t count, const std::function<void(uint32_t)>& fn)
+	{
+		if (jobs == nullptr)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				fn(i);
+			return;
+		}
+
+		jobs->ParallelFor(0, count, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; i++)
+					fn(i);
+			});
+	}
+
+	void HashBytecode(CacheHasher& hasher, const D3D12_SHADER_BYTECODE& bytecode)
+	{
+		hasher.AddValue((uint64_t)bytecode.BytecodeLength);
+		if (bytecode.BytecodeLength > 0)
+			hasher.Add(bytecode.pShaderBytecode, bytecode.BytecodeLength);
+	}
+
+	void HashStencilOp(CacheHasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		hasher.AddValue(op.StencilFailOp);
+		hasher.AddValue(op.StencilDepthFailOp);
+		hasher.AddValue(op.StencilPassOp);
+		hasher.AddValue(op.StencilFunc);
+	}
+}
+
+D3D12PipelineCache::D3D12PipelineCache(ID3D12Device* device, const std::filesystem::path& directory)
+	: m_Device(device), m_Index(directory)
+{
+	// Pipeline libraries need ID3D12Device1; without it only shaders are cached.
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(&m_Device1))))
+		return;
+
+	if (m_Index.Load(PipelineLibraryKey(), m_LibraryData))
+	{
+		// A library from another driver or adapter is rejected by the runtime; start over.
+		if (FAILED(m_Device1->CreatePipelineLibrary(m_LibraryData.data(), m_LibraryData.size(), IID_PPV_ARGS(&m_Library))))
+		{
+			m_Library.Reset();
+			m_LibraryData.clear();
+		}
+	}
+
+	if (!m_Library)
+	{
+		ThrowIfFailed(m_Device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_Library)));
+		m_LibraryDirty = true;
+	}
+}
+
+ComPtr<ID3DBlob> D3D12PipelineCache::CompileShader(const std::wstring& filename, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target)
+{
+	ShaderCompileRequest request;
+	request.Filename = filename;
+	for (const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define)
+		request.Defines.emplace_back(define->Name, define->Definition ? define->Definition : "");
+	request.EntryPoint = entrypoint;
+	request.Target = target;
+
+	return LoadOrCompile({ request }, nullptr)[0];
+}
+
+std::vector<ComPtr<ID3DBlob>> D3D12PipelineCache::CompileShaders(const std::vector<ShaderCompileRequest>& requests, JobSystem& jobs)
+{
+	return LoadOrCompile(requests, &jobs);
+}
+
+std::vector<ComPtr<ID3DBlob>> D3D12PipelineCache::LoadOrCompile(const std::vector<ShaderCompileRequest>& requests, JobSystem* jobs)
+{
+	std::vector<ComPtr<ID3DBlob>> blobs(requests.size());
+	std::vector<uint64_t> keys(requests.size());
+
+	// Hashing reads every source file, so it runs in parallel too; the index does not.
+	ForEachRequest(jobs, (uint32_t)requests.size(), [&](uint32_t i)
+		{
+			const ShaderCompileRequest& request = requests[i];
+			keys[i] = MakeShaderCacheKey(request.Filename, request.Defines, request.EntryPoint, request.Target, d3dUtil::ShaderCompileFlags());
+		});
+
+	std::vector<uint32_t> misses;
+	std::vector<uint8_t> cached;
+	for (uint32_t i = 0; i < (uint32_t)requests.size(); i++)
+	{
+		if (m_Index.Load(keys[i], cached))
+		{
+			ThrowIfFailed(D3DCreateBlob(cached.size(), &blobs[i]));
+			memcpy(blobs[i]->GetBufferPointer(), cached.data(), cached.size());
+			m_ShaderHits++;
+		}
+		else
+		{
+			misses.push_back(i);
+		}
+	}
+
+	ForEachRequest(jobs, (uint32_t)misses.size(), [&](uint32_t miss)
+		{
+			blobs[misses[miss]] = CompileUncached(requests[misses[miss]]);
+		});
+
+	for (uint32_t i : misses)
+	{
+		m_Index.Store(keys[i], blobs[i]->GetBufferPointer(), blobs[i]->GetBufferSize());
+		m_ShaderMisses++;
+	}
+
+	return blobs;
+}
+
+ComPtr<ID3DBlob> D3D12PipelineCache::CompileUncached(const ShaderCompileRequest& request)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const auto& define : request.Defines)
+		macros.push_back({ define.first.c_str(), define.second.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	return d3dUtil::CompileShader(request.Filename, macros.data(), request.EntryPoint, request.Target);
+}
+
+uint64_t D3D12PipelineCache::HashPipelineDesc(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	// Field by field, since several of the state structs have padding. The runtime checks
+	// the full description again when loading, so a collision here only costs a rebuild.
+	CacheHasher hasher;
+	hasher.Add(name);
+
+	HashBytecode(hasher, desc.VS);
+	HashBytecode(hasher, desc.PS);
+	HashBytecode(hasher, desc.DS);
+	HashBytecode(hasher, desc.HS);
+	HashBytecode(hasher, desc.GS);
+
+	hasher.AddValue(desc.BlendState.AlphaToCoverageEnable);
+	hasher.AddValue(desc.BlendState.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& rt : desc.BlendState.RenderTarget)
+	{
+		hasher.AddValue(rt.BlendEnable);
+		hasher.AddValue(rt.LogicOpEnable);
+		hasher.AddValue(rt.SrcBlend);
+		hasher.AddValue(rt.DestBlend);
+		hasher.AddValue(rt.BlendOp);
+		hasher.AddValue(rt.SrcBlendAlpha);
+		hasher.AddValue(rt.DestBlendAlpha);
+		hasher.AddValue(rt.BlendOpAlpha);
+		hasher.AddValue(rt.LogicOp);
+		hasher.AddValue(rt.RenderTargetWriteMask);
+	}
+
+	hasher.AddValue(desc.SampleMask);
+	hasher.AddValue(desc.RasterizerState);
+
+	const D3D12_DEPTH_STENCIL_DESC& ds = desc.DepthStencilState;
+	hasher.AddValue(ds.DepthEnable);
+	hasher.AddValue(ds.DepthWriteMask);
+	hasher.AddValue(ds.DepthFunc);
+	hasher.AddValue(ds.StencilEnable);
+	hasher.AddValue(ds.StencilReadMask);
+	hasher.AddValue(ds.StencilWriteMask);
+	HashStencilOp(hasher, ds.FrontFace);
+	HashStencilOp(hasher, ds.BackFace);
+
+	for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hasher.Add(std::string(element.SemanticName));
+		hasher.AddValue(element.SemanticIndex);
+		hasher.AddValue(element.Format);
+		hasher.AddValue(element.InputSlot);
+		hasher.AddValue(element.AlignedByteOffset);
+		hasher.AddValue(element.InputSlotClass);
+		hasher.AddValue(element.InstanceDataStepRate);
+	}
+
+	hasher.AddValue(desc.IBStripCutValue);
+	hasher.AddValue(desc.PrimitiveTopologyType);
+	hasher.AddValue(desc.NumRenderTargets);
+	for (DXGI_FORMAT format : desc.RTVFormats)
+		hasher.AddValue(format);
+	hasher.AddValue(desc.DSVFormat);
+	hasher.AddValue(desc.SampleDesc);
+	hasher.AddValue(desc.NodeMask);
+	hasher.AddValue(desc.Flags);
+
+	return hasher.Value();
+}
+
+ComPtr<ID3D12PipelineState> D3D12PipelineCache::CreateGraphicsPipeline(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	std::string key = CacheKeyToString(HashPipelineDesc(name, desc));
+	std::wstring libraryName(key.begin(), key.end());
+
+	ComPtr<ID3D12PipelineState> pso;
+	if (m_Library && SUCCEEDED(m_Library->LoadGraphicsPipeline(libraryName.c_str(), &desc, IID_PPV_ARGS(&pso))))
+	{
+		m_PipelineHits++;
+	}
+	else
+	{
+		ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+		m_PipelineMisses++;
+		m_LibraryDirty = true;
+	}
+
+	m_Pipelines[name] = { libraryName, pso };
+	return pso;
+}
+
+void D3D12PipelineCache::Save()
+{
+	if (m_Device1 && m_LibraryDirty)
+	{
+		// A library cannot replace or drop entries, so write a fresh one with exactly the
+		// pipelines used this run.
+		ComPtr<ID3D12PipelineLibrary> library;
+		ThrowIfFailed(m_Device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library)));
+		for (const auto& [name, pipeline] : m_Pipelines)
+		{
+			// Two requests with the same description share one entry.
+			HRESULT hr = library->StorePipeline(pipeline.first.c_str(), pipeline.second.Get());
+			if (hr != E_INVALIDARG)
+				ThrowIfFailed(hr);
+		}
+
+		std::vector<uint8_t> data(library->GetSerializedSize());
+		ThrowIfFailed(library->Serialize(data.data(), data.size()));
+		m_Index.Store(PipelineLibraryKey(), data.data(), data.size());
+		m_LibraryDirty = false;
+	}
+
+	m_Index.Save();
+}
+
+D3D12PipelineCache::Stats D3D12PipelineCache::GetStats() const
+{
+	Stats stats;
+	stats.ShaderHits = m_ShaderHits;
+	stats.ShaderMisses = m_ShaderMisses;
+	stats.PipelineHits = m_PipelineHits;
+	stats.PipelineMisses = m_PipelineMisses;
+	stats.Rejected = m_Index.Rejected();
+	return stats;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+
+class JobSystem;
+
+struct ShaderCompileRequest
+{
+	std::wstring Filename;
+	ShaderDefines Defines;
+	std::string EntryPoint;
+	std::string Target;
+};
+
+// Shader bytecode and pipeline state cache kept on disk between runs. Shaders are stored as
+// blobs keyed by their sources and compile options; pipelines go into one
+// ID3D12PipelineLibrary, named by a hash of their description. Anything that fails to load
+// or no longer matches is rebuilt and replaced.
+class D3D12PipelineCache
+{
+public:
+	D3D12PipelineCache(ID3D12Device* device, const std::filesystem::path& directory);
+	D3D12PipelineCache(const D3D12PipelineCache& rhs) = delete;
+	D3D12PipelineCache& operator=(const D3D12PipelineCache& rhs) = delete;
+
+	Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(const std::wstring& filename, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target);
+
+	// Returns one blob per request, in order. Cached shaders are loaded; the rest are compiled
+	// as jobs.
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> CompileShaders(const std::vector<ShaderCompileRequest>& requests, JobSystem& jobs);
+
+	// Compiles without going through the cache, so it can run on any thread.
+	static Microsoft::WRL::ComPtr<ID3DBlob> CompileUncached(const ShaderCompileRequest& request);
+
+	// Creating a pipeline under a name already used replaces the earlier one in the library.
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipeline(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// Writes out the pipeline library, if any pipeline had to be created, and the index.
+	void Save();
+
+	struct Stats
+	{
+		uint32_t ShaderHits = 0;
+		uint32_t ShaderMisses = 0;
+		uint32_t PipelineHits = 0;
+		uint32_t PipelineMisses = 0;
+		uint32_t Rejected = 0;
+	};
+
+	Stats GetStats() const;
+
+private:
+	// Without a job system everything runs on the calling thread.
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> LoadOrCompile(const std::vector<ShaderCompileRequest>& requests, JobSystem* jobs);
+
+	static uint64_t HashPipelineDesc(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	ID3D12Device* m_Device = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Device1> m_Device1;
+
+	ShaderCacheIndex m_Index;
+
+	// The library reads from this memory for as long as it exists.
+	std::vector<uint8_t> m_LibraryData;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_Library;
+	bool m_LibraryDirty = false;
+
+	// The latest pipeline handed out under each name, so Save() can rebuild the library
+	// without the ones that are no longer used.
+	std::unordered_map<std::string, std::pair<std::wstring, Microsoft::WRL::ComPtr<ID3D12PipelineState>>> m_Pipelines;
+
+	uint32_t m_ShaderHits = 0;
+	uint32_t m_ShaderMisses = 0;
+	uint32_t m_PipelineHits = 0;
+	uint32_t m_PipelineMisses = 0;
+};
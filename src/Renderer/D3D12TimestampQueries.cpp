@@ -0,0 +1,59 @@
+#include "D3D12TimestampQueries.h"
+#include <cstring>
+
+D3D12TimestampQueries::D3D12TimestampQueries(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t queryCount)
+	: m_Queue(queue)
+{
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = queryCount;
+	ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(m_Heap.GetAddressOf())));
+	d3dSetDebugName(m_Heap.Get(), "D3D12TimestampQueries::Heap");
+
+	CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer((UINT64)queryCount * sizeof(uint64_t));
+	ThrowIfFailed(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_Readback.GetAddressOf())));
+	d3dSetDebugName(m_Readback.Get(), "D3D12TimestampQueries::Readback");
+	d3dUtil::TrackGpuMemory(m_Readback.Get(), MemoryTag::Profiling);
+
+	ThrowIfFailed(m_Queue->GetTimestampFrequency(&m_Frequency));
+
+	LARGE_INTEGER cpuFrequency;
+	QueryPerformanceFrequency(&cpuFrequency);
+	m_CpuFrequency = (uint64_t)cpuFrequency.QuadPart;
+}
+
+void D3D12TimestampQueries::WriteTimestamp(void* list, uint32_t query)
+{
+	((ID3D12GraphicsCommandList*)list)->EndQuery(m_Heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void D3D12TimestampQueries::Resolve(void* list, uint32_t first, uint32_t count)
+{
+	((ID3D12GraphicsCommandList*)list)->ResolveQueryData(m_Heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count,
+		m_Readback.Get(), (UINT64)first * sizeof(uint64_t));
+}
+
+void D3D12TimestampQueries::ReadResults(uint32_t first, uint32_t count, uint64_t* ticks)
+{
+	D3D12_RANGE readRange = { (SIZE_T)first * sizeof(uint64_t), (SIZE_T)(first + count) * sizeof(uint64_t) };
+	void* mapped = nullptr;
+	ThrowIfFailed(m_Readback->Map(0, &readRange, &mapped));
+	std::memcpy(ticks, (const BYTE*)mapped + readRange.Begin, (size_t)count * sizeof(uint64_t));
+
+	D3D12_RANGE writeRange = { 0, 0 };
+	m_Readback->Unmap(0, &writeRange);
+}
+
+bool D3D12TimestampQueries::Calibrate(uint64_t& gpuTicks, int64_t& cpuNs)
+{
+	// The CPU side is a QueryPerformanceCounter value, which is also what steady_clock, and so
+	// Profiler::NowNs(), counts on Windows.
+	uint64_t cpuTicks = 0;
+	if (FAILED(m_Queue->GetClockCalibration(&gpuTicks, &cpuTicks)))
+		return false;
+
+	cpuNs = (int64_t)((cpuTicks / m_CpuFrequency) * 1000000000ull + (cpuTicks % m_CpuFrequency) * 1000000000ull / m_CpuFrequency);
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+#include "GpuPassTimer.h"
+
+// Timestamp query heap and readback buffer for GpuPassTimer, on a direct queue.
+class D3D12TimestampQueries : public TimestampQuerySource
+{
+public:
+	D3D12TimestampQueries(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t queryCount);
+	D3D12TimestampQueries(const D3D12TimestampQueries& rhs) = delete;
+	D3D12TimestampQueries& operator=(const D3D12TimestampQueries& rhs) = delete;
+
+	void WriteTimestamp(void* list, uint32_t query) override;
+	void Resolve(void* list, uint32_t first, uint32_t count) override;
+	void ReadResults(uint32_t first, uint32_t count, uint64_t* ticks) override;
+	uint64_t TicksPerSecond() const override { return m_Frequency; }
+	bool Calibrate(uint64_t& gpuTicks, int64_t& cpuNs) override;
+
+private:
+	ID3D12CommandQueue* m_Queue = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_Heap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_Readback;
+	uint64_t m_Frequency = 1;
+	uint64_t m_CpuFrequency = 1;
+};
@@ -0,0 +1,75 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t capacity)
+	: m_Generations(capacity, 0),
+	m_Alive(capacity, 0)
+{
+	// Hand out low indices first.
+	m_FreeList.reserve(capacity);
+	for (uint32_t n = capacity; n > 0; n--)
+		m_FreeList.push_back(n - 1);
+}
+
+DescriptorHandle DescriptorAllocator::Allocate()
+{
+	if (m_FreeList.empty())
+		return DescriptorHandle();
+
+	uint32_t index = m_FreeList.back();
+	m_FreeList.pop_back();
+
+	m_Alive[index] = 1;
+	m_AllocatedCount++;
+	m_HighWaterMark = std::max(m_HighWaterMark, m_AllocatedCount);
+
+	DescriptorHandle handle;
+	handle.Index = index;
+	handle.Generation = m_Generations[index];
+	return handle;
+}
+
+void DescriptorAllocator::Free(DescriptorHandle handle, uint64_t fenceValue)
+{
+	if (!IsAlive(handle))
+		return;
+
+	assert(m_PendingFrees.empty() || m_PendingFrees.back().Fence <= fenceValue);
+
+	// Bump the generation right away so the old handle is rejected even while the slot
+	// is still waiting for the GPU.
+	m_Alive[handle.Index] = 0;
+	m_Generations[handle.Index]++;
+	m_AllocatedCount--;
+
+	m_PendingFrees.push_back({ fenceValue, handle.Index });
+}
+
+void DescriptorAllocator::CollectFrees(uint64_t completedFence)
+{
+	while (!m_PendingFrees.empty() && m_PendingFrees.front().Fence <= completedFence)
+	{
+		m_FreeList.push_back(m_PendingFrees.front().Index);
+		m_PendingFrees.pop_front();
+	}
+}
+
+bool DescriptorAllocator::IsAlive(DescriptorHandle handle) const
+{
+	if (!handle.IsValid() || handle.Index >= m_Generations.size())
+		return false;
+
+	return m_Alive[handle.Index] && m_Generations[handle.Index] == handle.Generation;
+}
+
+DescriptorHandle DescriptorAllocator::HandleAt(uint32_t index) const
+{
+	if (index >= m_Generations.size() || !m_Alive[index])
+		return DescriptorHandle();
+
+	DescriptorHandle handle;
+	handle.Index = index;
+	handle.Generation = m_Generations[index];
+	return handle;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Stable handle to a slot in a descriptor heap. Index is the value shaders use to index
+// the heap directly; Generation changes every time the slot is freed, so a handle that
+// outlived its descriptor can be detected on the CPU.
+struct DescriptorHandle
+{
+	static constexpr uint32_t InvalidIndex = 0xffffffffu;
+
+	uint32_t Index = InvalidIndex;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Index != InvalidIndex; }
+
+	bool operator==(const DescriptorHandle& rhs) const { return Index == rhs.Index && Generation == rhs.Generation; }
+	bool operator!=(const DescriptorHandle& rhs) const { return !(*this == rhs); }
+};
+
+// Free-list allocator over a fixed number of descriptor slots. It knows nothing about
+// D3D12 so it can be exercised on any platform.
+//
+// Frees are deferred: a freed slot is only handed out again once the fence value it was
+// freed at has been reported complete through CollectFrees, because frames still in
+// flight may be reading the descriptor.
+class DescriptorAllocator
+{
+public:
+	explicit DescriptorAllocator(uint32_t capacity);
+
+	// Returns an invalid handle when the heap is full.
+	DescriptorHandle Allocate();
+
+	// Stale or invalid handles are ignored.
+	void Free(DescriptorHandle handle, uint64_t fenceValue);
+
+	// Recycles every slot freed at or before completedFence.
+	void CollectFrees(uint64_t completedFence);
+
+	bool IsAlive(DescriptorHandle handle) const;
+
+	// Handle currently occupying index, for APIs that only hand back raw heap offsets.
+	DescriptorHandle HandleAt(uint32_t index) const;
+
+	uint32_t Capacity() const { return (uint32_t)m_Generations.size(); }
+	uint32_t AllocatedCount() const { return m_AllocatedCount; }
+	uint32_t PendingFreeCount() const { return (uint32_t)m_PendingFrees.size(); }
+	uint32_t HighWaterMark() const { return m_HighWaterMark; }
+
+private:
+	struct PendingFree
+	{
+		uint64_t Fence = 0;
+		uint32_t Index = 0;
+	};
+
+	std::vector<uint32_t> m_Generations;
+	std::vector<uint8_t> m_Alive;
+	std::vector<uint32_t> m_FreeList;
+
+	// Fence values only grow, so pending frees retire in FIFO order.
+	std::deque<PendingFree> m_PendingFrees;
+
+	uint32_t m_AllocatedCount = 0;
+	uint32_t m_HighWaterMark = 0;
+};
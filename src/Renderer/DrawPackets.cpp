@@ -0,0 +1,158 @@
+#include "DrawPackets.h"
+#include <cassert>
+#include <utility>
+
+namespace
+{
+	uint32_t SaturateField(uint32_t value, uint32_t bits)
+	{
+		const uint32_t maxValue = (1u << bits) - 1;
+		return value < maxValue ? value : maxValue;
+	}
+}
+
+uint64_t DrawSortKey::Make(uint32_t pipeline, uint32_t geometry, uint32_t material, uint32_t index)
+{
+	assert(pipeline < (1u << PipelineBits));
+	assert(geometry < (1u << GeometryBits));
+	assert(material < (1u << MaterialBits));
+
+	// Without the asserts an id past its field would spill into the next one up and scramble
+	// the order; saturated, it only shares the top bucket and costs some extra state changes.
+	pipeline = SaturateField(pipeline, PipelineBits);
+	geometry = SaturateField(geometry, GeometryBits);
+	material = SaturateField(material, MaterialBits);
+
+	return ((uint64_t)pipeline << (64 - PipelineBits)) |
+		((uint64_t)geometry << (64 - PipelineBits - GeometryBits)) |
+		((uint64_t)material << 32) |
+		(uint64_t)index;
+}
+
+void RadixSortKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, uint32_t firstByte)
+{
+	const size_t count = keys.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+	uint64_t* src = keys.data();
+	uint64_t* dst = scratch.data();
+
+	for (uint32_t byte = firstByte; byte < 8; byte++)
+	{
+		const uint32_t shift = byte * 8;
+
+		size_t offsets[256] = {};
+		for (size_t i = 0; i < count; i++)
+			offsets[(src[i] >> shift) & 0xff]++;
+
+		// All keys share this byte, so the pass would not move anything.
+		if (offsets[(src[0] >> shift) & 0xff] == count)
+			continue;
+
+		size_t sum = 0;
+		for (size_t& offset : offsets)
+		{
+			size_t bucket = offset;
+			offset = sum;
+			sum += bucket;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dst[offsets[(src[i] >> shift) & 0xff]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	if (src != keys.data())
+		keys.swap(scratch);
+}
+
+void SortDrawPackets(std::vector<DrawPacket>& packets, std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, std::vector<DrawPacket>& sorted)
+{
+	keys.clear();
+	for (const DrawPacket& packet : packets)
+		keys.push_back(packet.SortKey);
+
+	// The low 32 bits hold the submission index, which is already ascending, so a stable
+	// sort on the upper half gives the full order.
+	RadixSortKeys(keys, scratch, 4);
+
+	sorted.clear();
+	for (uint64_t key : keys)
+		sorted.push_back(packets[DrawSortKey::Index(key)]);
+}
+
+DrawCallStats& DrawCallStats::operator+=(const DrawCallStats& rhs)
+{
+	Draws += rhs.Draws;
+	PipelineSets += rhs.PipelineSets;
+	VertexBufferSets += rhs.VertexBufferSets;
+	IndexBufferSets += rhs.IndexBufferSets;
+	TopologySets += rhs.TopologySets;
+	RootCbvSets += rhs.RootCbvSets;
+	Triangles += rhs.Triangles;
+	UnsortedCalls += rhs.UnsortedCalls;
+	return *this;
+}
+
+void SubmitDrawPackets(const DrawPacket* packets, size_t count, uint32_t boundPipeline, DrawPacketSink& sink, DrawCallStats& stats)
+{
+	const uint32_t None = 0xffffffffu;
+
+	uint32_t pipeline = boundPipeline;
+	uint32_t geometry = None;
+	uint32_t topology = None;
+	uint32_t objectConstants = None;
+	uint32_t materialConstants = None;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const DrawPacket& packet = packets[i];
+
+		if (packet.Pipeline != pipeline)
+		{
+			sink.SetPipeline(packet.Pipeline);
+			pipeline = packet.Pipeline;
+			stats.PipelineSets++;
+		}
+
+		if (packet.Geometry != geometry)
+		{
+			sink.SetGeometry(packet.Geometry);
+			geometry = packet.Geometry;
+			stats.VertexBufferSets++;
+			stats.IndexBufferSets++;
+		}
+
+		if (packet.Topology != topology)
+		{
+			sink.SetTopology(packet.Topology);
+			topology = packet.Topology;
+			stats.TopologySets++;
+		}
+
+		if (packet.ObjectConstants != objectConstants)
+		{
+			sink.SetObjectConstants(packet.ObjectConstants);
+			objectConstants = packet.ObjectConstants;
+			stats.RootCbvSets++;
+		}
+
+		if (packet.MaterialConstants != materialConstants)
+		{
+			sink.SetMaterialConstants(packet.MaterialConstants);
+			materialConstants = packet.MaterialConstants;
+			stats.RootCbvSets++;
+		}
+
+		sink.Draw(packet);
+		stats.Draws++;
+		// Everything in the scene is drawn as triangle lists.
+		stats.Triangles += packet.IndexCount / 3;
+
+		// Vertex buffer, index buffer, topology, two root CBVs and the draw.
+		stats.UnsortedCalls += 6;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact, API-neutral description of one draw. The ids are small per-frame indices into
+// tables owned by whoever submits the packets (pipeline states, mesh geometries, constant
+// buffer slots), so packets can be built, sorted and submitted without touching D3D12.
+struct DrawPacket
+{
+	uint64_t SortKey = 0;
+
+	uint32_t Pipeline = 0;
+	uint32_t Geometry = 0;
+	uint32_t Topology = 0;
+	uint32_t ObjectConstants = 0;
+	uint32_t MaterialConstants = 0;
+
+	uint32_t IndexCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+};
+
+// Sort key layout, most significant first:
+//   pipeline (8 bits) | geometry (12 bits) | material (12 bits) | submission index (32 bits)
+// The submission index keeps keys unique and ties in declaration order.
+namespace DrawSortKey
+{
+	constexpr uint32_t PipelineBits = 8;
+	constexpr uint32_t GeometryBits = 12;
+	constexpr uint32_t MaterialBits = 12;
+
+	// Ids past their field's range assert in debug builds and share the field's largest value
+	// otherwise: the packets still draw correctly, just with less state sharing.
+	uint64_t Make(uint32_t pipeline, uint32_t geometry, uint32_t material, uint32_t index);
+
+	// For passes that must keep their submission order, e.g. blended geometry.
+	inline uint64_t MakeOrdered(uint32_t index) { return index; }
+
+	inline uint32_t Index(uint64_t key) { return (uint32_t)key; }
+}
+
+// LSD radix sort on bytes [firstByte, 8) of the keys, 8 bits per pass. Bytes below firstByte
+// are left in input order (the sort is stable), and passes where every key has the same byte
+// are skipped. scratch is resized as needed and can be reused across calls.
+void RadixSortKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, uint32_t firstByte = 0);
+
+// Sorts packets by SortKey.
+void SortDrawPackets(std::vector<DrawPacket>& packets, std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, std::vector<DrawPacket>& sorted);
+
+// API calls issued for a range of packets.
+struct DrawCallStats
+{
+	uint32_t Draws = 0;
+	uint32_t PipelineSets = 0;
+	uint32_t VertexBufferSets = 0;
+	uint32_t IndexBufferSets = 0;
+	uint32_t TopologySets = 0;
+	uint32_t RootCbvSets = 0;
+	uint64_t Triangles = 0;
+
+	// What the same packets would have cost with every state set per draw.
+	uint32_t UnsortedCalls = 0;
+
+	uint32_t TotalCalls() const { return Draws + PipelineSets + VertexBufferSets + IndexBufferSets + TopologySets + RootCbvSets; }
+
+	DrawCallStats& operator+=(const DrawCallStats& rhs);
+};
+
+// Receives only the state changes a sorted packet stream actually needs.
+class DrawPacketSink
+{
+public:
+	virtual ~DrawPacketSink() = default;
+
+	virtual void SetPipeline(uint32_t pipeline) = 0;
+	virtual void SetGeometry(uint32_t geometry) = 0;
+	virtual void SetTopology(uint32_t topology) = 0;
+	virtual void SetObjectConstants(uint32_t slot) = 0;
+	virtual void SetMaterialConstants(uint32_t slot) = 0;
+	virtual void Draw(const DrawPacket& packet) = 0;
+};
+
+// Emits packets[0, count) into sink, skipping state that is already set. boundPipeline is the
+// pipeline the caller bound beforehand; nothing else is assumed, since a fresh command list
+// starts with no input assembler or root argument state.
+void SubmitDrawPackets(const DrawPacket* packets, size_t count, uint32_t boundPipeline, DrawPacketSink& sink, DrawCallStats& stats);
@@ -0,0 +1,472 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	const FgState WriteStates = FgState::RenderTarget | FgState::DepthWrite | FgState::UnorderedAccess | FgState::CopyDest;
+
+	bool IsReadOnly(FgState state)
+	{
+		return state != FgState::Undefined && !HasAnyState(state, WriteStates);
+	}
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	void AddUnique(std::vector<uint32_t>& list, uint32_t value)
+	{
+		if (std::find(list.begin(), list.end(), value) == list.end())
+			list.push_back(value);
+	}
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::Read(FgResourceId resource, FgState state)
+{
+	auto& accesses = m_Graph.m_Passes[m_Pass].Accesses;
+	for (auto& a : accesses)
+	{
+		if (a.Resource == resource)
+		{
+			a.State = a.State | state;
+			return *this;
+		}
+	}
+	accesses.push_back({ resource, state, false });
+	return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::Write(FgResourceId resource, FgState state)
+{
+	auto& accesses = m_Graph.m_Passes[m_Pass].Accesses;
+	for (auto& a : accesses)
+	{
+		if (a.Resource == resource)
+		{
+			a.State = a.State | state;
+			a.Write = true;
+			return *this;
+		}
+	}
+	accesses.push_back({ resource, state, true });
+	return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::SideEffect()
+{
+	m_Graph.m_Passes[m_Pass].SideEffect = true;
+	return *this;
+}
+
+void FrameGraph::Reset()
+{
+	m_Passes.clear();
+	m_Resources.clear();
+	m_Order.clear();
+	m_FinalBarriers.clear();
+	m_Placements.clear();
+	m_HeapSize = 0;
+	m_Compiled = false;
+	m_Stats = Stats();
+}
+
+FgResourceId FrameGraph::ImportTexture(const char* name, void* native, FgState initialState, FgState finalState)
+{
+	Resource r;
+	r.Name = name;
+	r.Imported = true;
+	r.InitialState = initialState;
+	r.FinalState = finalState;
+	r.Native = native;
+	m_Resources.push_back(r);
+	return (FgResourceId)(m_Resources.size() - 1);
+}
+
+FgResourceId FrameGraph::CreateTexture(const char* name, const FgTextureDesc& desc)
+{
+	Resource r;
+	r.Name = name;
+	r.Desc = desc;
+	m_Resources.push_back(r);
+	return (FgResourceId)(m_Resources.size() - 1);
+}
+
+FrameGraph::PassBuilder FrameGraph::AddPass(const char* name, ExecuteFn execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	m_Passes.push_back(std::move(pass));
+	return PassBuilder(*this, (uint32_t)(m_Passes.size() - 1));
+}
+
+void FrameGraph::Compile(FrameGraphBackend& backend)
+{
+	m_Order.clear();
+	m_FinalBarriers.clear();
+	m_Placements.clear();
+	m_HeapSize = 0;
+	m_Stats = Stats();
+	m_Stats.DeclaredPasses = (uint32_t)m_Passes.size();
+
+	BuildDependencies();
+	CullPasses();
+	SortPasses();
+	ComputeLifetimes();
+
+	// Aliasing barriers go first in a pass's batch, ahead of the transitions planned next.
+	PlaceTransients(backend);
+	PlanBarriers();
+
+	m_Compiled = true;
+}
+
+void FrameGraph::BuildDependencies()
+{
+	std::vector<int> lastWriter(m_Resources.size(), -1);
+	std::vector<std::vector<uint32_t>> readersSinceWrite(m_Resources.size());
+
+	for (uint32_t i = 0; i < (uint32_t)m_Passes.size(); i++)
+	{
+		Pass& pass = m_Passes[i];
+		pass.Dependencies.clear();
+		pass.Producers.clear();
+		pass.Barriers.clear();
+		pass.Live = false;
+
+		for (const Access& a : pass.Accesses)
+		{
+			int writer = lastWriter[a.Resource];
+			if (writer >= 0)
+			{
+				AddUnique(pass.Dependencies, (uint32_t)writer);
+				AddUnique(pass.Producers, (uint32_t)writer);
+			}
+
+			if (a.Write)
+			{
+				for (uint32_t reader : readersSinceWrite[a.Resource])
+				{
+					if (reader != i)
+						AddUnique(pass.Dependencies, reader);
+				}
+			}
+		}
+
+		for (const Access& a : pass.Accesses)
+		{
+			if (a.Write)
+			{
+				lastWriter[a.Resource] = (int)i;
+				readersSinceWrite[a.Resource].clear();
+			}
+			else
+			{
+				readersSinceWrite[a.Resource].push_back(i);
+			}
+		}
+	}
+}
+
+void FrameGraph::CullPasses()
+{
+	std::vector<uint32_t> stack;
+	for (uint32_t i = 0; i < (uint32_t)m_Passes.size(); i++)
+	{
+		const Pass& pass = m_Passes[i];
+		bool isRoot = pass.SideEffect;
+		for (const Access& a : pass.Accesses)
+		{
+			if (a.Write && m_Resources[a.Resource].Imported)
+				isRoot = true;
+		}
+
+		if (isRoot)
+		{
+			m_Passes[i].Live = true;
+			stack.push_back(i);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		uint32_t i = stack.back();
+		stack.pop_back();
+		for (uint32_t producer : m_Passes[i].Producers)
+		{
+			if (!m_Passes[producer].Live)
+			{
+				m_Passes[producer].Live = true;
+				stack.push_back(producer);
+			}
+		}
+	}
+
+	for (const Pass& pass : m_Passes)
+	{
+		if (!pass.Live)
+			m_Stats.CulledPasses++;
+	}
+}
+
+void FrameGraph::SortPasses()
+{
+	// Kahn's algorithm, always picking the earliest declared ready pass so the order is
+	// deterministic and stays close to how the passes were written.
+	const uint32_t count = (uint32_t)m_Passes.size();
+	std::vector<uint32_t> pending(count, 0);
+	std::vector<std::vector<uint32_t>> dependents(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!m_Passes[i].Live)
+			continue;
+
+		for (uint32_t dep : m_Passes[i].Dependencies)
+		{
+			if (m_Passes[dep].Live)
+			{
+				pending[i]++;
+				dependents[dep].push_back(i);
+			}
+		}
+	}
+
+	std::vector<uint32_t> ready;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (m_Passes[i].Live && pending[i] == 0)
+			ready.push_back(i);
+	}
+
+	while (!ready.empty())
+	{
+		auto next = std::min_element(ready.begin(), ready.end());
+		uint32_t i = *next;
+		ready.erase(next);
+		m_Order.push_back(i);
+
+		for (uint32_t dependent : dependents[i])
+		{
+			if (--pending[dependent] == 0)
+				ready.push_back(dependent);
+		}
+	}
+
+	assert(m_Order.size() == count - m_Stats.CulledPasses && "frame graph has a cycle");
+}
+
+void FrameGraph::ComputeLifetimes()
+{
+	for (Resource& r : m_Resources)
+	{
+		r.FirstUse = 0xffffffffu;
+		r.LastUse = 0;
+	}
+
+	for (uint32_t p = 0; p < (uint32_t)m_Order.size(); p++)
+	{
+		for (const Access& a : m_Passes[m_Order[p]].Accesses)
+		{
+			Resource& r = m_Resources[a.Resource];
+			r.FirstUse = std::min(r.FirstUse, p);
+			r.LastUse = std::max(r.LastUse, p);
+		}
+	}
+}
+
+void FrameGraph::PlaceTransients(FrameGraphBackend& backend)
+{
+	std::vector<FgPlacement> candidates;
+	for (FgResourceId id = 0; id < (FgResourceId)m_Resources.size(); id++)
+	{
+		const Resource& r = m_Resources[id];
+		if (r.Imported || r.FirstUse == 0xffffffffu)
+			continue;
+
+		FgAllocationInfo info = backend.GetAllocationInfo(r.Desc);
+		FgPlacement placement;
+		placement.Resource = id;
+		placement.Desc = r.Desc;
+		placement.Size = AlignUp(info.Size, info.Alignment);
+		candidates.push_back(placement);
+		m_Stats.TransientBytesRequested += placement.Size;
+	}
+
+	// Largest first keeps the heap compact.
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const FgPlacement& a, const FgPlacement& b) { return a.Size > b.Size; });
+
+	for (FgPlacement& candidate : candidates)
+	{
+		const Resource& r = m_Resources[candidate.Resource];
+		const uint64_t alignment = backend.GetAllocationInfo(r.Desc).Alignment;
+
+		auto livesOverlap = [&](const FgPlacement& other)
+		{
+			const Resource& o = m_Resources[other.Resource];
+			return r.FirstUse <= o.LastUse && o.FirstUse <= r.LastUse;
+		};
+		auto memoryOverlaps = [](uint64_t offset, uint64_t size, const FgPlacement& other)
+		{
+			return offset < other.Offset + other.Size && other.Offset < offset + size;
+		};
+
+		// The lowest offset is either the start of the heap or right after a resource that
+		// is alive at the same time.
+		std::vector<uint64_t> offsets = { 0 };
+		for (const FgPlacement& placed : m_Placements)
+		{
+			if (livesOverlap(placed))
+				offsets.push_back(AlignUp(placed.Offset + placed.Size, alignment));
+		}
+		std::sort(offsets.begin(), offsets.end());
+
+		for (uint64_t offset : offsets)
+		{
+			bool fits = true;
+			for (const FgPlacement& placed : m_Placements)
+			{
+				if (livesOverlap(placed) && memoryOverlaps(offset, candidate.Size, placed))
+				{
+					fits = false;
+					break;
+				}
+			}
+
+			if (fits)
+			{
+				candidate.Offset = offset;
+				break;
+			}
+		}
+
+		m_Placements.push_back(candidate);
+		m_HeapSize = std::max(m_HeapSize, candidate.Offset + candidate.Size);
+	}
+
+	// Resources share memory only when their lifetimes are disjoint, so of every overlapping
+	// pair one runs entirely before the other. Placement is by size, not time, so the pairs are
+	// only known once everything is placed: the later resource takes an aliasing barrier before
+	// its first pass, for each resource that used its memory earlier.
+	std::vector<uint32_t> byFirstUse(m_Placements.size());
+	for (uint32_t i = 0; i < (uint32_t)byFirstUse.size(); i++)
+		byFirstUse[i] = i;
+	std::stable_sort(byFirstUse.begin(), byFirstUse.end(), [&](uint32_t a, uint32_t b)
+		{ return m_Resources[m_Placements[a].Resource].FirstUse < m_Resources[m_Placements[b].Resource].FirstUse; });
+
+	for (uint32_t later : byFirstUse)
+	{
+		const FgPlacement& after = m_Placements[later];
+		const Resource& r = m_Resources[after.Resource];
+		for (uint32_t earlier : byFirstUse)
+		{
+			const FgPlacement& before = m_Placements[earlier];
+			const bool memoryOverlaps = after.Offset < before.Offset + before.Size && before.Offset < after.Offset + after.Size;
+			if (earlier != later && memoryOverlaps && m_Resources[before.Resource].LastUse < r.FirstUse)
+			{
+				FgBarrier barrier;
+				barrier.BarrierType = FgBarrier::Type::Aliasing;
+				barrier.Resource = after.Resource;
+				barrier.AliasBefore = before.Resource;
+				m_Passes[m_Order[r.FirstUse]].Barriers.push_back(barrier);
+			}
+		}
+	}
+
+	m_Stats.TransientResources = (uint32_t)m_Placements.size();
+	m_Stats.TransientHeapSize = m_HeapSize;
+}
+
+void FrameGraph::PlanBarriers()
+{
+	std::vector<FgState> current(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		current[i] = m_Resources[i].InitialState;
+
+	for (uint32_t passIndex : m_Order)
+	{
+		Pass& pass = m_Passes[passIndex];
+		for (const Access& a : pass.Accesses)
+		{
+			FgState& state = current[a.Resource];
+
+			// A resource already in a read state that covers this read can stay where it is.
+			if (!a.Write && IsReadOnly(state) && (state & a.State) == a.State)
+				continue;
+
+			if (state != a.State)
+			{
+				FgBarrier barrier;
+				barrier.Resource = a.Resource;
+				barrier.Before = state;
+				barrier.After = a.State;
+				pass.Barriers.push_back(barrier);
+				state = a.State;
+			}
+		}
+
+		m_Stats.Barriers += (uint32_t)pass.Barriers.size();
+		if (!pass.Barriers.empty())
+			m_Stats.BarrierBatches++;
+	}
+
+	for (FgResourceId id = 0; id < (FgResourceId)m_Resources.size(); id++)
+	{
+		const Resource& r = m_Resources[id];
+		if (r.Imported && current[id] != r.FinalState)
+		{
+			FgBarrier barrier;
+			barrier.Resource = id;
+			barrier.Before = current[id];
+			barrier.After = r.FinalState;
+			m_FinalBarriers.push_back(barrier);
+		}
+	}
+
+	m_Stats.Barriers += (uint32_t)m_FinalBarriers.size();
+	if (!m_FinalBarriers.empty())
+		m_Stats.BarrierBatches++;
+}
+
+void FrameGraph::Execute(FrameGraphBackend& backend)
+{
+	assert(m_Compiled && "Compile() the frame graph before executing it");
+
+	m_TransientNatives.clear();
+	backend.CreateTransients(m_HeapSize, m_Placements, m_TransientNatives);
+	assert(m_TransientNatives.size() == m_Placements.size());
+	for (size_t i = 0; i < m_Placements.size(); i++)
+		m_Resources[m_Placements[i].Resource].Native = m_TransientNatives[i];
+
+	for (uint32_t passIndex : m_Order)
+	{
+		Pass& pass = m_Passes[passIndex];
+		Submit(backend, pass.Barriers);
+
+		backend.BeginPass(pass.Name.c_str());
+		if (pass.Execute)
+			pass.Execute(*this);
+		backend.EndPass();
+	}
+
+	Submit(backend, m_FinalBarriers);
+}
+
+void FrameGraph::Submit(FrameGraphBackend& backend, const std::vector<FgBarrier>& barriers)
+{
+	if (barriers.empty())
+		return;
+
+	m_BarrierNatives.clear();
+	m_AliasNatives.clear();
+	for (const FgBarrier& b : barriers)
+	{
+		m_BarrierNatives.push_back(m_Resources[b.Resource].Native);
+		m_AliasNatives.push_back(b.AliasBefore != FgInvalidResource ? m_Resources[b.AliasBefore].Native : nullptr);
+	}
+
+	backend.SubmitBarriers(barriers.data(), m_BarrierNatives.data(), m_AliasNatives.data(), barriers.size());
+}
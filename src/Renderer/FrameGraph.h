@@ -0,0 +1,221 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Backend-neutral resource states. They map one to one onto D3D12_RESOURCE_STATES bits in
+// D3D12FrameGraphBackend, and can be combined for passes that read a resource in several
+// ways at once (e.g. DepthRead | PixelShaderResource).
+enum class FgState : uint32_t
+{
+	Undefined = 0,
+	Present = 1u << 0,
+	RenderTarget = 1u << 1,
+	DepthWrite = 1u << 2,
+	DepthRead = 1u << 3,
+	PixelShaderResource = 1u << 4,
+	NonPixelShaderResource = 1u << 5,
+	UnorderedAccess = 1u << 6,
+	CopySource = 1u << 7,
+	CopyDest = 1u << 8,
+};
+
+inline FgState operator|(FgState a, FgState b) { return (FgState)((uint32_t)a | (uint32_t)b); }
+inline FgState operator&(FgState a, FgState b) { return (FgState)((uint32_t)a & (uint32_t)b); }
+inline bool HasAnyState(FgState states, FgState bits) { return (states & bits) != FgState::Undefined; }
+
+using FgResourceId = uint32_t;
+static constexpr FgResourceId FgInvalidResource = 0xffffffffu;
+
+struct FgTextureDesc
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Format = 0; // Backend format enum, DXGI_FORMAT on D3D12.
+	bool RenderTarget = false;
+	bool DepthStencil = false;
+	bool UnorderedAccess = false;
+
+	bool operator==(const FgTextureDesc& rhs) const = default;
+};
+
+struct FgAllocationInfo
+{
+	uint64_t Size = 0;
+	uint64_t Alignment = 1;
+};
+
+struct FgBarrier
+{
+	enum class Type
+	{
+		Transition,
+		Aliasing,
+	};
+
+	Type BarrierType = Type::Transition;
+	FgResourceId Resource = FgInvalidResource;
+
+	// Transition only. Before is Undefined for the first use of a transient resource.
+	FgState Before = FgState::Undefined;
+	FgState After = FgState::Undefined;
+
+	// Aliasing only: the transient that previously occupied the memory.
+	FgResourceId AliasBefore = FgInvalidResource;
+};
+
+// Where a transient resource lives inside the shared transient heap.
+struct FgPlacement
+{
+	FgResourceId Resource = FgInvalidResource;
+	FgTextureDesc Desc;
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+};
+
+class FrameGraph;
+
+// Everything the graph needs from the graphics API. The graph itself never touches D3D12,
+// so it can be compiled and executed against a mock backend.
+class FrameGraphBackend
+{
+public:
+	virtual ~FrameGraphBackend() = default;
+
+	virtual FgAllocationInfo GetAllocationInfo(const FgTextureDesc& desc) = 0;
+
+	// Called once per Execute with the compiled heap layout. Returns the native handle of
+	// every placement, in order.
+	virtual void CreateTransients(uint64_t heapSize, const std::vector<FgPlacement>& placements, std::vector<void*>& outNatives) = 0;
+
+	// One call per batch; natives[i] is the resource of barriers[i] (and aliasNatives[i] the
+	// previous occupant for aliasing barriers).
+	virtual void SubmitBarriers(const FgBarrier* barriers, const void* const* natives, const void* const* aliasNatives, size_t count) = 0;
+
+	virtual void BeginPass(const char* /*name*/) {}
+	virtual void EndPass() {}
+};
+
+// Per-frame render graph. Passes declare the resources they read and write; Compile() orders
+// them, drops passes whose results are never used, plans batched state transitions and packs
+// transient textures with non-overlapping lifetimes into the same heap memory.
+//
+// Declaration order defines resource versions: a read sees the latest earlier write, and a
+// write depends on the previous write and on every read since (render targets load by
+// default, so writes are treated as read-modify-write).
+class FrameGraph
+{
+public:
+	using ExecuteFn = std::function<void(FrameGraph& graph)>;
+
+	class PassBuilder
+	{
+	public:
+		PassBuilder& Read(FgResourceId resource, FgState state);
+		PassBuilder& Write(FgResourceId resource, FgState state);
+
+		// Keeps the pass even when nothing reads what it writes.
+		PassBuilder& SideEffect();
+
+	private:
+		friend class FrameGraph;
+		PassBuilder(FrameGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+		FrameGraph& m_Graph;
+		uint32_t m_Pass;
+	};
+
+	struct Stats
+	{
+		uint32_t DeclaredPasses = 0;
+		uint32_t CulledPasses = 0;
+		uint32_t Barriers = 0;
+		uint32_t BarrierBatches = 0;
+		uint32_t TransientResources = 0;
+		uint64_t TransientHeapSize = 0;
+		uint64_t TransientBytesRequested = 0; // Without aliasing.
+	};
+
+	// Clears the graph for the next frame. The pass and resource arrays keep their capacity, but
+	// each pass's name, callback and access lists are allocated again when it is re-added.
+	void Reset();
+
+	// Imported resources are owned elsewhere. They count as graph outputs and are returned to
+	// finalState at the end of the frame.
+	FgResourceId ImportTexture(const char* name, void* native, FgState initialState, FgState finalState);
+	FgResourceId CreateTexture(const char* name, const FgTextureDesc& desc);
+
+	PassBuilder AddPass(const char* name, ExecuteFn execute);
+
+	void Compile(FrameGraphBackend& backend);
+	void Execute(FrameGraphBackend& backend);
+
+	// Native resource of id; only valid for transients while Execute() is running.
+	void* GetNative(FgResourceId resource) const { return m_Resources[resource].Native; }
+
+	// Compiled results, for inspection.
+	const std::vector<uint32_t>& ExecutionOrder() const { return m_Order; }
+	const std::vector<FgBarrier>& PassBarriers(uint32_t pass) const { return m_Passes[pass].Barriers; }
+	const std::vector<FgBarrier>& FinalBarriers() const { return m_FinalBarriers; }
+	const std::vector<FgPlacement>& Placements() const { return m_Placements; }
+	const std::string& PassName(uint32_t pass) const { return m_Passes[pass].Name; }
+	bool IsCulled(uint32_t pass) const { return !m_Passes[pass].Live; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Access
+	{
+		FgResourceId Resource = FgInvalidResource;
+		FgState State = FgState::Undefined;
+		bool Write = false;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFn Execute;
+		std::vector<Access> Accesses;
+		std::vector<uint32_t> Dependencies; // Everything that has to run first.
+		std::vector<uint32_t> Producers;    // Passes whose output this one consumes, for culling.
+		std::vector<FgBarrier> Barriers;
+		bool SideEffect = false;
+		bool Live = false;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		bool Imported = false;
+		FgTextureDesc Desc;
+		FgState InitialState = FgState::Undefined;
+		FgState FinalState = FgState::Undefined;
+		void* Native = nullptr;
+
+		// Execution order positions of the first and last live use, for aliasing.
+		uint32_t FirstUse = 0xffffffffu;
+		uint32_t LastUse = 0;
+	};
+
+	void BuildDependencies();
+	void CullPasses();
+	void SortPasses();
+	void ComputeLifetimes();
+	void PlanBarriers();
+	void PlaceTransients(FrameGraphBackend& backend);
+	void Submit(FrameGraphBackend& backend, const std::vector<FgBarrier>& barriers);
+
+	std::vector<Pass> m_Passes;
+	std::vector<Resource> m_Resources;
+	std::vector<uint32_t> m_Order;
+	std::vector<FgBarrier> m_FinalBarriers;
+	std::vector<FgPlacement> m_Placements;
+	uint64_t m_HeapSize = 0;
+	bool m_Compiled = false;
+	Stats m_Stats;
+
+	// Scratch buffers reused across frames.
+	std::vector<void*> m_TransientNatives;
+	std::vector<const void*> m_BarrierNatives;
+	std::vector<const void*> m_AliasNatives;
+};
@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+void FrameTimeHistogram::Add(double ms)
+{
+	uint32_t bucket = (uint32_t)std::min(std::max(ms, 0.0) / BucketWidthMs, (double)(BucketCount - 1));
+	m_Buckets[bucket] += 1.0f;
+	m_Count++;
+	m_SumMs += ms;
+	m_MaxMs = std::max(m_MaxMs, ms);
+}
+
+void FrameTimeHistogram::Reset()
+{
+	m_Buckets.fill(0.0f);
+	m_Count = 0;
+	m_SumMs = 0.0;
+	m_MaxMs = 0.0;
+}
+
+double FrameTimeHistogram::PercentileMs(double fraction) const
+{
+	if (m_Count == 0)
+		return 0.0;
+
+	double target = fraction * (double)m_Count;
+	double seen = 0.0;
+	for (uint32_t i = 0; i < BucketCount; i++)
+	{
+		seen += m_Buckets[i];
+		if (seen >= target)
+			return i == BucketCount - 1 ? m_MaxMs : (i + 1) * BucketWidthMs;
+	}
+	return m_MaxMs;
+}
+
+FramePacer::FramePacer(uint32_t frameResourceCount)
+	: m_FrameResourceCount(std::min(frameResourceCount, MaxTrackedFrames))
+{
+	SetSettings(m_Settings);
+}
+
+void FramePacer::SetSettings(const FramePacingSettings& settings)
+{
+	m_Settings = settings;
+	m_Settings.MaxFramesInFlight = std::clamp(m_Settings.MaxFramesInFlight, 1u, m_FrameResourceCount);
+	m_Settings.MaxFrameLatency = std::clamp(m_Settings.MaxFrameLatency, 1u, 16u);
+	m_Settings.TargetFps = std::max(m_Settings.TargetFps, 0.0);
+}
+
+double FramePacer::LimiterWait(double now)
+{
+	if (m_Settings.TargetFps <= 0.0)
+	{
+		m_NextFrameTime = -1.0;
+		return 0.0;
+	}
+
+	double interval = 1.0 / m_Settings.TargetFps;
+	if (m_NextFrameTime < 0.0 || now > m_NextFrameTime + interval)
+	{
+		m_NextFrameTime = now + interval;
+		return 0.0;
+	}
+
+	double wait = std::max(m_NextFrameTime - now, 0.0);
+	m_NextFrameTime += interval;
+	return wait;
+}
+
+void FramePacer::OnInputSampled(double now)
+{
+	if (m_LastInputTime >= 0.0)
+		m_FrameTimes.Add((now - m_LastInputTime) * 1000.0);
+
+	m_LastInputTime = now;
+	m_InputTime = now;
+}
+
+void FramePacer::OnPresent(double now)
+{
+	if (m_InputTime < 0.0)
+		return;
+
+	m_InputLatency.Add((now - m_InputTime) * 1000.0);
+	m_InputTime = -1.0;
+}
+
+void FramePacer::OnFrameSubmitted(uint64_t fence)
+{
+	m_SubmittedFences[m_SubmittedCount % MaxTrackedFrames] = fence;
+	m_SubmittedCount++;
+}
+
+uint64_t FramePacer::FenceToWaitFor() const
+{
+	// The frame about to start makes one more in flight, so the one submitted
+	// MaxFramesInFlight frames ago has to have finished.
+	uint32_t inFlight = m_Settings.MaxFramesInFlight;
+	if (m_SubmittedCount < inFlight)
+		return 0;
+
+	return m_SubmittedFences[(m_SubmittedCount - inFlight) % MaxTrackedFrames];
+}
+
+void FramePacer::ResetHistograms()
+{
+	m_FrameTimes.Reset();
+	m_InputLatency.Reset();
+}
+
+void SleepPrecise(double seconds)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	const std::chrono::microseconds spinTime(1500);
+
+	Clock::time_point now = Clock::now();
+	if (end - now > spinTime)
+		std::this_thread::sleep_for(end - now - spinTime);
+
+	while (Clock::now() < end)
+		std::this_thread::yield();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Counts of samples in fixed-width millisecond buckets, with the last bucket collecting
+// everything beyond the range. Fixed size, so adding a sample never allocates.
+class FrameTimeHistogram
+{
+public:
+	static constexpr uint32_t BucketCount = 100;
+	static constexpr double BucketWidthMs = 0.5;
+
+	void Add(double ms);
+	void Reset();
+
+	uint64_t Count() const { return m_Count; }
+	double MeanMs() const { return m_Count ? m_SumMs / m_Count : 0.0; }
+	double MaxMs() const { return m_MaxMs; }
+
+	// Upper edge of the bucket holding the given fraction of samples, e.g. 0.99.
+	double PercentileMs(double fraction) const;
+
+	const std::array<float, BucketCount>& Buckets() const { return m_Buckets; }
+
+private:
+	std::array<float, BucketCount> m_Buckets = {};
+	uint64_t m_Count = 0;
+	double m_SumMs = 0.0;
+	double m_MaxMs = 0.0;
+};
+
+struct FramePacingSettings
+{
+	bool VSync = true;
+
+	// Frames the CPU may run ahead of the GPU, at most the number of frame resources.
+	uint32_t MaxFramesInFlight = 2;
+
+	// Frames the swap chain may queue before its waitable object blocks the next one.
+	uint32_t MaxFrameLatency = 1;
+
+	// Zero for no limit.
+	double TargetFps = 0.0;
+};
+
+// Frame pacing decisions, kept apart from DXGI and the system clock: callers pass the time
+// in seconds, so the policy can be driven by a simulated clock.
+class FramePacer
+{
+public:
+	static constexpr uint32_t MaxTrackedFrames = 8;
+
+	// frameResourceCount bounds MaxFramesInFlight.
+	explicit FramePacer(uint32_t frameResourceCount);
+
+	const FramePacingSettings& Settings() const { return m_Settings; }
+	void SetSettings(const FramePacingSettings& settings);
+
+	// Seconds to wait before starting a frame at time now, to hold the target frame rate.
+	// The schedule advances by whole intervals, so a frame that starts a little late is made
+	// up by the next one; more than an interval late and the schedule restarts from now.
+	double LimiterWait(double now);
+
+	// Marks when the frame sampled its input; the time since the previous sample is its
+	// frame time.
+	void OnInputSampled(double now);
+	void OnPresent(double now);
+
+	// The frame has been submitted and signals fence when the GPU is done with it.
+	void OnFrameSubmitted(uint64_t fence);
+
+	// Fence to wait for before starting a frame so that no more than MaxFramesInFlight are
+	// queued, or zero if nothing has to be waited for.
+	uint64_t FenceToWaitFor() const;
+
+	const FrameTimeHistogram& FrameTimes() const { return m_FrameTimes; }
+	const FrameTimeHistogram& InputLatency() const { return m_InputLatency; }
+	void ResetHistograms();
+
+private:
+	uint32_t m_FrameResourceCount;
+	FramePacingSettings m_Settings;
+
+	double m_NextFrameTime = -1.0;
+	double m_LastInputTime = -1.0;
+	double m_InputTime = -1.0;
+
+	std::array<uint64_t, MaxTrackedFrames> m_SubmittedFences = {};
+	uint64_t m_SubmittedCount = 0;
+
+	FrameTimeHistogram m_FrameTimes;
+	FrameTimeHistogram m_InputLatency;
+};
+
+// Sleeps for about the given time, spinning over the last stretch because the system timer
+// is too coarse to hit a frame deadline on its own.
+void SleepPrecise(double seconds);
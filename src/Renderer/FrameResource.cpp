@@ -2,7 +2,7 @@
 
 FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT opaqueObjectCount, UINT transparentObjectCount, UINT skyObjectCount, UINT materialCount, UINT waveVertCount)
 {
-	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
+	CommandLists = std::make_unique<CommandListPool>(device);
 
 	UINT totalObjectCount = opaqueObjectCount + transparentObjectCount + skyObjectCount;
 
@@ -13,6 +13,39 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT opaqueOb
 
 	WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
 	WaterCB = std::make_unique<UploadBuffer<WaterConstants>>(device, transparentObjectCount, true);
+
+	MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
+	ReserveInstances(device, 1);
+
+	IndirectCount = std::make_unique<UploadBuffer<UINT>>(device, 1, false);
+	ReserveIndirectCommands(device, 1);
+}
+
+void FrameResource::ReserveInstances(ID3D12Device* device, UINT instanceCount)
+{
+	if (instanceCount <= InstanceCapacity)
+		return;
+
+	// Grow geometrically so a slowly rising count does not reallocate every frame.
+	InstanceCapacity = std::max(instanceCount, InstanceCapacity * 2);
+	InstanceBuffer = std::make_unique<UploadBuffer<InstanceData>>(device, InstanceCapacity, false);
+}
+
+void FrameResource::ReserveIndirectCommands(ID3D12Device* device, UINT commandCount)
+{
+	if (commandCount <= IndirectCapacity)
+		return;
+
+	IndirectCapacity = std::max(commandCount, IndirectCapacity * 2);
+	IndirectCommands = std::make_unique<UploadBuffer<IndirectDrawCommand>>(device, IndirectCapacity, false);
+}
+
+UINT64 FrameResource::TakeUploadBytes()
+{
+	return PassCB->TakeBytesWritten() + ObjectCB->TakeBytesWritten() + MaterialCB->TakeBytesWritten() +
+		WavesVB->TakeBytesWritten() + WaterCB->TakeBytesWritten() + TerrainCB->TakeBytesWritten() +
+		InstanceBuffer->TakeBytesWritten() + MaterialBuffer->TakeBytesWritten() +
+		IndirectCommands->TakeBytesWritten() + IndirectCount->TakeBytesWritten();
 }
 
 FrameResource::~FrameResource()
@@ -2,6 +2,10 @@
 #include "../Utils/d3dUtil.h"
 #include "../../include/MathHelper.h"
 #include "../../include/UploadBuffer.h"
+#include "CommandListPool.h"
+#include "InstanceBatcher.h"
+#include "IndirectDraw.h"
+#include "HandleRegistry.h"
 
 using namespace DirectX;
 
@@ -41,12 +45,34 @@ struct TerrainConstants
 	float gPad = 0.0f;
 };
 
+// Bindless heap indices of the textures the shaders read, bound as root constants (b4).
+struct DescriptorIndexConstants
+{
+	UINT GrassDiffuse = 0;
+	UINT GrassNormal = 0;
+	UINT MudDiffuse = 0;
+	UINT MudNormal = 0;
+	UINT SkyCube = 0;
+	UINT HeightMap = 0;
+	UINT RockDiffuse = 0;
+	UINT RockNormal = 0;
+	UINT SceneDepth = 0;
+};
+
 struct ObjectConstants
 {
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 };
 
+// Material table read by the instanced shaders, indexed by Material::MatCBIndex.
+struct MaterialData
+{
+	XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+};
+
 struct PassConstants
 {
 	XMFLOAT4X4 View = MathHelper::Identity4x4();
@@ -86,7 +112,16 @@ public:
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
+	// Grows InstanceBuffer to hold at least instanceCount instances. Only call once the GPU
+	// is done with this frame resource.
+	void ReserveInstances(ID3D12Device* device, UINT instanceCount);
+	void ReserveIndirectCommands(ID3D12Device* device, UINT commandCount);
+
+	// Bytes written to this frame resource's upload buffers since the previous call.
+	UINT64 TakeUploadBytes();
+
+	// Every command list recorded for this frame, possibly on several threads.
+	std::unique_ptr<CommandListPool> CommandLists;
 
 	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
 	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
@@ -96,27 +131,44 @@ public:
 	std::unique_ptr<UploadBuffer<WaterConstants>> WaterCB = nullptr;
 	std::unique_ptr<UploadBuffer<TerrainConstants>> TerrainCB = nullptr;
 
+	std::unique_ptr<UploadBuffer<InstanceData>> InstanceBuffer = nullptr;
+	UINT InstanceCapacity = 0;
+	std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
+
+	// Compacted ExecuteIndirect arguments for the instanced draws, and their count.
+	std::unique_ptr<UploadBuffer<IndirectDrawCommand>> IndirectCommands = nullptr;
+	UINT IndirectCapacity = 0;
+	std::unique_ptr<UploadBuffer<UINT>> IndirectCount = nullptr;
+
 	UINT Fence = 0;
 };
 
+using MaterialHandle = Handle<Material>;
+using GeometryHandle = Handle<MeshGeometry>;
+
 struct RenderItem
 {
 	RenderItem() = default;
 
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-
+	// The world matrix lives in the renderer's transform store, in slot ObjCBIndex;
+	// NumFramesDirty covers the texture transform.
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
 	int NumFramesDirty = gNumFrameResources;
 
 	UINT ObjCBIndex = -1;
 
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
+	MaterialHandle Mat;
+	GeometryHandle Geo;
 
 	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
-};
\ No newline at end of file
+
+	// Local-space bounds, used to cull instanced items.
+	BoundingBox Bounds;
+};
+
+using RenderItemHandle = Handle<RenderItem>;
\ No newline at end of file
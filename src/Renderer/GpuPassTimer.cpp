@@ -0,0 +1,111 @@
+#include "GpuPassTimer.h"
+#include <algorithm>
+
+GpuPassTimer::GpuPassTimer(TimestampQuerySource& source, uint32_t frameSlots, uint32_t maxPassesPerFrame)
+	: m_Source(source), m_MaxPasses(maxPassesPerFrame), m_Slots(frameSlots)
+{
+	for (Slot& slot : m_Slots)
+		slot.Names.resize(maxPassesPerFrame);
+	m_Ticks.resize((size_t)maxPassesPerFrame * 2);
+}
+
+const char* GpuPassTimer::Intern(const char* name)
+{
+	// Set nodes never move, so the pointer stays valid; only a name seen for the first time
+	// allocates.
+	return m_NameTable.emplace(name).first->c_str();
+}
+
+bool GpuPassTimer::BeginFrame(uint32_t slot)
+{
+	m_CurrentSlot = slot;
+	Slot& s = m_Slots[slot];
+	bool collected = s.Pending;
+	if (collected)
+		Collect(s, slot);
+
+	s.PassCount = 0;
+	s.Frame = m_FrameIndex++;
+	s.Pending = false;
+	m_OpenPasses.clear();
+	return collected;
+}
+
+void GpuPassTimer::BeginPass(void* list, const char* name)
+{
+	Slot& slot = m_Slots[m_CurrentSlot];
+	if (slot.PassCount == m_MaxPasses)
+	{
+		m_DroppedPasses++;
+		m_OpenPasses.push_back(Untimed);
+		return;
+	}
+
+	uint32_t pass = slot.PassCount++;
+	slot.Names[pass] = Intern(name);
+	m_Source.WriteTimestamp(list, FirstQuery(m_CurrentSlot) + pass * 2);
+	m_OpenPasses.push_back(pass);
+}
+
+void GpuPassTimer::EndPass(void* list)
+{
+	if (m_OpenPasses.empty())
+		return;
+
+	uint32_t pass = m_OpenPasses.back();
+	m_OpenPasses.pop_back();
+	if (pass != Untimed)
+		m_Source.WriteTimestamp(list, FirstQuery(m_CurrentSlot) + pass * 2 + 1);
+}
+
+void GpuPassTimer::EndFrame(void* list)
+{
+	// A pass left open would resolve a query that was never written.
+	while (!m_OpenPasses.empty())
+		EndPass(list);
+
+	Slot& slot = m_Slots[m_CurrentSlot];
+	if (slot.PassCount == 0)
+		return;
+
+	m_Source.Resolve(list, FirstQuery(m_CurrentSlot), slot.PassCount * 2);
+	slot.Pending = true;
+}
+
+void GpuPassTimer::Collect(Slot& slot, uint32_t slotIndex)
+{
+	uint32_t queryCount = slot.PassCount * 2;
+	m_Source.ReadResults(FirstQuery(slotIndex), queryCount, m_Ticks.data());
+
+	uint64_t gpuBase = 0;
+	int64_t cpuBase = 0;
+	bool calibrated = m_Source.Calibrate(gpuBase, cpuBase);
+	double ticksPerMs = m_Source.TicksPerSecond() / 1000.0;
+	auto toCpuNs = [&](uint64_t ticks)
+		{
+			double deltaMs = ((double)ticks - (double)gpuBase) / ticksPerMs;
+			return cpuBase + (int64_t)(deltaMs * 1e6);
+		};
+
+	m_Results.resize(slot.PassCount);
+	uint64_t first = ~0ull;
+	uint64_t last = 0;
+	for (uint32_t i = 0; i < slot.PassCount; i++)
+	{
+		uint64_t begin = m_Ticks[i * 2];
+		uint64_t end = std::max(m_Ticks[i * 2 + 1], begin);
+
+		GpuPassTiming& timing = m_Results[i];
+		timing.Name = slot.Names[i];
+		timing.Ms = (end - begin) / ticksPerMs;
+		timing.StartNs = calibrated ? toCpuNs(begin) : 0;
+		timing.EndNs = calibrated ? toCpuNs(end) : 0;
+
+		first = std::min(first, begin);
+		last = std::max(last, end);
+	}
+
+	m_FrameMs = (last - first) / ticksPerMs;
+	m_ResultsFrame = slot.Frame;
+	m_HasResults = true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// GPU timestamp queries as GpuPassTimer needs them. The D3D12 implementation is
+// D3D12TimestampQueries; lists are passed as void* so the bookkeeping can be driven by a fake.
+class TimestampQuerySource
+{
+public:
+	virtual ~TimestampQuerySource() = default;
+
+	// Records the GPU time at which list reaches this point into query.
+	virtual void WriteTimestamp(void* list, uint32_t query) = 0;
+
+	// Records a copy of queries [first, first + count) into readback memory at the same indices.
+	virtual void Resolve(void* list, uint32_t first, uint32_t count) = 0;
+
+	// Reads back resolved queries. Only called once the GPU has finished the list that
+	// resolved them.
+	virtual void ReadResults(uint32_t first, uint32_t count, uint64_t* ticks) = 0;
+
+	virtual uint64_t TicksPerSecond() const = 0;
+
+	// A GPU timestamp and the CPU time it corresponds to, on the Profiler::NowNs() clock.
+	// Returns false if the two clocks cannot be correlated.
+	virtual bool Calibrate(uint64_t& gpuTicks, int64_t& cpuNs) = 0;
+};
+
+struct GpuPassTiming
+{
+	// Interned by the timer, valid for as long as it lives.
+	const char* Name = nullptr;
+	double Ms = 0.0;
+
+	// On the Profiler::NowNs() clock, or zero if the clocks could not be correlated.
+	int64_t StartNs = 0;
+	int64_t EndNs = 0;
+};
+
+// Times named GPU passes with a begin and an end timestamp each. Queries and readback memory
+// are split into one region per frame slot, normally one per frame resource: a frame resolves
+// its queries into its own region, and the results are read when the slot comes around again,
+// by which time the CPU has already waited for that frame's fence. Reading never stalls, and
+// the results lag by one frame resource cycle.
+class GpuPassTimer
+{
+public:
+	GpuPassTimer(TimestampQuerySource& source, uint32_t frameSlots, uint32_t maxPassesPerFrame);
+	GpuPassTimer(const GpuPassTimer& rhs) = delete;
+	GpuPassTimer& operator=(const GpuPassTimer& rhs) = delete;
+
+	// Queries the source has to provide.
+	static uint32_t QueryCount(uint32_t frameSlots, uint32_t maxPassesPerFrame) { return frameSlots * maxPassesPerFrame * 2; }
+
+	// Collects the results the slot holds from its previous frame, then starts recording into
+	// it. Returns whether new results were collected.
+	bool BeginFrame(uint32_t slot);
+
+	// Passes may nest. Passes beyond maxPassesPerFrame are not timed.
+	void BeginPass(void* list, const char* name);
+	void EndPass(void* list);
+
+	// Resolves the frame's queries on list, which must be submitted after every list the
+	// passes were recorded on.
+	void EndFrame(void* list);
+
+	// Passes of the most recently collected frame, in the order they began.
+	const std::vector<GpuPassTiming>& Results() const { return m_Results; }
+	uint64_t ResultsFrame() const { return m_ResultsFrame; }
+	bool HasResults() const { return m_HasResults; }
+
+	// First begin to last end of the collected frame.
+	double FrameMs() const { return m_FrameMs; }
+	uint64_t DroppedPasses() const { return m_DroppedPasses; }
+
+private:
+	static constexpr uint32_t Untimed = 0xffffffffu;
+
+	struct Slot
+	{
+		std::vector<const char*> Names;
+		uint32_t PassCount = 0;
+		uint64_t Frame = 0;
+		bool Pending = false;
+	};
+
+	uint32_t FirstQuery(uint32_t slot) const { return slot * m_MaxPasses * 2; }
+	void Collect(Slot& slot, uint32_t slotIndex);
+	const char* Intern(const char* name);
+
+	TimestampQuerySource& m_Source;
+	uint32_t m_MaxPasses;
+	std::vector<Slot> m_Slots;
+	uint32_t m_CurrentSlot = 0;
+	uint64_t m_FrameIndex = 0;
+	std::vector<uint32_t> m_OpenPasses;
+
+	std::unordered_set<std::string> m_NameTable;
+	std::vector<uint64_t> m_Ticks;
+	std::vector<GpuPassTiming> m_Results;
+	uint64_t m_ResultsFrame = 0;
+	bool m_HasResults = false;
+	double m_FrameMs = 0.0;
+	uint64_t m_DroppedPasses = 0;
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Reference to an object in a HandleRegistry<T>. The generation changes every time a slot is
+// reused, so a handle to a removed object resolves to nullptr instead of to its successor.
+template<typename T>
+struct Handle
+{
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+	uint32_t Index = InvalidIndex;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Index != InvalidIndex; }
+	bool operator==(const Handle& rhs) const = default;
+};
+
+// Owns objects of type T in one contiguous array and hands out generational handles to them.
+// Add, Remove and Get are O(1): handles index a slot table that points into the array, and a
+// removal moves the last object into the hole. Pointers returned by Get are only valid until
+// the next Add or Remove. Objects can optionally be registered under a name, for lookups at
+// load time; per-frame code keeps the handle instead.
+template<typename T>
+class HandleRegistry
+{
+public:
+	Handle<T> Add(T value)
+	{
+		uint32_t slot;
+		if (!m_FreeSlots.empty())
+		{
+			slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else
+		{
+			slot = (uint32_t)m_Slots.size();
+			m_Slots.emplace_back();
+		}
+
+		m_Slots[slot].Item = (uint32_t)m_Items.size();
+		m_Items.push_back(std::move(value));
+		m_ItemSlots.push_back(slot);
+
+		return { slot, m_Slots[slot].Generation };
+	}
+
+	Handle<T> Add(const std::string& name, T value)
+	{
+		assert(m_Names.find(name) == m_Names.end());
+		Handle<T> handle = Add(std::move(value));
+		m_Slots[handle.Index].Name = name;
+		m_Names[name] = handle;
+		return handle;
+	}
+
+	bool Remove(Handle<T> handle)
+	{
+		if (!IsAlive(handle))
+			return false;
+
+		Slot& slot = m_Slots[handle.Index];
+		uint32_t last = (uint32_t)m_Items.size() - 1;
+		if (slot.Item != last)
+		{
+			m_Items[slot.Item] = std::move(m_Items[last]);
+			m_ItemSlots[slot.Item] = m_ItemSlots[last];
+			m_Slots[m_ItemSlots[slot.Item]].Item = slot.Item;
+		}
+		m_Items.pop_back();
+		m_ItemSlots.pop_back();
+
+		if (!slot.Name.empty())
+		{
+			m_Names.erase(slot.Name);
+			slot.Name.clear();
+		}
+
+		slot.Item = InvalidItem;
+		slot.Generation++;
+		m_FreeSlots.push_back(handle.Index);
+		return true;
+	}
+
+	bool IsAlive(Handle<T> handle) const
+	{
+		return handle.Index < m_Slots.size() && m_Slots[handle.Index].Generation == handle.Generation &&
+			m_Slots[handle.Index].Item != InvalidItem;
+	}
+
+	T* Get(Handle<T> handle)
+	{
+		return IsAlive(handle) ? &m_Items[m_Slots[handle.Index].Item] : nullptr;
+	}
+
+	const T* Get(Handle<T> handle) const
+	{
+		return IsAlive(handle) ? &m_Items[m_Slots[handle.Index].Item] : nullptr;
+	}
+
+	Handle<T> Find(const std::string& name) const
+	{
+		auto it = m_Names.find(name);
+		return it != m_Names.end() ? it->second : Handle<T>();
+	}
+
+	// The live objects, densely packed, in no particular order.
+	size_t Size() const { return m_Items.size(); }
+	typename std::vector<T>::iterator begin() { return m_Items.begin(); }
+	typename std::vector<T>::iterator end() { return m_Items.end(); }
+	typename std::vector<T>::const_iterator begin() const { return m_Items.begin(); }
+	typename std::vector<T>::const_iterator end() const { return m_Items.end(); }
+
+private:
+	static constexpr uint32_t InvalidItem = UINT32_MAX;
+
+	struct Slot
+	{
+		uint32_t Item = InvalidItem;
+		uint32_t Generation = 0;
+		std::string Name;
+	};
+
+	std::vector<T> m_Items;
+	std::vector<uint32_t> m_ItemSlots;
+	std::vector<Slot> m_Slots;
+	std::vector<uint32_t> m_FreeSlots;
+	std::unordered_map<std::string, Handle<T>> m_Names;
+};
@@ -0,0 +1,72 @@
+#include "IndirectDraw.h"
+#include <algorithm>
+#include <cstring>
+
+IndirectCommandSignature DescribeIndirectDrawSignature(uint32_t instanceOffsetRootParameter)
+{
+	IndirectCommandSignature signature;
+	signature.ByteStride = sizeof(IndirectDrawCommand);
+
+	IndirectArgument vertexBuffer;
+	vertexBuffer.Type = IndirectArgumentType::VertexBufferView;
+	vertexBuffer.Slot = 0;
+	vertexBuffer.ByteOffset = offsetof(IndirectDrawCommand, VertexBuffer);
+	signature.Arguments.push_back(vertexBuffer);
+
+	IndirectArgument indexBuffer;
+	indexBuffer.Type = IndirectArgumentType::IndexBufferView;
+	indexBuffer.ByteOffset = offsetof(IndirectDrawCommand, IndexBuffer);
+	signature.Arguments.push_back(indexBuffer);
+
+	IndirectArgument instanceOffset;
+	instanceOffset.Type = IndirectArgumentType::Constant;
+	instanceOffset.Slot = instanceOffsetRootParameter;
+	instanceOffset.DestOffsetIn32BitValues = 0;
+	instanceOffset.Num32BitValues = 1;
+	instanceOffset.ByteOffset = offsetof(IndirectDrawCommand, InstanceOffset);
+	signature.Arguments.push_back(instanceOffset);
+
+	IndirectArgument draw;
+	draw.Type = IndirectArgumentType::DrawIndexed;
+	draw.ByteOffset = offsetof(IndirectDrawCommand, Draw);
+	signature.Arguments.push_back(draw);
+
+	return signature;
+}
+
+uint32_t CompactIndirectDraws(const IndirectDrawCandidate* candidates, size_t count, const IndirectGeometry* geometries, std::vector<IndirectDrawCommand>& out)
+{
+	out.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		const IndirectDrawCandidate& candidate = candidates[i];
+		if (candidate.InstanceCount == 0)
+			continue;
+
+		IndirectDrawCommand command;
+		command.VertexBuffer = geometries[candidate.Geometry].VertexBuffer;
+		command.IndexBuffer = geometries[candidate.Geometry].IndexBuffer;
+		command.InstanceOffset = candidate.FirstInstance;
+		command.Draw.IndexCountPerInstance = candidate.IndexCount;
+		command.Draw.InstanceCount = candidate.InstanceCount;
+		command.Draw.StartIndexLocation = candidate.StartIndexLocation;
+		command.Draw.BaseVertexLocation = candidate.BaseVertexLocation;
+		command.Draw.StartInstanceLocation = candidate.FirstInstance;
+		out.push_back(command);
+	}
+
+	return (uint32_t)out.size();
+}
+
+bool SameIndirectCommands(const IndirectDrawCommand* a, const IndirectDrawCommand* b, size_t count)
+{
+	// Commands have no padding, so bytewise order is a total order.
+	auto less = [](const IndirectDrawCommand& lhs, const IndirectDrawCommand& rhs) { return memcmp(&lhs, &rhs, sizeof(IndirectDrawCommand)) < 0; };
+
+	std::vector<IndirectDrawCommand> sortedA(a, a + count);
+	std::vector<IndirectDrawCommand> sortedB(b, b + count);
+	std::sort(sortedA.begin(), sortedA.end(), less);
+	std::sort(sortedB.begin(), sortedB.end(), less);
+
+	return memcmp(sortedA.data(), sortedB.data(), count * sizeof(IndirectDrawCommand)) == 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// API-neutral layout of the indirect draw arguments. The structs mirror D3D12's
+// D3D12_VERTEX_BUFFER_VIEW, D3D12_INDEX_BUFFER_VIEW and D3D12_DRAW_INDEXED_ARGUMENTS byte for
+// byte, so a buffer of IndirectDrawCommand can be fed to ExecuteIndirect as is, and a GPU
+// compaction pass can be checked against CompactIndirectDraws on any platform.
+struct IndirectVertexBufferView
+{
+	uint64_t BufferLocation = 0;
+	uint32_t SizeInBytes = 0;
+	uint32_t StrideInBytes = 0;
+};
+
+struct IndirectIndexBufferView
+{
+	uint64_t BufferLocation = 0;
+	uint32_t SizeInBytes = 0;
+	uint32_t Format = 0;
+};
+
+struct IndirectDrawIndexedArgs
+{
+	uint32_t IndexCountPerInstance = 0;
+	uint32_t InstanceCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	uint32_t StartInstanceLocation = 0;
+};
+
+// One command: bind the geometry, set the first-instance root constant, draw. The buffer
+// views come first to keep them 8-byte aligned.
+struct IndirectDrawCommand
+{
+	IndirectVertexBufferView VertexBuffer;
+	IndirectIndexBufferView IndexBuffer;
+	uint32_t InstanceOffset = 0;
+	IndirectDrawIndexedArgs Draw;
+};
+
+static_assert(sizeof(IndirectVertexBufferView) == 16, "Must match D3D12_VERTEX_BUFFER_VIEW");
+static_assert(sizeof(IndirectIndexBufferView) == 16, "Must match D3D12_INDEX_BUFFER_VIEW");
+static_assert(sizeof(IndirectDrawIndexedArgs) == 20, "Must match D3D12_DRAW_INDEXED_ARGUMENTS");
+static_assert(offsetof(IndirectDrawCommand, InstanceOffset) == 32, "Arguments are tightly packed");
+static_assert(offsetof(IndirectDrawCommand, Draw) == 36, "Arguments are tightly packed");
+static_assert(sizeof(IndirectDrawCommand) == 56, "Command stride");
+
+enum class IndirectArgumentType : uint32_t
+{
+	VertexBufferView,
+	IndexBufferView,
+	Constant,
+	DrawIndexed,
+};
+
+struct IndirectArgument
+{
+	IndirectArgumentType Type = IndirectArgumentType::DrawIndexed;
+
+	// Vertex buffer slot, or root parameter index for constants.
+	uint32_t Slot = 0;
+	uint32_t DestOffsetIn32BitValues = 0;
+	uint32_t Num32BitValues = 0;
+
+	// Where the argument starts within a command.
+	uint32_t ByteOffset = 0;
+};
+
+struct IndirectCommandSignature
+{
+	uint32_t ByteStride = 0;
+	std::vector<IndirectArgument> Arguments;
+};
+
+// Signature of IndirectDrawCommand; instanceOffsetRootParameter takes the one 32-bit root
+// constant holding InstanceOffset.
+IndirectCommandSignature DescribeIndirectDrawSignature(uint32_t instanceOffsetRootParameter);
+
+// Buffer views of a geometry the commands can bind.
+struct IndirectGeometry
+{
+	IndirectVertexBufferView VertexBuffer;
+	IndirectIndexBufferView IndexBuffer;
+};
+
+// A potential draw as produced by culling: InstanceCount is how many of its instances
+// survived, stored from FirstInstance on in the instance buffer.
+struct IndirectDrawCandidate
+{
+	uint32_t Geometry = 0;
+	uint32_t IndexCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	uint32_t FirstInstance = 0;
+	uint32_t InstanceCount = 0;
+};
+
+// Reference for the compaction pass: writes one command per candidate with visible
+// instances, in candidate order, and returns the command count. A GPU version appending
+// with an atomic counter may emit them in another order; compare with
+// SameIndirectCommands.
+uint32_t CompactIndirectDraws(const IndirectDrawCandidate* candidates, size_t count, const IndirectGeometry* geometries, std::vector<IndirectDrawCommand>& out);
+
+// True when both ranges hold the same commands, in any order.
+bool SameIndirectCommands(const IndirectDrawCommand* a, const IndirectDrawCommand* b, size_t count);
@@ -0,0 +1,155 @@
+#include "InstanceBatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+CullFrustum FrustumFromViewProj(const float m[16])
+{
+	// Column j of the matrix, as used by p * M.
+	auto column = [m](int j, float out[4])
+	{
+		for (int i = 0; i < 4; i++)
+			out[i] = m[i * 4 + j];
+	};
+
+	float c0[4], c1[4], c2[4], c3[4];
+	column(0, c0);
+	column(1, c1);
+	column(2, c2);
+	column(3, c3);
+
+	CullFrustum frustum;
+	for (int i = 0; i < 4; i++)
+	{
+		frustum.Planes[0][i] = c3[i] + c0[i]; // left
+		frustum.Planes[1][i] = c3[i] - c0[i]; // right
+		frustum.Planes[2][i] = c3[i] + c1[i]; // bottom
+		frustum.Planes[3][i] = c3[i] - c1[i]; // top
+		frustum.Planes[4][i] = c2[i];         // near
+		frustum.Planes[5][i] = c3[i] - c2[i]; // far
+	}
+
+	// Normalise so the plane distance is in world units and can be compared with radii.
+	for (auto& plane : frustum.Planes)
+	{
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (float& v : plane)
+				v /= length;
+		}
+	}
+
+	return frustum;
+}
+
+size_t InstanceBatcher::KeyHash::operator()(const InstanceBatchKey& key) const
+{
+	size_t h = std::hash<const void*>()(key.Geometry);
+	auto combine = [&h](uint32_t v) { h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2); };
+	combine(key.IndexCount);
+	combine(key.StartIndexLocation);
+	combine((uint32_t)key.BaseVertexLocation);
+	combine(key.Material);
+	return h;
+}
+
+void InstanceBatcher::Begin()
+{
+	m_Sources.clear();
+	m_KeyToBatch.clear();
+	m_Keys.clear();
+}
+
+void InstanceBatcher::Add(const InstanceBatchKey& key, const float world[16], const float localCenter[3], float localRadius)
+{
+	auto it = m_KeyToBatch.find(key);
+	if (it == m_KeyToBatch.end())
+	{
+		it = m_KeyToBatch.emplace(key, (uint32_t)m_Keys.size()).first;
+		m_Keys.push_back(key);
+	}
+
+	Source source;
+	source.Batch = it->second;
+	memcpy(source.World, world, sizeof(source.World));
+
+	// Move the bounding sphere to world space; the radius grows with the largest axis scale.
+	for (int i = 0; i < 3; i++)
+		source.Center[i] = localCenter[0] * world[0 * 4 + i] + localCenter[1] * world[1 * 4 + i] + localCenter[2] * world[2 * 4 + i] + world[3 * 4 + i];
+
+	float maxScaleSq = 0.0f;
+	for (int row = 0; row < 3; row++)
+	{
+		const float* r = &world[row * 4];
+		maxScaleSq = std::max(maxScaleSq, r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+	}
+	source.Radius = localRadius * std::sqrt(maxScaleSq);
+
+	m_Sources.push_back(source);
+}
+
+void InstanceBatcher::Build(const CullFrustum& frustum)
+{
+	m_Stats = InstanceStats();
+	m_Stats.Submitted = (uint32_t)m_Sources.size();
+
+	m_Batches.assign(m_Keys.size(), InstanceBatch());
+	for (size_t i = 0; i < m_Keys.size(); i++)
+		m_Batches[i].Key = m_Keys[i];
+
+	m_Visible.clear();
+	for (uint32_t i = 0; i < (uint32_t)m_Sources.size(); i++)
+	{
+		const Source& s = m_Sources[i];
+
+		bool inside = true;
+		for (const auto& plane : frustum.Planes)
+		{
+			if (plane[0] * s.Center[0] + plane[1] * s.Center[1] + plane[2] * s.Center[2] + plane[3] < -s.Radius)
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside)
+		{
+			m_Visible.push_back(i);
+			m_Batches[s.Batch].InstanceCount++;
+		}
+	}
+
+	// Counting sort of the visible instances into one contiguous range per batch.
+	uint32_t first = 0;
+	for (InstanceBatch& batch : m_Batches)
+	{
+		batch.FirstInstance = first;
+		first += batch.InstanceCount;
+	}
+
+	m_Instances.resize(m_Visible.size());
+	m_Cursors.assign(m_Batches.size(), 0);
+
+	for (uint32_t index : m_Visible)
+	{
+		const Source& s = m_Sources[index];
+		InstanceBatch& batch = m_Batches[s.Batch];
+		InstanceData& data = m_Instances[batch.FirstInstance + m_Cursors[s.Batch]++];
+
+		for (int row = 0; row < 4; row++)
+		{
+			for (int col = 0; col < 4; col++)
+				data.World[col * 4 + row] = s.World[row * 4 + col];
+		}
+		data.MaterialIndex = batch.Key.Material;
+	}
+
+	// Drop keys with nothing visible so every batch turns into a draw.
+	m_Batches.erase(std::remove_if(m_Batches.begin(), m_Batches.end(),
+		[](const InstanceBatch& b) { return b.InstanceCount == 0; }), m_Batches.end());
+
+	m_Stats.Visible = (uint32_t)m_Instances.size();
+	m_Stats.Batches = (uint32_t)m_Batches.size();
+}
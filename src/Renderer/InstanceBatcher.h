@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Per-instance record read by the instanced vertex shader (StructuredBuffer<InstanceData>).
+// World is stored transposed, like the constant buffers, for HLSL's column-major packing.
+struct InstanceData
+{
+	float World[16];
+	uint32_t MaterialIndex = 0;
+	uint32_t Pad[3] = {};
+};
+
+// Items that share all of these are drawn with a single instanced draw.
+struct InstanceBatchKey
+{
+	const void* Geometry = nullptr;
+	uint32_t IndexCount = 0;
+	uint32_t StartIndexLocation = 0;
+	int32_t BaseVertexLocation = 0;
+	uint32_t Material = 0;
+
+	bool operator==(const InstanceBatchKey& rhs) const = default;
+};
+
+struct InstanceBatch
+{
+	InstanceBatchKey Key;
+	uint32_t FirstInstance = 0;
+	uint32_t InstanceCount = 0;
+};
+
+// Six planes (a, b, c, d) with normals pointing inwards: a point p is inside a plane when
+// dot(n, p) + d >= 0.
+struct CullFrustum
+{
+	float Planes[6][4] = {};
+};
+
+// Extracts the frustum of a row-vector view-projection matrix (p' = p * M, D3D clip space
+// with 0 <= z <= w), stored row-major.
+CullFrustum FrustumFromViewProj(const float viewProj[16]);
+
+struct InstanceStats
+{
+	uint32_t Submitted = 0;
+	uint32_t Visible = 0;
+	uint32_t Batches = 0;
+};
+
+// Collects instances for a frame, culls them against the camera frustum and groups the
+// survivors by InstanceBatchKey into contiguous ranges of one instance buffer.
+class InstanceBatcher
+{
+public:
+	void Begin();
+
+	// world is a row-major, row-vector matrix; the bounding sphere is in local space.
+	void Add(const InstanceBatchKey& key, const float world[16], const float localCenter[3], float localRadius);
+
+	// Culls and groups everything added since Begin(). Batches come out in the order their key
+	// was first added.
+	void Build(const CullFrustum& frustum);
+
+	const std::vector<InstanceData>& Instances() const { return m_Instances; }
+	const std::vector<InstanceBatch>& Batches() const { return m_Batches; }
+	const InstanceStats& GetStats() const { return m_Stats; }
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const InstanceBatchKey& key) const;
+	};
+
+	struct Source
+	{
+		uint32_t Batch = 0;
+		float World[16];
+		float Center[3];
+		float Radius = 0.0f;
+	};
+
+	std::vector<Source> m_Sources;
+	std::unordered_map<InstanceBatchKey, uint32_t, KeyHash> m_KeyToBatch;
+	std::vector<InstanceBatchKey> m_Keys;
+	std::vector<uint32_t> m_Visible;
+	std::vector<uint32_t> m_Cursors;
+
+	std::vector<InstanceData> m_Instances;
+	std::vector<InstanceBatch> m_Batches;
+	InstanceStats m_Stats;
+};
@@ -0,0 +1,57 @@
+#include "ParallelRecorder.h"
+#include "../Utils/JobSystem.h"
+#include <algorithm>
+
+std::vector<DrawBatch> PartitionDraws(uint32_t itemCount, uint32_t maxBatches, uint32_t minBatchSize)
+{
+	std::vector<DrawBatch> batches;
+	if (itemCount == 0)
+		return batches;
+
+	minBatchSize = std::max(minBatchSize, 1u);
+	uint32_t batchCount = std::max(1u, std::min(std::max(maxBatches, 1u), itemCount / minBatchSize));
+
+	// Spread the remainder over the first batches so sizes differ by at most one.
+	uint32_t baseSize = itemCount / batchCount;
+	uint32_t remainder = itemCount % batchCount;
+
+	uint32_t begin = 0;
+	for (uint32_t i = 0; i < batchCount; i++)
+	{
+		uint32_t size = baseSize + (i < remainder ? 1 : 0);
+		batches.push_back({ begin, begin + size });
+		begin += size;
+	}
+
+	return batches;
+}
+
+ParallelRecorder::ParallelRecorder(JobSystem& jobs, uint32_t maxThreads)
+	: m_Jobs(jobs), m_MaxThreads(std::max(maxThreads, 1u))
+{
+}
+
+uint32_t ParallelRecorder::ThreadCount() const
+{
+	return std::min(m_Jobs.ThreadCount(), m_MaxThreads);
+}
+
+void ParallelRecorder::Record(CommandListSource& source, const std::vector<DrawBatch>& batches, const RecordFn& record)
+{
+	if (batches.empty())
+		return;
+
+	m_Lists.clear();
+	for (size_t i = 0; i < batches.size(); i++)
+		m_Lists.push_back(source.Acquire());
+
+	// One batch per job. A batch that throws is not closed; ParallelFor waits for the others.
+	m_Jobs.ParallelFor(0, (uint32_t)batches.size(), 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				record(m_Lists[i], batches[i]);
+				source.Close(m_Lists[i]);
+			}
+		});
+}
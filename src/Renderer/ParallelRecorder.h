@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class JobSystem;
+
+// A contiguous range of draws recorded into one command list.
+struct DrawBatch
+{
+	uint32_t Begin = 0;
+	uint32_t End = 0;
+};
+
+// Splits itemCount draws into at most maxBatches contiguous, evenly sized batches that hold at
+// least minBatchSize draws each (except when there are fewer draws than that in total).
+std::vector<DrawBatch> PartitionDraws(uint32_t itemCount, uint32_t maxBatches, uint32_t minBatchSize);
+
+// Supplies command lists in submission order. The D3D12 implementation is CommandListPool;
+// lists are passed around as void* so the scheduler can be driven by a mock.
+class CommandListSource
+{
+public:
+	virtual ~CommandListSource() = default;
+
+	// Next list in submission order, open for recording. Only called on the thread that
+	// calls ParallelRecorder::Record.
+	virtual void* Acquire() = 0;
+
+	// Called on the recording thread once a batch is done.
+	virtual void Close(void* list) = 0;
+};
+
+// Records batches of draws on the job system, one job per batch. Lists are acquired up front
+// on the calling thread, one per batch and in batch order, so the submission order never
+// depends on which thread finished first.
+class ParallelRecorder
+{
+public:
+	using RecordFn = std::function<void(void* list, const DrawBatch& batch)>;
+
+	// Records on at most maxThreads of the job system's threads, counting the calling one.
+	ParallelRecorder(JobSystem& jobs, uint32_t maxThreads);
+
+	// Threads that record, including the calling thread; the most batches worth splitting into.
+	uint32_t ThreadCount() const;
+
+	// Blocks until every batch is recorded and closed, running batches on the calling thread
+	// meanwhile. An exception thrown by record is rethrown here after the other batches have
+	// finished.
+	void Record(CommandListSource& source, const std::vector<DrawBatch>& batches, const RecordFn& record);
+
+private:
+	JobSystem& m_Jobs;
+	uint32_t m_MaxThreads;
+	std::vector<void*> m_Lists;
+};
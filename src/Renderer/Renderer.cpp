@@ -1,58 +1,39 @@
 #include "Renderer.h"
-#define STB_PERLIN_IMPLEMENTATION
+#include "../Utils/FrameArena.h"
+#include "../Utils/MeshLoader.h"
 #include "stb_perlin.h"
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_win32.h"
 #include "imgui/backends/imgui_impl_dx12.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <dxgi1_5.h>
 
 const int gNumFrameResources = 3;
 
-// Simple free list based allocator
-struct ExampleDescriptorHeapAllocator
+static double PacingNow()
 {
-	ID3D12DescriptorHeap* Heap = nullptr;
-	D3D12_DESCRIPTOR_HEAP_TYPE  HeapType = D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES;
-	D3D12_CPU_DESCRIPTOR_HANDLE HeapStartCpu;
-	D3D12_GPU_DESCRIPTOR_HANDLE HeapStartGpu;
-	UINT                        HeapHandleIncrement;
-	ImVector<int>               FreeIndices;
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-	void Create(ID3D12Device* device, ID3D12DescriptorHeap* heap)
-	{
-		IM_ASSERT(Heap == nullptr && FreeIndices.empty());
-		Heap = heap;
-		D3D12_DESCRIPTOR_HEAP_DESC desc = heap->GetDesc();
-		HeapType = desc.Type;
-		HeapStartCpu = Heap->GetCPUDescriptorHandleForHeapStart();
-		HeapStartGpu = Heap->GetGPUDescriptorHandleForHeapStart();
-		HeapHandleIncrement = device->GetDescriptorHandleIncrementSize(HeapType);
-		FreeIndices.reserve((int)desc.NumDescriptors);
-		for (int n = desc.NumDescriptors; n > 0; n--)
-			FreeIndices.push_back(n - 1);
-	}
-	void Destroy()
-	{
-		Heap = nullptr;
-		FreeIndices.clear();
-	}
-	void Alloc(D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_desc_handle)
-	{
-		IM_ASSERT(FreeIndices.Size > 0);
-		int idx = FreeIndices.back();
-		FreeIndices.pop_back();
-		out_cpu_desc_handle->ptr = HeapStartCpu.ptr + (idx * HeapHandleIncrement);
-		out_gpu_desc_handle->ptr = HeapStartGpu.ptr + (idx * HeapHandleIncrement);
-	}
-	void Free(D3D12_CPU_DESCRIPTOR_HANDLE out_cpu_desc_handle, D3D12_GPU_DESCRIPTOR_HANDLE out_gpu_desc_handle)
-	{
-		int cpu_idx = (int)((out_cpu_desc_handle.ptr - HeapStartCpu.ptr) / HeapHandleIncrement);
-		int gpu_idx = (int)((out_gpu_desc_handle.ptr - HeapStartGpu.ptr) / HeapHandleIncrement);
-		IM_ASSERT(cpu_idx == gpu_idx);
-		FreeIndices.push_back(cpu_idx);
-	}
-};
+static Transform MakeTransform(FXMVECTOR scale, FXMVECTOR rotation, FXMVECTOR position)
+{
+	Transform transform;
+	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(transform.Scale), scale);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(transform.Rotation), rotation);
+	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(transform.Position), position);
+	return transform;
+}
 
-static ExampleDescriptorHeapAllocator g_pd3dSrvDescHeapAlloc;
+static std::unique_ptr<Waves> CreateWaves(JobSystem& jobs)
+{
+	return std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f, jobs);
+}
+
+// Prop counts offered in the UI, selected by m_PropCountIndex.
+static const char* const PropCountNames[] = { "None", "1k", "10k", "100k" };
+static const UINT PropCountValues[] = { 0, 1000, 10000, 100000 };
 
 Renderer::Renderer(HWND& windowHandle, UINT width, UINT height, Camera& cam)
 	:m_Hwnd(windowHandle),
@@ -64,6 +45,49 @@ Renderer::Renderer(HWND& windowHandle, UINT width, UINT height, Camera& cam)
 	InitializeD3D12(m_Hwnd);
 }
 
+Renderer::~Renderer()
+{
+	FlushCommandQueue();
+
+	if (m_ShaderReload.valid())
+		m_ShaderReload.wait();
+
+	if (m_FrameLatencyWaitable)
+	{
+		CloseHandle(m_FrameLatencyWaitable);
+	}
+	if (m_FenceEvent)
+	{
+		CloseHandle(m_FenceEvent);
+	}
+}
+
+void Renderer::BeginFrame()
+{
+	PROFILE_FUNCTION();
+	int64_t start = Profiler::NowNs();
+
+	// The waitable object signals once the swap chain has room for another frame, so the
+	// frame does not sit in the present queue and the input sampled next stays fresh.
+	if (m_FrameLatencyWaitable)
+		WaitForSingleObjectEx(m_FrameLatencyWaitable, 1000, true);
+
+	double wait = m_Pacer.LimiterWait(PacingNow());
+	if (wait > 0.0)
+		SleepPrecise(wait);
+
+	m_PacingWaitNs = Profiler::NowNs() - start;
+	m_Pacer.OnInputSampled(PacingNow());
+	FrameArena::BeginFrame();
+}
+
+void Renderer::SetVSync(bool enabled)
+{
+	FramePacingSettings pacing = m_Pacer.Settings();
+	pacing.VSync = enabled;
+	m_Pacer.SetSettings(pacing);
+}
+
 bool Renderer::InitializeD3D12(HWND& windowHandle)
 {
 #if defined(DEBUG) || defined(_DEBUG)
@@ -87,9 +111,22 @@ bool Renderer::InitializeD3D12(HWND& windowHandle)
 
 	CreateCommandObjects();
 
+	m_Uploads = std::make_unique<UploadService>(m_Device.Get(), gNumFrameResources);
+	m_Bindless = std::make_unique<BindlessHeap>(m_Device.Get(), BindlessHeapCapacity);
+	m_FrameGraphBackend = std::make_unique<D3D12FrameGraphBackend>(m_Device.Get());
+	m_TimestampQueries = std::make_unique<D3D12TimestampQueries>(m_Device.Get(), m_CommandQueue.Get(), GpuPassTimer::QueryCount(NumFrameResources, MaxGpuPasses));
+	m_GpuTimer = std::make_unique<GpuPassTimer>(*m_TimestampQueries, NumFrameResources, MaxGpuPasses);
+	m_FrameGraphBackend->SetPassTimer(m_GpuTimer.get());
+	m_GpuProfilerTrack = Profiler::Get().CreateTrack("GPU");
+	m_PipelineCache = std::make_unique<D3D12PipelineCache>(m_Device.Get(), "ShaderCache");
+
+	m_Jobs = std::make_unique<JobSystem>(JobSystem::DefaultWorkerCount());
+	m_Recorder = std::make_unique<ParallelRecorder>(*m_Jobs, MaxRecordingThreads);
+
 	m_BackBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
 
 	CreateSwapChain(windowHandle);
+	RegisterMetrics();
 
 	CreateRtvAndDsvDescriptorHeaps();
 
@@ -103,10 +140,10 @@ bool Renderer::InitializeD3D12(HWND& windowHandle)
 	//XMStoreFloat4x4(&m_View, m_Camera.GetView());
 
 	m_CbvSrvDescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	m_Waves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	m_Waves = CreateWaves(*m_Jobs);
 
-	HeightMap hm = GeneratePerlinHeightmap(m_TerrainWidth, m_TerrainHeight, m_TerrainHeightScale, m_TerrainNoiseOctaves, m_TerrainNoisePersistance, m_TerrainNoiseSeed);
-	CreateHeightMapTexture(hm);
+	m_CpuHeightMap = GeneratePerlinHeightmap(m_TerrainWidth, m_TerrainHeight, TerrainNoiseSettings(), *m_Jobs);
+	CreateHeightMapTexture(m_CpuHeightMap);
 
 	//	CreateCbvDescriptorHeaps();
 	LoadTextures();
@@ -114,19 +151,36 @@ bool Renderer::InitializeD3D12(HWND& windowHandle)
 	CreateTextureSrvDescriptors();
 	CreateOpaqueRootSignature();
 	CreateTransparentRootSignature();
+	CreateIndirectCommandSignature();
 
+	auto pipelineBuildStart = std::chrono::high_resolution_clock::now();
 	BuildShadersAndInputLayout();
+	auto pipelineBuildEnd = std::chrono::high_resolution_clock::now();
+	m_PipelineBuildMs = std::chrono::duration<double, std::milli>(pipelineBuildEnd - pipelineBuildStart).count();
+
 	BuildShapeGeometry();
-	BuildLandGeometry(hm.width, hm.height);
+	BuildLandGeometry(m_CpuHeightMap.width, m_CpuHeightMap.height);
 	BuildSkullGeometry();
 	BuildMaterials();
 	BuildWavesGeometry();
 	BuildRenderItems();
 	BuildFrameResources();
 
+	pipelineBuildStart = std::chrono::high_resolution_clock::now();
 	BuildPSOs();
+	m_PipelineCache->Save();
+	pipelineBuildEnd = std::chrono::high_resolution_clock::now();
+	m_PipelineBuildMs += std::chrono::duration<double, std::milli>(pipelineBuildEnd - pipelineBuildStart).count();
+
+	// One line per launch, so cold (empty cache) and warm startups can be compared from the log.
+	D3D12PipelineCache::Stats cacheStats = m_PipelineCache->GetStats();
+	char pipelineLog[160];
+	snprintf(pipelineLog, sizeof(pipelineLog), "Shaders and pipelines built in %.2f ms (%s cache: %u/%u shaders, %u/%u pipelines cached)\n",
+		m_PipelineBuildMs, cacheStats.ShaderMisses == 0 && cacheStats.PipelineMisses == 0 ? "warm" : "cold",
+		cacheStats.ShaderHits, cacheStats.ShaderHits + cacheStats.ShaderMisses,
+		cacheStats.PipelineHits, cacheStats.PipelineHits + cacheStats.PipelineMisses);
+	::OutputDebugStringA(pipelineLog);
 
-	CreateImGuiDescriptorHeap();
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
@@ -139,20 +193,29 @@ bool Renderer::InitializeD3D12(HWND& windowHandle)
 	init_info.CommandQueue = m_CommandQueue.Get();
 	init_info.NumFramesInFlight = SwapChainBufferCount;
 	init_info.RTVFormat = m_BackBufferFormat; // Or your render target format.
+	init_info.UserData = this;
 
-	//Allocating SRV descriptors (for textures) is up to the application, so we provide callbacks.
-	//The example_win32_directx12/main.cpp application include a simple free-list based allocator.
-	g_pd3dSrvDescHeapAlloc.Create(m_Device.Get(), m_ImGuiSrvHeap.Get());
-	init_info.SrvDescriptorHeap = m_ImGuiSrvHeap.Get();
-	init_info.SrvDescriptorAllocFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_handle) { return g_pd3dSrvDescHeapAlloc.Alloc(out_cpu_handle, out_gpu_handle); };
-	init_info.SrvDescriptorFreeFn = [](ImGui_ImplDX12_InitInfo*, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle) { return g_pd3dSrvDescHeapAlloc.Free(cpu_handle, gpu_handle);  };
-
-	imguiCpuStart = m_ImGuiSrvHeap->GetCPUDescriptorHandleForHeapStart();
-	imguiGpuStart = m_ImGuiSrvHeap->GetGPUDescriptorHandleForHeapStart();
+	// ImGui allocates its texture descriptors from the bindless heap too, so the heap bound
+	// for the scene passes stays bound while it renders.
+	init_info.SrvDescriptorHeap = m_Bindless->Heap();
+	init_info.SrvDescriptorAllocFn = [](ImGui_ImplDX12_InitInfo* info, D3D12_CPU_DESCRIPTOR_HANDLE* out_cpu_handle, D3D12_GPU_DESCRIPTOR_HANDLE* out_gpu_handle)
+	{
+		Renderer* renderer = static_cast<Renderer*>(info->UserData);
+		DescriptorHandle handle = renderer->m_Bindless->Allocate();
+		*out_cpu_handle = renderer->m_Bindless->CpuHandle(handle);
+		*out_gpu_handle = renderer->m_Bindless->GpuHandle(handle);
+	};
+	init_info.SrvDescriptorFreeFn = [](ImGui_ImplDX12_InitInfo* info, D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle)
+	{
+		Renderer* renderer = static_cast<Renderer*>(info->UserData);
+		renderer->m_Bindless->Free(gpu_handle, (UINT64)renderer->m_CurrentFence + 1);
+	};
 
 	ImGui_ImplDX12_Init(&init_info);
 	ImGui_ImplWin32_Init(m_Hwnd);
 
+	m_TextureUploadFence = m_Uploads->Submit();
+	m_TerrainUploadFence = m_TextureUploadFence;
 
 	ThrowIfFailed(m_CommandList->Close());
 	ID3D12CommandList* cmdLists[] = { m_CommandList.Get() };
@@ -163,148 +226,221 @@ bool Renderer::InitializeD3D12(HWND& windowHandle)
 
 void Renderer::Update(GameTimer& gt, Camera& cam)
 {
+	PROFILE_FUNCTION();
 	m_CurrentFrameResourceIndex = (m_CurrentFrameResourceIndex + 1) % NumFrameResources;
 	m_CurrentFrameResource = m_FrameResources[m_CurrentFrameResourceIndex].get();
 
-	if (m_CurrentFrameResource->Fence != 0 && m_Fence->GetCompletedValue() < m_CurrentFrameResource->Fence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(m_Fence->SetEventOnCompletion(m_CurrentFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
-
-	cam.UpdateViewMatrix();
-	XMStoreFloat4x4(&m_View, cam.GetView());
-	XMStoreFloat4x4(&m_Proj, cam.GetProj());
-	m_EyePos = cam.GetPosition3f();
-
-
-	UpdateObjectCBs();
-	UpdateMainPassCB();
-	UpdateMaterialCBs();
-	UpdateWaves(gt);
-	UpdateWaterCB(gt);
+	// The frame resource about to be reused has to be free, and no more than
+	// MaxFramesInFlight frames may be queued on the GPU.
+	int64_t waitStart = Profiler::NowNs();
+	WaitForFence(std::max<UINT64>(m_CurrentFrameResource->Fence, m_Pacer.FenceToWaitFor()));
+	int64_t updateStart = Profiler::NowNs();
+	m_FenceWaitNs = updateStart - waitStart;
+
+	ReleaseRetiredResources();
+	m_Bindless->CollectFrees(m_Fence->GetCompletedValue());
+	m_Uploads->BeginFrame();
+	UpdateShaderHotReload();
+
+	// Each phase writes its own buffers in the current frame resource, so the only ordering
+	// between them is the camera. The wave step is the longest and is declared first, so a
+	// worker picks it up while the rest run alongside.
+	m_UpdateGraph.Reset();
+	TaskDataId camera = m_UpdateGraph.DeclareData("Camera");
+	TaskDataId objectCB = m_UpdateGraph.DeclareData("ObjectCB");
+	TaskDataId passCB = m_UpdateGraph.DeclareData("PassCB");
+	TaskDataId materialCB = m_UpdateGraph.DeclareData("MaterialCB");
+	TaskDataId instances = m_UpdateGraph.DeclareData("InstanceBuffer");
+	TaskDataId waves = m_UpdateGraph.DeclareData("WavesVB");
+	TaskDataId waterCB = m_UpdateGraph.DeclareData("WaterCB");
+
+	m_UpdateGraph.AddTask("Waves", [this, &gt]() { UpdateWaves(gt); }).Write(waves);
+	m_UpdateGraph.AddTask("Camera", [this, &cam]()
+		{
+			PROFILE_SCOPE("Camera");
+			cam.UpdateViewMatrix();
+			XMStoreFloat4x4(&m_View, cam.GetView());
+			XMStoreFloat4x4(&m_Proj, cam.GetProj());
+			m_EyePos = cam.GetPosition3f();
+		}).Write(camera);
+	m_UpdateGraph.AddTask("ObjectCBs", [this]() { UpdateObjectCBs(); }).Write(objectCB);
+	m_UpdateGraph.AddTask("MainPassCB", [this]() { UpdateMainPassCB(); }).Read(camera).Write(passCB);
+	m_UpdateGraph.AddTask("MaterialCBs", [this]() { UpdateMaterialCBs(); }).Write(materialCB);
+	m_UpdateGraph.AddTask("Instances", [this]() { UpdateInstanceBuffers(); }).Read(camera).Write(instances);
+	m_UpdateGraph.AddTask("WaterCB", [this, &gt]() { UpdateWaterCB(gt); }).Read(camera).Write(waterCB);
+	m_UpdateGraph.Execute(*m_Jobs);
+	m_UpdateNs = Profiler::NowNs() - updateStart;
 }
 
 void Renderer::Draw()
 {
+	PROFILE_FUNCTION();
+	int64_t drawStart = Profiler::NowNs();
+	m_TerrainRegenerated = false;
 	ImGui_ImplDX12_NewFrame();
 	ImGui_ImplWin32_NewFrame();
-	ImGui::NewFrame();
-	ShowImGUIEnvironmentControl();
-
-	showImgui = true;
-	ImGui::Render();
+	{
+		PROFILE_SCOPE("ImGui");
+		ImGui::NewFrame();
+		ShowImGUIEnvironmentControl();
 
-	auto cmdListAlloc = m_CurrentFrameResource->CmdListAlloc;
+		showImgui = true;
+		ImGui::Render();
+	}
 
-	ThrowIfFailed(cmdListAlloc->Reset());
+	CommandListPool& commandLists = *m_CurrentFrameResource->CommandLists;
+	commandLists.BeginFrame(m_Bindless->Heap());
+	m_FrameCommandList = commandLists.AcquireList();
 
-	ThrowIfFailed(m_CommandList->Reset(cmdListAlloc.Get(), m_PipelineStateObjects["opaque"].Get()));
+	// This frame resource's fence has been waited for, so its timestamps are ready to read.
+	if (m_GpuTimer->BeginFrame(m_CurrentFrameResourceIndex))
+	{
+		for (const GpuPassTiming& timing : m_GpuTimer->Results())
+		{
+			if (timing.StartNs != 0)
+				Profiler::Get().AddTrackScope(m_GpuProfilerTrack, timing.Name, timing.StartNs, timing.EndNs);
+		}
+	}
 
 	if (m_NeedRegen)
 	{
-		FlushCommandQueue();
-		m_TerrainConstantsCB.gTerrainSize = XMFLOAT2(m_TerrainWidth, m_TerrainHeight);
-		m_TerrainConstantsCPU.gHeightScale = m_TerrainHeightScale;
 		RegenerateHeightMap();
 		UpdateHeightMapTexture();
+		BuildPropRenderItems((UINT)m_PropRenderItems.size());
+		RebuildLandGeometry((float)m_TerrainWidth, (float)m_TerrainHeight);
+		m_TerrainUploadFence = m_Uploads->Submit();
 		UpdateHeightMapSrv();
-		RebuildLandGeometry(m_TerrainConstantsCB.gTerrainSize.x, m_TerrainConstantsCB.gTerrainSize.y);
 		RebuildLandRenderItem();
 		m_NeedRegen = false;
+		m_TerrainRegenerated = true;
 	}
 	UpdateTerrainCB();
 
-	D3D12_VIEWPORT vp;
-	vp.TopLeftX = 0.0f;
-	vp.TopLeftY = 0.0f;
-	vp.Width = m_ClientWidth;
-	vp.Height = m_ClientHeight;
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-
-	m_CommandList->RSSetViewports(1, &vp);
+	m_ScreenViewport.TopLeftX = 0.0f;
+	m_ScreenViewport.TopLeftY = 0.0f;
+	m_ScreenViewport.Width = m_ClientWidth;
+	m_ScreenViewport.Height = m_ClientHeight;
+	m_ScreenViewport.MinDepth = 0.0f;
+	m_ScreenViewport.MaxDepth = 1.0f;
 
 	m_ScissorRect = { 0, 0, static_cast<long>(m_ClientWidth), static_cast<long>(m_ClientHeight) };
-	m_CommandList->RSSetScissorRects(1, &m_ScissorRect);
 
-	m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-	m_CommandList->ClearRenderTargetView(CurrentBackBufferView(), DirectX::Colors::Fuchsia, 0, nullptr);
-	m_CommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
-	m_CommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	if (m_WireframeMode)
+	// Barriers between the passes below are planned by the frame graph from what each pass
+	// reads and writes.
+	m_FrameGraph.Reset();
+	FgResourceId backBuffer = m_FrameGraph.ImportTexture("BackBuffer", CurrentBackBuffer(), FgState::Present, FgState::Present);
+	FgResourceId sceneDepth = m_FrameGraph.ImportTexture("SceneDepth", m_DepthStencilBuffer.Get(), FgState::DepthWrite, FgState::DepthWrite);
+
+	// Pipeline state is looked up here rather than in the recording callbacks, which may run
+	// on worker threads.
+	uint32_t features = m_ShaderFeatures | (m_WireframeMode ? ShaderFeatureWireframeDebug : 0);
+	ID3D12PipelineState* opaquePso = GetPipeline(m_TerrainPipelines[m_TerrainPermutations.VariantIndex(features)]);
+	ID3D12PipelineState* skyPso = GetPipeline(m_SkyPipeline);
+	ID3D12PipelineState* waterPso = GetPipeline(m_WaterPipelines[m_WaterPermutations.VariantIndex(features)]);
+	ID3D12PipelineState* instancedPso = GetPipeline(m_WireframeMode ? m_InstancedWireframePipeline : m_InstancedPipeline);
+
+	// Draw packets are sorted by pipeline, geometry and material so the recorders only set
+	// state that actually changes. Blended water keeps its submission order.
+	m_DrawPipelines.assign({ opaquePso, skyPso, waterPso });
+	m_DrawGeometries.clear();
+	BuildDrawPackets(m_OpaqueRenderItems, DrawPipelineOpaque, false, m_OpaqueDraws);
+	BuildDrawPackets(m_SkyRenderItems, DrawPipelineSky, false, m_SkyDraws);
+	BuildDrawPackets(m_TransparentRenderItems, DrawPipelineWater, true, m_TransparentDraws);
+
+	m_FrameGraph.AddPass("Opaque", [this, opaquePso](FrameGraph&)
+		{
+			m_FrameCommandList->ClearRenderTargetView(CurrentBackBufferView(), DirectX::Colors::Fuchsia, 0, nullptr);
+			m_FrameCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+
+			RecordDraws(m_OpaqueDraws, DrawPipelineOpaque, [this, opaquePso](ID3D12GraphicsCommandList* cmdList)
+				{
+					SetPassState(cmdList, m_OpaqueRootSignature.Get(), opaquePso, m_CurrentFrameResource->TerrainCB->Resource());
+				});
+		})
+		.Write(backBuffer, FgState::RenderTarget)
+		.Write(sceneDepth, FgState::DepthWrite);
+
+	if (!m_InstanceBatcher.Batches().empty())
 	{
-		m_CommandList->SetPipelineState(m_PipelineStateObjects["wireframe"].Get());
+		m_FrameGraph.AddPass("Props", [this, instancedPso](FrameGraph&)
+			{
+				SetPassState(m_FrameCommandList, m_OpaqueRootSignature.Get(), instancedPso, m_CurrentFrameResource->TerrainCB->Resource());
+				DrawInstanceBatches(m_FrameCommandList);
+			})
+			.Write(backBuffer, FgState::RenderTarget)
+			.Write(sceneDepth, FgState::DepthWrite);
 	}
-	else
+
+	m_FrameGraph.AddPass("Sky", [this, skyPso](FrameGraph&)
+		{
+			RecordDraws(m_SkyDraws, DrawPipelineSky, [this, skyPso](ID3D12GraphicsCommandList* cmdList)
+				{
+					SetPassState(cmdList, m_OpaqueRootSignature.Get(), skyPso, m_CurrentFrameResource->TerrainCB->Resource());
+				});
+		})
+		.Write(backBuffer, FgState::RenderTarget)
+		.Write(sceneDepth, FgState::DepthWrite);
+
+	m_FrameGraph.AddPass("Water", [this, waterPso](FrameGraph&)
+		{
+			RecordDraws(m_TransparentDraws, DrawPipelineWater, [this, waterPso](ID3D12GraphicsCommandList* cmdList)
+				{
+					SetPassState(cmdList, m_TransparentRootSignature.Get(), waterPso, m_CurrentFrameResource->WaterCB->Resource());
+				});
+		})
+		.Write(backBuffer, FgState::RenderTarget)
+		.Read(sceneDepth, FgState::DepthRead | FgState::PixelShaderResource);
+
+	m_FrameGraph.AddPass("ImGui", [this](FrameGraph&)
+		{
+			m_FrameCommandList->RSSetViewports(1, &m_ScreenViewport);
+			m_FrameCommandList->RSSetScissorRects(1, &m_ScissorRect);
+			m_FrameCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, nullptr);
+			ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_FrameCommandList);
+		})
+		.Write(backBuffer, FgState::RenderTarget);
+
+	m_FrameGraphBackend->BeginFrame(m_FrameCommandList, (UINT64)m_CurrentFence + 1, m_Fence->GetCompletedValue());
 	{
-		m_CommandList->SetPipelineState(m_PipelineStateObjects["opaque"].Get());
+		PROFILE_SCOPE("FrameGraph");
+		m_FrameGraph.Compile(*m_FrameGraphBackend);
+		m_FrameGraph.Execute(*m_FrameGraphBackend);
 	}
-	m_CommandList->SetGraphicsRootSignature(m_OpaqueRootSignature.Get());
-
-
-	auto passCB = m_CurrentFrameResource->PassCB->Resource();
-	m_CommandList->SetGraphicsRootConstantBufferView(3, passCB->GetGPUVirtualAddress());
-	auto terrainCB = m_CurrentFrameResource->TerrainCB->Resource();
-	m_CommandList->SetGraphicsRootConstantBufferView(4, terrainCB->GetGPUVirtualAddress());
-
-	ID3D12DescriptorHeap* descriptorHeaps[] = { m_TexSrvHeap.Get() };
-	m_CommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-	D3D12_GPU_DESCRIPTOR_HANDLE tex = m_TexSrvHeap->GetGPUDescriptorHandleForHeapStart();
-	m_CommandList->SetGraphicsRootDescriptorTable(0, tex);
-
-
-	DrawRenderItems(m_CommandList.Get(), m_OpaqueRenderItems);
-
-	m_CommandList->SetPipelineState(m_PipelineStateObjects["sky"].Get());
-	m_CommandList->SetGraphicsRootSignature(m_OpaqueRootSignature.Get());
-	m_CommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-	passCB = m_CurrentFrameResource->PassCB->Resource();
-	m_CommandList->SetGraphicsRootConstantBufferView(3, passCB->GetGPUVirtualAddress());
-	tex = m_TexSrvHeap->GetGPUDescriptorHandleForHeapStart();
-	m_CommandList->SetGraphicsRootDescriptorTable(0, tex);
+	m_GpuTimer->EndFrame(m_FrameCommandList);
 
-	DrawRenderItems(m_CommandList.Get(), m_SkyRenderItems);
+	m_DrawStats = DrawCallStats();
+	m_DrawStats += m_OpaqueDraws.Stats;
+	m_DrawStats += m_SkyDraws.Stats;
+	m_DrawStats += m_TransparentDraws.Stats;
 
-	m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_DepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-	m_CommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+	ThrowIfFailed(m_FrameCommandList->Close());
+	m_FrameCommandList = nullptr;
 
-	m_CommandList->SetPipelineState(m_PipelineStateObjects["water"].Get());
-	m_CommandList->SetGraphicsRootSignature(m_TransparentRootSignature.Get());
-	ID3D12DescriptorHeap* descriptorHeaps2[] = { m_SrvHeap.Get() };
-	m_CommandList->SetDescriptorHeaps(_countof(descriptorHeaps2), descriptorHeaps2);
+	m_Uploads->WaitOnQueue(m_CommandQueue.Get(), m_TextureUploadFence);
+	m_Uploads->WaitOnQueue(m_CommandQueue.Get(), m_TerrainUploadFence);
 
-	passCB = m_CurrentFrameResource->PassCB->Resource();
-	m_CommandList->SetGraphicsRootConstantBufferView(3, passCB->GetGPUVirtualAddress());
-	auto waterCB = m_CurrentFrameResource->WaterCB->Resource();
-	m_CommandList->SetGraphicsRootConstantBufferView(4, waterCB->GetGPUVirtualAddress());
-	tex = m_SrvHeap->GetGPUDescriptorHandleForHeapStart();
-	m_CommandList->SetGraphicsRootDescriptorTable(0, tex);
-
-	DrawRenderItems(m_CommandList.Get(), m_TransparentRenderItems);
-	m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_DepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
-
-	m_CommandList->SetDescriptorHeaps(1, m_ImGuiSrvHeap.GetAddressOf());
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_CommandList.Get());
-
-
-	m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-	ThrowIfFailed(m_CommandList->Close());
-
-	ID3D12CommandList* cmdLists[] = { m_CommandList.Get() };
-	m_CommandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+	// Every list recorded this frame, in order, in one submission.
+	commandLists.Execute(m_CommandQueue.Get());
+	m_UploadBytesPerFrame = m_CurrentFrameResource->TakeUploadBytes();
 
-	ThrowIfFailed(m_SwapChain->Present(0, 0));
+	const FramePacingSettings& pacing = m_Pacer.Settings();
+	UINT presentFlags = !pacing.VSync && m_TearingSupported ? DXGI_PRESENT_ALLOW_TEARING : 0;
+	int64_t presentStart = Profiler::NowNs();
+	m_DrawNs = presentStart - drawStart;
+	{
+		PROFILE_SCOPE("Present");
+		ThrowIfFailed(m_SwapChain->Present(pacing.VSync ? 1 : 0, presentFlags));
+	}
+	m_PresentNs = Profiler::NowNs() - presentStart;
+	m_Pacer.OnPresent(PacingNow());
 	m_CurrentBackBuffer = (m_CurrentBackBuffer + 1) % SwapChainBufferCount;
 
 	m_CurrentFrameResource->Fence = ++m_CurrentFence;
 
 	m_CommandQueue->Signal(m_Fence.Get(), m_CurrentFence);
+	m_Pacer.OnFrameSubmitted(m_CurrentFence);
+
+	PublishMetrics();
 
 	//	ThrowIfFailed(cmdListAlloc->Reset());
 
@@ -328,9 +464,90 @@ void Renderer::CreateDevice()
 	}
 }
 
+void Renderer::RegisterMetrics()
+{
+	MetricsRegistry& metrics = MetricsRegistry::Get();
+	m_Metrics.Frames = metrics.Register("frames", "frames", MetricKind::Counter);
+	m_Metrics.CpuFrameP50 = metrics.Register("cpu.frame.p50", "us", MetricKind::Gauge);
+	m_Metrics.CpuFrameP95 = metrics.Register("cpu.frame.p95", "us", MetricKind::Gauge);
+	m_Metrics.CpuFrameP99 = metrics.Register("cpu.frame.p99", "us", MetricKind::Gauge);
+	m_Metrics.PacingWait = metrics.Register("cpu.pacing_wait", "us", MetricKind::Gauge);
+	m_Metrics.FenceWait = metrics.Register("cpu.fence_wait", "us", MetricKind::Gauge);
+	m_Metrics.Update = metrics.Register("cpu.update", "us", MetricKind::Gauge);
+	m_Metrics.Draw = metrics.Register("cpu.draw", "us", MetricKind::Gauge);
+	m_Metrics.Present = metrics.Register("cpu.present", "us", MetricKind::Gauge);
+	m_Metrics.GpuFrame = metrics.Register("gpu.frame", "us", MetricKind::Gauge);
+	m_Metrics.DrawCalls = metrics.Register("gpu.draw_calls", "draws", MetricKind::Gauge);
+	m_Metrics.Triangles = metrics.Register("gpu.triangles", "triangles", MetricKind::Gauge);
+	m_Metrics.UploadBytes = metrics.Register("upload.bytes_per_frame", "bytes", MetricKind::Gauge);
+	m_Metrics.DescriptorsUsed = metrics.Register("descriptors.used", "descriptors", MetricKind::Gauge);
+	m_Metrics.DescriptorsHighWater = metrics.Register("descriptors.high_water", "descriptors", MetricKind::Gauge);
+	m_Metrics.DescriptorCapacity = metrics.Register("descriptors.capacity", "descriptors", MetricKind::Gauge);
+	m_Metrics.GpuMemoryUsage = metrics.Register("gpu.memory.usage", "bytes", MetricKind::Gauge);
+	m_Metrics.GpuMemoryBudget = metrics.Register("gpu.memory.budget", "bytes", MetricKind::Gauge);
+	m_Metrics.CpuTrackedMemory = metrics.Register("memory.cpu.tracked", "bytes", MetricKind::Gauge);
+	m_Metrics.GpuTrackedMemory = metrics.Register("memory.gpu.tracked", "bytes", MetricKind::Gauge);
+
+	// The budget comes from the adapter the device was created on; without it the memory
+	// gauges stay at zero.
+	if (FAILED(m_DxgiFactory->EnumAdapterByLuid(m_Device->GetAdapterLuid(), IID_PPV_ARGS(&m_Adapter))))
+		m_Adapter = nullptr;
+}
+
+void Renderer::PublishMetrics()
+{
+	MetricsRegistry& metrics = MetricsRegistry::Get();
+
+	// CPU frame time is the work in Update and Draw, without the waits for the GPU and the
+	// swap chain, which are reported separately.
+	m_CpuFrameTimes.Add((float)(m_UpdateNs + m_DrawNs) / 1000.0f);
+	metrics.Add(m_Metrics.Frames);
+	metrics.Set(m_Metrics.CpuFrameP50, (int64_t)m_CpuFrameTimes.Percentile(0.50f));
+	metrics.Set(m_Metrics.CpuFrameP95, (int64_t)m_CpuFrameTimes.Percentile(0.95f));
+	metrics.Set(m_Metrics.CpuFrameP99, (int64_t)m_CpuFrameTimes.Percentile(0.99f));
+	metrics.Set(m_Metrics.PacingWait, m_PacingWaitNs / 1000);
+	metrics.Set(m_Metrics.FenceWait, m_FenceWaitNs / 1000);
+	metrics.Set(m_Metrics.Update, m_UpdateNs / 1000);
+	metrics.Set(m_Metrics.Draw, m_DrawNs / 1000);
+	metrics.Set(m_Metrics.Present, m_PresentNs / 1000);
+	metrics.Set(m_Metrics.GpuFrame, (int64_t)(m_GpuTimer->FrameMs() * 1000.0));
+
+	// Indirect draws are one API call but one draw each on the GPU.
+	uint64_t triangles = m_DrawStats.Triangles;
+	for (const IndirectDrawCommand& command : m_IndirectCommands)
+		triangles += (uint64_t)command.Draw.IndexCountPerInstance / 3 * command.Draw.InstanceCount;
+	metrics.Set(m_Metrics.DrawCalls, m_DrawStats.Draws + m_IndirectCommands.size());
+	metrics.Set(m_Metrics.Triangles, (int64_t)triangles);
+	metrics.Set(m_Metrics.UploadBytes, (int64_t)m_UploadBytesPerFrame);
+
+	const DescriptorAllocator& descriptors = m_Bindless->Allocator();
+	metrics.Set(m_Metrics.DescriptorsUsed, descriptors.AllocatedCount());
+	metrics.Set(m_Metrics.DescriptorsHighWater, descriptors.HighWaterMark());
+	metrics.Set(m_Metrics.DescriptorCapacity, descriptors.Capacity());
+	metrics.Set(m_Metrics.CpuTrackedMemory, MemoryTracker::Get().TotalBytes(MemoryDomain::Cpu));
+	metrics.Set(m_Metrics.GpuTrackedMemory, MemoryTracker::Get().TotalBytes(MemoryDomain::Gpu));
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO memory = {};
+	if (m_Adapter && SUCCEEDED(m_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory)))
+	{
+		metrics.Set(m_Metrics.GpuMemoryUsage, (int64_t)memory.CurrentUsage);
+		metrics.Set(m_Metrics.GpuMemoryBudget, (int64_t)memory.Budget);
+	}
+}
+
 void Renderer::CreateFence()
 {
 	ThrowIfFailed(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence)));
+	m_FenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+}
+
+void Renderer::WaitForFence(UINT64 fence)
+{
+	if (fence == 0 || m_Fence->GetCompletedValue() >= fence)
+		return;
+
+	ThrowIfFailed(m_Fence->SetEventOnCompletion(fence, m_FenceEvent));
+	WaitForSingleObject(m_FenceEvent, INFINITE);
 }
 
 void Renderer::GetDescriptorSizes()
@@ -389,9 +606,29 @@ void Renderer::CreateSwapChain(HWND& windowHandle)
 	swapChainDesc.OutputWindow = m_Hwnd;
 	swapChainDesc.Windowed = true;
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
+	// Presenting without vsync only goes faster than the refresh rate if tearing is allowed.
+	Microsoft::WRL::ComPtr<IDXGIFactory5> factory5;
+	BOOL allowTearing = FALSE;
+	if (SUCCEEDED(m_DxgiFactory.As(&factory5)))
+		m_TearingSupported = SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))) && allowTearing;
+	if (m_TearingSupported)
+		swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
 
 	ThrowIfFailed(m_DxgiFactory->CreateSwapChain(m_CommandQueue.Get(), &swapChainDesc, m_SwapChain.GetAddressOf()));
+
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+	ThrowIfFailed(m_SwapChain.As(&swapChain2));
+	m_FrameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+	SetFrameLatency(m_Pacer.Settings().MaxFrameLatency);
+}
+
+void Renderer::SetFrameLatency(UINT frames)
+{
+	Microsoft::WRL::ComPtr<IDXGISwapChain2> swapChain2;
+	ThrowIfFailed(m_SwapChain.As(&swapChain2));
+	ThrowIfFailed(swapChain2->SetMaximumFrameLatency(frames));
 }
 
 void Renderer::CreateRtvAndDsvDescriptorHeaps()
@@ -430,6 +667,7 @@ void Renderer::CreateRenderTargetView()
 	for (UINT i = 0; i < SwapChainBufferCount; i++)
 	{
 		ThrowIfFailed(m_SwapChain->GetBuffer(i, IID_PPV_ARGS(&m_SwapChainBuffer[i])));
+		d3dUtil::TrackGpuMemory(m_SwapChainBuffer[i].Get(), MemoryTag::RenderTargets);
 
 		m_Device->CreateRenderTargetView(m_SwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
 
@@ -458,6 +696,7 @@ void Renderer::CreateDepthStencilView()
 	optClear.DepthStencil.Stencil = 0;
 
 	ThrowIfFailed(m_Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &depthStencilDesc, D3D12_RESOURCE_STATE_COMMON, &optClear, IID_PPV_ARGS(m_DepthStencilBuffer.GetAddressOf())));
+	d3dUtil::TrackGpuMemory(m_DepthStencilBuffer.Get(), MemoryTag::RenderTargets);
 
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
 	dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
@@ -574,8 +813,9 @@ void Renderer::LoadTextures()
 	grassTex->Name = "grassTex";
 	grassTex->Filename = L"../../Textures/Grass/grass4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), grassTex->Filename.c_str(),
+		m_Uploads->CommandList(), grassTex->Filename.c_str(),
 		grassTex->Resource, grassTex->UploadHeap));
+	m_Uploads->TrackStaging(std::move(grassTex->UploadHeap));
 
 	m_Textures[grassTex->Name] = std::move(grassTex);
 
@@ -583,8 +823,9 @@ void Renderer::LoadTextures()
 	skyCubeMap->Name = "skyCubeMap";
 	skyCubeMap->Filename = L"../../Textures/grasscube1024.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), skyCubeMap->Filename.c_str(),
+		m_Uploads->CommandList(), skyCubeMap->Filename.c_str(),
 		skyCubeMap->Resource, skyCubeMap->UploadHeap));
+	m_Uploads->TrackStaging(std::move(skyCubeMap->UploadHeap));
 
 	m_Textures[skyCubeMap->Name] = std::move(skyCubeMap);
 
@@ -592,8 +833,9 @@ void Renderer::LoadTextures()
 	grassNorm->Name = "grassNorm";
 	grassNorm->Filename = L"../../Textures/Grass/grassnorm4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), grassNorm->Filename.c_str(),
+		m_Uploads->CommandList(), grassNorm->Filename.c_str(),
 		grassNorm->Resource, grassNorm->UploadHeap));
+	m_Uploads->TrackStaging(std::move(grassNorm->UploadHeap));
 
 	m_Textures[grassNorm->Name] = std::move(grassNorm);
 
@@ -601,8 +843,9 @@ void Renderer::LoadTextures()
 	mud->Name = "wetmud";
 	mud->Filename = L"../../Textures/Mud/mud4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), mud->Filename.c_str(),
+		m_Uploads->CommandList(), mud->Filename.c_str(),
 		mud->Resource, mud->UploadHeap));
+	m_Uploads->TrackStaging(std::move(mud->UploadHeap));
 
 	m_Textures[mud->Name] = std::move(mud);
 
@@ -610,8 +853,9 @@ void Renderer::LoadTextures()
 	wetmudNorm->Name = "wetmud_norm";
 	wetmudNorm->Filename = L"../../Textures/Mud/mudnorm4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), wetmudNorm->Filename.c_str(),
+		m_Uploads->CommandList(), wetmudNorm->Filename.c_str(),
 		wetmudNorm->Resource, wetmudNorm->UploadHeap));
+	m_Uploads->TrackStaging(std::move(wetmudNorm->UploadHeap));
 
 	m_Textures[wetmudNorm->Name] = std::move(wetmudNorm);
 
@@ -619,8 +863,9 @@ void Renderer::LoadTextures()
 	rock->Name = "rock";
 	rock->Filename = L"../../Textures/Rock/rock4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), rock->Filename.c_str(),
+		m_Uploads->CommandList(), rock->Filename.c_str(),
 		rock->Resource, rock->UploadHeap));
+	m_Uploads->TrackStaging(std::move(rock->UploadHeap));
 
 	m_Textures[rock->Name] = std::move(rock);
 
@@ -628,143 +873,61 @@ void Renderer::LoadTextures()
 	rockNorm->Name = "rockNorm";
 	rockNorm->Filename = L"../../Textures/Rock/rocknorm4k.dds";
 	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_Device.Get(),
-		m_CommandList.Get(), rockNorm->Filename.c_str(),
+		m_Uploads->CommandList(), rockNorm->Filename.c_str(),
 		rockNorm->Resource, rockNorm->UploadHeap));
+	m_Uploads->TrackStaging(std::move(rockNorm->UploadHeap));
 
 	m_Textures[rockNorm->Name] = std::move(rockNorm);
+
+	for (auto& [name, texture] : m_Textures)
+		d3dUtil::TrackGpuMemory(texture->Resource.Get(), MemoryTag::Textures);
 }
 
 void Renderer::createSrvDescriptorHeaps()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 1;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(m_Device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_SrvHeap)));
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_SrvHeap->GetCPUDescriptorHandleForHeapStart());
-
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-
-
-
-	srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.MipLevels = 1;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	m_Device->CreateShaderResourceView(m_DepthStencilBuffer.Get(), &srvDesc, hDescriptor);
-
+	m_DescriptorIndices.SceneDepth = m_Bindless->CreateSrv(m_DepthStencilBuffer.Get(), &srvDesc).Index;
 }
 
 void Renderer::CreateTextureSrvDescriptors()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 8;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(m_Device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_TexSrvHeap)));
+	auto createTexture2DSrv = [this](ID3D12Resource* resource)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = resource->GetDesc().Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = resource->GetDesc().MipLevels;
+		srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+		return m_Bindless->CreateSrv(resource, &srvDesc).Index;
+	};
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_TexSrvHeap->GetCPUDescriptorHandleForHeapStart());
+	m_DescriptorIndices.GrassDiffuse = createTexture2DSrv(m_Textures["grassTex"]->Resource.Get());
+	m_DescriptorIndices.GrassNormal = createTexture2DSrv(m_Textures["grassNorm"]->Resource.Get());
+	m_DescriptorIndices.MudDiffuse = createTexture2DSrv(m_Textures["wetmud"]->Resource.Get());
+	m_DescriptorIndices.MudNormal = createTexture2DSrv(m_Textures["wetmud_norm"]->Resource.Get());
+	m_DescriptorIndices.RockDiffuse = createTexture2DSrv(m_Textures["rock"]->Resource.Get());
+	m_DescriptorIndices.RockNormal = createTexture2DSrv(m_Textures["rockNorm"]->Resource.Get());
 
-	auto grassTex = m_Textures["grassTex"]->Resource;
-	auto grassNorm = m_Textures["grassNorm"]->Resource;
-	auto wetmud = m_Textures["wetmud"]->Resource;
-	auto wetmud_norm = m_Textures["wetmud_norm"]->Resource;
 	auto skyCubeMap = m_Textures["skyCubeMap"]->Resource;
-	auto rock = m_Textures["rock"]->Resource;
-	auto rockNorm = m_Textures["rockNorm"]->Resource;
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = grassTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = grassTex->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	m_Device->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = grassNorm->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = grassNorm->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	m_Device->CreateShaderResourceView(grassNorm.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = wetmud->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = wetmud->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	m_Device->CreateShaderResourceView(wetmud.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = wetmud_norm->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = wetmud_norm->GetDesc().MipLevels;
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	m_Device->CreateShaderResourceView(wetmud_norm.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
+	srvDesc.Format = skyCubeMap->GetDesc().Format;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
 	srvDesc.TextureCube.MostDetailedMip = 0;
 	srvDesc.TextureCube.MipLevels = skyCubeMap->GetDesc().MipLevels;
 	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-	srvDesc.Format = skyCubeMap->GetDesc().Format;
-	m_Device->CreateShaderResourceView(skyCubeMap.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = 1;
-
-
-	m_Device->CreateShaderResourceView(m_HeightMapTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.TextureCube.MostDetailedMip = 0;
-	srvDesc.TextureCube.MipLevels = rock->GetDesc().MipLevels;
-	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-	srvDesc.Format = rock->GetDesc().Format;
-
-
-	m_Device->CreateShaderResourceView(rock.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.TextureCube.MostDetailedMip = 0;
-	srvDesc.TextureCube.MipLevels = rockNorm->GetDesc().MipLevels;
-	srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-	srvDesc.Format = rockNorm->GetDesc().Format;
-
-
-
-	m_Device->CreateShaderResourceView(rockNorm.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, m_CbvSrvUavDescriptorSize);
-
+	m_DescriptorIndices.SkyCube = m_Bindless->CreateSrv(skyCubeMap.Get(), &srvDesc).Index;
 
+	UpdateHeightMapSrv();
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Renderer::GetStaticSamplers()
@@ -826,21 +989,30 @@ std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Renderer::GetStaticSamplers()
 
 void Renderer::CreateOpaqueRootSignature()
 {
-	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 8, 0, 0, 0);
+	// The whole bindless heap, viewed as 2D textures in space1 and cube maps in space2.
+	CD3DX12_DESCRIPTOR_RANGE heapRanges[2];
+	heapRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, 0);
+	heapRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2, 0);
 
-	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[9];
 
-	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_ALL);
+	slotRootParameter[0].InitAsDescriptorTable(_countof(heapRanges), heapRanges, D3D12_SHADER_VISIBILITY_ALL);
 	slotRootParameter[1].InitAsConstantBufferView(0);
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
 	slotRootParameter[4].InitAsConstantBufferView(3);
+	slotRootParameter[5].InitAsConstants(sizeof(DescriptorIndexConstants) / sizeof(UINT), 4);
+
+	// Instanced draws: instance and material structured buffers, and the first instance of
+	// the draw.
+	slotRootParameter[6].InitAsShaderResourceView(0, 3);
+	slotRootParameter[7].InitAsShaderResourceView(1, 3);
+	slotRootParameter[InstanceOffsetRootParameter].InitAsConstants(1, 5);
 
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(_countof(slotRootParameter), slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -861,22 +1033,24 @@ void Renderer::CreateOpaqueRootSignature()
 
 void Renderer::CreateTransparentRootSignature()
 {
-	CD3DX12_DESCRIPTOR_RANGE srvTable;
-	srvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, 0);
+	CD3DX12_DESCRIPTOR_RANGE heapRanges[2];
+	heapRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, 0);
+	heapRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2, 0);
 
 
-	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[6];
 
-	slotRootParameter[0].InitAsDescriptorTable(1, &srvTable, D3D12_SHADER_VISIBILITY_ALL);
+	slotRootParameter[0].InitAsDescriptorTable(_countof(heapRanges), heapRanges, D3D12_SHADER_VISIBILITY_ALL);
 	slotRootParameter[1].InitAsConstantBufferView(0);
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
 	slotRootParameter[4].InitAsConstantBufferView(3);
+	slotRootParameter[5].InitAsConstants(sizeof(DescriptorIndexConstants) / sizeof(UINT), 4);
 
 	auto staticSamplers = GetStaticSamplers();
 
 
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter, (UINT)staticSamplers.size(), staticSamplers.data(), D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(6, slotRootParameter, (UINT)staticSamplers.size(), staticSamplers.data(), D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	Microsoft::WRL::ComPtr<ID3DBlob> serializedRootSig = nullptr;
 	Microsoft::WRL::ComPtr<ID3DBlob> errorBlob = nullptr;
@@ -893,6 +1067,45 @@ void Renderer::CreateTransparentRootSignature()
 	ThrowIfFailed(m_Device->CreateRootSignature(0, serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize(), IID_PPV_ARGS(m_TransparentRootSignature.GetAddressOf())));
 }
 
+void Renderer::CreateIndirectCommandSignature()
+{
+	IndirectCommandSignature signature = DescribeIndirectDrawSignature(InstanceOffsetRootParameter);
+
+	std::vector<D3D12_INDIRECT_ARGUMENT_DESC> arguments;
+	for (const IndirectArgument& argument : signature.Arguments)
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC desc = {};
+		switch (argument.Type)
+		{
+		case IndirectArgumentType::VertexBufferView:
+			desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+			desc.VertexBuffer.Slot = argument.Slot;
+			break;
+		case IndirectArgumentType::IndexBufferView:
+			desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+			break;
+		case IndirectArgumentType::Constant:
+			desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			desc.Constant.RootParameterIndex = argument.Slot;
+			desc.Constant.DestOffsetIn32BitValues = argument.DestOffsetIn32BitValues;
+			desc.Constant.Num32BitValuesToSet = argument.Num32BitValues;
+			break;
+		case IndirectArgumentType::DrawIndexed:
+			desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+			break;
+		}
+		arguments.push_back(desc);
+	}
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = signature.ByteStride;
+	signatureDesc.NumArgumentDescs = (UINT)arguments.size();
+	signatureDesc.pArgumentDescs = arguments.data();
+
+	// The signature changes a root constant, so it is tied to the root signature.
+	ThrowIfFailed(m_Device->CreateCommandSignature(&signatureDesc, m_OpaqueRootSignature.Get(), IID_PPV_ARGS(&m_IndirectDrawSignature)));
+}
+
 void Renderer::BuildShadersAndInputLayout()
 {
 	const D3D_SHADER_MACRO alphaTestDefines[] =
@@ -901,14 +1114,31 @@ void Renderer::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	HRESULT hr = S_OK;
+	// Every shader and permutation goes into one batch so the cache misses compile in
+	// parallel.
+	m_ShaderRequests =
+	{
+		{ L"Shaders\\vertex.hlsl", {}, "VS", "vs_5_1" },
+		{ L"Shaders\\vertex_water.hlsl", {}, "VS", "vs_5_1" },
+		{ L"Shaders\\vertex_sky.hlsl", {}, "VS", "vs_5_1" },
+		{ L"Shaders\\pixel_sky.hlsl", {}, "PS", "ps_5_1" },
+		{ L"Shaders\\vertex_instanced.hlsl", {}, "VS", "vs_5_1" },
+		{ L"Shaders\\pixel_instanced.hlsl", {}, "PS", "ps_5_1" },
+	};
+
+	m_TerrainShaderFirst = m_ShaderRequests.size();
+	for (uint32_t i = 0; i < m_TerrainPermutations.VariantCount(); i++)
+		m_ShaderRequests.push_back({ L"Shaders\\pixel.hlsl", m_TerrainPermutations.Defines(m_TerrainPermutations.VariantFeatures(i)), "PS", "ps_5_1" });
 
-	m_VsByteCode = d3dUtil::CompileShader(L"Shaders\\vertex.hlsl", nullptr, "VS", "vs_5_0");
-	m_PsByteCode = d3dUtil::CompileShader(L"Shaders\\pixel.hlsl", nullptr, "PS", "ps_5_0");
-	m_VsByteCodeWater = d3dUtil::CompileShader(L"Shaders\\vertex_water.hlsl", nullptr, "VS", "vs_5_0");
-	m_PsByteCodeWater = d3dUtil::CompileShader(L"Shaders\\pixel_water.hlsl", nullptr, "PS", "ps_5_0");
-	m_VsByteCodeSky = d3dUtil::CompileShader(L"Shaders\\vertex_sky.hlsl", nullptr, "VS", "vs_5_0");
-	m_PsByteCodeSky = d3dUtil::CompileShader(L"Shaders\\pixel_sky.hlsl", nullptr, "PS", "ps_5_0");
+	m_WaterShaderFirst = m_ShaderRequests.size();
+	for (uint32_t i = 0; i < m_WaterPermutations.VariantCount(); i++)
+		m_ShaderRequests.push_back({ L"Shaders\\pixel_water.hlsl", m_WaterPermutations.Defines(m_WaterPermutations.VariantFeatures(i)), "PS", "ps_5_1" });
+
+	m_ShaderBlobs = m_PipelineCache->CompileShaders(m_ShaderRequests, *m_Jobs);
+	AssignShaderBlobs();
+
+	for (const ShaderCompileRequest& request : m_ShaderRequests)
+		m_ShaderWatcher.Watch(request.Filename);
 
 
 
@@ -921,45 +1151,138 @@ void Renderer::BuildShadersAndInputLayout()
 
 
 }
+void Renderer::AssignShaderBlobs()
+{
+	m_VsByteCode = m_ShaderBlobs[0];
+	m_VsByteCodeWater = m_ShaderBlobs[1];
+	m_VsByteCodeSky = m_ShaderBlobs[2];
+	m_PsByteCodeSky = m_ShaderBlobs[3];
+	m_VsByteCodeInstanced = m_ShaderBlobs[4];
+	m_PsByteCodeInstanced = m_ShaderBlobs[5];
+	m_PsByteCodeTerrain.assign(m_ShaderBlobs.begin() + m_TerrainShaderFirst, m_ShaderBlobs.begin() + m_WaterShaderFirst);
+	m_PsByteCodeWater.assign(m_ShaderBlobs.begin() + m_WaterShaderFirst, m_ShaderBlobs.end());
+}
+
+void Renderer::UpdateShaderHotReload()
+{
+	if (m_ShaderReload.valid())
+	{
+		if (m_ShaderReload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		ShaderReload reload = m_ShaderReload.get();
+		if (!reload.Succeeded)
+		{
+			m_ShaderReloadStatus = "Compile failed for " + reload.Changed + ", keeping previous shaders";
+			return;
+		}
+
+		for (size_t i = 0; i < reload.Requests.size(); i++)
+			m_ShaderBlobs[reload.Requests[i]] = reload.Blobs[i];
+		AssignShaderBlobs();
+
+		// Frames still in flight use the current pipelines; release them once those are done.
+		for (const auto& pso : m_PipelineStates)
+			DeferRelease(pso);
+
+		BuildPSOs();
+		m_PipelineCache->Save();
+
+		m_ShaderReloadCount++;
+		m_ShaderReloadStatus = "Reloaded " + reload.Changed;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_LastShaderPoll < ShaderPollInterval)
+		return;
+	m_LastShaderPoll = now;
+
+	std::vector<std::filesystem::path> changed = m_ShaderWatcher.Poll();
+	if (changed.empty())
+		return;
+
+	ShaderReload reload;
+	std::vector<ShaderCompileRequest> requests;
+	for (uint32_t i = 0; i < (uint32_t)m_ShaderRequests.size(); i++)
+	{
+		if (std::find(changed.begin(), changed.end(), std::filesystem::path(m_ShaderRequests[i].Filename)) != changed.end())
+		{
+			reload.Requests.push_back(i);
+			requests.push_back(m_ShaderRequests[i]);
+		}
+	}
+
+	for (const std::filesystem::path& path : changed)
+		reload.Changed += (reload.Changed.empty() ? "" : ", ") + path.filename().string();
+
+	// The compiles are jobs on the shared pool, so frames may run a little slower while a
+	// reload is in flight, but the render thread only runs its own jobs while it waits and
+	// never picks up a compile. ~Renderer waits for the reload before the pool goes away.
+	m_ShaderReload = std::async(std::launch::async, [reload = std::move(reload), requests = std::move(requests), jobs = m_Jobs.get()]() mutable
+		{
+			reload.Blobs.resize(requests.size());
+			try
+			{
+				jobs->ParallelFor(0, (uint32_t)requests.size(), 1, [&](uint32_t begin, uint32_t end)
+					{
+						for (uint32_t i = begin; i < end; i++)
+							reload.Blobs[i] = D3D12PipelineCache::CompileUncached(requests[i]);
+					});
+				reload.Succeeded = true;
+			}
+			catch (DxException&)
+			{
+				// The compiler errors have already gone to the debug output.
+			}
+			catch (const std::exception& e)
+			{
+				// Anything else, such as a failed allocation, also keeps the old shaders
+				// rather than escaping through the future into the frame.
+				::OutputDebugStringA((std::string("Shader reload failed: ") + e.what() + "\n").c_str());
+			}
+			return reload;
+		});
+}
+
 void Renderer::BuildMaterials()
 {
-	auto sky = std::make_unique<Material>();
-	sky->Name = "sky";
-	sky->MatCBIndex = 0;
-	sky->DiffuseSrvHeapIndex = 1;
-	sky->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	sky->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
-	sky->Roughness = 1.0f;
-
-
-	auto grass = std::make_unique<Material>();
-	grass->Name = "grass";
-	grass->MatCBIndex = 1;
-	grass->DiffuseSrvHeapIndex = 0;
-	grass->DiffuseAlbedo = XMFLOAT4(0.5f, 0.6f, 0.1f, 1.0f);
-	grass->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	grass->Roughness = 0.125f;
-
-	auto skullMat = std::make_unique<Material>();
-	skullMat->Name = "skullMat";
-	skullMat->MatCBIndex = 2;
-	skullMat->DiffuseSrvHeapIndex = 2;
-	skullMat->DiffuseAlbedo = XMFLOAT4(0.3f, 0.33f, 0.31f, 1.0f);
-	skullMat->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	skullMat->Roughness = 0.25f;
-
-	auto water = std::make_unique<Material>();
-	water->Name = "water";
-	water->MatCBIndex = 3;
-	water->DiffuseSrvHeapIndex = 3;
-	water->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	water->FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
-	water->Roughness = 0.0f;
-
-	m_Materials["sky"] = std::move(sky);
-	m_Materials["grass"] = std::move(grass);
-	m_Materials["skullMat"] = std::move(skullMat);
-	m_Materials["water"] = std::move(water);
+	Material sky;
+	sky.Name = "sky";
+	sky.MatCBIndex = 0;
+	sky.DiffuseSrvHeapIndex = 1;
+	sky.DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	sky.FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
+	sky.Roughness = 1.0f;
+
+
+	Material grass;
+	grass.Name = "grass";
+	grass.MatCBIndex = 1;
+	grass.DiffuseSrvHeapIndex = 0;
+	grass.DiffuseAlbedo = XMFLOAT4(0.5f, 0.6f, 0.1f, 1.0f);
+	grass.FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
+	grass.Roughness = 0.125f;
+
+	Material skullMat;
+	skullMat.Name = "skullMat";
+	skullMat.MatCBIndex = 2;
+	skullMat.DiffuseSrvHeapIndex = 2;
+	skullMat.DiffuseAlbedo = XMFLOAT4(0.3f, 0.33f, 0.31f, 1.0f);
+	skullMat.FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
+	skullMat.Roughness = 0.25f;
+
+	Material water;
+	water.Name = "water";
+	water.MatCBIndex = 3;
+	water.DiffuseSrvHeapIndex = 3;
+	water.DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	water.FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
+	water.Roughness = 0.0f;
+
+	m_Materials.Add(sky.Name, std::move(sky));
+	m_Materials.Add(grass.Name, std::move(grass));
+	m_Materials.Add(skullMat.Name, std::move(skullMat));
+	m_Materials.Add(water.Name, std::move(water));
 }
 void Renderer::BuildShapeGeometry()
 {
@@ -1047,6 +1370,11 @@ void Renderer::BuildShapeGeometry()
 		vertices[k].Normal = cylinder.Vertices[i].Normal;
 	}
 
+	BoundingBox::CreateFromPoints(boxSubmesh.Bounds, box.Vertices.size(), &vertices[boxVertexOffset].Pos, sizeof(Vertex));
+	BoundingBox::CreateFromPoints(gridSubmesh.Bounds, grid.Vertices.size(), &vertices[gridVertexOffset].Pos, sizeof(Vertex));
+	BoundingBox::CreateFromPoints(sphereSubmesh.Bounds, sphere.Vertices.size(), &vertices[sphereVertexOffset].Pos, sizeof(Vertex));
+	BoundingBox::CreateFromPoints(cylinderSubmesh.Bounds, cylinder.Vertices.size(), &vertices[cylinderVertexOffset].Pos, sizeof(Vertex));
+
 	std::vector<std::uint16_t> indices;
 	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
 	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
@@ -1059,10 +1387,10 @@ void Renderer::BuildShapeGeometry()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateTrackedBlob(vbByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateTrackedBlob(ibByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
@@ -1081,45 +1409,25 @@ void Renderer::BuildShapeGeometry()
 	geo->DrawArgs["sphere"] = sphereSubmesh;
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
 
-	m_Geometries[geo->Name] = std::move(geo);
+	m_Geometries.Add(geo->Name, std::move(*geo));
 }
 
 void Renderer::BuildSkullGeometry()
 {
-	std::ifstream fin("Models/skull.txt");
-
-	if (!fin)
+	TextMesh mesh;
+	if (!LoadTextMesh("Models/skull.txt", mesh))
 	{
-		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
+		MessageBox(0, L"Models/skull.txt not found or invalid.", 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
+	std::vector<Vertex> vertices(mesh.Positions.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
 	{
-		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+		vertices[i].Pos = mesh.Positions[i];
+		vertices[i].Normal = mesh.Normals[i];
 	}
-
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
-
-	std::vector<std::int32_t> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	fin.close();
+	const std::vector<std::int32_t>& indices = mesh.Indices;
 
 	//
 	// Pack the indices of all the meshes into one index buffer.
@@ -1132,10 +1440,10 @@ void Renderer::BuildSkullGeometry()
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "skullGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateTrackedBlob(vbByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateTrackedBlob(ibByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
@@ -1153,10 +1461,11 @@ void Renderer::BuildSkullGeometry()
 	submesh.IndexCount = (UINT)indices.size();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
 
 	geo->DrawArgs["skull"] = submesh;
 
-	m_Geometries[geo->Name] = std::move(geo);
+	m_Geometries.Add(geo->Name, std::move(*geo));
 }
 
 void Renderer::BuildLandGeometry(float width, float height)
@@ -1164,16 +1473,19 @@ void Renderer::BuildLandGeometry(float width, float height)
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid = geoGen.CreateGrid(460.0f, 460.0f, 50, 50);
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
-	for (size_t i = 0; i < grid.Vertices.size(); ++i)
-	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-		XMFLOAT3 n = GetHillsNormal(p.x, p.z);
-		vertices[i].Normal = n;
-		vertices[i].TexCoord = grid.Vertices[i].TexC;
-	}
+	FrameVector<Vertex> vertices(grid.Vertices.size());
+	m_Jobs->ParallelFor(0, (uint32_t)grid.Vertices.size(), MeshBuildGrainVertices, [&](uint32_t begin, uint32_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto& p = grid.Vertices[i].Position;
+				vertices[i].Pos = p;
+				vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
+				XMFLOAT3 n = GetHillsNormal(p.x, p.z);
+				vertices[i].Normal = n;
+				vertices[i].TexCoord = grid.Vertices[i].TexC;
+			}
+		});
 	//for (size_t i = 0; i < grid.Vertices.size(); ++i)
 	//{
 	//	auto& p = grid.Vertices[i].Position;
@@ -1186,23 +1498,23 @@ void Renderer::BuildLandGeometry(float width, float height)
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
+	FrameVector<std::uint16_t> indices(grid.Indices32.size());
+	for (size_t i = 0; i < grid.Indices32.size(); ++i)
+		indices[i] = (std::uint16_t)grid.Indices32[i];
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateTrackedBlob(vbByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateTrackedBlob(ibByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
-		m_CommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = m_Uploads->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
-		m_CommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = m_Uploads->CreateDefaultBuffer(indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1216,24 +1528,28 @@ void Renderer::BuildLandGeometry(float width, float height)
 
 	geo->DrawArgs["grid"] = submesh;
 
-	m_Geometries["landGeo"] = std::move(geo);
+	m_Geometries.Add(geo->Name, std::move(*geo));
 }
 
 void Renderer::RebuildLandGeometry(float width, float height)
 {
+	PROFILE_FUNCTION();
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid = geoGen.CreateGrid(m_TerrainConstantsCPU.gTerrainSize.x, m_TerrainConstantsCPU.gTerrainSize.y, 50, 50);
 
-	std::vector<Vertex> vertices(grid.Vertices.size());
-	for (size_t i = 0; i < grid.Vertices.size(); ++i)
-	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-		XMFLOAT3 n = GetHillsNormal(p.x, p.z);
-		vertices[i].Normal = n;
-		vertices[i].TexCoord = grid.Vertices[i].TexC;
-	}
+	FrameVector<Vertex> vertices(grid.Vertices.size());
+	m_Jobs->ParallelFor(0, (uint32_t)grid.Vertices.size(), MeshBuildGrainVertices, [&](uint32_t begin, uint32_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto& p = grid.Vertices[i].Position;
+				vertices[i].Pos = p;
+				vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
+				XMFLOAT3 n = GetHillsNormal(p.x, p.z);
+				vertices[i].Normal = n;
+				vertices[i].TexCoord = grid.Vertices[i].TexC;
+			}
+		});
 	//for (size_t i = 0; i < grid.Vertices.size(); ++i)
 	//{
 	//	auto& p = grid.Vertices[i].Position;
@@ -1246,23 +1562,23 @@ void Renderer::RebuildLandGeometry(float width, float height)
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
+	FrameVector<std::uint16_t> indices(grid.Indices32.size());
+	for (size_t i = 0; i < grid.Indices32.size(); ++i)
+		indices[i] = (std::uint16_t)grid.Indices32[i];
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	geo->VertexBufferCPU = d3dUtil::CreateTrackedBlob(vbByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateTrackedBlob(ibByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
-		m_CommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = m_Uploads->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
-		m_CommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = m_Uploads->CreateDefaultBuffer(indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1276,7 +1592,17 @@ void Renderer::RebuildLandGeometry(float width, float height)
 
 	geo->DrawArgs["grid"] = submesh;
 
-	m_Geometries["landGeo"] = std::move(geo);
+	// Removing the old mesh invalidates handles to it, so the land item is rebuilt against the
+	// new one. Frames in flight may still read the old buffers.
+	GeometryHandle oldGeo = m_Geometries.Find(geo->Name);
+	if (const MeshGeometry* old = m_Geometries.Get(oldGeo))
+	{
+		DeferRelease(old->VertexBufferGPU);
+		DeferRelease(old->IndexBufferGPU);
+		m_Geometries.Remove(oldGeo);
+	}
+
+	m_Geometries.Add(geo->Name, std::move(*geo));
 }
 
 
@@ -1313,7 +1639,7 @@ void Renderer::BuildWavesGeometry()
 	geo->VertexBufferCPU = nullptr;
 	geo->VertexBufferGPU = nullptr;
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	geo->IndexBufferCPU = d3dUtil::CreateTrackedBlob(ibByteSize, MemoryTag::Geometry);
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(m_Device.Get(),
@@ -1331,7 +1657,7 @@ void Renderer::BuildWavesGeometry()
 
 	geo->DrawArgs["grid"] = submesh;
 
-	m_Geometries["waterGeo"] = std::move(geo);
+	m_Geometries.Add(geo->Name, std::move(*geo));
 }
 
 float Renderer::GetHillsHeight(float x, float z)
@@ -1354,32 +1680,22 @@ XMFLOAT3 Renderer::GetHillsNormal(float x, float z)
 
 void Renderer::RebuildLandRenderItem()
 {
-	auto isLand = [](RenderItem* ri) { return ri->ObjCBIndex == 1; };
-
-	auto itOpaque = std::remove_if(m_OpaqueRenderItems.begin(), m_OpaqueRenderItems.end(), isLand);
-	m_OpaqueRenderItems.erase(itOpaque, m_OpaqueRenderItems.end());
-
-	auto itAll = std::remove_if(m_AllRenderItems.begin(), m_AllRenderItems.end(), isLand);
-	m_AllRenderItems.erase(itAll, m_AllRenderItems.end());
-
-	auto landRitem = new RenderItem();
-	landRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&landRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 10.0f));
-
-	landRitem->ObjCBIndex = 1;
-	landRitem->NumFramesDirty = NumFrameResources;
-	landRitem->Mat = m_Materials["grass"].get();
-	landRitem->Geo = m_Geometries["landGeo"].get();
-	landRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-	const auto& gridSubmesh = landRitem->Geo->DrawArgs["grid"];
-	landRitem->IndexCount = gridSubmesh.IndexCount;
-	landRitem->StartIndexLocation = gridSubmesh.StartIndexLocation;
-	landRitem->BaseVertexLocation = gridSubmesh.BaseVertexLocation;
-
-	m_OpaqueRenderItems.push_back(landRitem);
-	m_AllRenderItems.push_back(landRitem);
-
+	m_RenderItems.Remove(m_LandRitem);
+	m_OpaqueRenderItems.erase(std::remove(m_OpaqueRenderItems.begin(), m_OpaqueRenderItems.end(), m_LandRitem), m_OpaqueRenderItems.end());
+
+	RenderItem landRitem;
+	XMStoreFloat4x4(&landRitem.TexTransform, XMMatrixScaling(8.0f, 8.0f, 10.0f));
+
+	landRitem.ObjCBIndex = 1;
+	SetObjectTransform(&landRitem, Transform());
+	landRitem.NumFramesDirty = NumFrameResources;
+	landRitem.Mat = m_Materials.Find("grass");
+	landRitem.Geo = m_Geometries.Find("landGeo");
+	landRitem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetSubmesh(landRitem, "grid");
+
+	m_LandRitem = m_RenderItems.Add(std::move(landRitem));
+	m_OpaqueRenderItems.push_back(m_LandRitem);
 }
 
 void Renderer::RebuildFrameResources()
@@ -1387,8 +1703,8 @@ void Renderer::RebuildFrameResources()
 	m_FrameResources.clear();
 
 	UINT passCount = gNumFrameResources;
-	UINT objectCount = (UINT)m_AllRenderItems.size();
-	UINT materialCount = (UINT)m_Materials.size();
+	UINT objectCount = (UINT)m_RenderItems.Size();
+	UINT materialCount = (UINT)m_Materials.Size();
 	UINT opaqueObjectCount = (UINT)m_OpaqueRenderItems.size();
 	UINT transparentObjectCount = (UINT)m_TransparentRenderItems.size();
 	UINT skyObjectCount = (UINT)m_SkyRenderItems.size();
@@ -1406,98 +1722,362 @@ void Renderer::RebuildFrameResources()
 
 void Renderer::BuildRenderItems()
 {
-	auto skyRitem = new RenderItem();
-	XMStoreFloat4x4(&skyRitem->World, XMMatrixScaling(5000.0f, 5000.0f, 5000.0f));
-	skyRitem->TexTransform = MathHelper::Identity4x4();
-	skyRitem->ObjCBIndex = 0;
-	skyRitem->Mat = m_Materials["sky"].get();
-	skyRitem->Geo = m_Geometries["shapeGeo"].get();
-	skyRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	skyRitem->IndexCount = skyRitem->Geo->DrawArgs["sphere"].IndexCount;
-	skyRitem->StartIndexLocation = skyRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-	skyRitem->BaseVertexLocation = skyRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
-	m_SkyRenderItems.push_back(std::move(skyRitem));
-
-	auto gridRitem = new RenderItem();
-	gridRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 10.0f));
-	gridRitem->ObjCBIndex = 1;
-	gridRitem->Mat = m_Materials["grass"].get();
-	gridRitem->Geo = m_Geometries["landGeo"].get();
-	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-	m_OpaqueRenderItems.push_back(std::move(gridRitem));
-
-	auto skullRitem = new RenderItem();
-	XMStoreFloat4x4(&skullRitem->TexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
-	skullRitem->ObjCBIndex = 2;
-	skullRitem->Mat = m_Materials["skullMat"].get();
-	skullRitem->Geo = m_Geometries["skullGeo"].get();
-	skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
-	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
-	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
-	m_OpaqueRenderItems.push_back(std::move(skullRitem));
-
-	auto wavesRitem = new RenderItem();
-	XMStoreFloat4x4(&wavesRitem->World, XMMatrixScaling(10.0f, 1.0f, 10.0f) * XMMatrixTranslation(0.0f, 50.0f, 0.0f));
-	XMStoreFloat4x4(&wavesRitem->TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
-	wavesRitem->ObjCBIndex = 3;
-	wavesRitem->Mat = m_Materials["water"].get();
-	wavesRitem->Geo = m_Geometries["waterGeo"].get();
-	wavesRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wavesRitem->IndexCount = wavesRitem->Geo->DrawArgs["grid"].IndexCount;
-	wavesRitem->StartIndexLocation = wavesRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	wavesRitem->BaseVertexLocation = wavesRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-
-	m_WavesRitem = wavesRitem;
-	m_TransparentRenderItems.push_back(std::move(wavesRitem));
-
-	for (auto& e : m_SkyRenderItems)
-		m_AllRenderItems.push_back(e);
-
-	for (auto& e : m_OpaqueRenderItems)
-		m_AllRenderItems.push_back(e);
-
-	for (auto& e : m_TransparentRenderItems)
-		m_AllRenderItems.push_back(e);
-}
-
-void Renderer::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& riItems)
+	RenderItem skyRitem;
+	skyRitem.TexTransform = MathHelper::Identity4x4();
+	skyRitem.ObjCBIndex = 0;
+	SetObjectTransform(&skyRitem, MakeTransform(XMVectorReplicate(5000.0f), XMQuaternionIdentity(), XMVectorZero()));
+	skyRitem.Mat = m_Materials.Find("sky");
+	skyRitem.Geo = m_Geometries.Find("shapeGeo");
+	skyRitem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetSubmesh(skyRitem, "sphere");
+	m_SkyRenderItems.push_back(m_RenderItems.Add(std::move(skyRitem)));
+
+	RenderItem gridRitem;
+	XMStoreFloat4x4(&gridRitem.TexTransform, XMMatrixScaling(8.0f, 8.0f, 10.0f));
+	gridRitem.ObjCBIndex = 1;
+	SetObjectTransform(&gridRitem, Transform());
+	gridRitem.Mat = m_Materials.Find("grass");
+	gridRitem.Geo = m_Geometries.Find("landGeo");
+	gridRitem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetSubmesh(gridRitem, "grid");
+	m_LandRitem = m_RenderItems.Add(std::move(gridRitem));
+	m_OpaqueRenderItems.push_back(m_LandRitem);
+
+	RenderItem skullRitem;
+	XMStoreFloat4x4(&skullRitem.TexTransform, XMMatrixScaling(8.0f, 8.0f, 1.0f));
+	skullRitem.ObjCBIndex = 2;
+	SetObjectTransform(&skullRitem, Transform());
+	skullRitem.Mat = m_Materials.Find("skullMat");
+	skullRitem.Geo = m_Geometries.Find("skullGeo");
+	skullRitem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetSubmesh(skullRitem, "skull");
+	m_OpaqueRenderItems.push_back(m_RenderItems.Add(std::move(skullRitem)));
+
+	RenderItem wavesRitem;
+	XMStoreFloat4x4(&wavesRitem.TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
+	wavesRitem.ObjCBIndex = 3;
+	SetObjectTransform(&wavesRitem, MakeTransform(XMVectorSet(10.0f, 1.0f, 10.0f, 0.0f), XMQuaternionIdentity(), XMVectorSet(0.0f, 50.0f, 0.0f, 0.0f)));
+	wavesRitem.Mat = m_Materials.Find("water");
+	wavesRitem.Geo = m_Geometries.Find("waterGeo");
+	wavesRitem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetSubmesh(wavesRitem, "grid");
+
+	m_WavesRitem = m_RenderItems.Add(std::move(wavesRitem));
+	m_TransparentRenderItems.push_back(m_WavesRitem);
+}
+
+void Renderer::SetSubmesh(RenderItem& ri, const std::string& submesh) const
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	const SubmeshGeometry& args = m_Geometries.Get(ri.Geo)->DrawArgs.at(submesh);
+	ri.IndexCount = args.IndexCount;
+	ri.StartIndexLocation = args.StartIndexLocation;
+	ri.BaseVertexLocation = args.BaseVertexLocation;
+}
 
-	auto objectCB = m_CurrentFrameResource->ObjectCB->Resource();
-	auto matCB = m_CurrentFrameResource->MaterialCB->Resource();
+void Renderer::SetPassState(ID3D12GraphicsCommandList* cmdList, ID3D12RootSignature* rootSignature, ID3D12PipelineState* pso, ID3D12Resource* materialCB)
+{
+	// Command lists start with no state, so every list a pass records into sets all of it,
+	// apart from the descriptor heap, which CommandListPool binds when it hands the list out.
+	cmdList->RSSetViewports(1, &m_ScreenViewport);
+	cmdList->RSSetScissorRects(1, &m_ScissorRect);
+	cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
+
+	cmdList->SetGraphicsRootSignature(rootSignature);
+	cmdList->SetPipelineState(pso);
+	cmdList->SetGraphicsRootConstantBufferView(3, m_CurrentFrameResource->PassCB->Resource()->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootConstantBufferView(4, materialCB->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootDescriptorTable(0, m_Bindless->GpuStart());
+	cmdList->SetGraphicsRoot32BitConstants(5, sizeof(DescriptorIndexConstants) / sizeof(UINT), &m_DescriptorIndices, 0);
+}
 
-	for (size_t i = 0; i < riItems.size(); ++i)
+void Renderer::BuildDrawPackets(const std::vector<RenderItemHandle>& items, UINT pipeline, bool keepOrder, PassDrawList& draws)
+{
+	draws.Packets.clear();
+	for (size_t i = 0; i < items.size(); ++i)
 	{
-		auto ri = riItems[i];
+		const RenderItem* ri = m_RenderItems.Get(items[i]);
+		MeshGeometry* geo = m_Geometries.Get(ri->Geo);
+
+		UINT geometry = 0;
+		while (geometry < m_DrawGeometries.size() && m_DrawGeometries[geometry] != geo)
+			geometry++;
+		if (geometry == m_DrawGeometries.size())
+			m_DrawGeometries.push_back(geo);
+
+		DrawPacket packet;
+		packet.Pipeline = pipeline;
+		packet.Geometry = geometry;
+		packet.Topology = (UINT)ri->PrimitiveType;
+		packet.ObjectConstants = ri->ObjCBIndex;
+		packet.MaterialConstants = m_Materials.Get(ri->Mat)->MatCBIndex;
+		packet.IndexCount = ri->IndexCount;
+		packet.StartIndexLocation = ri->StartIndexLocation;
+		packet.BaseVertexLocation = ri->BaseVertexLocation;
+		packet.SortKey = keepOrder ? DrawSortKey::MakeOrdered((UINT)i) : DrawSortKey::Make(pipeline, geometry, packet.MaterialConstants, (UINT)i);
+		draws.Packets.push_back(packet);
+	}
+
+	SortDrawPackets(draws.Packets, m_SortKeys, m_SortScratch, draws.Sorted);
+}
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+namespace
+{
+	// Turns the state changes of a sorted packet stream into D3D12 calls.
+	class D3D12DrawPacketSink : public DrawPacketSink
+	{
+	public:
+		D3D12DrawPacketSink(ID3D12GraphicsCommandList* cmdList, const std::vector<ID3D12PipelineState*>& pipelines, const std::vector<MeshGeometry*>& geometries,
+			D3D12_GPU_VIRTUAL_ADDRESS objectCB, D3D12_GPU_VIRTUAL_ADDRESS materialCB)
+			: m_CmdList(cmdList), m_Pipelines(pipelines), m_Geometries(geometries), m_ObjectCB(objectCB), m_MaterialCB(materialCB)
+		{
+		}
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
+		void SetPipeline(uint32_t pipeline) override { m_CmdList->SetPipelineState(m_Pipelines[pipeline]); }
 
-		if (ri->Geo->Name == "waterGeo")
+		void SetGeometry(uint32_t geometry) override
 		{
+			D3D12_VERTEX_BUFFER_VIEW vbv = m_Geometries[geometry]->VertexBufferView();
+			D3D12_INDEX_BUFFER_VIEW ibv = m_Geometries[geometry]->IndexBufferView();
+			m_CmdList->IASetVertexBuffers(0, 1, &vbv);
+			m_CmdList->IASetIndexBuffer(&ibv);
+		}
 
-			cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-			cmdList->SetGraphicsRootConstantBufferView(2, matCBAddress);
+		void SetTopology(uint32_t topology) override { m_CmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)topology); }
+		void SetObjectConstants(uint32_t slot) override { m_CmdList->SetGraphicsRootConstantBufferView(1, m_ObjectCB + slot * ObjectCBByteSize); }
+		void SetMaterialConstants(uint32_t slot) override { m_CmdList->SetGraphicsRootConstantBufferView(2, m_MaterialCB + slot * MaterialCBByteSize); }
+
+		void Draw(const DrawPacket& packet) override
+		{
+			m_CmdList->DrawIndexedInstanced(packet.IndexCount, 1, packet.StartIndexLocation, packet.BaseVertexLocation, 0);
 		}
-		else
+
+	private:
+		const UINT ObjectCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+		const UINT MaterialCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+		ID3D12GraphicsCommandList* m_CmdList;
+		const std::vector<ID3D12PipelineState*>& m_Pipelines;
+		const std::vector<MeshGeometry*>& m_Geometries;
+		D3D12_GPU_VIRTUAL_ADDRESS m_ObjectCB;
+		D3D12_GPU_VIRTUAL_ADDRESS m_MaterialCB;
+	};
+}
+
+void Renderer::RecordDraws(PassDrawList& draws, UINT pipeline, const std::function<void(ID3D12GraphicsCommandList*)>& setup)
+{
+	PROFILE_FUNCTION();
+	std::vector<DrawBatch> batches = PartitionDraws((UINT)draws.Sorted.size(), m_Recorder->ThreadCount(), MinDrawsPerBatch);
+	draws.Stats = DrawCallStats();
+
+	// Not worth a separate list: record inline on the current one.
+	if (batches.size() <= 1)
+	{
+		setup(m_FrameCommandList);
+		DrawPackets(m_FrameCommandList, draws.Sorted.data(), draws.Sorted.size(), pipeline, draws.Stats);
+		return;
+	}
+
+	// The batch lists go in between the list recorded so far and a fresh one that picks up
+	// the rest of the frame, so the submission order matches the recording order.
+	CommandListPool& commandLists = *m_CurrentFrameResource->CommandLists;
+	ThrowIfFailed(m_FrameCommandList->Close());
+
+	draws.BatchStats.assign(batches.size(), DrawCallStats());
+	m_Recorder->Record(commandLists, batches, [&](void* list, const DrawBatch& batch)
+		{
+			ID3D12GraphicsCommandList* cmdList = (ID3D12GraphicsCommandList*)list;
+			setup(cmdList);
+			DrawPackets(cmdList, draws.Sorted.data() + batch.Begin, batch.End - batch.Begin, pipeline, draws.BatchStats[&batch - batches.data()]);
+		});
+
+	for (const DrawCallStats& batchStats : draws.BatchStats)
+		draws.Stats += batchStats;
+
+	m_FrameCommandList = commandLists.AcquireList();
+	m_FrameGraphBackend->SetCommandList(m_FrameCommandList);
+}
+
+void Renderer::DrawPackets(ID3D12GraphicsCommandList* cmdList, const DrawPacket* packets, size_t count, UINT boundPipeline, DrawCallStats& stats)
+{
+	D3D12DrawPacketSink sink(cmdList, m_DrawPipelines, m_DrawGeometries,
+		m_CurrentFrameResource->ObjectCB->Resource()->GetGPUVirtualAddress(),
+		m_CurrentFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress());
+
+	SubmitDrawPackets(packets, count, boundPipeline, sink, stats);
+}
+
+void Renderer::BuildPropRenderItems(UINT count)
+{
+	m_PropRenderItems.clear();
+	m_PropRenderItems.reserve(count);
+	m_PropTransforms.Clear();
+
+	struct PropMesh
+	{
+		GeometryHandle Geo;
+		const SubmeshGeometry* Submesh;
+		float Scale;
+	};
+
+	GeometryHandle skullGeo = m_Geometries.Find("skullGeo");
+	GeometryHandle shapeGeo = m_Geometries.Find("shapeGeo");
+	const auto& skullArgs = m_Geometries.Get(skullGeo)->DrawArgs;
+	const auto& shapeArgs = m_Geometries.Get(shapeGeo)->DrawArgs;
+	const PropMesh meshes[] =
+	{
+		{ skullGeo, &skullArgs.at("skull"), 0.5f },
+		{ skullGeo, &skullArgs.at("skull"), 0.5f },
+		{ shapeGeo, &shapeArgs.at("box"), 3.0f },
+		{ shapeGeo, &shapeArgs.at("cylinder"), 2.0f },
+	};
+	MaterialHandle materials[] = { m_Materials.Find("skullMat"), m_Materials.Find("grass") };
+
+	// Fixed seed, so a given count always produces the same scene.
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const XMFLOAT2 terrainSize = m_TerrainConstantsCPU.gTerrainSize;
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		const PropMesh& mesh = meshes[i % _countof(meshes)];
+
+		float x = (unit(rng) - 0.5f) * terrainSize.x;
+		float z = (unit(rng) - 0.5f) * terrainSize.y;
+		float scale = mesh.Scale * (0.5f + unit(rng));
+		float yaw = unit(rng) * XM_2PI;
+
+		RenderItem& ri = m_PropRenderItems.emplace_back();
+		m_PropTransforms.Add(MakeTransform(XMVectorReplicate(scale), XMQuaternionRotationRollPitchYaw(0.0f, yaw, 0.0f), XMVectorSet(x, SampleTerrainHeight(x, z), z, 0.0f)));
+		ri.Mat = materials[(i / _countof(meshes)) % _countof(materials)];
+		ri.Geo = mesh.Geo;
+		ri.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		ri.IndexCount = mesh.Submesh->IndexCount;
+		ri.StartIndexLocation = mesh.Submesh->StartIndexLocation;
+		ri.BaseVertexLocation = mesh.Submesh->BaseVertexLocation;
+		ri.Bounds = mesh.Submesh->Bounds;
+	}
+}
+
+float Renderer::SampleTerrainHeight(float x, float z) const
+{
+	// Same mapping as the displacement in vertex.hlsl, nearest texel.
+	const HeightMap& hm = m_CpuHeightMap;
+	if (hm.data.empty())
+		return 0.0f;
+
+	float u = std::clamp(x / m_TerrainConstantsCPU.gTerrainSize.x + 0.5f, 0.0f, 1.0f);
+	float v = std::clamp(z / m_TerrainConstantsCPU.gTerrainSize.y + 0.5f, 0.0f, 1.0f);
+	UINT col = std::min((UINT)(u * (hm.width - 1) + 0.5f), hm.width - 1);
+	UINT row = std::min((UINT)(v * (hm.height - 1) + 0.5f), hm.height - 1);
+
+	return hm.data[row * hm.width + col] * m_TerrainHeightScale;
+}
+
+void Renderer::UpdateInstanceBuffers()
+{
+	PROFILE_FUNCTION();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&m_View), XMLoadFloat4x4(&m_Proj)));
+	CullFrustum frustum = FrustumFromViewProj(&viewProj.m[0][0]);
+
+	UpdatePropWorlds();
+
+	m_InstanceBatcher.Begin();
+	for (size_t i = 0; i < m_PropRenderItems.size(); ++i)
+	{
+		const RenderItem& ri = m_PropRenderItems[i];
+		InstanceBatchKey key;
+		key.Geometry = m_Geometries.Get(ri.Geo);
+		key.IndexCount = ri.IndexCount;
+		key.StartIndexLocation = ri.StartIndexLocation;
+		key.BaseVertexLocation = ri.BaseVertexLocation;
+		key.Material = m_Materials.Get(ri.Mat)->MatCBIndex;
+
+		const BoundingBox& bounds = ri.Bounds;
+		float center[3] = { bounds.Center.x, bounds.Center.y, bounds.Center.z };
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+		m_InstanceBatcher.Add(key, &m_PropWorlds[i].m[0][0], center, radius);
+	}
+	m_InstanceBatcher.Build(frustum);
+
+	// Only what survived culling is uploaded, already grouped by batch.
+	const std::vector<InstanceData>& instances = m_InstanceBatcher.Instances();
+	if (!instances.empty())
+	{
+		m_CurrentFrameResource->ReserveInstances(m_Device.Get(), (UINT)instances.size());
+		m_CurrentFrameResource->InstanceBuffer->CopyData(0, instances.data(), (UINT)instances.size());
+	}
+
+	// Each batch is a draw candidate; compaction turns the non-empty ones into indirect
+	// commands that bind their own geometry.
+	m_IndirectGeometrySources.clear();
+	m_IndirectGeometries.clear();
+	m_IndirectCandidates.clear();
+	for (const InstanceBatch& batch : m_InstanceBatcher.Batches())
+	{
+		const MeshGeometry* geo = static_cast<const MeshGeometry*>(batch.Key.Geometry);
+
+		UINT geometry = 0;
+		while (geometry < m_IndirectGeometrySources.size() && m_IndirectGeometrySources[geometry] != geo)
+			geometry++;
+		if (geometry == m_IndirectGeometrySources.size())
 		{
-			cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-			cmdList->SetGraphicsRootConstantBufferView(2, matCBAddress);
+			D3D12_VERTEX_BUFFER_VIEW vbv = geo->VertexBufferView();
+			D3D12_INDEX_BUFFER_VIEW ibv = geo->IndexBufferView();
+
+			IndirectGeometry views;
+			views.VertexBuffer.BufferLocation = vbv.BufferLocation;
+			views.VertexBuffer.SizeInBytes = vbv.SizeInBytes;
+			views.VertexBuffer.StrideInBytes = vbv.StrideInBytes;
+			views.IndexBuffer.BufferLocation = ibv.BufferLocation;
+			views.IndexBuffer.SizeInBytes = ibv.SizeInBytes;
+			views.IndexBuffer.Format = (uint32_t)ibv.Format;
+
+			m_IndirectGeometrySources.push_back(geo);
+			m_IndirectGeometries.push_back(views);
 		}
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		IndirectDrawCandidate candidate;
+		candidate.Geometry = geometry;
+		candidate.IndexCount = batch.Key.IndexCount;
+		candidate.StartIndexLocation = batch.Key.StartIndexLocation;
+		candidate.BaseVertexLocation = batch.Key.BaseVertexLocation;
+		candidate.FirstInstance = batch.FirstInstance;
+		candidate.InstanceCount = batch.InstanceCount;
+		m_IndirectCandidates.push_back(candidate);
 	}
+
+	UINT commandCount = CompactIndirectDraws(m_IndirectCandidates.data(), m_IndirectCandidates.size(), m_IndirectGeometries.data(), m_IndirectCommands);
+	if (commandCount > 0)
+	{
+		m_CurrentFrameResource->ReserveIndirectCommands(m_Device.Get(), commandCount);
+		m_CurrentFrameResource->IndirectCommands->CopyData(0, m_IndirectCommands.data(), commandCount);
+	}
+	m_CurrentFrameResource->IndirectCount->CopyData(0, commandCount);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	m_InstanceCullMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Renderer::DrawInstanceBatches(ID3D12GraphicsCommandList* cmdList)
+{
+	PROFILE_FUNCTION();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	cmdList->SetGraphicsRootShaderResourceView(6, m_CurrentFrameResource->InstanceBuffer->Resource()->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootShaderResourceView(7, m_CurrentFrameResource->MaterialBuffer->Resource()->GetGPUVirtualAddress());
+	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Geometry, first instance and draw all come from the argument buffer, so this costs the
+	// same however many batches are visible.
+	cmdList->ExecuteIndirect(m_IndirectDrawSignature.Get(), (UINT)m_IndirectCommands.size(),
+		m_CurrentFrameResource->IndirectCommands->Resource(), 0,
+		m_CurrentFrameResource->IndirectCount->Resource(), 0);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	m_InstanceRecordMs = std::chrono::duration<double, std::milli>(end - start).count();
 }
 
 void Renderer::BuildPSOs()
@@ -1514,8 +2094,8 @@ void Renderer::BuildPSOs()
 		m_VsByteCode->GetBufferSize()
 	};
 	opaquePsoDesc.PS = {
-		reinterpret_cast<BYTE*>(m_PsByteCode->GetBufferPointer()),
-		m_PsByteCode->GetBufferSize()
+		reinterpret_cast<BYTE*>(m_PsByteCodeTerrain[0]->GetBufferPointer()),
+		m_PsByteCodeTerrain[0]->GetBufferSize()
 	};
 	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
@@ -1529,11 +2109,19 @@ void Renderer::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Quality = 0;
 	opaquePsoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 
-	ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&m_PipelineStateObjects["opaque"])));
-
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC wireframePsoDesc = opaquePsoDesc;
-	wireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-	ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&wireframePsoDesc, IID_PPV_ARGS(&m_PipelineStateObjects["wireframe"])));
+	m_TerrainPipelines.resize(m_TerrainPermutations.VariantCount());
+	for (uint32_t i = 0; i < m_TerrainPermutations.VariantCount(); i++)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC terrainPsoDesc = opaquePsoDesc;
+		terrainPsoDesc.PS = {
+			reinterpret_cast<BYTE*>(m_PsByteCodeTerrain[i]->GetBufferPointer()),
+			m_PsByteCodeTerrain[i]->GetBufferSize()
+		};
+		if (m_TerrainPermutations.VariantFeatures(i) & ShaderFeatureWireframeDebug)
+			terrainPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+
+		m_TerrainPipelines[i] = StorePipeline("terrain" + std::to_string(i), terrainPsoDesc);
+	}
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC skyPsoDesc = opaquePsoDesc;
 	skyPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -1548,7 +2136,21 @@ void Renderer::BuildPSOs()
 		m_PsByteCodeSky->GetBufferSize()
 	};
 
-	ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&skyPsoDesc, IID_PPV_ARGS(&m_PipelineStateObjects["sky"])));
+	m_SkyPipeline = StorePipeline("sky", skyPsoDesc);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedPsoDesc = opaquePsoDesc;
+	instancedPsoDesc.VS = {
+		reinterpret_cast<BYTE*>(m_VsByteCodeInstanced->GetBufferPointer()),
+		m_VsByteCodeInstanced->GetBufferSize()
+	};
+	instancedPsoDesc.PS = {
+		reinterpret_cast<BYTE*>(m_PsByteCodeInstanced->GetBufferPointer()),
+		m_PsByteCodeInstanced->GetBufferSize()
+	};
+	m_InstancedPipeline = StorePipeline("instanced", instancedPsoDesc);
+
+	instancedPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+	m_InstancedWireframePipeline = StorePipeline("instancedWireframe", instancedPsoDesc);
 
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC waterPsoDesc = opaquePsoDesc;
@@ -1557,10 +2159,6 @@ void Renderer::BuildPSOs()
 		reinterpret_cast<BYTE*>(m_VsByteCodeWater->GetBufferPointer()),
 		m_VsByteCodeWater->GetBufferSize()
 	};
-	waterPsoDesc.PS = {
-		reinterpret_cast<BYTE*>(m_PsByteCodeWater->GetBufferPointer()),
-		m_PsByteCodeWater->GetBufferSize()
-	};
 	waterPsoDesc.BlendState.RenderTarget[0].BlendEnable = TRUE;
 	waterPsoDesc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
 	waterPsoDesc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
@@ -1573,45 +2171,192 @@ void Renderer::BuildPSOs()
 	waterPsoDesc.DepthStencilState.DepthEnable = TRUE;
 	waterPsoDesc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
-	ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&waterPsoDesc, IID_PPV_ARGS(&m_PipelineStateObjects["water"])));
+	m_WaterPipelines.resize(m_WaterPermutations.VariantCount());
+	for (uint32_t i = 0; i < m_WaterPermutations.VariantCount(); i++)
+	{
+		waterPsoDesc.PS = {
+			reinterpret_cast<BYTE*>(m_PsByteCodeWater[i]->GetBufferPointer()),
+			m_PsByteCodeWater[i]->GetBufferSize()
+		};
+		m_WaterPipelines[i] = StorePipeline("water" + std::to_string(i), waterPsoDesc);
+	}
 
 }
+
+PipelineHandle Renderer::StorePipeline(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	// A rebuilt pipeline takes over the slot of the one it replaces.
+	ComPtr<ID3D12PipelineState> pso = m_PipelineCache->CreateGraphicsPipeline(name, desc);
+	PipelineHandle handle = m_PipelineStates.Find(name);
+	if (ComPtr<ID3D12PipelineState>* existing = m_PipelineStates.Get(handle))
+	{
+		*existing = pso;
+		return handle;
+	}
+	return m_PipelineStates.Add(name, pso);
+}
+
+ID3D12PipelineState* Renderer::GetPipeline(PipelineHandle handle) const
+{
+	const ComPtr<ID3D12PipelineState>* pso = m_PipelineStates.Get(handle);
+	return pso ? pso->Get() : nullptr;
+}
 void Renderer::BuildFrameResources()
 {
 	for (int i = 0; i < NumFrameResources; ++i)
 	{
-		m_FrameResources.push_back(std::make_unique<FrameResource>(m_Device.Get(), 1, (UINT)m_OpaqueRenderItems.size(), (UINT)m_TransparentRenderItems.size(), (UINT)m_SkyRenderItems.size(), (UINT)m_Materials.size(), m_Waves->VertexCount()));
+		m_FrameResources.push_back(std::make_unique<FrameResource>(m_Device.Get(), 1, (UINT)m_OpaqueRenderItems.size(), (UINT)m_TransparentRenderItems.size(), (UINT)m_SkyRenderItems.size(), (UINT)m_Materials.Size(), m_Waves->VertexCount()));
 	}
 }
 void Renderer::UpdateObjectCBs()
 {
+	PROFILE_FUNCTION();
 	auto currObjectCB = m_CurrentFrameResource->ObjectCB.get();
+	BYTE* mapped = currObjectCB->MappedData();
+	UINT stride = currObjectCB->ElementByteSize();
+
+	// World matrices are built in batches over the dirty slots and written straight into the
+	// constant buffer, slot i being element i.
+	m_ObjectTransformRanges.clear();
+	m_ObjectTransforms.TakeDirtyRanges(m_ObjectTransformRanges);
+	m_TransformsUpdated = 0;
+	for (const TransformRange& range : m_ObjectTransformRanges)
+	{
+		ComputeWorldMatricesParallel(m_ObjectTransforms, range, mapped + (size_t)range.First * stride + offsetof(ObjectConstants, World), stride, true);
+		currObjectCB->AddBytesWritten((UINT64)range.Count * sizeof(XMFLOAT4X4));
+		m_TransformsUpdated += range.Count;
+	}
+
+	for (RenderItem& e : m_RenderItems)
+	{
+		if (e.NumFramesDirty)
+		{
+			XMMATRIX texTransform = XMLoadFloat4x4(&e.TexTransform);
+			auto* dst = reinterpret_cast<XMFLOAT4X4*>(mapped + (size_t)e.ObjCBIndex * stride + offsetof(ObjectConstants, TexTransform));
+			XMStoreFloat4x4(dst, XMMatrixTranspose(texTransform));
+			currObjectCB->AddBytesWritten(sizeof(XMFLOAT4X4));
+
+			e.NumFramesDirty--;
+		}
+	}
+}
+
+void Renderer::SetObjectTransform(const RenderItem* ri, const Transform& transform)
+{
+	while (m_ObjectTransforms.Size() <= ri->ObjCBIndex)
+		m_ObjectTransforms.Add(Transform());
+	m_ObjectTransforms.Set(ri->ObjCBIndex, transform);
+}
+
+void Renderer::UpdatePropWorlds()
+{
+	m_PropWorlds.resize(m_PropTransforms.Size());
+
+	m_PropTransformRanges.clear();
+	m_PropTransforms.TakeDirtyRanges(m_PropTransformRanges);
+	for (const TransformRange& range : m_PropTransformRanges)
+		ComputeWorldMatricesParallel(m_PropTransforms, range, reinterpret_cast<BYTE*>(&m_PropWorlds[range.First]), sizeof(XMFLOAT4X4), false);
+}
 
-	for (auto& e : m_AllRenderItems)
+void Renderer::ComputeWorldMatricesParallel(const TransformStore& store, const TransformRange& range, BYTE* dst, size_t stride, bool transpose)
+{
+	// Small ranges are not worth handing to the thread pool.
+	if (range.Count <= TransformChunkSize)
 	{
-		if (e->NumFramesDirty)
+		ComputeWorldMatrices(store, range.First, range.Count, dst, stride, transpose);
+		return;
+	}
+
+	m_Jobs->ParallelFor(0, range.Count, TransformChunkSize, [&](uint32_t begin, uint32_t end)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+			ComputeWorldMatrices(store, range.First + begin, end - begin, dst + (size_t)begin * stride, stride, transpose);
+		});
+}
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+void Renderer::RunTransformBenchmark(UINT count)
+{
+	// Random transforms, set up both as heap-allocated render items for the per-item path and
+	// as a transform store for the batched one. Both write ObjectConstants-sized elements.
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	TransformStore store(1);
+	std::vector<std::unique_ptr<RenderItem>> items;
+	std::vector<Transform> transforms;
+	for (UINT i = 0; i < count; ++i)
+	{
+		Transform transform = MakeTransform(XMVectorReplicate(1.0f + 0.5f * unit(rng)),
+			XMQuaternionRotationRollPitchYaw(unit(rng), unit(rng), unit(rng)),
+			XMVectorSet(100.0f * unit(rng), 100.0f * unit(rng), 100.0f * unit(rng), 0.0f));
+		store.Add(transform);
+		transforms.push_back(transform);
+
+		auto ri = std::make_unique<RenderItem>();
+		ri->ObjCBIndex = i;
+		items.push_back(std::move(ri));
+	}
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	const size_t stride = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	std::vector<BYTE> upload(stride * count);
 
-			e->NumFramesDirty--;
+	// The per-item path: compose each world matrix with DirectXMath, transpose and copy.
+	auto start = std::chrono::high_resolution_clock::now();
+	for (UINT i = 0; i < count; ++i)
+	{
+		const Transform& t = transforms[i];
+		const RenderItem* ri = items[i].get();
+		XMMATRIX world = XMMatrixScaling(t.Scale[0], t.Scale[1], t.Scale[2]) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(t.Rotation))) *
+			XMMatrixTranslation(t.Position[0], t.Position[1], t.Position[2]);
+
+		ObjectConstants objConstants;
+		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+		XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(XMLoadFloat4x4(&ri->TexTransform)));
+		memcpy(&upload[ri->ObjCBIndex * stride], &objConstants, sizeof(objConstants));
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	m_TransformBenchPerItemMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	ComputeWorldMatrices(store, 0, count, upload.data(), stride, true);
+	end = std::chrono::high_resolution_clock::now();
+	m_TransformBenchBatchMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	ComputeWorldMatricesParallel(store, { 0, count }, upload.data(), stride, true);
+	end = std::chrono::high_resolution_clock::now();
+	m_TransformBenchParallelMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Renderer::RunJobScalingBenchmark()
+{
+	// The same terrain generation on pools of 1 to N threads, best of three runs each.
+	const UINT size = 1024;
+	m_JobScalingMs.clear();
+	for (UINT threads = 1; threads <= m_Jobs->ThreadCount(); ++threads)
+	{
+		JobSystem jobs(threads - 1);
+		double best = DBL_MAX;
+		for (int run = 0; run < 3; ++run)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			GeneratePerlinHeightmap(size, size, TerrainNoiseSettings(), jobs);
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
 		}
+		m_JobScalingMs.push_back(best);
 	}
 }
 
 void Renderer::UpdateMaterialCBs()
 {
+	PROFILE_FUNCTION();
 	auto curretMaterialCB = m_CurrentFrameResource->MaterialCB.get();
+	auto currMaterialBuffer = m_CurrentFrameResource->MaterialBuffer.get();
 
-	for (auto& e : m_Materials)
+	for (Material& e : m_Materials)
 	{
-		Material* mat = e.second.get();
+		Material* mat = &e;
 
 		if (mat->NumFramesDirty > 0)
 		{
@@ -1625,12 +2370,30 @@ void Renderer::UpdateMaterialCBs()
 
 			curretMaterialCB->CopyData(mat->MatCBIndex, matConstants);
 
+			MaterialData matData;
+			matData.DiffuseAlbedo = mat->DiffuseAlbedo;
+			matData.FresnelR0 = mat->FresnelR0;
+			matData.Roughness = mat->Roughness;
+			currMaterialBuffer->CopyData(mat->MatCBIndex, matData);
+
 			mat->NumFramesDirty--;
 		}
 	}
 }
 void Renderer::UpdateMainPassCB()
 {
+	PROFILE_FUNCTION();
+	PassInputs inputs = { m_View, m_Proj, m_Camera.GetPosition3f(), m_ClientWidth, m_ClientHeight };
+	if (m_PassInputs.Changed(inputs))
+		BuildMainPassCB();
+
+	UploadIfStale(*m_CurrentFrameResource->PassCB, 0, m_MainPassCB, m_CurrentFrameResourceIndex);
+}
+
+void Renderer::BuildMainPassCB()
+{
+	PassConstants& passCB = m_MainPassCB.Edit();
+
 	XMMATRIX view = XMLoadFloat4x4(&m_View);
 	XMMATRIX proj = XMLoadFloat4x4(&m_Proj);
 
@@ -1640,49 +2403,56 @@ void Renderer::UpdateMainPassCB()
 	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
 	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
 
-	XMStoreFloat4x4(&m_MainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&m_MainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&m_MainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&m_MainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&m_MainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&m_MainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-
-	m_MainPassCB.EyePosW = m_Camera.GetPosition3f();
-	m_MainPassCB.RenderTargetSize = XMFLOAT2((float)m_ClientWidth, (float)m_ClientHeight);
-	m_MainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / m_ClientWidth, 1.0f / m_ClientHeight);
-	m_MainPassCB.NearZ = 1.0f;
-	m_MainPassCB.FarZ = 1000.0f;
-	m_MainPassCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
-	m_MainPassCB.FogColor = { 0.7f, 0.7f, 0.7f, 1.0f };
-	m_MainPassCB.FogStart = 5.0f;
-	m_MainPassCB.FogRange = 150.0f;
-
-	m_MainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	m_MainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
-	m_MainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
-	m_MainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
-	m_MainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	m_MainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
-
-	auto currPassCB = m_CurrentFrameResource->PassCB.get();
-	currPassCB->CopyData(0, m_MainPassCB);
+	XMStoreFloat4x4(&passCB.View, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&passCB.InvView, XMMatrixTranspose(invView));
+	XMStoreFloat4x4(&passCB.Proj, XMMatrixTranspose(proj));
+	XMStoreFloat4x4(&passCB.InvProj, XMMatrixTranspose(invProj));
+	XMStoreFloat4x4(&passCB.ViewProj, XMMatrixTranspose(viewProj));
+	XMStoreFloat4x4(&passCB.InvViewProj, XMMatrixTranspose(invViewProj));
+
+	passCB.EyePosW = m_Camera.GetPosition3f();
+	passCB.RenderTargetSize = XMFLOAT2((float)m_ClientWidth, (float)m_ClientHeight);
+	passCB.InvRenderTargetSize = XMFLOAT2(1.0f / m_ClientWidth, 1.0f / m_ClientHeight);
+	passCB.NearZ = 1.0f;
+	passCB.FarZ = 1000.0f;
+	passCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
+	passCB.FogColor = { 0.7f, 0.7f, 0.7f, 1.0f };
+	passCB.FogStart = 5.0f;
+	passCB.FogRange = 150.0f;
+
+	passCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+	passCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+	passCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
+	passCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
+	passCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
+	passCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
 }
 
 void Renderer::UpdateTerrainCB()
 {
-	const float mudStartFrac = 0.15f;
-	const float grassStartFrac = 0.45f;
-	const float rockStartFrac = 0.69f;
-	const float mudRepeatSize = 16.0f;
-	const float grassRepeatSize = 8.0f;
+	PROFILE_FUNCTION();
+	TerrainInputs inputs = { m_TerrainConstantsCPU.gTerrainSize, m_TerrainHeightScale };
+	if (m_TerrainInputs.Changed(inputs))
+		BuildTerrainCB();
+
+	UploadIfStale(*m_CurrentFrameResource->TerrainCB, 0, m_TerrainConstantsCB, m_CurrentFrameResourceIndex);
+}
+
+void Renderer::BuildTerrainCB()
+{
+	// Calibrated against the default 135-high, 460-wide terrain.
+	const float mudStartFrac = 37.0f / 135.0f;
+	const float grassStartFrac = 49.0f / 135.0f;
+	const float rockStartFrac = 89.0f / 135.0f;
+	const float mudRepeatSize = 460.0f / 2.0f;
+	const float grassRepeatSize = 460.0f / 6.0f;
 	const float rockRepeatSize = 12.0f;
 
-	const float blendFrac = 0.12f;
+	const float blendFrac = 3.0f / 135.0f;
 	m_TerrainConstantsCPU.gHeightOffset = 0.0f;
 	m_TerrainConstantsCPU.gHeightScale = m_TerrainHeightScale;
 
 	float minH = m_TerrainConstantsCPU.gHeightOffset;
-	;
 	float maxH = m_TerrainConstantsCPU.gHeightOffset + m_TerrainConstantsCPU.gHeightScale;
 	float rangeH = maxH - minH;
 
@@ -1690,69 +2460,54 @@ void Renderer::UpdateTerrainCB()
 	m_TerrainConstantsCPU.gGrassStartHeight = minH + grassStartFrac * rangeH;
 	m_TerrainConstantsCPU.gRockStartHeight = minH + rockStartFrac * rangeH;
 	m_TerrainConstantsCPU.gHeightBlendRange = blendFrac * rangeH;
-	m_TerrainConstantsCPU.gMudSlopeBias = 0.15f;
-	m_TerrainConstantsCPU.gMudSlopePower = 1.8f;
+	m_TerrainConstantsCPU.gMudSlopeBias = 0.2f;
+	m_TerrainConstantsCPU.gMudSlopePower = 2.0f;
 	m_TerrainConstantsCPU.gRockSlopeBias = 0.3f;
 	m_TerrainConstantsCPU.gRockSlopePower = 3.0f;
 
-	m_TerrainConstantsCPU.gMudTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / mudRepeatSize);;
-	m_TerrainConstantsCPU.gGrassTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / grassRepeatSize);;
-	m_TerrainConstantsCPU.gRockTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / rockRepeatSize);;
+	m_TerrainConstantsCPU.gMudTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / mudRepeatSize);
+	m_TerrainConstantsCPU.gGrassTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / grassRepeatSize);
+	m_TerrainConstantsCPU.gRockTiling = std::max(1.0f, m_TerrainConstantsCPU.gTerrainSize.x / rockRepeatSize);
 
-	m_TerrainConstantsCB.gTerrainSize = m_TerrainConstantsCPU.gTerrainSize;
-	m_TerrainConstantsCB.gHeightScale = m_TerrainConstantsCPU.gHeightScale;
-	m_TerrainConstantsCB.gHeightOffset = m_TerrainConstantsCPU.gHeightOffset;
-
-	m_TerrainConstantsCB.gMudStartHeight = m_TerrainConstantsCPU.gMudStartHeight;
-	m_TerrainConstantsCB.gGrassStartHeight = m_TerrainConstantsCPU.gGrassStartHeight;
-
-	m_TerrainConstantsCB.gRockStartHeight = m_TerrainConstantsCPU.gRockStartHeight;
-	m_TerrainConstantsCB.gHeightBlendRange = m_TerrainConstantsCPU.gHeightBlendRange;
-
-	m_TerrainConstantsCB.gMudSlopeBias = m_TerrainConstantsCPU.gMudSlopeBias;
-	m_TerrainConstantsCB.gMudSlopePower = m_TerrainConstantsCPU.gMudSlopePower;
-
-	m_TerrainConstantsCB.gRockSlopeBias = m_TerrainConstantsCPU.gRockSlopeBias;
-	m_TerrainConstantsCB.gRockSlopePower = m_TerrainConstantsCPU.gRockSlopePower;
-
-	m_TerrainConstantsCB.gMudTiling = m_TerrainConstantsCPU.gMudTiling;
-	m_TerrainConstantsCB.gGrassTiling = m_TerrainConstantsCPU.gGrassTiling;
-
-	m_TerrainConstantsCB.gRockTiling = m_TerrainConstantsCPU.gRockTiling;
-	m_TerrainConstantsCB.gPad = m_TerrainConstantsCPU.gPad;
-
-	auto currTerrainCB = m_CurrentFrameResource->TerrainCB.get();
-	currTerrainCB->CopyData(0, m_TerrainConstantsCB);
+	m_TerrainConstantsCB.Edit() = m_TerrainConstantsCPU;
 }
 
 void Renderer::UpdateWaterCB(GameTimer& dt)
 {
+	PROFILE_FUNCTION();
+	// The water block carries the time, so it changes every frame; it is the same for every
+	// transparent item though, so build it once.
+	WaterConstants& waterCB = m_WaterConstantsCB.Edit();
+	XMMATRIX world = XMMatrixIdentity() * XMMatrixTranslation(m_WaterHeight[0], m_WaterHeight[1], m_WaterHeight[2]);
+	XMStoreFloat4x4(&waterCB.gWorld, world);
+	XMStoreFloat4x4(&waterCB.gViewProj, XMMatrixMultiply(XMMatrixTranspose(XMLoadFloat4x4(&m_View)), XMMatrixTranspose(XMLoadFloat4x4(&m_Proj))));
+
+	waterCB.gCameraPos = m_EyePos;
+	waterCB.gTime = dt.TotalTime();
+	waterCB.gWaterColor = XMFLOAT3(0.65f, 0.75f, 0.90f);
+	waterCB.gPad0 = 0.0f;
+
+	auto currWaterCB = m_CurrentFrameResource->WaterCB.get();
 	for (int i = 0; i < m_TransparentRenderItems.size(); ++i)
-	{
-		XMMATRIX world = XMMatrixIdentity() * XMMatrixTranslation(m_WaterHeight[0], m_WaterHeight[1], m_WaterHeight[2]);
-		XMStoreFloat4x4(&m_WaterConstantsCB.gWorld, world);
-		XMStoreFloat4x4(&m_WaterConstantsCB.gViewProj, XMMatrixMultiply(XMMatrixTranspose(XMLoadFloat4x4(&m_View)), XMMatrixTranspose(XMLoadFloat4x4(&m_Proj))));
-
-		m_WaterConstantsCB.gCameraPos = m_EyePos;
-		m_WaterConstantsCB.gTime = dt.TotalTime();
-		m_WaterConstantsCB.gWaterColor = XMFLOAT3(0.65f, 0.75f, 0.90f);
-		m_WaterConstantsCB.gPad0 = 0.0f;
-		auto currWaterCB = m_CurrentFrameResource->WaterCB.get();
-		currWaterCB->CopyData(i, m_WaterConstantsCB);
-	}
+		currWaterCB->CopyData(i, m_WaterConstantsCB.Data());
+	m_WaterConstantsCB.MarkUploaded(m_CurrentFrameResourceIndex);
 }
 
 void Renderer::UpdateWaves(GameTimer& gt)
 {
-	static float t_base = 0.0f;
-	if ((gt.TotalTime() - t_base) >= 0.25f)
+	PROFILE_FUNCTION();
+	if ((gt.TotalTime() - m_WaveDisturbTime) >= 0.25f)
 	{
-		t_base += 0.25f;
+		m_WaveDisturbTime += 0.25f;
 
-		int i = MathHelper::Rand(4, m_Waves->RowCount() - 5);
-		int j = MathHelper::Rand(4, m_Waves->ColumnCount() - 5);
+		// Drawn from the frame seed rather than rand(), so a replay disturbs the same cells.
+		std::minstd_rand rng(m_FrameSeed);
+		auto randInt = [&rng](int a, int b) { return a + (int)(rng() % (uint32_t)(b - a + 1)); };
 
-		float r = MathHelper::RandF(0.2f, 0.5f);
+		int i = randInt(4, m_Waves->RowCount() - 5);
+		int j = randInt(4, m_Waves->ColumnCount() - 5);
+
+		float r = 0.2f + 0.3f * (float)(rng() - rng.min()) / (float)(rng.max() - rng.min());
 
 		m_Waves->Disturb(i, j, r);
 	}
@@ -1778,7 +2533,7 @@ void Renderer::UpdateWaves(GameTimer& gt)
 	}
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	m_WavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+	m_Geometries.Get(m_RenderItems.Get(m_WavesRitem)->Geo)->VertexBufferGPU = currWavesVB->Resource();
 };
 
 
@@ -1798,15 +2553,25 @@ void Renderer::FlushCommandQueue()
 
 	ThrowIfFailed(m_CommandQueue->Signal(m_Fence.Get(), m_CurrentFence));
 
-	if (m_Fence->GetCompletedValue() < m_CurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+	WaitForFence(m_CurrentFence);
+}
 
-		ThrowIfFailed(m_Fence->SetEventOnCompletion(m_CurrentFence, eventHandle));
+void Renderer::DeferRelease(Microsoft::WRL::ComPtr<ID3D12Pageable> object)
+{
+	if (object == nullptr)
+		return;
 
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	// The frame being recorded signals m_CurrentFence + 1 once the GPU is done with it.
+	m_DeferredReleases.push_back({ (UINT64)m_CurrentFence + 1, std::move(object) });
+}
+
+void Renderer::ReleaseRetiredResources()
+{
+	const UINT64 completed = m_Fence->GetCompletedValue();
+
+	auto it = std::remove_if(m_DeferredReleases.begin(), m_DeferredReleases.end(),
+		[completed](const DeferredRelease& d) { return d.Fence <= completed; });
+	m_DeferredReleases.erase(it, m_DeferredReleases.end());
 }
 
 ID3D12Resource* Renderer::CurrentBackBuffer() const
@@ -1818,6 +2583,93 @@ void Renderer::ShowImGUIEnvironmentControl()
 {
 	ImGui::Begin("Landscape Control");
 
+	if (ImGui::CollapsingHeader("Performance", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		// Everything here is read back from the metrics registry, the same values a scraper sees.
+		MetricsRegistry& metrics = MetricsRegistry::Get();
+		auto ms = [&metrics](MetricId id) { return metrics.Value(id) / 1000.0; };
+
+		ImGui::Text("CPU frame: p50 %.2f, p95 %.2f, p99 %.2f ms over %u frames",
+			ms(m_Metrics.CpuFrameP50), ms(m_Metrics.CpuFrameP95), ms(m_Metrics.CpuFrameP99), m_CpuFrameTimes.Count());
+		ImGui::PlotLines("##CpuFrameTimes", m_CpuFrameTimes.Data(), (int)m_CpuFrameTimes.Count(), (int)m_CpuFrameTimes.Offset(),
+			nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 50.0f));
+		ImGui::Text("Update %.2f, draw %.2f ms", ms(m_Metrics.Update), ms(m_Metrics.Draw));
+		ImGui::Text("Waits: pacing %.2f, fence %.2f, present %.2f ms", ms(m_Metrics.PacingWait), ms(m_Metrics.FenceWait), ms(m_Metrics.Present));
+		ImGui::Text("GPU frame: %.2f ms", ms(m_Metrics.GpuFrame));
+		if (m_GpuTimer->HasResults())
+		{
+			ImGui::Indent();
+			for (const GpuPassTiming& timing : m_GpuTimer->Results())
+				ImGui::Text("%s: %.3f ms", timing.Name, timing.Ms);
+			ImGui::Unindent();
+		}
+		ImGui::Text("Draw calls: %lld, triangles: %lld", (long long)metrics.Value(m_Metrics.DrawCalls), (long long)metrics.Value(m_Metrics.Triangles));
+		ImGui::Text("Uploads: %lld bytes/frame", (long long)metrics.Value(m_Metrics.UploadBytes));
+		ImGui::Text("Descriptors: %lld / %lld (high water %lld)", (long long)metrics.Value(m_Metrics.DescriptorsUsed),
+			(long long)metrics.Value(m_Metrics.DescriptorCapacity), (long long)metrics.Value(m_Metrics.DescriptorsHighWater));
+		ImGui::Text("GPU memory: %.1f / %.1f MB budget", metrics.Value(m_Metrics.GpuMemoryUsage) / (1024.0 * 1024.0),
+			metrics.Value(m_Metrics.GpuMemoryBudget) / (1024.0 * 1024.0));
+
+		if (ImGui::TreeNode("All metrics"))
+		{
+			metrics.Snapshot(m_MetricSamples);
+			for (const MetricSample& sample : m_MetricSamples)
+				ImGui::Text("%s: %lld %s", sample.Name, (long long)sample.Value, sample.Unit);
+			ImGui::TreePop();
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Memory"))
+	{
+		// Only allocations made through the tracked allocators and resource helpers are counted.
+		const MemoryTracker& tracker = MemoryTracker::Get();
+		const double mb = 1.0 / (1024.0 * 1024.0);
+		ImGui::Text("Tracked: CPU %.1f MB, GPU %.1f MB", tracker.TotalBytes(MemoryDomain::Cpu) * mb, tracker.TotalBytes(MemoryDomain::Gpu) * mb);
+		if (ImGui::BeginTable("MemoryTags", 5, ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Tag");
+			ImGui::TableSetupColumn("CPU MB");
+			ImGui::TableSetupColumn("CPU peak");
+			ImGui::TableSetupColumn("GPU MB");
+			ImGui::TableSetupColumn("GPU peak");
+			ImGui::TableHeadersRow();
+			for (size_t i = 0; i < (size_t)MemoryTag::Count; i++)
+			{
+				MemoryTag tag = (MemoryTag)i;
+				MemoryUsage cpu = tracker.Usage(tag, MemoryDomain::Cpu);
+				MemoryUsage gpu = tracker.Usage(tag, MemoryDomain::Gpu);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(MemoryTagName(tag));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", cpu.CurrentBytes * mb);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", cpu.PeakBytes * mb);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", gpu.CurrentBytes * mb);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", gpu.PeakBytes * mb);
+			}
+			ImGui::EndTable();
+		}
+		if (ImGui::Button("Reset peaks"))
+			MemoryTracker::Get().ResetPeaks();
+	}
+
+	if (ImGui::CollapsingHeader("Replay"))
+	{
+		// Recording and playback both run the simulation at a fixed time step.
+		if (ImGui::Button("Record"))
+			m_ReplayCommand = ReplayCommand::Record;
+		ImGui::SameLine();
+		if (ImGui::Button("Play"))
+			m_ReplayCommand = ReplayCommand::Play;
+		ImGui::SameLine();
+		if (ImGui::Button("Stop"))
+			m_ReplayCommand = ReplayCommand::Stop;
+		ImGui::TextUnformatted(m_ReplayStatus.c_str());
+	}
+
 	if (ImGui::CollapsingHeader("Water Settings"))
 	{
 		ImGui::SliderFloat3("Water Position", m_WaterHeight, -40.0f, 150.0f);
@@ -1844,66 +2696,283 @@ void Renderer::ShowImGUIEnvironmentControl()
 	}
 
 
-	ImGui::Checkbox("Wireframe", &m_WireframeMode);
-	XMStoreFloat4x4(&m_TransparentRenderItems[0]->World, XMMatrixScaling(m_WaterScale[0], m_WaterScale[1], m_WaterScale[2]) * XMMatrixTranslation(m_WaterHeight[0], m_WaterHeight[1], m_WaterHeight[2]));
-	m_TransparentRenderItems[0]->NumFramesDirty = NumFrameResources;
-	ImGui::End();
-}
+	if (ImGui::CollapsingHeader("Upload Stats"))
+	{
+		const UploadStats& stats = m_Uploads->GetStats();
+		ImGui::Text("Uploaded last frame: %llu bytes", stats.BytesLastFrame);
+		ImGui::Text("Uploaded total: %llu bytes", stats.BytesTotal);
+		ImGui::Text("Copy fence CPU wait: %.3f ms", stats.CpuWaitMsLastFrame);
+		ImGui::Text("Queue waits inserted: %u", stats.QueueWaitsLastFrame);
+	}
 
-HeightMap Renderer::GeneratePerlinHeightmap(UINT width, UINT height, float scale, int octaves, float persistence, int seed)
-{
-	HeightMap hm;
-	hm.width = width;
-	hm.height = height;
-	hm.data.resize(width * height);
+	if (ImGui::CollapsingHeader("Frame Graph"))
+	{
+		const FrameGraph::Stats& stats = m_FrameGraph.GetStats();
+		ImGui::Text("Passes: %u (%u culled)", stats.DeclaredPasses, stats.CulledPasses);
+		ImGui::Text("Barriers: %u in %u batches", stats.Barriers, stats.BarrierBatches);
+		ImGui::Text("Transient heap: %llu bytes for %llu requested", stats.TransientHeapSize, stats.TransientBytesRequested);
+		ImGui::Text("Command lists: %u on %u recording threads", m_CurrentFrameResource->CommandLists->ListsUsed(), m_Recorder->ThreadCount());
+	}
 
-	// Guard against division by zero
-	if (width <= 1 || height <= 1) return hm;
+	if (ImGui::CollapsingHeader("Draw Submission"))
+	{
+		ImGui::Text("Draws: %u (%llu triangles)", m_DrawStats.Draws, (unsigned long long)m_DrawStats.Triangles);
+		ImGui::Text("API calls: %u sorted, %u unsorted", m_DrawStats.TotalCalls(), m_DrawStats.UnsortedCalls);
+		ImGui::Text("Pipeline sets: %u", m_DrawStats.PipelineSets);
+		ImGui::Text("Vertex/index buffer sets: %u/%u", m_DrawStats.VertexBufferSets, m_DrawStats.IndexBufferSets);
+		ImGui::Text("Topology sets: %u", m_DrawStats.TopologySets);
+		ImGui::Text("Root CBV sets: %u", m_DrawStats.RootCbvSets);
+		ImGui::Text("Upload memory written: %llu bytes", m_UploadBytesPerFrame);
+	}
 
-	float minH = FLT_MAX;
-	float maxH = -FLT_MAX;
+	if (ImGui::CollapsingHeader("CPU Profiler"))
+	{
+		Profiler& profiler = Profiler::Get();
+		bool enabled = profiler.IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+			profiler.SetEnabled(enabled);
+
+		if (const ProfileFrame* frame = profiler.LastFrame())
+		{
+			double overheadMs = profiler.LastFrameOverheadMs();
+			ImGui::Text("Frame %llu: %.3f ms, %zu scopes", (unsigned long long)frame->Index, frame->DurationMs(), frame->Nodes.size());
+			ImGui::Text("Profiler overhead: %.4f ms (%.3f%%), %llu scopes dropped", overheadMs,
+				frame->DurationMs() > 0.0 ? 100.0 * overheadMs / frame->DurationMs() : 0.0, (unsigned long long)profiler.DroppedScopes());
+
+			// Nodes of a thread are contiguous, so a thread header starts wherever the thread changes.
+			uint32_t node = 0;
+			while (node < (uint32_t)frame->Nodes.size())
+			{
+				uint32_t thread = frame->Nodes[node].Thread;
+				std::string threadName = profiler.ThreadName(thread);
+				bool open = ImGui::TreeNodeEx(threadName.c_str(), ImGuiTreeNodeFlags_DefaultOpen);
+				while (node < (uint32_t)frame->Nodes.size() && frame->Nodes[node].Thread == thread)
+					node = open ? ShowProfileNode(*frame, node) : node + 1;
+				if (open)
+					ImGui::TreePop();
+			}
+		}
 
-	std::vector<float> noiseValues(width * height, 0.0f);
+		if (ImGui::Button("Export Chrome trace"))
+		{
+			m_TraceExportStatus = profiler.WriteChromeTrace("cpu_trace.json")
+				? "Wrote cpu_trace.json (" + std::to_string(profiler.FrameCount()) + " frames)"
+				: "Could not write cpu_trace.json";
+		}
+		if (!m_TraceExportStatus.empty())
+			ImGui::Text("%s", m_TraceExportStatus.c_str());
+	}
 
-	for (UINT j = 0; j < height; ++j)
+	if (ImGui::CollapsingHeader("Frame Pacing"))
 	{
-		for (UINT i = 0; i < width; ++i)
+		FramePacingSettings pacing = m_Pacer.Settings();
+		int framesInFlight = (int)pacing.MaxFramesInFlight;
+		int frameLatency = (int)pacing.MaxFrameLatency;
+		float targetFps = (float)pacing.TargetFps;
+
+		bool changed = ImGui::Checkbox("VSync", &pacing.VSync);
+		changed |= ImGui::SliderInt("Max frames in flight", &framesInFlight, 1, NumFrameResources);
+		bool latencyChanged = ImGui::SliderInt("Max frame latency", &frameLatency, 1, 3);
+		changed |= ImGui::SliderFloat("Target FPS (0 = off)", &targetFps, 0.0f, 240.0f, "%.0f");
+		if (changed || latencyChanged)
 		{
-			float u = static_cast<float>(i) / static_cast<float>(width - 1);
-			float v = static_cast<float>(j) / static_cast<float>(height - 1);
+			pacing.MaxFramesInFlight = (uint32_t)framesInFlight;
+			pacing.MaxFrameLatency = (uint32_t)frameLatency;
+			pacing.TargetFps = targetFps;
+			m_Pacer.SetSettings(pacing);
+		}
+		if (latencyChanged)
+			SetFrameLatency(m_Pacer.Settings().MaxFrameLatency);
+		if (!m_TearingSupported)
+			ImGui::Text("Tearing unsupported: without vsync, presents still wait for vblank");
+
+		const FrameTimeHistogram& frames = m_Pacer.FrameTimes();
+		ImGui::Text("Frame time: mean %.2f, p50 %.1f, p95 %.1f, p99 %.1f, max %.2f ms",
+			frames.MeanMs(), frames.PercentileMs(0.5), frames.PercentileMs(0.95), frames.PercentileMs(0.99), frames.MaxMs());
+		ImGui::PlotHistogram("##FrameTimes", frames.Buckets().data(), FrameTimeHistogram::BucketCount, 0, "0 - 50 ms", 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+		const FrameTimeHistogram& latency = m_Pacer.InputLatency();
+		ImGui::Text("Input to present: mean %.2f, p95 %.1f, p99 %.1f, max %.2f ms",
+			latency.MeanMs(), latency.PercentileMs(0.95), latency.PercentileMs(0.99), latency.MaxMs());
+		ImGui::PlotHistogram("##InputLatency", latency.Buckets().data(), FrameTimeHistogram::BucketCount, 0, "0 - 50 ms", 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+
+		if (ImGui::Button("Reset histograms"))
+			m_Pacer.ResetHistograms();
+	}
 
-			float x = u * scale;
-			float z = v * scale;
+	if (ImGui::CollapsingHeader("Pipeline Cache"))
+	{
+		D3D12PipelineCache::Stats stats = m_PipelineCache->GetStats();
+		ImGui::Text("Shaders and pipelines built in %.2f ms at startup", m_PipelineBuildMs);
+		ImGui::Text("Shaders: %u cached, %u compiled", stats.ShaderHits, stats.ShaderMisses);
+		ImGui::Text("Pipelines: %u cached, %u created", stats.PipelineHits, stats.PipelineMisses);
+		ImGui::Text("Rejected cache entries: %u", stats.Rejected);
+		ImGui::Text("Hot reload: %zu files watched, %u reloads", m_ShaderWatcher.WatchedFileCount(), m_ShaderReloadCount);
+		ImGui::TextWrapped("%s", m_ShaderReloadStatus.c_str());
+	}
 
-			float amplitude = m_TerrainNoisePersistance;
-			float frequency = m_TerrainNoiseFrequency;
-			float noiseValue = m_TerrainNoiseValue;
+	if (ImGui::CollapsingHeader("Shader Features"))
+	{
+		const ShaderFeature toggles[] = { ShaderFeatureNormalMapping, ShaderFeatureRockLayer, ShaderFeatureFog, ShaderFeatureDepthAbsorption };
+		for (ShaderFeature feature : toggles)
+		{
+			bool enabled = (m_ShaderFeatures & feature) != 0;
+			if (ImGui::Checkbox(ShaderFeatureName(feature), &enabled))
+				m_ShaderFeatures = enabled ? (m_ShaderFeatures | feature) : (m_ShaderFeatures & ~feature);
+		}
+		ImGui::Text("Variants: %u terrain, %u water", m_TerrainPermutations.VariantCount(), m_WaterPermutations.VariantCount());
+	}
 
-			for (int o = 0; o < octaves; ++o)
-			{
-				noiseValue += amplitude * stb_perlin_noise3_seed(x * frequency, z * frequency, 0.0f, 0, 0, 0, m_TerrainNoiseSeed);
-				amplitude *= persistence;
-				frequency *= 2.0f;
-			}
+	if (ImGui::CollapsingHeader("Instancing"))
+	{
+		if (ImGui::Combo("Props", &m_PropCountIndex, PropCountNames, _countof(PropCountNames)))
+			BuildPropRenderItems(PropCountValues[m_PropCountIndex]);
+
+		const InstanceStats& stats = m_InstanceBatcher.GetStats();
+		ImGui::Text("Instances: %u visible of %u", stats.Visible, stats.Submitted);
+		ImGui::Text("Draws: %u instanced, %u without instancing", stats.Batches, stats.Visible);
+		ImGui::Text("Indirect commands: %u in 1 ExecuteIndirect", (UINT)m_IndirectCommands.size());
+		ImGui::Text("Cull and upload: %.3f ms", m_InstanceCullMs);
+		ImGui::Text("Record: %.3f ms", m_InstanceRecordMs);
+	}
 
-			//float h = 0.5f * (noiseValue + 1.0f);
+	if (ImGui::CollapsingHeader("Transforms"))
+	{
+		ImGui::Text("Object matrices rebuilt this frame: %u", m_TransformsUpdated);
+		if (ImGui::Button("Benchmark 100k transforms"))
+			RunTransformBenchmark(100000);
+		ImGui::Text("Per item: %.3f ms", m_TransformBenchPerItemMs);
+		ImGui::Text("SoA batch: %.3f ms", m_TransformBenchBatchMs);
+		ImGui::Text("SoA batch, parallel: %.3f ms", m_TransformBenchParallelMs);
+	}
 
-			noiseValues[j * width + i] = noiseValue;
+	if (ImGui::CollapsingHeader("Update Tasks"))
+	{
+		ImGui::Text("Wall: %.3f ms, tasks summed: %.3f ms", m_UpdateGraph.WallMs(), m_UpdateGraph.TotalTaskMs());
+		ImGui::Text("Critical path: %.3f ms", m_UpdateGraph.CriticalPathMs());
+		std::string path;
+		for (uint32_t task : m_UpdateGraph.CriticalPath())
+			path += (path.empty() ? "" : " > ") + m_UpdateGraph.TaskName(task);
+		ImGui::TextUnformatted(path.c_str());
+		for (uint32_t i = 0; i < m_UpdateGraph.TaskCount(); ++i)
+		{
+			const TaskGraph::TaskTiming& timing = m_UpdateGraph.Timing(i);
+			ImGui::Text("%-12s %7.3f - %7.3f ms", m_UpdateGraph.TaskName(i).c_str(), timing.StartMs, timing.EndMs);
+		}
+	}
 
-			minH = std::min(minH, noiseValue);
-			maxH = std::max(maxH, noiseValue);
+	if (ImGui::CollapsingHeader("Job System"))
+	{
+		ImGui::Text("Threads: %u", m_Jobs->ThreadCount());
+		if (ImGui::Button("Benchmark scaling (1024x1024 terrain)"))
+			RunJobScalingBenchmark();
+		for (size_t i = 0; i < m_JobScalingMs.size(); ++i)
+			ImGui::Text("%u threads: %.2f ms (%.2fx)", (UINT)i + 1, m_JobScalingMs[i], m_JobScalingMs[0] / m_JobScalingMs[i]);
+	}
 
-		}
+	ImGui::Checkbox("Wireframe", &m_WireframeMode);
+	Transform water = MakeTransform(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(m_WaterScale)), XMQuaternionIdentity(), XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(m_WaterHeight)));
+	const RenderItem* waterRitem = m_RenderItems.Get(m_WavesRitem);
+	Transform current = m_ObjectTransforms.Get(waterRitem->ObjCBIndex);
+	if (memcmp(&water, &current, sizeof(Transform)) != 0)
+		SetObjectTransform(waterRitem, water);
+	ImGui::End();
+}
+
+uint32_t Renderer::ShowProfileNode(const ProfileFrame& frame, uint32_t node)
+{
+	// Pre-order storage: the subtree of a node is the run of deeper nodes that follows it.
+	const ProfileNode& n = frame.Nodes[node];
+	uint32_t next = node + 1;
+	uint32_t end = next;
+	while (end < (uint32_t)frame.Nodes.size() && frame.Nodes[end].Thread == n.Thread && frame.Nodes[end].Depth > n.Depth)
+		end++;
+
+	ImGuiTreeNodeFlags flags = next == end ? ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen : 0;
+	bool open = ImGui::TreeNodeEx((void*)(intptr_t)node, flags, "%s  %.3f ms", n.Name, n.DurationMs());
+	if (open && next != end)
+	{
+		while (next < end)
+			next = ShowProfileNode(frame, next);
+		ImGui::TreePop();
 	}
+	return end;
+}
+
+PerlinNoiseSettings Renderer::TerrainNoiseSettings() const
+{
+	PerlinNoiseSettings settings;
+	settings.Scale = m_TerrainHeightScale;
+	settings.Octaves = m_TerrainNoiseOctaves;
+	settings.Amplitude = m_TerrainNoisePersistance;
+	settings.Persistence = m_TerrainNoisePersistance;
+	settings.Frequency = m_TerrainNoiseFrequency;
+	settings.Offset = m_TerrainNoiseValue;
+	settings.Seed = m_TerrainNoiseSeed;
+	return settings;
+}
 
-	float invRange = (maxH - minH) > 1e-6f ? 1.0f / (maxH - minH) : 1.0f;
-	
-	for (UINT j = 0; j < width * height; ++j)
+ReplayParameters Renderer::GetReplayParameters() const
+{
+	ReplayParameters p;
+	std::copy(std::begin(m_WaterHeight), std::end(m_WaterHeight), p.WaterPosition);
+	std::copy(std::begin(m_WaterScale), std::end(m_WaterScale), p.WaterScale);
+	p.WaveSpeed = m_WaterWaveSpeed;
+	p.WaveAmplitude = m_WaterWaveAmplitude;
+	p.WaveFrequency = m_WaterWaveFrequency;
+	p.TerrainWidth = m_TerrainWidth;
+	p.TerrainHeight = m_TerrainHeight;
+	p.TerrainHeightScale = m_TerrainHeightScale;
+	p.NoiseFrequency = m_TerrainNoiseFrequency;
+	p.NoiseOctaves = m_TerrainNoiseOctaves;
+	p.NoisePersistence = m_TerrainNoisePersistance;
+	p.NoiseAmplitude = m_TerrainNoiseAmplitude;
+	p.NoiseValue = m_TerrainNoiseValue;
+	p.NoiseSeed = m_TerrainNoiseSeed;
+	p.PropCountIndex = m_PropCountIndex;
+	p.Wireframe = m_WireframeMode;
+	p.Regenerate = m_TerrainRegenerated;
+	return p;
+}
+
+void Renderer::ApplyReplayParameters(const ReplayParameters& p)
+{
+	std::copy(std::begin(p.WaterPosition), std::end(p.WaterPosition), m_WaterHeight);
+	std::copy(std::begin(p.WaterScale), std::end(p.WaterScale), m_WaterScale);
+	m_WaterWaveSpeed = p.WaveSpeed;
+	m_WaterWaveAmplitude = p.WaveAmplitude;
+	m_WaterWaveFrequency = p.WaveFrequency;
+	m_TerrainWidth = p.TerrainWidth;
+	m_TerrainHeight = p.TerrainHeight;
+	m_TerrainHeightScale = p.TerrainHeightScale;
+	m_TerrainNoiseFrequency = p.NoiseFrequency;
+	m_TerrainNoiseOctaves = p.NoiseOctaves;
+	m_TerrainNoisePersistance = p.NoisePersistence;
+	m_TerrainNoiseAmplitude = p.NoiseAmplitude;
+	m_TerrainNoiseValue = p.NoiseValue;
+	m_TerrainNoiseSeed = p.NoiseSeed;
+	m_WireframeMode = p.Wireframe;
+
+	if (p.PropCountIndex != m_PropCountIndex && p.PropCountIndex >= 0 && p.PropCountIndex < (int)_countof(PropCountValues))
 	{
-		float normalizedHeight = (noiseValues[j] - minH) * invRange;
-		hm.data[j] = std::clamp(normalizedHeight, 0.0f, 1.0f);
+		m_PropCountIndex = p.PropCountIndex;
+		BuildPropRenderItems(PropCountValues[m_PropCountIndex]);
 	}
-	return hm;
+	if (p.Regenerate)
+		m_NeedRegen = true;
+}
+
+void Renderer::ResetSimulation()
+{
+	// Called between frames, when no update task is touching the waves.
+	m_Waves = CreateWaves(*m_Jobs);
+	m_WaveDisturbTime = 0.0f;
+	m_NeedRegen = true;
+}
+
+ReplayCommand Renderer::TakeReplayCommand()
+{
+	return std::exchange(m_ReplayCommand, ReplayCommand::None);
 }
 
 void Renderer::CreateHeightMapTexture(const HeightMap& hm)
@@ -1923,52 +2992,35 @@ void Renderer::CreateHeightMapTexture(const HeightMap& hm)
 	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
+	// Frames still in flight may sample the previous heightmap.
+	DeferRelease(m_HeightMapTex);
+
 	ThrowIfFailed(device->CreateCommittedResource(
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&texDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_COMMON,
 		nullptr,
 		IID_PPV_ARGS(&m_HeightMapTex)));
-
-	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(m_HeightMapTex.Get(), 0, 1);
-
-
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_HeightMapUpload)));
+	d3dUtil::TrackGpuMemory(m_HeightMapTex.Get(), MemoryTag::Terrain);
 
 	D3D12_SUBRESOURCE_DATA subresourceData = {};
 	subresourceData.pData = hm.data.data();
 	subresourceData.RowPitch = hm.width * sizeof(float);
 	subresourceData.SlicePitch = subresourceData.RowPitch * hm.height;
 
-	auto cmdList = m_CommandList.Get();
-
-	UpdateSubresources(cmdList, m_HeightMapTex.Get(), m_HeightMapUpload.Get(), 0, 0, 1, &subresourceData);
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_HeightMapTex.Get(),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-
+	m_Uploads->UploadTexture(m_HeightMapTex.Get(), 0, 1, &subresourceData);
 }
 
 void Renderer::RegenerateHeightMap()
 {
-	m_CpuHeightMap = GeneratePerlinHeightmap(m_TerrainWidth, m_TerrainHeight, m_TerrainHeightScale, m_TerrainNoiseOctaves, m_TerrainNoisePersistance, m_TerrainNoiseSeed);
-
-	m_HeightMapData = m_CpuHeightMap.data;
+	PROFILE_FUNCTION();
+	m_CpuHeightMap = GeneratePerlinHeightmap(m_TerrainWidth, m_TerrainHeight, TerrainNoiseSettings(), *m_Jobs);
 }
 
 void Renderer::UpdateHeightMapTexture()
 {
-	m_HeightMapTex.Reset();
-	m_HeightMapUpload.Reset();
-
 	CreateHeightMapTexture(m_CpuHeightMap);
-
 }
 
 HeightMap Renderer::GeneratePerlinHeightmap_Simple(UINT width, UINT height, float scale, int seed)
@@ -2003,9 +3055,9 @@ HeightMap Renderer::GeneratePerlinHeightmap_Simple(UINT width, UINT height, floa
 
 void Renderer::UpdateHeightMapSrv()
 {
-	// heightmap SRV is descriptor #5 in m_TexSrvHeap
-	CD3DX12_CPU_DESCRIPTOR_HANDLE h(m_TexSrvHeap->GetCPUDescriptorHandleForHeapStart());
-	h.Offset(5, m_CbvSrvUavDescriptorSize);
+	// Frames still in flight keep sampling the old descriptor, so it is only recycled once
+	// the frame being recorded has retired. No flush needed.
+	m_Bindless->Free(m_HeightMapSrv, (UINT64)m_CurrentFence + 1);
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -2015,5 +3067,6 @@ void Renderer::UpdateHeightMapSrv()
 	srvDesc.Texture2D.MipLevels = 1;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-	m_Device->CreateShaderResourceView(m_HeightMapTex.Get(), &srvDesc, h);
+	m_HeightMapSrv = m_Bindless->CreateSrv(m_HeightMapTex.Get(), &srvDesc);
+	m_DescriptorIndices.HeightMap = m_HeightMapSrv.Index;
 }
\ No newline at end of file
@@ -2,10 +2,34 @@
 #include "../Utils/d3dUtil.h"
 #include "../Utils/GeometryGenerator.h"
 #include "../Utils/Waves.h"
+#include "../Utils/JobSystem.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Metrics.h"
+#include "../Utils/HeightMapGenerator.h"
+#include "../Utils/Replay.h"
 #include "UploadBuffer.h"
 #include "FrameResource.h"
+#include "UploadService.h"
+#include "BindlessHeap.h"
+#include "FrameGraph.h"
+#include "TaskGraph.h"
+#include "FramePacer.h"
+#include "D3D12FrameGraphBackend.h"
+#include "D3D12TimestampQueries.h"
+#include "GpuPassTimer.h"
+#include "CommandListPool.h"
+#include "DrawPackets.h"
+#include "InstanceBatcher.h"
+#include "IndirectDraw.h"
+#include "D3D12PipelineCache.h"
+#include "ShaderWatcher.h"
+#include "VersionedConstants.h"
+#include "TransformStore.h"
+#include "HandleRegistry.h"
 #include "../Camera.h"
 #include "../Utils/GameTimer.h"
+#include <chrono>
+#include <future>
 
 
 
@@ -17,22 +41,45 @@ enum class RenderLayer : int
 	Count
 };
 
-struct HeightMap
+using PipelineHandle = Handle<Microsoft::WRL::ComPtr<ID3D12PipelineState>>;
+
+// Requests from the replay controls in the UI, carried out by the application between frames.
+enum class ReplayCommand
 {
-	std::vector<float> data;
-	UINT width;
-	UINT height;
+	None,
+	Record,
+	Play,
+	Stop
 };
 
 class Renderer {
 public:
 	Renderer(HWND& windowHandle, UINT width, UINT height, Camera& cam);
-	~Renderer() = default;
+	~Renderer();
 
 	bool InitializeD3D12(HWND& windowHandle);
 	bool Shutdown();
+
+	// Waits for the swap chain and the frame rate limiter; input should be sampled right after.
+	void BeginFrame();
 	void Update(GameTimer& dt, Camera& cam);
 	void Draw();
+	void SetVSync(bool enabled);
+
+	// Replay support. The parameters are the settings the UI controls; the frame seed drives
+	// the random wave disturbances; resetting restarts the wave simulation and regenerates the
+	// terrain, so a replay starts from the same state as its recording.
+	ReplayParameters GetReplayParameters() const;
+	void ApplyReplayParameters(const ReplayParameters& parameters);
+	void SetFrameSeed(uint32_t seed) { m_FrameSeed = seed; }
+	void ResetSimulation();
+	ReplayCommand TakeReplayCommand();
+	void SetReplayStatus(const std::string& status) { m_ReplayStatus = status; }
+
+	// Update and draw time of the last frame, and the most recent GPU frame time, which lags
+	// a few frames behind.
+	double LastCpuFrameMs() const { return (m_UpdateNs + m_DrawNs) / 1e6; }
+	double LastGpuFrameMs() const { return m_GpuTimer->FrameMs(); }
 
 private:
 	void CreateDebugController();
@@ -42,6 +89,8 @@ private:
 	void CheckMSAAQuality();
 	void CreateCommandObjects();
 	void CreateSwapChain(HWND& hwnd);
+	void SetFrameLatency(UINT frames);
+	void WaitForFence(UINT64 fence);
 	void CreateRtvAndDsvDescriptorHeaps();
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
@@ -60,10 +109,15 @@ private:
 	void CreateTextureSrvDescriptors();
 	void CreateOpaqueRootSignature();
 	void CreateTransparentRootSignature();
+	void CreateIndirectCommandSignature();
 
 	void BuildShadersAndInputLayout();
+	void AssignShaderBlobs();
+	void UpdateShaderHotReload();
 	
 	void BuildPSOs();
+	PipelineHandle StorePipeline(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+	ID3D12PipelineState* GetPipeline(PipelineHandle handle) const;
 
 	void BuildMaterials();
 	void BuildShapeGeometry();
@@ -75,23 +129,60 @@ private:
 	XMFLOAT3 GetHillsNormal(float x, float z);
 	void BuildRenderItems();
 	void RebuildLandRenderItem();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& riItems);
-	void DrawRenderItemsWater(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& riItems);
+	void SetSubmesh(RenderItem& ri, const std::string& submesh) const;
+	void SetPassState(ID3D12GraphicsCommandList* cmdList, ID3D12RootSignature* rootSignature, ID3D12PipelineState* pso, ID3D12Resource* materialCB);
+
+	struct PassDrawList
+	{
+		std::vector<DrawPacket> Packets;
+		std::vector<DrawPacket> Sorted;
+		std::vector<DrawCallStats> BatchStats;
+		DrawCallStats Stats;
+	};
+
+	// Indices into m_DrawPipelines, also the pipeline field of the draw sort keys.
+	enum DrawPipeline : UINT
+	{
+		DrawPipelineOpaque = 0,
+		DrawPipelineSky,
+		DrawPipelineWater,
+	};
+
+	void BuildDrawPackets(const std::vector<RenderItemHandle>& items, UINT pipeline, bool keepOrder, PassDrawList& draws);
+	void RecordDraws(PassDrawList& draws, UINT pipeline, const std::function<void(ID3D12GraphicsCommandList*)>& setup);
+	void DrawPackets(ID3D12GraphicsCommandList* cmdList, const DrawPacket* packets, size_t count, UINT boundPipeline, DrawCallStats& stats);
+
+	void BuildPropRenderItems(UINT count);
+	float SampleTerrainHeight(float x, float z) const;
+	void UpdateInstanceBuffers();
+	void DrawInstanceBatches(ID3D12GraphicsCommandList* cmdList);
 
 	void BuildFrameResources();
 	void RebuildFrameResources();
 	void UpdateObjectCBs();
+	void SetObjectTransform(const RenderItem* ri, const Transform& transform);
+	void UpdatePropWorlds();
+	void ComputeWorldMatricesParallel(const TransformStore& store, const TransformRange& range, BYTE* dst, size_t stride, bool transpose);
+	void RunTransformBenchmark(UINT count);
+	void RunJobScalingBenchmark();
 	void UpdateMaterialCBs();
 	void UpdateMainPassCB();
+	void BuildMainPassCB();
 	void UpdateWaterCB(GameTimer& dt);
 	void UpdateTerrainCB();
+	void BuildTerrainCB();
 	void UpdateWaves(GameTimer& dt);
 
 	void FlushCommandQueue();
+	void DeferRelease(Microsoft::WRL::ComPtr<ID3D12Pageable> object);
+	void ReleaseRetiredResources();
 
 	ID3D12Resource* CurrentBackBuffer() const;
 
 	void ShowImGUIEnvironmentControl();
+	static uint32_t ShowProfileNode(const ProfileFrame& frame, uint32_t node);
+	void RegisterMetrics();
+	void PublishMetrics();
 	void ShowImGUICameraControl();
 	void ShowImGUILightControl();
 	void ShowImGUITerrainControl();
@@ -104,20 +195,37 @@ private:
 	Microsoft::WRL::ComPtr<IDXGIFactory4> m_DxgiFactory;
 
 	Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+	HANDLE m_FenceEvent = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_CommandAllocator;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
 
+	std::unique_ptr<UploadService> m_Uploads;
+	UINT64 m_TextureUploadFence = 0;
+	UINT64 m_TerrainUploadFence = 0;
+
+	struct DeferredRelease
+	{
+		UINT64 Fence = 0;
+		Microsoft::WRL::ComPtr<ID3D12Pageable> Object;
+	};
+	std::vector<DeferredRelease> m_DeferredReleases;
+
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_RtvHeap;;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_DsvHeap;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_CbvHeap;
 
 	Microsoft::WRL::ComPtr<IDXGISwapChain> m_SwapChain;
 	static const int SwapChainBufferCount = 2;
+	HANDLE m_FrameLatencyWaitable = nullptr;
+	bool m_TearingSupported = false;
+	FramePacer m_Pacer{ NumFrameResources };
+	static constexpr UINT BindlessHeapCapacity = 4096;
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_SwapChainBuffer[SwapChainBufferCount];
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthStencilBuffer;
 	int m_CurrentBackBuffer = 0;
 
+	D3D12_VIEWPORT m_ScreenViewport;
 	D3D12_RECT m_ScissorRect;
 
 	Microsoft::WRL::ComPtr<ID3DBlob> m_VertexBufferCPU = nullptr;
@@ -157,11 +265,11 @@ private:
 
 
 	Microsoft::WRL::ComPtr<ID3DBlob> m_VsByteCode;
-	Microsoft::WRL::ComPtr<ID3DBlob> m_PsByteCode;
 	Microsoft::WRL::ComPtr<ID3DBlob> m_VsByteCodeWater;
-	Microsoft::WRL::ComPtr<ID3DBlob> m_PsByteCodeWater;
 	Microsoft::WRL::ComPtr<ID3DBlob> m_VsByteCodeSky;
 	Microsoft::WRL::ComPtr<ID3DBlob> m_PsByteCodeSky;
+	Microsoft::WRL::ComPtr<ID3DBlob> m_VsByteCodeInstanced;
+	Microsoft::WRL::ComPtr<ID3DBlob> m_PsByteCodeInstanced;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_InputLayoutDescs;
 
 	XMFLOAT4X4 m_World = MathHelper::Identity4x4();
@@ -170,7 +278,47 @@ private:
 
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_OpaqueRootSignature;
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_TransparentRootSignature;
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_PipelineStateObjects;
+
+	// Every pipeline the renderer draws with, by handle. Rebuilding a pipeline replaces it in
+	// its slot, so the handles below survive shader reloads.
+	HandleRegistry<Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_PipelineStates;
+	PipelineHandle m_SkyPipeline;
+	PipelineHandle m_InstancedPipeline;
+	PipelineHandle m_InstancedWireframePipeline;
+
+	// Terrain and water pixel shaders are compiled once per feature combination; the
+	// variant drawn is picked from m_ShaderFeatures every frame.
+	ShaderPermutationSet m_TerrainPermutations{ ShaderFeatureNormalMapping | ShaderFeatureRockLayer | ShaderFeatureFog | ShaderFeatureWireframeDebug };
+	ShaderPermutationSet m_WaterPermutations{ ShaderFeatureDepthAbsorption | ShaderFeatureFog };
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> m_PsByteCodeTerrain;
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> m_PsByteCodeWater;
+	std::vector<PipelineHandle> m_TerrainPipelines;
+	std::vector<PipelineHandle> m_WaterPipelines;
+	uint32_t m_ShaderFeatures = ShaderFeatureNormalMapping | ShaderFeatureRockLayer | ShaderFeatureDepthAbsorption;
+
+	// Every shader the renderer compiles, with the blobs in the same order, so a change to a
+	// source file can recompile just the requests that use it.
+	std::vector<ShaderCompileRequest> m_ShaderRequests;
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> m_ShaderBlobs;
+	size_t m_TerrainShaderFirst = 0;
+	size_t m_WaterShaderFirst = 0;
+
+	// Shader hot reload: changed files are recompiled in the background and the pipelines
+	// swapped at the start of a frame. A failed compile keeps the current pipelines.
+	struct ShaderReload
+	{
+		std::vector<uint32_t> Requests;
+		std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> Blobs;
+		std::string Changed;
+		bool Succeeded = false;
+	};
+	static constexpr std::chrono::milliseconds ShaderPollInterval{ 250 };
+	ShaderWatcher m_ShaderWatcher;
+	std::future<ShaderReload> m_ShaderReload;
+	std::chrono::steady_clock::time_point m_LastShaderPoll;
+	uint32_t m_ShaderReloadCount = 0;
+	std::string m_ShaderReloadStatus = "No changes";
+	std::string m_TraceExportStatus;
 
 	float m_Theta = 1.5f * DirectX::XM_PI;
 	float m_Phi = DirectX::XM_PIDIV4;
@@ -182,23 +330,72 @@ private:
 	int m_CurrentFrameResourceIndex = 0;
 	XMFLOAT3 m_EyePos;
 
-	std::vector<RenderItem*> m_AllRenderItems;
-
-	std::vector<RenderItem*> m_OpaqueRenderItems;
-	std::vector<RenderItem*> m_TransparentRenderItems;
-	std::vector<RenderItem*> m_SkyRenderItems;
-
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> m_Geometries;
-	std::unordered_map<std::string, std::unique_ptr<Material>> m_Materials;
+	// Render items with an object CB slot are owned by the registry; the pass lists hold handles.
+	HandleRegistry<RenderItem> m_RenderItems;
+	std::vector<RenderItemHandle> m_OpaqueRenderItems;
+	std::vector<RenderItemHandle> m_TransparentRenderItems;
+	std::vector<RenderItemHandle> m_SkyRenderItems;
+	RenderItemHandle m_LandRitem;
+
+	// Repeated props, drawn through the instance buffer rather than one object CB slot each.
+	std::vector<RenderItem> m_PropRenderItems;
+
+	// World transforms as SoA streams: render items by ObjCBIndex, streamed into the object
+	// constant buffer, and props by index, expanded into m_PropWorlds for the instancing path.
+	static constexpr uint32_t TransformChunkSize = 4096;
+	TransformStore m_ObjectTransforms{ NumFrameResources };
+	TransformStore m_PropTransforms{ 1 };
+	std::vector<XMFLOAT4X4> m_PropWorlds;
+	// Dirty ranges of each store. They are separate because the ObjectCBs and Instances tasks
+	// take them at the same time.
+	std::vector<TransformRange> m_ObjectTransformRanges;
+	std::vector<TransformRange> m_PropTransformRanges;
+	UINT m_TransformsUpdated = 0;
+	double m_TransformBenchPerItemMs = 0.0;
+	double m_TransformBenchBatchMs = 0.0;
+	double m_TransformBenchParallelMs = 0.0;
+	int m_PropCountIndex = 0;
+	InstanceBatcher m_InstanceBatcher;
+	double m_InstanceCullMs = 0.0;
+	double m_InstanceRecordMs = 0.0;
+
+	// Instance batches become compacted indirect commands, drawn by one ExecuteIndirect.
+	static constexpr UINT InstanceOffsetRootParameter = 8;
+	Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_IndirectDrawSignature;
+	std::vector<const MeshGeometry*> m_IndirectGeometrySources;
+	std::vector<IndirectGeometry> m_IndirectGeometries;
+	std::vector<IndirectDrawCandidate> m_IndirectCandidates;
+	std::vector<IndirectDrawCommand> m_IndirectCommands;
+
+	HandleRegistry<MeshGeometry> m_Geometries;
+	HandleRegistry<Material> m_Materials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> m_Textures;
 	
 	std::unique_ptr<Waves> m_Waves;
-	RenderItem* m_WavesRitem = nullptr;
+	RenderItemHandle m_WavesRitem;
 	bool m_WireframeMode = false;
 
-	PassConstants m_MainPassCB;
-	WaterConstants m_WaterConstantsCB;
-	TerrainConstants m_TerrainConstantsCB;
+	// Constant blocks are rebuilt only when their inputs change and copied only into frame
+	// resources that have not seen the current version.
+	struct PassInputs
+	{
+		XMFLOAT4X4 View;
+		XMFLOAT4X4 Proj;
+		XMFLOAT3 EyePos;
+		UINT Width;
+		UINT Height;
+	};
+	struct TerrainInputs
+	{
+		XMFLOAT2 TerrainSize;
+		float HeightScale;
+	};
+	VersionedConstants<PassConstants> m_MainPassCB{ NumFrameResources };
+	VersionedConstants<WaterConstants> m_WaterConstantsCB{ NumFrameResources };
+	VersionedConstants<TerrainConstants> m_TerrainConstantsCB{ NumFrameResources };
+	ConstantInputs<PassInputs> m_PassInputs;
+	ConstantInputs<TerrainInputs> m_TerrainInputs;
+	UINT64 m_UploadBytesPerFrame = 0;
 	INT m_TerrainWidth = 360;
 	INT m_TerrainHeight = 360;
 	float m_TerrainHeightScale = 135.0f;
@@ -226,20 +423,83 @@ private:
 
 	Camera& m_Camera;
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_SrvHeap;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_TexSrvHeap;
-	UINT m_SkyTexHeapIndex = 1;
+	std::unique_ptr<BindlessHeap> m_Bindless;
+	std::unique_ptr<D3D12PipelineCache> m_PipelineCache;
+	double m_PipelineBuildMs = 0.0;
+	FrameGraph m_FrameGraph;
+	std::unique_ptr<D3D12FrameGraphBackend> m_FrameGraphBackend;
+
+	// CPU work: the wave solver, terrain generation, transforms and draw recording.
+	static constexpr UINT MeshBuildGrainVertices = 512;
+	std::unique_ptr<JobSystem> m_Jobs;
+	std::vector<double> m_JobScalingMs;
+
+	// Draws are split across job threads in batches of at least MinDrawsPerBatch items.
+	static constexpr UINT MinDrawsPerBatch = 64;
+	static constexpr UINT MaxRecordingThreads = 8;
+	std::unique_ptr<ParallelRecorder> m_Recorder;
+
+	// The per-frame update phases, run as a task graph on m_Jobs.
+	TaskGraph m_UpdateGraph;
+	ID3D12GraphicsCommandList* m_FrameCommandList = nullptr;
+
+	std::vector<ID3D12PipelineState*> m_DrawPipelines;
+	std::vector<MeshGeometry*> m_DrawGeometries;
+	PassDrawList m_OpaqueDraws;
+	PassDrawList m_SkyDraws;
+	PassDrawList m_TransparentDraws;
+	std::vector<uint64_t> m_SortKeys;
+	std::vector<uint64_t> m_SortScratch;
+	DrawCallStats m_DrawStats;
+
+	// Every frame graph pass is timed on the GPU; results arrive one frame resource cycle late.
+	static constexpr uint32_t MaxGpuPasses = 16;
+	std::unique_ptr<D3D12TimestampQueries> m_TimestampQueries;
+	std::unique_ptr<GpuPassTimer> m_GpuTimer;
+	uint32_t m_GpuProfilerTrack = 0;
+
+	// The renderer's entries in MetricsRegistry. Times are in microseconds.
+	struct MetricIds
+	{
+		MetricId Frames;
+		MetricId CpuFrameP50;
+		MetricId CpuFrameP95;
+		MetricId CpuFrameP99;
+		MetricId PacingWait;
+		MetricId FenceWait;
+		MetricId Update;
+		MetricId Draw;
+		MetricId Present;
+		MetricId GpuFrame;
+		MetricId DrawCalls;
+		MetricId Triangles;
+		MetricId UploadBytes;
+		MetricId DescriptorsUsed;
+		MetricId DescriptorsHighWater;
+		MetricId DescriptorCapacity;
+		MetricId GpuMemoryUsage;
+		MetricId GpuMemoryBudget;
+		MetricId CpuTrackedMemory;
+		MetricId GpuTrackedMemory;
+	};
+	MetricIds m_Metrics = {};
+	static constexpr uint32_t CpuFrameWindow = 240;
+	RollingWindow<CpuFrameWindow> m_CpuFrameTimes;
+	int64_t m_PacingWaitNs = 0;
+	int64_t m_FenceWaitNs = 0;
+	int64_t m_UpdateNs = 0;
+	int64_t m_DrawNs = 0;
+	int64_t m_PresentNs = 0;
+	std::vector<MetricSample> m_MetricSamples;
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> m_Adapter;
+	DescriptorIndexConstants m_DescriptorIndices;
 
 	void LoadTextures();
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 	UINT m_CbvSrvDescriptorSize;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthSRV;
-
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_HeightMapTex = nullptr;
-	D3D12_GPU_DESCRIPTOR_HANDLE m_HeightMapSrvGpuHandle = {};
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_HeightMapUpload;
-	std::vector<float> m_HeightMapData;
+	DescriptorHandle m_HeightMapSrv;
 	float m_HeightMapWidth = 0;
 	float m_HeightMapHeight = 0;
 	float m_HeightMapScale = 0;
@@ -247,32 +507,21 @@ private:
 	int m_HeightMapOctaves = 0;
 	float m_HeightMapPersistance = 0.0f;
 	bool m_NeedRegen = false;
+	bool m_TerrainRegenerated = false;
 	HeightMap m_CpuHeightMap;
 	void RegenerateHeightMap();
 	void UpdateHeightMapTexture();
 
 	HeightMap GeneratePerlinHeightmap_Simple(UINT width, UINT height, float scale, int seed);
 
-	HeightMap GeneratePerlinHeightmap(UINT width, UINT height, float scale, int octaves, float persistence, int seed);
+	PerlinNoiseSettings TerrainNoiseSettings() const;
 
 	void CreateHeightMapTexture(const HeightMap& hm);
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_ImGuiSrvHeap;
-	D3D12_GPU_DESCRIPTOR_HANDLE imguiGpuStart;
-	D3D12_CPU_DESCRIPTOR_HANDLE	imguiCpuStart;
 	bool showImgui = true;
 
-	void CreateImGuiDescriptorHeap()
-	{
-		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
-		desc.NumDescriptors = 1;
-		desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		desc.NodeMask = 0;
-
-		ThrowIfFailed(m_Device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(m_ImGuiSrvHeap.GetAddressOf())));
-
-	}
+	uint32_t m_FrameSeed = 0;
+	float m_WaveDisturbTime = 0.0f;
+	ReplayCommand m_ReplayCommand = ReplayCommand::None;
+	std::string m_ReplayStatus;
 };
-
-
@@ -0,0 +1,262 @@
+#include "ShaderCache.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	const char* IndexFileName = "index.txt";
+	const char* IndexHeader = "ShaderCacheIndex 1";
+
+	bool ReadFile(const std::filesystem::path& path, std::string& out)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		if (!fin)
+			return false;
+
+		std::ostringstream contents;
+		contents << fin.rdbuf();
+		out = contents.str();
+		return true;
+	}
+
+	// Parses one whole space-separated field of a line, in the given base.
+	bool ParseField(const char*& cursor, const char* end, int base, uint64_t& out)
+	{
+		const char* fieldEnd = std::find(cursor, end, ' ');
+		auto [parsed, error] = std::from_chars(cursor, fieldEnd, out, base);
+		if (error != std::errc() || parsed != fieldEnd || parsed == cursor)
+			return false;
+
+		cursor = fieldEnd == end ? end : fieldEnd + 1;
+		return true;
+	}
+
+	// "<key> <size> <checksum>", key and checksum in hex.
+	bool ParseIndexLine(const std::string& line, uint64_t& key, uint64_t& size, uint64_t& checksum)
+	{
+		const char* cursor = line.data();
+		const char* end = line.data() + line.size();
+		return ParseField(cursor, end, 16, key)
+			&& ParseField(cursor, end, 10, size)
+			&& ParseField(cursor, end, 16, checksum)
+			&& cursor == end;
+	}
+
+	bool HashSourceRecursive(const std::filesystem::path& path, CacheHasher& hasher, std::unordered_set<std::string>& visited)
+	{
+		std::filesystem::path normalized = path.lexically_normal();
+		if (!visited.insert(normalized.generic_string()).second)
+			return true;
+
+		std::string source;
+		if (!ReadFile(normalized, source))
+			return false;
+
+		hasher.Add(normalized.filename().generic_string());
+		hasher.AddValue((uint64_t)source.size());
+		hasher.Add(source);
+
+		for (const std::string& include : ParseShaderIncludes(source))
+		{
+			if (!HashSourceRecursive(normalized.parent_path() / include, hasher, visited))
+				return false;
+		}
+
+		return true;
+	}
+}
+
+std::vector<std::string> ParseShaderIncludes(const std::string& source)
+{
+	std::vector<std::string> includes;
+
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		size_t hash = line.find_first_not_of(" \t");
+		if (hash == std::string::npos || line.compare(hash, 8, "#include") != 0)
+			continue;
+
+		size_t open = line.find('"', hash + 8);
+		size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+		if (close == std::string::npos)
+			continue;
+
+		includes.push_back(line.substr(open + 1, close - open - 1));
+	}
+
+	return includes;
+}
+
+void CacheHasher::Add(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		m_Hash ^= bytes[i];
+		m_Hash *= 1099511628211ull;
+	}
+}
+
+void CacheHasher::Add(const std::string& text)
+{
+	// Length first, so consecutive strings cannot run into each other.
+	AddValue((uint64_t)text.size());
+	Add(text.data(), text.size());
+}
+
+std::string CacheKeyToString(uint64_t key)
+{
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)key);
+	return text;
+}
+
+bool HashShaderSource(const std::filesystem::path& path, CacheHasher& hasher)
+{
+	std::unordered_set<std::string> visited;
+	return HashSourceRecursive(path, hasher, visited);
+}
+
+uint64_t MakeShaderCacheKey(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& defines,
+	const std::string& entryPoint, const std::string& target, uint32_t compileFlags)
+{
+	CacheHasher hasher;
+	HashShaderSource(path, hasher);
+
+	hasher.AddValue((uint64_t)defines.size());
+	for (const auto& define : defines)
+	{
+		hasher.Add(define.first);
+		hasher.Add(define.second);
+	}
+
+	hasher.Add(entryPoint);
+	hasher.Add(target);
+	hasher.AddValue(compileFlags);
+	return hasher.Value();
+}
+
+ShaderCacheIndex::ShaderCacheIndex(std::filesystem::path directory)
+	: m_Directory(std::move(directory))
+{
+	std::error_code ec;
+	std::filesystem::create_directories(m_Directory, ec);
+	ReadIndex();
+}
+
+std::filesystem::path ShaderCacheIndex::BlobPath(uint64_t key) const
+{
+	return m_Directory / (CacheKeyToString(key) + ".bin");
+}
+
+void ShaderCacheIndex::ReadIndex()
+{
+	std::ifstream fin(m_Directory / IndexFileName);
+	if (!fin)
+		return;
+
+	std::string header;
+	if (!std::getline(fin, header) || header != IndexHeader)
+	{
+		// Unknown format: start empty and rewrite the index on Save().
+		m_Dirty = true;
+		return;
+	}
+
+	// A line that does not parse is dropped, so its shader is compiled again and the index
+	// rewritten without it.
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		uint64_t key;
+		Entry entry;
+		if (ParseIndexLine(line, key, entry.Size, entry.Checksum))
+			m_Entries[key] = entry;
+		else if (!line.empty())
+			m_Dirty = true;
+	}
+}
+
+bool ShaderCacheIndex::Load(uint64_t key, std::vector<uint8_t>& out)
+{
+	auto it = m_Entries.find(key);
+	if (it == m_Entries.end())
+	{
+		m_Misses++;
+		return false;
+	}
+
+	std::string blob;
+	bool valid = ReadFile(BlobPath(key), blob) && blob.size() == it->second.Size;
+	if (valid)
+	{
+		CacheHasher checksum;
+		checksum.Add(blob.data(), blob.size());
+		valid = checksum.Value() == it->second.Checksum;
+	}
+
+	if (!valid)
+	{
+		m_Entries.erase(it);
+		m_Dirty = true;
+		m_Rejected++;
+		m_Misses++;
+		return false;
+	}
+
+	out.assign(blob.begin(), blob.end());
+	m_Used.insert(key);
+	m_Hits++;
+	return true;
+}
+
+void ShaderCacheIndex::Store(uint64_t key, const void* data, size_t size)
+{
+	std::ofstream fout(BlobPath(key), std::ios::binary | std::ios::trunc);
+	fout.write(static_cast<const char*>(data), size);
+	if (!fout)
+		return;
+
+	Entry entry;
+	entry.Size = size;
+	CacheHasher checksum;
+	checksum.Add(data, size);
+	entry.Checksum = checksum.Value();
+
+	m_Entries[key] = entry;
+	m_Used.insert(key);
+	m_Dirty = true;
+}
+
+void ShaderCacheIndex::Save()
+{
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		if (m_Used.count(it->first) == 0)
+		{
+			std::error_code ec;
+			std::filesystem::remove(BlobPath(it->first), ec);
+			it = m_Entries.erase(it);
+			m_Dirty = true;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (!m_Dirty)
+		return;
+
+	std::ofstream fout(m_Directory / IndexFileName, std::ios::trunc);
+	fout << IndexHeader << "\n";
+	for (const auto& [key, entry] : m_Entries)
+		fout << CacheKeyToString(key) << " " << entry.Size << " " << CacheKeyToString(entry.Checksum) << "\n";
+
+	m_Dirty = false;
+}
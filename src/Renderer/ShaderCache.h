@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// 64-bit FNV-1a, fed incrementally. Stable across platforms and runs, so it can name files.
+class CacheHasher
+{
+public:
+	void Add(const void* data, size_t size);
+	void Add(const std::string& text);
+	template<typename T> void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+	uint64_t Value() const { return m_Hash; }
+
+private:
+	uint64_t m_Hash = 14695981039346656037ull;
+};
+
+std::string CacheKeyToString(uint64_t key);
+
+// Paths named by the #include "..." lines of a shader source, in order, as written.
+std::vector<std::string> ParseShaderIncludes(const std::string& source);
+
+// Hashes a shader file together with everything it pulls in through #include "...",
+// resolved relative to the including file, each file once. Returns false if a file is
+// missing, in which case the compiler will report the real error.
+bool HashShaderSource(const std::filesystem::path& path, CacheHasher& hasher);
+
+// Key of one compiled shader: its sources, defines, entry point, target and compile flags.
+uint64_t MakeShaderCacheKey(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& defines,
+	const std::string& entryPoint, const std::string& target, uint32_t compileFlags);
+
+// Content-addressed store of binary blobs in one directory, with a text index recording
+// each blob's size and checksum. A blob that fails validation on load is dropped and
+// reported as a miss. Because keys cover all inputs, a changed input simply misses; entries
+// not used during a run are pruned by Save().
+class ShaderCacheIndex
+{
+public:
+	explicit ShaderCacheIndex(std::filesystem::path directory);
+
+	bool Load(uint64_t key, std::vector<uint8_t>& out);
+	void Store(uint64_t key, const void* data, size_t size);
+
+	// Writes the index and deletes blobs of entries that were not used since construction.
+	void Save();
+
+	const std::filesystem::path& Directory() const { return m_Directory; }
+
+	uint32_t Hits() const { return m_Hits; }
+	uint32_t Misses() const { return m_Misses; }
+	uint32_t Rejected() const { return m_Rejected; }
+
+private:
+	struct Entry
+	{
+		uint64_t Size = 0;
+		uint64_t Checksum = 0;
+	};
+
+	std::filesystem::path BlobPath(uint64_t key) const;
+	void ReadIndex();
+
+	std::filesystem::path m_Directory;
+	std::unordered_map<uint64_t, Entry> m_Entries;
+	std::unordered_set<uint64_t> m_Used;
+	bool m_Dirty = false;
+
+	uint32_t m_Hits = 0;
+	uint32_t m_Misses = 0;
+	uint32_t m_Rejected = 0;
+};
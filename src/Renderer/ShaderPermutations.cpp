@@ -0,0 +1,93 @@
+#include "ShaderPermutations.h"
+
+namespace
+{
+	struct FeatureInfo
+	{
+		ShaderFeature Feature;
+		const char* Define;
+		const char* Name;
+	};
+
+	const FeatureInfo Features[ShaderFeatureCount] =
+	{
+		{ ShaderFeatureNormalMapping, "NORMAL_MAPPING", "Normal mapping" },
+		{ ShaderFeatureRockLayer, "ROCK_LAYER", "Rock layer" },
+		{ ShaderFeatureFog, "FOG", "Fog" },
+		{ ShaderFeatureDepthAbsorption, "DEPTH_ABSORPTION", "Depth absorption" },
+		{ ShaderFeatureWireframeDebug, "WIREFRAME_DEBUG", "Wireframe debug" },
+	};
+
+	const FeatureInfo* FindFeature(ShaderFeature feature)
+	{
+		for (const FeatureInfo& info : Features)
+		{
+			if (info.Feature == feature)
+				return &info;
+		}
+		return nullptr;
+	}
+}
+
+const char* ShaderFeatureDefine(ShaderFeature feature)
+{
+	const FeatureInfo* info = FindFeature(feature);
+	return info ? info->Define : "";
+}
+
+const char* ShaderFeatureName(ShaderFeature feature)
+{
+	const FeatureInfo* info = FindFeature(feature);
+	return info ? info->Name : "";
+}
+
+ShaderPermutationSet::ShaderPermutationSet(uint32_t supportedFeatures)
+	: m_Supported(supportedFeatures)
+{
+	for (uint32_t bits = supportedFeatures; bits != 0; bits &= bits - 1)
+		m_SupportedCount++;
+}
+
+uint32_t ShaderPermutationSet::VariantIndex(uint32_t features) const
+{
+	// Packs the supported feature bits next to each other, lowest first.
+	uint32_t index = 0;
+	uint32_t slot = 0;
+	for (uint32_t bit = 1; bit != 0 && bit <= m_Supported; bit <<= 1)
+	{
+		if (m_Supported & bit)
+		{
+			if (features & bit)
+				index |= 1u << slot;
+			slot++;
+		}
+	}
+	return index;
+}
+
+uint32_t ShaderPermutationSet::VariantFeatures(uint32_t index) const
+{
+	uint32_t features = 0;
+	uint32_t slot = 0;
+	for (uint32_t bit = 1; bit != 0 && bit <= m_Supported; bit <<= 1)
+	{
+		if (m_Supported & bit)
+		{
+			if (index & (1u << slot))
+				features |= bit;
+			slot++;
+		}
+	}
+	return features;
+}
+
+ShaderDefines ShaderPermutationSet::Defines(uint32_t features) const
+{
+	ShaderDefines defines;
+	for (const FeatureInfo& info : Features)
+	{
+		if (m_Supported & info.Feature)
+			defines.emplace_back(info.Define, (features & info.Feature) ? "1" : "0");
+	}
+	return defines;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Optional shader features, compiled in or out through a define of the same meaning. A
+// variant is identified by the bitmask of the features it has.
+enum ShaderFeature : uint32_t
+{
+	ShaderFeatureNormalMapping = 1u << 0,
+	ShaderFeatureRockLayer = 1u << 1,
+	ShaderFeatureFog = 1u << 2,
+	ShaderFeatureDepthAbsorption = 1u << 3,
+	ShaderFeatureWireframeDebug = 1u << 4,
+};
+
+constexpr uint32_t ShaderFeatureCount = 5;
+
+// Define set to 0 or 1 in every variant of a shader that supports the feature.
+const char* ShaderFeatureDefine(ShaderFeature feature);
+const char* ShaderFeatureName(ShaderFeature feature);
+
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// The variants of one shader: every combination of the features it supports.
+class ShaderPermutationSet
+{
+public:
+	explicit ShaderPermutationSet(uint32_t supportedFeatures);
+
+	uint32_t SupportedFeatures() const { return m_Supported; }
+	uint32_t VariantCount() const { return 1u << m_SupportedCount; }
+
+	// Dense index of a variant, in [0, VariantCount()). Features the shader does not support
+	// are ignored, so callers can pass the full set of enabled features.
+	uint32_t VariantIndex(uint32_t features) const;
+
+	// Feature mask of the variant at index; the inverse of VariantIndex.
+	uint32_t VariantFeatures(uint32_t index) const;
+
+	ShaderDefines Defines(uint32_t features) const;
+
+private:
+	uint32_t m_Supported = 0;
+	uint32_t m_SupportedCount = 0;
+};
@@ -0,0 +1,89 @@
+#include "ShaderWatcher.h"
+#include "ShaderCache.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+namespace
+{
+	std::filesystem::file_time_type WriteTime(const std::filesystem::path& path)
+	{
+		// A missing file reads as the oldest time, so it shows up as changed once it is back.
+		std::error_code ec;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+		return ec ? std::filesystem::file_time_type::min() : time;
+	}
+
+	void CollectDependencies(const std::filesystem::path& path, std::unordered_set<std::string>& visited,
+		std::vector<std::filesystem::path>& files)
+	{
+		std::filesystem::path normalized = path.lexically_normal();
+		if (!visited.insert(normalized.generic_string()).second)
+			return;
+
+		files.push_back(normalized);
+
+		std::ifstream fin(normalized, std::ios::binary);
+		if (!fin)
+			return;
+
+		std::ostringstream contents;
+		contents << fin.rdbuf();
+		for (const std::string& include : ParseShaderIncludes(contents.str()))
+			CollectDependencies(normalized.parent_path() / include, visited, files);
+	}
+}
+
+std::vector<ShaderWatcher::FileTime> ShaderWatcher::ReadDependencies(const std::filesystem::path& shader)
+{
+	std::unordered_set<std::string> visited;
+	std::vector<std::filesystem::path> files;
+	CollectDependencies(shader, visited, files);
+
+	std::vector<FileTime> times;
+	for (const std::filesystem::path& file : files)
+		times.emplace_back(file, WriteTime(file));
+	return times;
+}
+
+void ShaderWatcher::Watch(const std::filesystem::path& shader)
+{
+	for (const WatchedShader& watched : m_Shaders)
+	{
+		if (watched.Path == shader)
+			return;
+	}
+
+	m_Shaders.push_back({ shader, ReadDependencies(shader) });
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::Poll()
+{
+	std::vector<std::filesystem::path> changed;
+
+	for (WatchedShader& watched : m_Shaders)
+	{
+		bool modified = std::any_of(watched.Files.begin(), watched.Files.end(),
+			[](const FileTime& file) { return WriteTime(file.first) != file.second; });
+
+		if (modified)
+		{
+			watched.Files = ReadDependencies(watched.Path);
+			changed.push_back(watched.Path);
+		}
+	}
+
+	return changed;
+}
+
+size_t ShaderWatcher::WatchedFileCount() const
+{
+	std::unordered_set<std::string> files;
+	for (const WatchedShader& watched : m_Shaders)
+	{
+		for (const FileTime& file : watched.Files)
+			files.insert(file.first.generic_string());
+	}
+	return files.size();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+// Watches shader files for changes by polling their write times. Each watched shader is
+// tracked together with everything it pulls in through #include "...", so editing a shared
+// include reports every shader that uses it.
+class ShaderWatcher
+{
+public:
+	void Watch(const std::filesystem::path& shader);
+
+	// Returns the watched shaders whose file or any include changed since the previous call,
+	// each once. The include lists of those shaders are read again, so includes added or
+	// removed by the edit are picked up.
+	std::vector<std::filesystem::path> Poll();
+
+	size_t WatchedFileCount() const;
+
+private:
+	using FileTime = std::pair<std::filesystem::path, std::filesystem::file_time_type>;
+
+	struct WatchedShader
+	{
+		std::filesystem::path Path;
+		std::vector<FileTime> Files;
+	};
+
+	static std::vector<FileTime> ReadDependencies(const std::filesystem::path& shader);
+
+	std::vector<WatchedShader> m_Shaders;
+};
@@ -0,0 +1,181 @@
+#include "TaskGraph.h"
+#include "../Utils/JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+	void AddUnique(std::vector<uint32_t>& list, uint32_t value)
+	{
+		if (std::find(list.begin(), list.end(), value) == list.end())
+			list.push_back(value);
+	}
+}
+
+TaskGraph::TaskBuilder& TaskGraph::TaskBuilder::Read(TaskDataId data)
+{
+	m_Graph.m_Tasks[m_Task].Accesses.push_back({ data, false });
+	return *this;
+}
+
+TaskGraph::TaskBuilder& TaskGraph::TaskBuilder::Write(TaskDataId data)
+{
+	m_Graph.m_Tasks[m_Task].Accesses.push_back({ data, true });
+	return *this;
+}
+
+void TaskGraph::Reset()
+{
+	m_Tasks.clear();
+	m_Data.clear();
+}
+
+TaskDataId TaskGraph::DeclareData(const char* name)
+{
+	m_Data.push_back(name);
+	return (TaskDataId)m_Data.size() - 1;
+}
+
+TaskGraph::TaskBuilder TaskGraph::AddTask(const char* name, TaskFn execute)
+{
+	Task task;
+	task.Name = name;
+	task.Execute = std::move(execute);
+	m_Tasks.push_back(std::move(task));
+	return TaskBuilder(*this, (uint32_t)m_Tasks.size() - 1);
+}
+
+void TaskGraph::BuildDependencies()
+{
+	std::vector<int> lastWriter(m_Data.size(), -1);
+	std::vector<std::vector<uint32_t>> readersSinceWrite(m_Data.size());
+
+	for (uint32_t i = 0; i < (uint32_t)m_Tasks.size(); i++)
+	{
+		Task& task = m_Tasks[i];
+		task.Dependencies.clear();
+		task.Successors.clear();
+		task.Timing = {};
+
+		for (const Access& a : task.Accesses)
+		{
+			int writer = lastWriter[a.Data];
+			if (writer >= 0 && writer != (int)i)
+				AddUnique(task.Dependencies, (uint32_t)writer);
+
+			if (a.Write)
+			{
+				for (uint32_t reader : readersSinceWrite[a.Data])
+				{
+					if (reader != i)
+						AddUnique(task.Dependencies, reader);
+				}
+			}
+		}
+
+		for (const Access& a : task.Accesses)
+		{
+			if (a.Write)
+			{
+				lastWriter[a.Data] = (int)i;
+				readersSinceWrite[a.Data].clear();
+			}
+			else
+			{
+				readersSinceWrite[a.Data].push_back(i);
+			}
+		}
+
+		for (uint32_t dependency : task.Dependencies)
+			m_Tasks[dependency].Successors.push_back(i);
+	}
+}
+
+void TaskGraph::Execute(JobSystem& jobs)
+{
+	BuildDependencies();
+
+	if (m_RemainingCapacity < m_Tasks.size())
+	{
+		m_RemainingCapacity = m_Tasks.size();
+		m_Remaining = std::make_unique<std::atomic<uint32_t>[]>(m_RemainingCapacity);
+	}
+	for (size_t i = 0; i < m_Tasks.size(); i++)
+		m_Remaining[i].store((uint32_t)m_Tasks[i].Dependencies.size(), std::memory_order_relaxed);
+
+	JobCounter counter;
+	m_Jobs = &jobs;
+	m_Counter = &counter;
+	m_Start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i < (uint32_t)m_Tasks.size(); i++)
+	{
+		if (m_Tasks[i].Dependencies.empty())
+			StartTask(i);
+	}
+
+	jobs.Wait(counter);
+	m_Jobs = nullptr;
+	m_Counter = nullptr;
+
+	m_WallMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count();
+	FindCriticalPath();
+}
+
+void TaskGraph::StartTask(uint32_t task)
+{
+	m_Jobs->Run(*m_Counter, [this, task]()
+		{
+			Task& t = m_Tasks[task];
+			t.Timing.StartMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count();
+			t.Execute();
+			t.Timing.EndMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count();
+
+			// The last dependency to finish starts the task, as a child of this one.
+			for (uint32_t next : t.Successors)
+			{
+				if (m_Remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+					StartTask(next);
+			}
+		});
+}
+
+void TaskGraph::FindCriticalPath()
+{
+	// Dependencies always point to earlier tasks, so declaration order is a topological order.
+	std::vector<double> finish(m_Tasks.size(), 0.0);
+	std::vector<int> previous(m_Tasks.size(), -1);
+	int last = -1;
+
+	for (uint32_t i = 0; i < (uint32_t)m_Tasks.size(); i++)
+	{
+		const Task& task = m_Tasks[i];
+		double start = 0.0;
+		for (uint32_t dependency : task.Dependencies)
+		{
+			if (finish[dependency] > start)
+			{
+				start = finish[dependency];
+				previous[i] = (int)dependency;
+			}
+		}
+
+		finish[i] = start + (task.Timing.EndMs - task.Timing.StartMs);
+		if (last < 0 || finish[i] > finish[last])
+			last = (int)i;
+	}
+
+	m_CriticalPath.clear();
+	for (int task = last; task >= 0; task = previous[task])
+		m_CriticalPath.push_back((uint32_t)task);
+	std::reverse(m_CriticalPath.begin(), m_CriticalPath.end());
+
+	m_CriticalPathMs = last >= 0 ? finish[last] : 0.0;
+}
+
+double TaskGraph::TotalTaskMs() const
+{
+	double total = 0.0;
+	for (const Task& task : m_Tasks)
+		total += task.Timing.EndMs - task.Timing.StartMs;
+	return total;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JobSystem;
+class JobCounter;
+
+using TaskDataId = uint32_t;
+
+// Per-frame graph of CPU tasks. Tasks declare the data they read and write, with the same
+// versioning rules as FrameGraph passes: a read waits for the latest earlier write, and a write
+// waits for the previous write and every read since. Execute() starts each task on the job
+// system as soon as the tasks it depends on have finished, and times every task so the
+// critical path through the frame can be inspected.
+class TaskGraph
+{
+public:
+	using TaskFn = std::function<void()>;
+
+	class TaskBuilder
+	{
+	public:
+		TaskBuilder& Read(TaskDataId data);
+		TaskBuilder& Write(TaskDataId data);
+
+	private:
+		friend class TaskGraph;
+		TaskBuilder(TaskGraph& graph, uint32_t task) : m_Graph(graph), m_Task(task) {}
+
+		TaskGraph& m_Graph;
+		uint32_t m_Task;
+	};
+
+	// Milliseconds since the start of the last Execute().
+	struct TaskTiming
+	{
+		double StartMs = 0.0;
+		double EndMs = 0.0;
+	};
+
+	// Removes every task and data declaration. Only the outer arrays keep their capacity; task
+	// names, callbacks and dependency lists are allocated anew as the graph is rebuilt.
+	void Reset();
+
+	TaskDataId DeclareData(const char* name);
+
+	// Tasks with no dependency between them start in declaration order, so long tasks should
+	// be declared first.
+	TaskBuilder AddTask(const char* name, TaskFn execute);
+
+	// Returns once every task has run. An exception thrown by a task is rethrown here, and the
+	// tasks that depend on it are skipped.
+	void Execute(JobSystem& jobs);
+
+	// Results of the last Execute().
+	uint32_t TaskCount() const { return (uint32_t)m_Tasks.size(); }
+	const std::string& TaskName(uint32_t task) const { return m_Tasks[task].Name; }
+	const std::vector<uint32_t>& TaskDependencies(uint32_t task) const { return m_Tasks[task].Dependencies; }
+	const TaskTiming& Timing(uint32_t task) const { return m_Tasks[task].Timing; }
+	double WallMs() const { return m_WallMs; }
+	double TotalTaskMs() const;
+
+	// The chain of dependent tasks with the largest summed duration, first task first. The
+	// frame cannot finish faster than this however many threads run it.
+	const std::vector<uint32_t>& CriticalPath() const { return m_CriticalPath; }
+	double CriticalPathMs() const { return m_CriticalPathMs; }
+
+private:
+	struct Access
+	{
+		TaskDataId Data = 0;
+		bool Write = false;
+	};
+
+	struct Task
+	{
+		std::string Name;
+		TaskFn Execute;
+		std::vector<Access> Accesses;
+		std::vector<uint32_t> Dependencies;
+		std::vector<uint32_t> Successors;
+		TaskTiming Timing;
+	};
+
+	void BuildDependencies();
+	void StartTask(uint32_t task);
+	void FindCriticalPath();
+
+	std::vector<Task> m_Tasks;
+	std::vector<std::string> m_Data;
+
+	// Only valid while Execute() is running.
+	JobSystem* m_Jobs = nullptr;
+	JobCounter* m_Counter = nullptr;
+	std::unique_ptr<std::atomic<uint32_t>[]> m_Remaining;
+	size_t m_RemainingCapacity = 0;
+	std::chrono::high_resolution_clock::time_point m_Start;
+
+	double m_WallMs = 0.0;
+	std::vector<uint32_t> m_CriticalPath;
+	double m_CriticalPathMs = 0.0;
+};
@@ -0,0 +1,198 @@
+#include "TransformStore.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_STORE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+TransformStore::TransformStore(uint32_t frameCount)
+	: m_FrameCount(frameCount)
+{
+}
+
+uint32_t TransformStore::Add(const Transform& transform)
+{
+	uint32_t slot = Size();
+	m_PositionX.push_back(0.0f);
+	m_PositionY.push_back(0.0f);
+	m_PositionZ.push_back(0.0f);
+	m_RotationX.push_back(0.0f);
+	m_RotationY.push_back(0.0f);
+	m_RotationZ.push_back(0.0f);
+	m_RotationW.push_back(1.0f);
+	m_ScaleX.push_back(1.0f);
+	m_ScaleY.push_back(1.0f);
+	m_ScaleZ.push_back(1.0f);
+	m_FramesDirty.push_back(0);
+
+	Set(slot, transform);
+	return slot;
+}
+
+void TransformStore::Set(uint32_t slot, const Transform& transform)
+{
+	m_PositionX[slot] = transform.Position[0];
+	m_PositionY[slot] = transform.Position[1];
+	m_PositionZ[slot] = transform.Position[2];
+	m_RotationX[slot] = transform.Rotation[0];
+	m_RotationY[slot] = transform.Rotation[1];
+	m_RotationZ[slot] = transform.Rotation[2];
+	m_RotationW[slot] = transform.Rotation[3];
+	m_ScaleX[slot] = transform.Scale[0];
+	m_ScaleY[slot] = transform.Scale[1];
+	m_ScaleZ[slot] = transform.Scale[2];
+
+	if (m_FramesDirty[slot] == 0)
+		m_DirtyCount++;
+	m_FramesDirty[slot] = (uint8_t)m_FrameCount;
+}
+
+Transform TransformStore::Get(uint32_t slot) const
+{
+	Transform transform;
+	transform.Position[0] = m_PositionX[slot];
+	transform.Position[1] = m_PositionY[slot];
+	transform.Position[2] = m_PositionZ[slot];
+	transform.Rotation[0] = m_RotationX[slot];
+	transform.Rotation[1] = m_RotationY[slot];
+	transform.Rotation[2] = m_RotationZ[slot];
+	transform.Rotation[3] = m_RotationW[slot];
+	transform.Scale[0] = m_ScaleX[slot];
+	transform.Scale[1] = m_ScaleY[slot];
+	transform.Scale[2] = m_ScaleZ[slot];
+	return transform;
+}
+
+void TransformStore::Clear()
+{
+	for (std::vector<float>* stream : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+		stream->clear();
+	m_FramesDirty.clear();
+	m_DirtyCount = 0;
+}
+
+void TransformStore::TakeDirtyRanges(std::vector<TransformRange>& ranges)
+{
+	if (m_DirtyCount == 0)
+		return;
+
+	uint32_t size = Size();
+	for (uint32_t slot = 0; slot < size; )
+	{
+		if (m_FramesDirty[slot] == 0)
+		{
+			slot++;
+			continue;
+		}
+
+		TransformRange range;
+		range.First = slot;
+		for (; slot < size && m_FramesDirty[slot] != 0; slot++)
+		{
+			if (--m_FramesDirty[slot] == 0)
+				m_DirtyCount--;
+		}
+		range.Count = slot - range.First;
+		ranges.push_back(range);
+	}
+}
+
+namespace
+{
+	// Element (row, column) of the output matrix, given the row-major world matrix w.
+	template<typename T>
+	const T& OutputElement(const T (&w)[4][4], int row, int column, bool transpose)
+	{
+		return transpose ? w[column][row] : w[row][column];
+	}
+
+	void ComputeOne(const float* px, const float* py, const float* pz, const float* qx, const float* qy, const float* qz, const float* qw,
+		const float* sx, const float* sy, const float* sz, uint32_t i, float* out, bool transpose)
+	{
+		float xx = qx[i] * qx[i], yy = qy[i] * qy[i], zz = qz[i] * qz[i];
+		float xy = qx[i] * qy[i], xz = qx[i] * qz[i], yz = qy[i] * qz[i];
+		float xw = qx[i] * qw[i], yw = qy[i] * qw[i], zw = qz[i] * qw[i];
+
+		const float w[4][4] =
+		{
+			{ sx[i] * (1.0f - 2.0f * (yy + zz)), sx[i] * 2.0f * (xy + zw), sx[i] * 2.0f * (xz - yw), 0.0f },
+			{ sy[i] * 2.0f * (xy - zw), sy[i] * (1.0f - 2.0f * (xx + zz)), sy[i] * 2.0f * (yz + xw), 0.0f },
+			{ sz[i] * 2.0f * (xz + yw), sz[i] * 2.0f * (yz - xw), sz[i] * (1.0f - 2.0f * (xx + yy)), 0.0f },
+			{ px[i], py[i], pz[i], 1.0f },
+		};
+
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+				out[row * 4 + column] = OutputElement(w, row, column, transpose);
+		}
+	}
+}
+
+void ComputeWorldMatrices(const TransformStore& store, uint32_t first, uint32_t count, void* dst, size_t stride, bool transpose)
+{
+	const float* px = store.m_PositionX.data();
+	const float* py = store.m_PositionY.data();
+	const float* pz = store.m_PositionZ.data();
+	const float* qx = store.m_RotationX.data();
+	const float* qy = store.m_RotationY.data();
+	const float* qz = store.m_RotationZ.data();
+	const float* qw = store.m_RotationW.data();
+	const float* sx = store.m_ScaleX.data();
+	const float* sy = store.m_ScaleY.data();
+	const float* sz = store.m_ScaleZ.data();
+
+	uint8_t* out = static_cast<uint8_t*>(dst);
+	uint32_t end = first + count;
+	uint32_t i = first;
+
+#if TRANSFORM_STORE_SSE
+	// Four objects per iteration, one per lane. The 16 elements are built as 16 registers and
+	// then transposed four at a time into per-object rows.
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(qx + i), y = _mm_loadu_ps(qy + i), z = _mm_loadu_ps(qz + i), qwv = _mm_loadu_ps(qw + i);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 xw = _mm_mul_ps(x, qwv), yw = _mm_mul_ps(y, qwv), zw = _mm_mul_ps(z, qwv);
+
+		__m128 sxv = _mm_loadu_ps(sx + i), syv = _mm_loadu_ps(sy + i), szv = _mm_loadu_ps(sz + i);
+		__m128 sx2 = _mm_mul_ps(sxv, two), sy2 = _mm_mul_ps(syv, two), sz2 = _mm_mul_ps(szv, two);
+
+		const __m128 w[4][4] =
+		{
+			{ _mm_mul_ps(sxv, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)))), _mm_mul_ps(sx2, _mm_add_ps(xy, zw)), _mm_mul_ps(sx2, _mm_sub_ps(xz, yw)), zero },
+			{ _mm_mul_ps(sy2, _mm_sub_ps(xy, zw)), _mm_mul_ps(syv, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)))), _mm_mul_ps(sy2, _mm_add_ps(yz, xw)), zero },
+			{ _mm_mul_ps(sz2, _mm_add_ps(xz, yw)), _mm_mul_ps(sz2, _mm_sub_ps(yz, xw)), _mm_mul_ps(szv, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))), zero },
+			{ _mm_loadu_ps(px + i), _mm_loadu_ps(py + i), _mm_loadu_ps(pz + i), one },
+		};
+
+		uint8_t* base = out + (size_t)(i - first) * stride;
+		for (int row = 0; row < 4; row++)
+		{
+			__m128 r0 = OutputElement(w, row, 0, transpose);
+			__m128 r1 = OutputElement(w, row, 1, transpose);
+			__m128 r2 = OutputElement(w, row, 2, transpose);
+			__m128 r3 = OutputElement(w, row, 3, transpose);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			_mm_storeu_ps(reinterpret_cast<float*>(base + 0 * stride) + row * 4, r0);
+			_mm_storeu_ps(reinterpret_cast<float*>(base + 1 * stride) + row * 4, r1);
+			_mm_storeu_ps(reinterpret_cast<float*>(base + 2 * stride) + row * 4, r2);
+			_mm_storeu_ps(reinterpret_cast<float*>(base + 3 * stride) + row * 4, r3);
+		}
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		float matrix[16];
+		ComputeOne(px, py, pz, qx, qy, qz, qw, sx, sy, sz, i, matrix, transpose);
+		memcpy(out + (size_t)(i - first) * stride, matrix, sizeof(matrix));
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Position, rotation quaternion (x, y, z, w) and scale of one object. The world matrix is
+// scale, then rotation, then translation, in the row-vector convention used by DirectXMath.
+struct Transform
+{
+	float Position[3] = { 0.0f, 0.0f, 0.0f };
+	float Rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float Scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+struct TransformRange
+{
+	uint32_t First = 0;
+	uint32_t Count = 0;
+};
+
+// Transforms kept as separate streams per component, so matrices can be built for four
+// objects at a time. Like RenderItem::NumFramesDirty, a changed slot stays dirty until each of
+// frameCount consumers has taken it.
+class TransformStore
+{
+public:
+	explicit TransformStore(uint32_t frameCount);
+
+	uint32_t Add(const Transform& transform);
+	void Set(uint32_t slot, const Transform& transform);
+	Transform Get(uint32_t slot) const;
+	void Clear();
+
+	uint32_t Size() const { return (uint32_t)m_PositionX.size(); }
+
+	// Appends the runs of dirty slots to ranges and counts them as taken once.
+	void TakeDirtyRanges(std::vector<TransformRange>& ranges);
+
+private:
+	friend void ComputeWorldMatrices(const TransformStore& store, uint32_t first, uint32_t count, void* dst, size_t stride, bool transpose);
+
+	uint32_t m_FrameCount = 1;
+	uint32_t m_DirtyCount = 0;
+	std::vector<uint8_t> m_FramesDirty;
+
+	std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+	std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+	std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+};
+
+// Writes the world matrices of slots [first, first + count) as 16 floats each, the first at
+// dst and the rest stride bytes apart. Row-major, or transposed for HLSL constant buffers.
+// Safe to call concurrently on disjoint ranges.
+void ComputeWorldMatrices(const TransformStore& store, uint32_t first, uint32_t count, void* dst, size_t stride, bool transpose);
@@ -0,0 +1,221 @@
+#include "UploadService.h"
+#include <chrono>
+
+using Microsoft::WRL::ComPtr;
+
+UploadService::UploadService(ID3D12Device* device, UINT allocatorCount)
+	: m_Device(device)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(m_Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_CopyQueue.GetAddressOf())));
+	d3dSetDebugName(m_CopyQueue.Get(), "UploadService::CopyQueue");
+
+	m_Allocators.resize(allocatorCount);
+	m_AllocatorFences.resize(allocatorCount, 0);
+	for (UINT i = 0; i < allocatorCount; ++i)
+	{
+		ThrowIfFailed(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(m_Allocators[i].GetAddressOf())));
+	}
+
+	ThrowIfFailed(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_Allocators[0].Get(), nullptr, IID_PPV_ARGS(m_CommandList.GetAddressOf())));
+	ThrowIfFailed(m_CommandList->Close());
+
+	ThrowIfFailed(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_Fence.GetAddressOf())));
+	m_FenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+}
+
+UploadService::~UploadService()
+{
+	if (m_IsOpen)
+	{
+		Submit();
+	}
+	Flush();
+
+	if (m_FenceEvent)
+	{
+		CloseHandle(m_FenceEvent);
+	}
+}
+
+void UploadService::BeginFrame()
+{
+	ReleaseCompletedStaging();
+
+	m_Stats.BytesLastFrame = m_Stats.BytesThisFrame;
+	m_Stats.CpuWaitMsLastFrame = m_Stats.CpuWaitMsThisFrame;
+	m_Stats.QueueWaitsLastFrame = m_Stats.QueueWaitsThisFrame;
+
+	m_Stats.BytesThisFrame = 0;
+	m_Stats.CpuWaitMsThisFrame = 0.0;
+	m_Stats.QueueWaitsThisFrame = 0;
+}
+
+ID3D12GraphicsCommandList* UploadService::CommandList()
+{
+	Open();
+	return m_CommandList.Get();
+}
+
+ComPtr<ID3D12Resource> UploadService::CreateDefaultBuffer(const void* initData, UINT64 byteSize, MemoryTag tag)
+{
+	Open();
+
+	ComPtr<ID3D12Resource> defaultBuffer;
+	ThrowIfFailed(m_Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+
+	ComPtr<ID3D12Resource> staging;
+	ThrowIfFailed(m_Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(staging.GetAddressOf())));
+
+	d3dUtil::TrackGpuMemory(defaultBuffer.Get(), tag);
+
+	D3D12_SUBRESOURCE_DATA subResourceData = {};
+	subResourceData.pData = initData;
+	subResourceData.RowPitch = byteSize;
+	subResourceData.SlicePitch = subResourceData.RowPitch;
+
+	// The buffer is promoted from COMMON to COPY_DEST implicitly by the copy.
+	UpdateSubresources<1>(m_CommandList.Get(), defaultBuffer.Get(), staging.Get(), 0, 0, 1, &subResourceData);
+
+	TrackStaging(std::move(staging));
+
+	return defaultBuffer;
+}
+
+void UploadService::UploadTexture(ID3D12Resource* texture, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* subresources)
+{
+	Open();
+
+	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture, firstSubresource, numSubresources);
+
+	ComPtr<ID3D12Resource> staging;
+	ThrowIfFailed(m_Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(staging.GetAddressOf())));
+
+	UpdateSubresources(m_CommandList.Get(), texture, staging.Get(), 0, firstSubresource, numSubresources, subresources);
+
+	TrackStaging(std::move(staging));
+}
+
+void UploadService::TrackStaging(ComPtr<ID3D12Resource> staging)
+{
+	if (staging == nullptr)
+		return;
+
+	const UINT64 byteSize = staging->GetDesc().Width;
+	m_Stats.BytesThisFrame += byteSize;
+	m_Stats.BytesTotal += byteSize;
+	d3dUtil::TrackGpuMemory(staging.Get(), MemoryTag::Upload);
+
+	m_OpenStaging.push_back(std::move(staging));
+}
+
+UINT64 UploadService::Submit()
+{
+	if (!m_IsOpen)
+		return m_LastSubmittedFence;
+
+	ThrowIfFailed(m_CommandList->Close());
+	ID3D12CommandList* cmdLists[] = { m_CommandList.Get() };
+	m_CopyQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+
+	++m_LastSubmittedFence;
+	ThrowIfFailed(m_CopyQueue->Signal(m_Fence.Get(), m_LastSubmittedFence));
+
+	m_AllocatorFences[m_CurrentAllocator] = m_LastSubmittedFence;
+	m_CurrentAllocator = (m_CurrentAllocator + 1) % (UINT)m_Allocators.size();
+	m_IsOpen = false;
+
+	for (auto& staging : m_OpenStaging)
+	{
+		m_PendingStaging.push_back({ m_LastSubmittedFence, std::move(staging) });
+	}
+	m_OpenStaging.clear();
+
+	return m_LastSubmittedFence;
+}
+
+void UploadService::WaitOnQueue(ID3D12CommandQueue* queue, UINT64 fenceValue)
+{
+	if (fenceValue == 0)
+		return;
+
+	UINT64& waited = m_QueueWaits[queue];
+	if (fenceValue <= waited)
+		return;
+
+	waited = fenceValue;
+
+	if (IsComplete(fenceValue))
+		return;
+
+	ThrowIfFailed(queue->Wait(m_Fence.Get(), fenceValue));
+	m_Stats.QueueWaitsThisFrame++;
+}
+
+bool UploadService::IsComplete(UINT64 fenceValue) const
+{
+	return m_Fence->GetCompletedValue() >= fenceValue;
+}
+
+void UploadService::Flush()
+{
+	WaitForFence(m_LastSubmittedFence);
+	ReleaseCompletedStaging();
+}
+
+void UploadService::Open()
+{
+	if (m_IsOpen)
+		return;
+
+	// The allocator we are about to reuse may still be executing on the copy queue.
+	WaitForFence(m_AllocatorFences[m_CurrentAllocator]);
+
+	auto& allocator = m_Allocators[m_CurrentAllocator];
+	ThrowIfFailed(allocator->Reset());
+	ThrowIfFailed(m_CommandList->Reset(allocator.Get(), nullptr));
+	m_IsOpen = true;
+}
+
+void UploadService::WaitForFence(UINT64 fenceValue)
+{
+	if (fenceValue == 0 || IsComplete(fenceValue))
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	ThrowIfFailed(m_Fence->SetEventOnCompletion(fenceValue, m_FenceEvent));
+	WaitForSingleObject(m_FenceEvent, INFINITE);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	m_Stats.CpuWaitMsThisFrame += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void UploadService::ReleaseCompletedStaging()
+{
+	const UINT64 completed = m_Fence->GetCompletedValue();
+
+	auto it = std::remove_if(m_PendingStaging.begin(), m_PendingStaging.end(),
+		[completed](const PendingStaging& p) { return p.Fence <= completed; });
+	m_PendingStaging.erase(it, m_PendingStaging.end());
+}
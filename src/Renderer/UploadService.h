@@ -0,0 +1,90 @@
+#pragma once
+#include "../Utils/d3dUtil.h"
+
+struct UploadStats
+{
+	UINT64 BytesThisFrame = 0;
+	UINT64 BytesLastFrame = 0;
+	UINT64 BytesTotal = 0;
+
+	// CPU time spent blocked on the copy fence before an allocator could be reused.
+	double CpuWaitMsThisFrame = 0.0;
+	double CpuWaitMsLastFrame = 0.0;
+
+	// Number of GPU-side queue waits inserted on consumer queues.
+	UINT QueueWaitsThisFrame = 0;
+	UINT QueueWaitsLastFrame = 0;
+};
+
+// Records uploads on a dedicated copy queue so that they overlap with graphics work.
+// Every Submit() returns a fence value on the copy fence; a consumer queue only has to
+// wait on it (WaitOnQueue) right before it first uses the uploaded resources.
+//
+// Resources written here are left in D3D12_RESOURCE_STATE_COMMON. Buffers and textures
+// decay to COMMON after a copy queue submission and get implicitly promoted to the read
+// state they are used in on the direct queue, so no barriers are needed on either side.
+class UploadService
+{
+public:
+	UploadService(ID3D12Device* device, UINT allocatorCount);
+	UploadService(const UploadService& rhs) = delete;
+	UploadService& operator=(const UploadService& rhs) = delete;
+	~UploadService();
+
+	// Rolls the per-frame counters over. Call once per frame.
+	void BeginFrame();
+
+	// Opens the copy command list if needed and returns it, for code that records its own copies.
+	ID3D12GraphicsCommandList* CommandList();
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(const void* initData, UINT64 byteSize, MemoryTag tag = MemoryTag::Geometry);
+	void UploadTexture(ID3D12Resource* texture, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* subresources);
+
+	// Keeps a staging resource alive until the next submission has completed on the copy queue.
+	void TrackStaging(Microsoft::WRL::ComPtr<ID3D12Resource> staging);
+
+	// Closes and executes the pending copies. Returns the copy fence value that signals their
+	// completion, or the last submitted value if nothing was recorded.
+	UINT64 Submit();
+
+	// Makes queue wait on the GPU for fenceValue. Waits already satisfied are skipped, so this
+	// is cheap to call every frame.
+	void WaitOnQueue(ID3D12CommandQueue* queue, UINT64 fenceValue);
+
+	bool IsComplete(UINT64 fenceValue) const;
+	void Flush();
+
+	ID3D12CommandQueue* Queue() const { return m_CopyQueue.Get(); }
+	const UploadStats& GetStats() const { return m_Stats; }
+
+private:
+	void Open();
+	void WaitForFence(UINT64 fenceValue);
+	void ReleaseCompletedStaging();
+
+	struct PendingStaging
+	{
+		UINT64 Fence = 0;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+	};
+
+	ID3D12Device* m_Device = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_CopyQueue;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_Allocators;
+	std::vector<UINT64> m_AllocatorFences;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_CommandList;
+	UINT m_CurrentAllocator = 0;
+	bool m_IsOpen = false;
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+	UINT64 m_LastSubmittedFence = 0;
+	HANDLE m_FenceEvent = nullptr;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_OpenStaging;
+	std::vector<PendingStaging> m_PendingStaging;
+
+	std::unordered_map<ID3D12CommandQueue*, UINT64> m_QueueWaits;
+
+	UploadStats m_Stats;
+};
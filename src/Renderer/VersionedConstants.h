@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// CPU copy of a constant block with a version that Edit() bumps, and the version each frame
+// resource last uploaded. A frame resource is stale until it has copied the current version,
+// so a block that stops changing is written once per frame resource and then not at all.
+template<typename T>
+class VersionedConstants
+{
+public:
+	explicit VersionedConstants(uint32_t frameCount)
+		: m_Uploaded(frameCount, 0)
+	{
+	}
+
+	const T& Data() const { return m_Data; }
+	T& Edit() { m_Version++; return m_Data; }
+
+	uint64_t Version() const { return m_Version; }
+	bool IsStale(uint32_t frame) const { return m_Uploaded[frame] != m_Version; }
+	void MarkUploaded(uint32_t frame) { m_Uploaded[frame] = m_Version; }
+
+private:
+	T m_Data = {};
+	// Starts ahead of every frame resource so the first frames upload the defaults.
+	uint64_t m_Version = 1;
+	std::vector<uint64_t> m_Uploaded;
+};
+
+// Copies the block into element index of buffer if the frame resource has not seen this
+// version yet. Returns whether it copied.
+template<typename Buffer, typename T>
+bool UploadIfStale(Buffer& buffer, int index, VersionedConstants<T>& constants, uint32_t frame)
+{
+	if (!constants.IsStale(frame))
+		return false;
+
+	buffer.CopyData(index, constants.Data());
+	constants.MarkUploaded(frame);
+	return true;
+}
+
+// The inputs a block was last built from. Compared bytewise, so T must not have padding.
+template<typename T>
+class ConstantInputs
+{
+public:
+	// Stores inputs and returns true if they differ from the previous call, or on the first.
+	bool Changed(const T& inputs)
+	{
+		if (m_Valid && memcmp(&m_Inputs, &inputs, sizeof(T)) == 0)
+			return false;
+
+		m_Inputs = inputs;
+		m_Valid = true;
+		return true;
+	}
+
+	void Invalidate() { m_Valid = false; }
+
+private:
+	T m_Inputs = {};
+	bool m_Valid = false;
+};
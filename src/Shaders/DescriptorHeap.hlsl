@@ -0,0 +1,27 @@
+// All SRVs live in one shader-visible heap. The root descriptor table covers the whole heap
+// once per resource type, and the root constants below carry the indices into it.
+Texture2D gTextureHeap[] : register(t0, space1);
+TextureCube gCubeHeap[] : register(t0, space2);
+
+cbuffer cbDescriptorIndices : register(b4)
+{
+    uint gGrassDiffuseIndex;
+    uint gGrassNormalIndex;
+    uint gMudDiffuseIndex;
+    uint gMudNormalIndex;
+    uint gSkyCubeIndex;
+    uint gHeightMapIndex;
+    uint gRockDiffuseIndex;
+    uint gRockNormalIndex;
+    uint gSceneDepthIndex;
+};
+
+#define gGrassDiffuseMap gTextureHeap[gGrassDiffuseIndex]
+#define gGrassNormalMap gTextureHeap[gGrassNormalIndex]
+#define gMudDiffuseMap gTextureHeap[gMudDiffuseIndex]
+#define gMudNormalMap gTextureHeap[gMudNormalIndex]
+#define gCubeMap gCubeHeap[gSkyCubeIndex]
+#define gHeightMap gTextureHeap[gHeightMapIndex]
+#define gRockDiffuseMap gTextureHeap[gRockDiffuseIndex]
+#define gRockNormalMap gTextureHeap[gRockNormalIndex]
+#define gDepth gTextureHeap[gSceneDepthIndex]
@@ -0,0 +1,25 @@
+// Per-instance data for the instanced draw path. gInstanceOffset is the first instance of the
+// current draw, since SV_InstanceID does not include StartInstanceLocation.
+struct InstanceData
+{
+    float4x4 World;
+    uint MaterialIndex;
+    uint InstPad0;
+    uint InstPad1;
+    uint InstPad2;
+};
+
+struct MaterialData
+{
+    float4 DiffuseAlbedo;
+    float3 FresnelR0;
+    float Roughness;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space3);
+StructuredBuffer<MaterialData> gMaterialData : register(t1, space3);
+
+cbuffer cbInstanceOffset : register(b5)
+{
+    uint gInstanceOffset;
+};
@@ -2,16 +2,22 @@
     #define NUM_DIR_LIGHTS 1
 #endif
 
+// Permutation features, set to 0 or 1 by the renderer.
+#ifndef NORMAL_MAPPING
+    #define NORMAL_MAPPING 1
+#endif
+#ifndef ROCK_LAYER
+    #define ROCK_LAYER 1
+#endif
+#ifndef FOG
+    #define FOG 0
+#endif
+#ifndef WIREFRAME_DEBUG
+    #define WIREFRAME_DEBUG 0
+#endif
+
 #include "LightingUtil.hlsl"
-Texture2D gGrassDiffuseMap : register(t0);
-    
-Texture2D gGrassNormalMap : register(t1);
-Texture2D gMudDiffuseMap : register(t2);
-Texture2D gMudNormalMap : register(t3);
-TextureCube gCubeMap : register(t4);
-Texture2D<float> gHeightMap : register(t5);
-Texture2D gRockDiffuseMap : register(t6);
-Texture2D gRockNormalMap : register(t7);
+#include "DescriptorHeap.hlsl"
 
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
@@ -80,22 +86,14 @@ cbuffer cbTerrain : register(b3)
 
 float4 PS(PixelIn pIn) : SV_Target
 {
+#if WIREFRAME_DEBUG
+    return float4(0.0f, 1.0f, 0.0f, 1.0f);
+#endif
+
     float height = pIn.PosW.y;
     float3 N = normalize(pIn.NormalW);
     float Ny = saturate(N.y); 
 
-    float gMudStartHeight = 37.0f;
-    float gGrassStartHeight = 49.0f;
-    float gRockStartHeight = 89.0f;
-    float gHeightBlendRange = 3.0f;
-
-    float gMaxGrassSlope = 0.75f;
-    float gMudSlopeBias = 0.2f;
-    float gMudSlopePower = 2.0f;
-
-    float gMudTiling = 2.0f;
-    float gGrassTiling = 6.0f;
-
     float wGrass = smoothstep(gGrassStartHeight - gHeightBlendRange,
                               gGrassStartHeight + gHeightBlendRange,
                               height);
@@ -104,11 +102,15 @@ float4 PS(PixelIn pIn) : SV_Target
                              gMudStartHeight + gHeightBlendRange,
                              height);
     
+#if ROCK_LAYER
     float wRock = smoothstep(gRockStartHeight - gHeightBlendRange,
                               gRockStartHeight + gHeightBlendRange,
                               height);
     
     wRock = saturate(wRock - wMud - wGrass);
+#else
+    float wRock = 0.0f;
+#endif
     
     float slopeFactor = 1.0f - Ny;
 
@@ -124,22 +126,24 @@ float4 PS(PixelIn pIn) : SV_Target
 
     float3 albedoGrass = gGrassDiffuseMap.Sample(gsamAnisotropicWrap, uvGrass).rgb * 5.5f;
     float3 albedoMud = gMudDiffuseMap.Sample(gsamAnisotropicWrap, uvMud).rgb;
+    float3 albedo = wGrass * albedoGrass + wMud * albedoMud;
+#if ROCK_LAYER
     float3 albedoRock = gRockDiffuseMap.Sample(gsamAnisotropicWrap, pIn.TexC * gRockTiling).rgb;
-    
+    albedo += wRock * albedoRock;
+#endif
+
+#if NORMAL_MAPPING
     float3 normalGrass = gGrassNormalMap.Sample(gsamAnisotropicWrap, uvGrass).xyz * 2.0f - 1.0f;
     float3 normalMud = gMudNormalMap.Sample(gsamAnisotropicWrap, uvMud).xyz * 2.0f - 1.0f;
+    float3 blendedNormal = wGrass * normalGrass + wMud * normalMud;
+#if ROCK_LAYER
     float3 normalRock = gRockNormalMap.Sample(gsamAnisotropicWrap, pIn.TexC * gRockTiling).xyz * 2.0f - 1.0f;
-
-    float3 blendedNormal =
-        wGrass * normalGrass +
-        wMud * normalMud + wRock * normalRock;
-
+    blendedNormal += wRock * normalRock;
+#endif
     blendedNormal = normalize(blendedNormal);
-
-    float3 albedo =
-        wGrass * albedoGrass +
-        wMud * albedoMud
-        + wRock * albedoRock;
+#else
+    float3 blendedNormal = N;
+#endif
 
     float3 L = normalize(-gLights[0].Direction);
     float NdotL = saturate(dot(blendedNormal, L));
@@ -151,6 +155,12 @@ float4 PS(PixelIn pIn) : SV_Target
     float3 hemiAmbient = lerp(groundCol, skyCol, t);
     float4 ambient = float4(hemiAmbient * albedo, 1.0f);
     float3 color = diffuse + ambient.xyz;
+
+#if FOG
+    float distToEye = length(gEyePosW - pIn.PosW);
+    float fogAmount = saturate((distToEye - gFogStart) / gFogRange);
+    color = lerp(color, gFogColor.rgb, fogAmount);
+#endif
     
     return float4(color, 1.0f);
 }
@@ -0,0 +1,56 @@
+#ifndef NUM_DIR_LIGHTS
+    #define NUM_DIR_LIGHTS 3
+#endif
+
+#include "LightingUtil.hlsl"
+#include "InstanceData.hlsl"
+
+cbuffer cbPass : register(b2)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+    float gNearZ;
+    float gFarZ;
+    float gTotalTime;
+    float gDeltaTime;
+    float4 gAmbientLight;
+    
+    float4 gFogColor;
+    float gFogStart;
+    float gFogRange;
+    
+    Light gLights[MaxLights];
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_POSITION;
+    float3 PosW : POSITION;
+    float3 NormalW : NORMAL;
+    nointerpolation uint MatIndex : MATINDEX;
+};
+
+float4 PS(VertexOut pin) : SV_Target
+{
+    MaterialData matData = gMaterialData[pin.MatIndex];
+
+    float3 normalW = normalize(pin.NormalW);
+    float3 toEyeW = normalize(gEyePosW - pin.PosW);
+
+    Material mat = { matData.DiffuseAlbedo, matData.FresnelR0, 1.0f - matData.Roughness };
+    float4 ambient = gAmbientLight * matData.DiffuseAlbedo;
+    float4 directLight = ComputeLighting(gLights, mat, pin.PosW, normalW, toEyeW, 1.0f);
+
+    float4 litColor = ambient + directLight;
+    litColor.a = matData.DiffuseAlbedo.a;
+
+    return litColor;
+}
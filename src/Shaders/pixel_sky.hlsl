@@ -1,9 +1,4 @@
-Texture2D gGrassDiffuseMap : register(t0);
-    
-Texture2D gGrassNormalMap : register(t1);
-Texture2D gMudDiffuseMap : register(t2);
-Texture2D gMudNormalMap : register(t3);
-TextureCube gCubeMap : register(t4);
+#include "DescriptorHeap.hlsl"
 
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
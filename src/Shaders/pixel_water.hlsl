@@ -1,6 +1,13 @@
-#include "LightingUtil.hlsl"
+// Permutation features, set to 0 or 1 by the renderer.
+#ifndef DEPTH_ABSORPTION
+    #define DEPTH_ABSORPTION 1
+#endif
+#ifndef FOG
+    #define FOG 0
+#endif
 
-Texture2D gDepth : register(t0);
+#include "LightingUtil.hlsl"
+#include "DescriptorHeap.hlsl"
 
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
@@ -77,6 +84,7 @@ float4 PS(VSOutput pin) : SV_TARGET
     float3 gDeepWaterColor = float3(0.0f, 0.05f, 0.1f);
     float gBaseAlpha = 0.5f;
     
+#if DEPTH_ABSORPTION
     float2 uv = pin.PosH.xy * gInvRenderTargetSize;
 
     float sceneDepthNonLinear = gDepth.SampleLevel(gsamPointClamp, uv, 0).r;
@@ -91,6 +99,9 @@ float4 PS(VSOutput pin) : SV_TARGET
     float absorption = saturate(thickness * gAbsorptionStrength);
 
     float3 waterColor = lerp(gShallowWaterColor, gDeepWaterColor, absorption);
+#else
+    float3 waterColor = gShallowWaterColor;
+#endif
 
     float3 N = normalize(pin.NormalW);
     float3 V = normalize(gEyePosW - pin.PosW);
@@ -101,10 +112,17 @@ float4 PS(VSOutput pin) : SV_TARGET
     
     float alpha = saturate(lerp(gBaseAlpha, 1.0f, fresnel));
 
+#if DEPTH_ABSORPTION
     if (thickness <= 0.0f)
     {
         alpha *= 0.3f;
     }
+#endif
+
+#if FOG
+    float fogAmount = saturate((length(gEyePosW - pin.PosW) - gFogStart) / gFogRange);
+    waterColor = lerp(waterColor, gFogColor.rgb, fogAmount);
+#endif
 
     return float4(waterColor, alpha);
 }
@@ -1,13 +1,6 @@
 #include "LightingUtil.hlsl"
+#include "DescriptorHeap.hlsl"
 
-Texture2D gGrassDiffuseMap : register(t0);
-    
-Texture2D gGrassNormalMap : register(t1);
-Texture2D gMudDiffuseMap : register(t2);
-Texture2D gMudNormalMap : register(t3);
-TextureCube gCubeMap : register(t4);
-    
-Texture2D<float> gHeightMap : register(t5);
 SamplerState gsamPointWrap : register(s0);
 SamplerState gsamPointClamp : register(s1);
 SamplerState gsamLinearWrap : register(s2);
@@ -105,7 +98,7 @@ VSOutput VS(VertexIn vIn)
     float v = (posW.z / gTerrainSize.y) + 0.5f;
     float2 uv = float2(u, v);
 
-    float height = gHeightMap.SampleLevel(gsamLinearClamp, uv, 0.0f);
+    float height = gHeightMap.SampleLevel(gsamLinearClamp, uv, 0.0f).r;
 
     posW.y = height * gHeightScale;
     float4x4 gWorldViewProj = mul(gWorld, gViewProj);
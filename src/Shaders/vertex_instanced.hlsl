@@ -0,0 +1,59 @@
+#include "LightingUtil.hlsl"
+#include "InstanceData.hlsl"
+
+cbuffer cbPass : register(b2)
+{
+    float4x4 gView;
+    float4x4 gInvView;
+    float4x4 gProj;
+    float4x4 gInvProj;
+    float4x4 gViewProj;
+    float4x4 gInvViewProj;
+    float3 gEyePosW;
+    float cbPerObjectPad1;
+    float2 gRenderTargetSize;
+    float2 gInvRenderTargetSize;
+    float gNearZ;
+    float gFarZ;
+    float gTotalTime;
+    float gDeltaTime;
+    float4 gAmbientLight;
+    
+    float4 gFogColor;
+    float gFogStart;
+    float gFogRange;
+    
+    Light gLights[MaxLights];
+};
+
+struct VertexIn
+{
+    float3 PosL : POSITION;
+    float3 NormalL : NORMAL;
+    float2 TexC : TEXCOORD;
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_POSITION;
+    float3 PosW : POSITION;
+    float3 NormalW : NORMAL;
+    nointerpolation uint MatIndex : MATINDEX;
+};
+
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    VertexOut vout;
+
+    InstanceData instData = gInstanceData[gInstanceOffset + instanceID];
+
+    float4 posW = mul(float4(vin.PosL, 1.0f), instData.World);
+
+    // Props are only scaled uniformly, so the world matrix transforms normals too.
+    vout.PosW = posW.xyz;
+    vout.NormalW = mul(vin.NormalL, (float3x3)instData.World);
+    vout.PosH = mul(posW, gViewProj);
+    vout.MatIndex = instData.MaterialIndex;
+
+    return vout;
+}
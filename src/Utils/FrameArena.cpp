@@ -0,0 +1,106 @@
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+
+std::atomic<uint64_t> FrameArena::s_Frame{ 0 };
+
+FrameArena& FrameArena::ForThread()
+{
+	thread_local FrameArena arena;
+	return arena;
+}
+
+void FrameArena::BeginFrame()
+{
+	s_Frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameArena::FrameArena(size_t blockSize)
+	: m_BlockSize(blockSize), m_Frame(s_Frame.load(std::memory_order_relaxed))
+{
+}
+
+FrameArena::~FrameArena()
+{
+	Trim();
+}
+
+void FrameArena::Trim()
+{
+	for (Half& half : m_Halves)
+	{
+		for (Block& block : half.Blocks)
+		{
+			MemoryTracker::Get().OnFree(MemoryTag::FrameArena, MemoryDomain::Cpu, block.Size);
+			delete[] block.Data;
+		}
+		half.Blocks.clear();
+		half.Reset();
+	}
+}
+
+void FrameArena::CatchUp()
+{
+	uint64_t frame = s_Frame.load(std::memory_order_relaxed);
+	if (frame == m_Frame)
+		return;
+
+	// The half written two frames ago becomes the active one. After a longer pause both are free.
+	if (frame - m_Frame > 1)
+		m_Halves[m_Active].Reset();
+	m_Active ^= 1;
+	m_Halves[m_Active].Reset();
+	m_Frame = frame;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	CatchUp();
+
+	Half& half = m_Halves[m_Active];
+	while (half.Current < half.Blocks.size())
+	{
+		const Block& block = half.Blocks[half.Current];
+		uintptr_t base = reinterpret_cast<uintptr_t>(block.Data);
+		uintptr_t aligned = (base + half.Offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if (aligned + size <= base + block.Size)
+		{
+			half.Offset = aligned + size - base;
+			half.Used += size;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		half.Current++;
+		half.Offset = 0;
+	}
+
+	// Only reached while the arena is still growing to what a frame needs.
+	Block block;
+	block.Size = std::max(m_BlockSize, size + alignment);
+	block.Data = new std::byte[block.Size];
+	MemoryTracker::Get().OnAllocate(MemoryTag::FrameArena, MemoryDomain::Cpu, block.Size);
+	half.Blocks.push_back(block);
+	half.Current = half.Blocks.size() - 1;
+
+	uintptr_t base = reinterpret_cast<uintptr_t>(block.Data);
+	uintptr_t aligned = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	half.Offset = aligned + size - base;
+	half.Used += size;
+	return reinterpret_cast<void*>(aligned);
+}
+
+size_t FrameArena::UsedBytes() const
+{
+	return m_Halves[m_Active].Used;
+}
+
+size_t FrameArena::ReservedBytes() const
+{
+	size_t bytes = 0;
+	for (const Half& half : m_Halves)
+	{
+		for (const Block& block : half.Blocks)
+			bytes += block.Size;
+	}
+	return bytes;
+}
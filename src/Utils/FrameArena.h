@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Bump allocator for scratch data that is dropped within the frame, e.g. vertices on their way
+// to an upload. Each thread has its own arena, so allocating takes no lock. Arenas are double
+// buffered: memory allocated in a frame stays valid until the end of the next frame, then its
+// blocks are reused. Nothing is freed individually; once the blocks have grown to a frame's
+// needs, allocating no longer touches the heap.
+class FrameArena
+{
+public:
+	static constexpr size_t DefaultBlockSize = 1024 * 1024;
+
+	// The calling thread's arena.
+	static FrameArena& ForThread();
+
+	// Advances the frame of every thread's arena. Call once per frame on the main thread; each
+	// arena catches up on its next allocation.
+	static void BeginFrame();
+
+	explicit FrameArena(size_t blockSize = DefaultBlockSize);
+	~FrameArena();
+
+	FrameArena(const FrameArena& rhs) = delete;
+	FrameArena& operator=(const FrameArena& rhs) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	// Gives every block back to the heap, e.g. after a one-off spike or before a leak check.
+	// Nothing allocated from the arena may be in use.
+	void Trim();
+
+	// Bytes handed out in the current frame, and bytes held in blocks by both halves.
+	size_t UsedBytes() const;
+	size_t ReservedBytes() const;
+
+private:
+	struct Block
+	{
+		std::byte* Data = nullptr;
+		size_t Size = 0;
+	};
+
+	// One frame's blocks; allocation bumps Offset within Blocks[Current].
+	struct Half
+	{
+		std::vector<Block> Blocks;
+		size_t Current = 0;
+		size_t Offset = 0;
+		size_t Used = 0;
+
+		void Reset() { Current = 0; Offset = 0; Used = 0; }
+	};
+
+	void CatchUp();
+
+	static std::atomic<uint64_t> s_Frame;
+
+	size_t m_BlockSize;
+	Half m_Halves[2];
+	uint32_t m_Active = 0;
+	uint64_t m_Frame = 0;
+};
+
+// Standard allocator over the calling thread's frame arena. deallocate does nothing, so
+// containers should be sized up front rather than grown.
+template<typename T>
+class FrameAllocator
+{
+public:
+	using value_type = T;
+
+	FrameAllocator() noexcept = default;
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept {}
+
+	T* allocate(size_t count)
+	{
+		if (count > SIZE_MAX / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(FrameArena::ForThread().Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t) noexcept {}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>&) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>&) const noexcept { return false; }
+};
+
+// Must not outlive the frame after the one it was filled in.
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
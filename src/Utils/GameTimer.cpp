@@ -6,7 +6,7 @@
 #include "GameTimer.h"
 
 GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
+: mSecondsPerCount(0.0), mDeltaTime(-1.0), mFixedTimeStep(0.0), mFixedTotalTime(0.0), mBaseTime(0), 
   mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
 	__int64 countsPerSec;
@@ -18,6 +18,11 @@ GameTimer::GameTimer()
 // time when the clock is stopped.
 float GameTimer::TotalTime()const
 {
+	if( mFixedTimeStep > 0.0 )
+	{
+		return (float)mFixedTotalTime;
+	}
+
 	// If we are stopped, do not count the time that has passed since we stopped.
 	// Moreover, if we previously already had a pause, the distance 
 	// mStopTime - mBaseTime includes paused time, which we do not want to count.
@@ -116,6 +121,13 @@ void GameTimer::Tick()
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
 
+	if( mFixedTimeStep > 0.0 )
+	{
+		mDeltaTime = mFixedTimeStep;
+		mFixedTotalTime += mFixedTimeStep;
+		return;
+	}
+
 	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the 
 	// processor goes into a power save mode or we get shuffled to another
 	// processor, then mDeltaTime can be negative.
@@ -125,3 +137,13 @@ void GameTimer::Tick()
 	}
 }
 
+void GameTimer::SetFixedTimeStep(float seconds)
+{
+	mFixedTimeStep = seconds > 0.0f ? seconds : 0.0;
+	mFixedTotalTime = 0.0;
+}
+
+bool GameTimer::IsFixedTimeStep()const
+{
+	return mFixedTimeStep > 0.0;
+}
@@ -18,9 +18,16 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// While non-zero, every Tick advances the clock by exactly this many seconds and
+	// TotalTime counts from the call. Zero returns to real time.
+	void SetFixedTimeStep(float seconds);
+	bool IsFixedTimeStep()const;
+
 private:
 	double mSecondsPerCount;
 	double mDeltaTime;
+	double mFixedTimeStep;
+	double mFixedTotalTime;
 
 	__int64 mBaseTime;
 	__int64 mPausedTime;
@@ -0,0 +1,68 @@
+#include "HeightMapGenerator.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#define STB_PERLIN_IMPLEMENTATION
+#include "stb_perlin.h"
+#include <algorithm>
+#include <cfloat>
+
+HeightMap GeneratePerlinHeightmap(uint32_t width, uint32_t height, const PerlinNoiseSettings& settings, JobSystem& jobs, uint32_t grainRows)
+{
+	HeightMap hm;
+	hm.width = width;
+	hm.height = height;
+	hm.data.resize(width * height);
+
+	// Guard against division by zero
+	if (width <= 1 || height <= 1) return hm;
+
+	float minH = FLT_MAX;
+	float maxH = -FLT_MAX;
+
+	// Scratch that is gone before the function returns.
+	FrameVector<float> noiseValues(width * height, 0.0f);
+
+	// Rows are independent; the range is found afterwards so the jobs share nothing.
+	jobs.ParallelFor(0, height, grainRows, [&](uint32_t firstRow, uint32_t endRow)
+		{
+			for (uint32_t j = firstRow; j < endRow; ++j)
+			{
+				for (uint32_t i = 0; i < width; ++i)
+				{
+					float u = static_cast<float>(i) / static_cast<float>(width - 1);
+					float v = static_cast<float>(j) / static_cast<float>(height - 1);
+
+					float x = u * settings.Scale;
+					float z = v * settings.Scale;
+
+					float amplitude = settings.Amplitude;
+					float frequency = settings.Frequency;
+					float noiseValue = settings.Offset;
+
+					for (int o = 0; o < settings.Octaves; ++o)
+					{
+						noiseValue += amplitude * stb_perlin_noise3_seed(x * frequency, z * frequency, 0.0f, 0, 0, 0, settings.Seed);
+						amplitude *= settings.Persistence;
+						frequency *= 2.0f;
+					}
+
+					noiseValues[j * width + i] = noiseValue;
+				}
+			}
+		});
+
+	for (float noiseValue : noiseValues)
+	{
+		minH = std::min(minH, noiseValue);
+		maxH = std::max(maxH, noiseValue);
+	}
+
+	float invRange = (maxH - minH) > 1e-6f ? 1.0f / (maxH - minH) : 1.0f;
+
+	for (uint32_t j = 0; j < width * height; ++j)
+	{
+		float normalizedHeight = (noiseValues[j] - minH) * invRange;
+		hm.data[j] = std::clamp(normalizedHeight, 0.0f, 1.0f);
+	}
+	return hm;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "MemoryTracker.h"
+#include <cstdint>
+
+class JobSystem;
+
+struct HeightMap
+{
+	TrackedVector<float, MemoryTag::Terrain> data;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+struct PerlinNoiseSettings
+{
+	// Extent of the whole map in noise space.
+	float Scale = 1.0f;
+	int Octaves = 1;
+
+	// Amplitude and frequency of the first octave. Every further octave scales the amplitude
+	// by Persistence and doubles the frequency.
+	float Amplitude = 1.0f;
+	float Persistence = 0.5f;
+	float Frequency = 1.0f;
+
+	// Added to every sample before the map is normalized.
+	float Offset = 0.0f;
+	int Seed = 0;
+};
+
+// Fractal Perlin noise normalized to [0, 1]. Rows are generated in parallel on jobs, grainRows
+// at a time.
+HeightMap GeneratePerlinHeightmap(uint32_t width, uint32_t height, const PerlinNoiseSettings& settings, JobSystem& jobs, uint32_t grainRows = 16);
@@ -0,0 +1,193 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+namespace
+{
+	// The pool the current thread works for and its queue in that pool.
+	thread_local const JobSystem* t_System = nullptr;
+	thread_local uint32_t t_Queue = 0;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	for (uint32_t i = 0; i < workerCount + 1; i++)
+		m_Queues.push_back(std::make_unique<WorkQueue>());
+
+	for (uint32_t i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_Quit = true;
+	}
+	m_Wake.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+uint32_t JobSystem::DefaultWorkerCount()
+{
+	return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+uint32_t JobSystem::CurrentQueue() const
+{
+	return t_System == this ? t_Queue : (uint32_t)m_Workers.size();
+}
+
+void JobSystem::Run(JobCounter& counter, std::function<void()> job)
+{
+	counter.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+	WorkQueue& queue = *m_Queues[CurrentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Jobs.push_back({ std::move(job), &counter });
+	}
+	m_QueuedJobs.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders this with a worker that has just found nothing and is about to
+	// sleep, so the notification cannot be lost.
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+	}
+	m_Wake.notify_one();
+}
+
+bool JobSystem::TryRunJob(uint32_t queue, const JobCounter* only)
+{
+	Job job;
+	bool found = false;
+
+	{
+		WorkQueue& own = *m_Queues[queue];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		for (auto it = own.Jobs.rbegin(); it != own.Jobs.rend(); ++it)
+		{
+			if (only == nullptr || it->Counter == only)
+			{
+				job = std::move(*it);
+				own.Jobs.erase(std::next(it).base());
+				found = true;
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 1; !found && i < m_Queues.size(); i++)
+	{
+		WorkQueue& victim = *m_Queues[(queue + i) % m_Queues.size()];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+		for (auto it = victim.Jobs.begin(); it != victim.Jobs.end(); ++it)
+		{
+			if (only == nullptr || it->Counter == only)
+			{
+				job = std::move(*it);
+				victim.Jobs.erase(it);
+				found = true;
+				break;
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+
+	m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	try
+	{
+		job.Fn();
+	}
+	catch (...)
+	{
+		if (!job.Counter->m_Failed.exchange(true))
+			job.Counter->m_Error = std::current_exception();
+	}
+
+	job.Counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+	return true;
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	// Workers run anything while they wait, but an outside thread only helps with its own
+	// counter, so it never ends up running work another caller queued.
+	uint32_t queue = CurrentQueue();
+	const JobCounter* only = t_System == this ? nullptr : &counter;
+	while (!counter.IsDone())
+	{
+		if (!TryRunJob(queue, only))
+			std::this_thread::yield();
+	}
+
+	if (counter.m_Failed.load(std::memory_order_acquire))
+	{
+		std::exception_ptr error = counter.m_Error;
+		counter.m_Error = nullptr;
+		counter.m_Failed = false;
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t queue)
+{
+	t_System = this;
+	t_Queue = queue;
+	Profiler::Get().SetThreadName(("Job Worker " + std::to_string(queue)).c_str());
+
+	for (;;)
+	{
+		if (TryRunJob(queue, nullptr))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_WakeMutex);
+		m_Wake.wait(lock, [this] { return m_Quit || m_QueuedJobs.load(std::memory_order_acquire) > 0; });
+		if (m_Quit)
+			return;
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t first, uint32_t last, uint32_t grainSize, const RangeFn& body)
+{
+	if (first >= last)
+		return;
+
+	// Jobs already queued refer to the counter and body, so they have to finish even if the
+	// part run on this thread throws.
+	JobCounter counter;
+	std::exception_ptr error;
+	try
+	{
+		SplitRange(counter, first, last, std::max(grainSize, 1u), body);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	Wait(counter);
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void JobSystem::SplitRange(JobCounter& counter, uint32_t first, uint32_t last, uint32_t grainSize, const RangeFn& body)
+{
+	// Offer the upper half and keep splitting the lower one; whatever nobody has stolen by
+	// the time this thread gets back to it is run here.
+	while (last - first > grainSize)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		Run(counter, [this, &counter, middle, last, grainSize, &body]() { SplitRange(counter, middle, last, grainSize, body); });
+		last = middle;
+	}
+
+	body(first, last);
+}
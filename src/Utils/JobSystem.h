@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks a group of jobs. Every job started with a counter holds it open until it returns,
+// and jobs it starts with the same counter count as its children, so waiting on the counter
+// waits for the whole tree.
+class JobCounter
+{
+public:
+	bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_Pending{ 0 };
+	std::atomic<bool> m_Failed{ false };
+	std::exception_ptr m_Error;
+};
+
+// Work-stealing scheduler. Each worker owns a deque: it pushes and pops its own jobs at the
+// back, so recently split work stays hot in its cache, and steals from the front of the
+// others, where the oldest and largest pieces are. Threads outside the pool share one extra
+// deque and, while they wait, run only the jobs of the counter they are waiting on.
+class JobSystem
+{
+public:
+	using RangeFn = std::function<void(uint32_t begin, uint32_t end)>;
+
+	// workerCount threads are started in addition to the threads that wait on jobs. With no
+	// workers, everything runs on the waiting thread.
+	explicit JobSystem(uint32_t workerCount);
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	// One worker per hardware thread, less the one that waits.
+	static uint32_t DefaultWorkerCount();
+
+	// Threads that run jobs, including one waiting thread.
+	uint32_t ThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+
+	void Run(JobCounter& counter, std::function<void()> job);
+
+	// Runs queued jobs until the counter's jobs are all done. An exception thrown by one of
+	// them is rethrown here once the rest have finished.
+	void Wait(JobCounter& counter);
+
+	// Calls body on subranges of [first, last) of at most grainSize indices and returns when
+	// all have run. The range is split in halves on demand, so idle threads pick up work in
+	// large pieces and the number of jobs adapts to how many threads are free.
+	void ParallelFor(uint32_t first, uint32_t last, uint32_t grainSize, const RangeFn& body);
+
+private:
+	struct Job
+	{
+		std::function<void()> Fn;
+		JobCounter* Counter = nullptr;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	uint32_t CurrentQueue() const;
+	// Runs one job, taking only jobs of the given counter unless it is null.
+	bool TryRunJob(uint32_t queue, const JobCounter* only);
+	void WorkerLoop(uint32_t queue);
+	void SplitRange(JobCounter& counter, uint32_t first, uint32_t last, uint32_t grainSize, const RangeFn& body);
+
+	// One queue per worker, then the one shared by outside threads.
+	std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+	std::vector<std::thread> m_Workers;
+
+	std::mutex m_WakeMutex;
+	std::condition_variable m_Wake;
+	std::atomic<uint32_t> m_QueuedJobs{ 0 };
+	bool m_Quit = false;
+};
@@ -0,0 +1,28 @@
+#include "Json.h"
+
+void WriteJsonString(std::ostream& out, std::string_view text)
+{
+	static const char Hex[] = "0123456789abcdef";
+
+	out << '"';
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': out << "\\\""; break;
+		case '\\': out << "\\\\"; break;
+		case '\b': out << "\\b"; break;
+		case '\f': out << "\\f"; break;
+		case '\n': out << "\\n"; break;
+		case '\r': out << "\\r"; break;
+		case '\t': out << "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20)
+				out << "\\u00" << Hex[(unsigned char)c >> 4] << Hex[c & 0xf];
+			else
+				out << c;
+			break;
+		}
+	}
+	out << '"';
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+
+// Writes text as a quoted JSON string. Quotes, backslashes and control characters are
+// escaped; other bytes, UTF-8 included, are copied as they are.
+void WriteJsonString(std::ostream& out, std::string_view text);
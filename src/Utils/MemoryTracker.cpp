@@ -0,0 +1,92 @@
+#include "MemoryTracker.h"
+
+const char* MemoryTagName(MemoryTag tag)
+{
+	switch (tag)
+	{
+	case MemoryTag::General: return "General";
+	case MemoryTag::Terrain: return "Terrain";
+	case MemoryTag::Geometry: return "Geometry";
+	case MemoryTag::Textures: return "Textures";
+	case MemoryTag::RenderTargets: return "Render targets";
+	case MemoryTag::ConstantBuffers: return "Constant buffers";
+	case MemoryTag::Upload: return "Upload";
+	case MemoryTag::FrameGraph: return "Frame graph";
+	case MemoryTag::Profiling: return "Profiling";
+	case MemoryTag::FrameArena: return "Frame arena";
+	default: return "Unknown";
+	}
+}
+
+MemoryTracker& MemoryTracker::Get()
+{
+	static MemoryTracker tracker;
+	return tracker;
+}
+
+void MemoryTracker::OnAllocate(MemoryTag tag, MemoryDomain domain, uint64_t bytes)
+{
+	Counter& counter = At(tag, domain);
+	int64_t current = counter.Current.fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+	counter.Allocations.fetch_add(1, std::memory_order_relaxed);
+	counter.TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	int64_t peak = counter.Peak.load(std::memory_order_relaxed);
+	while (current > peak && !counter.Peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MemoryTracker::OnFree(MemoryTag tag, MemoryDomain domain, uint64_t bytes)
+{
+	Counter& counter = At(tag, domain);
+	counter.Current.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+	counter.Allocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+MemoryUsage MemoryTracker::Usage(MemoryTag tag, MemoryDomain domain) const
+{
+	const Counter& counter = At(tag, domain);
+	MemoryUsage usage;
+	usage.CurrentBytes = counter.Current.load(std::memory_order_relaxed);
+	usage.PeakBytes = counter.Peak.load(std::memory_order_relaxed);
+	usage.Allocations = counter.Allocations.load(std::memory_order_relaxed);
+	usage.TotalAllocations = counter.TotalAllocations.load(std::memory_order_relaxed);
+	return usage;
+}
+
+int64_t MemoryTracker::TotalBytes(MemoryDomain domain) const
+{
+	int64_t total = 0;
+	for (size_t tag = 0; tag < (size_t)MemoryTag::Count; tag++)
+		total += At((MemoryTag)tag, domain).Current.load(std::memory_order_relaxed);
+	return total;
+}
+
+void MemoryTracker::ResetPeaks()
+{
+	for (auto& domain : m_Counters)
+	{
+		for (Counter& counter : domain)
+			counter.Peak.store(counter.Current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+uint32_t MemoryTracker::WriteLeakReport(std::ostream& out) const
+{
+	uint32_t leaks = 0;
+	for (size_t domain = 0; domain < (size_t)MemoryDomain::Count; domain++)
+	{
+		for (size_t tag = 0; tag < (size_t)MemoryTag::Count; tag++)
+		{
+			MemoryUsage usage = Usage((MemoryTag)tag, (MemoryDomain)domain);
+			if (usage.CurrentBytes == 0 && usage.Allocations == 0)
+				continue;
+
+			out << (domain == (size_t)MemoryDomain::Cpu ? "CPU " : "GPU ") << MemoryTagName((MemoryTag)tag) << ": "
+				<< usage.CurrentBytes << " bytes in " << usage.Allocations << " allocations still alive\n";
+			leaks++;
+		}
+	}
+	return leaks;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// What an allocation is for. Every allocation is counted under exactly one tag.
+enum class MemoryTag : uint8_t
+{
+	General,
+	Terrain,
+	Geometry,
+	Textures,
+	RenderTargets,
+	ConstantBuffers,
+	Upload,
+	FrameGraph,
+	Profiling,
+	FrameArena,
+	Count
+};
+
+enum class MemoryDomain : uint8_t
+{
+	Cpu,
+	Gpu,
+	Count
+};
+
+const char* MemoryTagName(MemoryTag tag);
+
+struct MemoryUsage
+{
+	int64_t CurrentBytes = 0;
+	int64_t PeakBytes = 0;
+	// Allocations currently alive.
+	int64_t Allocations = 0;
+	int64_t TotalAllocations = 0;
+};
+
+// Per-tag byte counts for CPU and GPU memory. Counting is a handful of relaxed atomics, so the
+// tracked allocators can be used from any thread.
+class MemoryTracker
+{
+public:
+	static MemoryTracker& Get();
+
+	MemoryTracker(const MemoryTracker& rhs) = delete;
+	MemoryTracker& operator=(const MemoryTracker& rhs) = delete;
+
+	void OnAllocate(MemoryTag tag, MemoryDomain domain, uint64_t bytes);
+	void OnFree(MemoryTag tag, MemoryDomain domain, uint64_t bytes);
+
+	MemoryUsage Usage(MemoryTag tag, MemoryDomain domain) const;
+	int64_t TotalBytes(MemoryDomain domain) const;
+
+	// Forgets the peaks, e.g. after loading, so the next peak is of steady state.
+	void ResetPeaks();
+
+	// One line per tag that still holds memory. Returns the number of such tags.
+	uint32_t WriteLeakReport(std::ostream& out) const;
+
+private:
+	MemoryTracker() = default;
+
+	struct Counter
+	{
+		std::atomic<int64_t> Current{ 0 };
+		std::atomic<int64_t> Peak{ 0 };
+		std::atomic<int64_t> Allocations{ 0 };
+		std::atomic<int64_t> TotalAllocations{ 0 };
+	};
+
+	Counter& At(MemoryTag tag, MemoryDomain domain) { return m_Counters[(size_t)domain][(size_t)tag]; }
+	const Counter& At(MemoryTag tag, MemoryDomain domain) const { return m_Counters[(size_t)domain][(size_t)tag]; }
+
+	Counter m_Counters[(size_t)MemoryDomain::Count][(size_t)MemoryTag::Count];
+};
+
+// Standard allocator that counts its memory under Tag.
+template<typename T, MemoryTag Tag>
+class TrackedAllocator
+{
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = TrackedAllocator<U, Tag>;
+	};
+
+	TrackedAllocator() noexcept = default;
+	template<typename U>
+	TrackedAllocator(const TrackedAllocator<U, Tag>&) noexcept {}
+
+	T* allocate(size_t count)
+	{
+		T* p = std::allocator<T>().allocate(count);
+		MemoryTracker::Get().OnAllocate(Tag, MemoryDomain::Cpu, count * sizeof(T));
+		return p;
+	}
+
+	void deallocate(T* p, size_t count) noexcept
+	{
+		MemoryTracker::Get().OnFree(Tag, MemoryDomain::Cpu, count * sizeof(T));
+		std::allocator<T>().deallocate(p, count);
+	}
+
+	template<typename U>
+	bool operator==(const TrackedAllocator<U, Tag>&) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const TrackedAllocator<U, Tag>&) const noexcept { return false; }
+};
+
+template<typename T, MemoryTag Tag>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Tag>>;
@@ -0,0 +1,51 @@
+#include "MeshLoader.h"
+#include <fstream>
+
+bool ParseTextMesh(std::istream& in, TextMesh& mesh)
+{
+	uint32_t vcount = 0;
+	uint32_t tcount = 0;
+	std::string ignore;
+
+	in >> ignore >> vcount;
+	in >> ignore >> tcount;
+	in >> ignore >> ignore >> ignore >> ignore;
+	if (!in)
+		return false;
+
+	mesh.Positions.resize(vcount);
+	mesh.Normals.resize(vcount);
+	for (uint32_t i = 0; i < vcount; ++i)
+	{
+		in >> mesh.Positions[i].x >> mesh.Positions[i].y >> mesh.Positions[i].z;
+		in >> mesh.Normals[i].x >> mesh.Normals[i].y >> mesh.Normals[i].z;
+	}
+
+	in >> ignore;
+	in >> ignore;
+	in >> ignore;
+
+	mesh.Indices.resize(3 * (size_t)tcount);
+	for (uint32_t i = 0; i < tcount; ++i)
+	{
+		in >> mesh.Indices[i * 3 + 0] >> mesh.Indices[i * 3 + 1] >> mesh.Indices[i * 3 + 2];
+	}
+	if (!in)
+		return false;
+
+	for (int32_t index : mesh.Indices)
+	{
+		if (index < 0 || (uint32_t)index >= vcount)
+			return false;
+	}
+	return true;
+}
+
+bool LoadTextMesh(const std::string& path, TextMesh& mesh)
+{
+	std::ifstream fin(path);
+	if (!fin)
+		return false;
+
+	return ParseTextMesh(fin, mesh);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+struct TextMesh
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<int32_t> Indices;
+};
+
+// Reads the text mesh format of Models/skull.txt: vertex and triangle counts, then a position
+// and normal per vertex and three indices per triangle. Returns false if the data ends early or
+// an index is out of range.
+bool ParseTextMesh(std::istream& in, TextMesh& mesh);
+bool LoadTextMesh(const std::string& path, TextMesh& mesh);
@@ -0,0 +1,90 @@
+#include "Metrics.h"
+#include <cstring>
+
+MetricsRegistry& MetricsRegistry::Get()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+MetricId MetricsRegistry::Register(const char* name, const char* unit, MetricKind kind)
+{
+	std::lock_guard<std::mutex> lock(m_RegisterMutex);
+
+	MetricId existing = Find(name);
+	if (existing != InvalidMetric)
+		return existing;
+
+	uint32_t count = m_Count.load(std::memory_order_relaxed);
+	if (count == MaxMetrics)
+		return InvalidMetric;
+
+	// The slot is filled in before the count is published, so readers never see it half written.
+	Slot& slot = m_Slots[count];
+	slot.Name = name;
+	slot.Unit = unit;
+	slot.Kind = kind;
+	slot.Value.store(0, std::memory_order_relaxed);
+	m_Count.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+MetricId MetricsRegistry::Find(const char* name) const
+{
+	uint32_t count = Count();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (std::strcmp(m_Slots[i].Name, name) == 0)
+			return i;
+	}
+	return InvalidMetric;
+}
+
+void MetricsRegistry::Add(MetricId id, int64_t delta)
+{
+	if (id < Count())
+		m_Slots[id].Value.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::Set(MetricId id, int64_t value)
+{
+	if (id < Count())
+		m_Slots[id].Value.store(value, std::memory_order_relaxed);
+}
+
+int64_t MetricsRegistry::Value(MetricId id) const
+{
+	return id < Count() ? m_Slots[id].Value.load(std::memory_order_relaxed) : 0;
+}
+
+MetricSample MetricsRegistry::Sample(MetricId id) const
+{
+	MetricSample sample;
+	if (id < Count())
+	{
+		const Slot& slot = m_Slots[id];
+		sample.Name = slot.Name;
+		sample.Unit = slot.Unit;
+		sample.Kind = slot.Kind;
+		sample.Value = slot.Value.load(std::memory_order_relaxed);
+	}
+	return sample;
+}
+
+void MetricsRegistry::Snapshot(std::vector<MetricSample>& samples) const
+{
+	uint32_t count = Count();
+	samples.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		samples[i] = Sample(i);
+}
+
+void MetricsRegistry::WriteText(std::ostream& out) const
+{
+	uint32_t count = Count();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		MetricSample sample = Sample(i);
+		out << sample.Name << ' ' << sample.Value << ' ' << sample.Unit << '\n';
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+enum class MetricKind : uint8_t
+{
+	// Only ever grows, e.g. frames rendered.
+	Counter,
+	// Replaced every time it is measured, e.g. draw calls last frame.
+	Gauge
+};
+
+using MetricId = uint32_t;
+
+struct MetricSample
+{
+	const char* Name = nullptr;
+	const char* Unit = nullptr;
+	MetricKind Kind = MetricKind::Gauge;
+	int64_t Value = 0;
+};
+
+// Fixed table of named 64-bit values. Registering takes a lock, but updating and reading a
+// value is a single atomic operation, so the UI, a benchmark harness or an external scraper can
+// read the counters from any thread while the renderer writes them.
+class MetricsRegistry
+{
+public:
+	static constexpr uint32_t MaxMetrics = 128;
+	static constexpr MetricId InvalidMetric = 0xffffffffu;
+
+	static MetricsRegistry& Get();
+
+	MetricsRegistry(const MetricsRegistry& rhs) = delete;
+	MetricsRegistry& operator=(const MetricsRegistry& rhs) = delete;
+
+	// Returns the existing id when the name is already registered, and InvalidMetric when the
+	// table is full. Names and units must outlive the registry, string literals in practice.
+	MetricId Register(const char* name, const char* unit, MetricKind kind);
+	MetricId Find(const char* name) const;
+
+	// Invalid ids are ignored, so callers never have to check what Register returned.
+	void Add(MetricId id, int64_t delta = 1);
+	void Set(MetricId id, int64_t value);
+	int64_t Value(MetricId id) const;
+
+	uint32_t Count() const { return m_Count.load(std::memory_order_acquire); }
+	MetricSample Sample(MetricId id) const;
+
+	// Replaces samples with every metric, in registration order.
+	void Snapshot(std::vector<MetricSample>& samples) const;
+
+	// One "name value unit" line per metric.
+	void WriteText(std::ostream& out) const;
+
+private:
+	struct Slot
+	{
+		const char* Name = nullptr;
+		const char* Unit = nullptr;
+		MetricKind Kind = MetricKind::Gauge;
+		std::atomic<int64_t> Value{ 0 };
+	};
+
+	MetricsRegistry() = default;
+
+	std::mutex m_RegisterMutex;
+	std::array<Slot, MaxMetrics> m_Slots;
+	std::atomic<uint32_t> m_Count{ 0 };
+};
+
+// The last Capacity samples, for statistics over a rolling window. Fixed size, so adding a
+// sample never allocates.
+template <uint32_t Capacity>
+class RollingWindow
+{
+public:
+	void Add(float value)
+	{
+		m_Values[m_Next] = value;
+		m_Next = (m_Next + 1) % Capacity;
+		m_Count = std::min(m_Count + 1, Capacity);
+	}
+
+	uint32_t Count() const { return m_Count; }
+
+	// Nearest-rank percentile, fraction in [0, 1].
+	float Percentile(float fraction) const
+	{
+		if (m_Count == 0)
+			return 0.0f;
+
+		std::copy(m_Values.begin(), m_Values.begin() + m_Count, m_Scratch.begin());
+		uint32_t rank = std::min((uint32_t)(fraction * m_Count), m_Count - 1);
+		std::nth_element(m_Scratch.begin(), m_Scratch.begin() + rank, m_Scratch.begin() + m_Count);
+		return m_Scratch[rank];
+	}
+
+	// Raw storage and the index of the oldest sample, in the form ImGui::PlotLines takes.
+	const float* Data() const { return m_Values.data(); }
+	uint32_t Offset() const { return m_Count < Capacity ? 0 : m_Next; }
+
+private:
+	std::array<float, Capacity> m_Values = {};
+	mutable std::array<float, Capacity> m_Scratch = {};
+	uint32_t m_Next = 0;
+	uint32_t m_Count = 0;
+};
@@ -0,0 +1,334 @@
+#include "Profiler.h"
+#include "Json.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+int64_t Profiler::NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::Profiler()
+	: m_History(HistoryFrames)
+{
+	m_ScopeCostNs = MeasureScopeCostNs();
+	m_Current.StartNs = NowNs();
+}
+
+double Profiler::MeasureScopeCostNs()
+{
+	// Best of a few runs on a private buffer, so the estimate is not skewed by a context switch.
+	const uint32_t scopes = EventCapacity / 4;
+	ThreadBuffer buffer;
+	double best = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		buffer.Head = 0;
+		buffer.Tail = 0;
+
+		int64_t start = NowNs();
+		for (uint32_t i = 0; i < scopes; i++)
+		{
+			PushBegin(buffer, "Calibration", NowNs());
+			PushEnd(buffer, NowNs());
+		}
+		double cost = (double)(NowNs() - start) / scopes;
+		best = run == 0 ? cost : std::min(best, cost);
+	}
+	return best;
+}
+
+Profiler::BufferOwner::~BufferOwner()
+{
+	if (!Buffer)
+		return;
+
+	std::lock_guard<std::mutex> lock(Owner->m_ThreadsMutex);
+	Buffer->Owned = false;
+}
+
+Profiler::ThreadBuffer& Profiler::CurrentBuffer()
+{
+	thread_local BufferOwner current;
+	if (!current.Buffer)
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+		current.Owner = this;
+		current.Buffer = &AddBuffer();
+	}
+	return *current.Buffer;
+}
+
+Profiler::ThreadBuffer& Profiler::AddBuffer()
+{
+	if (!m_FreeBuffers.empty())
+	{
+		// Drained and unowned, so nothing else touches it until it is handed out here.
+		ThreadBuffer& buffer = *m_Threads[m_FreeBuffers.back()];
+		m_FreeBuffers.pop_back();
+		buffer.Head.store(0, std::memory_order_relaxed);
+		buffer.Tail.store(0, std::memory_order_relaxed);
+		buffer.OpenScopes = 0;
+		buffer.Owned = true;
+		buffer.Free = false;
+		buffer.Name = "Thread " + std::to_string(buffer.Index);
+		return buffer;
+	}
+
+	m_Threads.push_back(std::make_unique<ThreadBuffer>());
+	ThreadBuffer& buffer = *m_Threads.back();
+	buffer.Index = (uint32_t)m_Threads.size() - 1;
+	buffer.Name = "Thread " + std::to_string(buffer.Index);
+	return buffer;
+}
+
+uint32_t Profiler::CreateTrack(const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+	ThreadBuffer& buffer = AddBuffer();
+	buffer.Name = name;
+	return buffer.Index;
+}
+
+void Profiler::AddTrackScope(uint32_t track, const char* name, int64_t startNs, int64_t endNs)
+{
+	if (!IsEnabled())
+		return;
+
+	ThreadBuffer* buffer;
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+		buffer = m_Threads[track].get();
+	}
+	if (PushBegin(*buffer, name, startNs))
+		PushEnd(*buffer, endNs);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = CurrentBuffer();
+	std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+	buffer.Name = name;
+}
+
+std::string Profiler::ThreadName(uint32_t thread) const
+{
+	std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+	return thread < m_Threads.size() ? m_Threads[thread]->Name : std::string();
+}
+
+bool Profiler::BeginScope(const char* name)
+{
+	if (!IsEnabled())
+		return false;
+
+	return PushBegin(CurrentBuffer(), name, NowNs());
+}
+
+void Profiler::EndScope()
+{
+	PushEnd(CurrentBuffer(), NowNs());
+}
+
+bool Profiler::PushBegin(ThreadBuffer& buffer, const char* name, int64_t timeNs)
+{
+	uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+	uint64_t tail = buffer.Tail.load(std::memory_order_acquire);
+
+	// Room is kept for the end of every open scope, this one included, so ends are never
+	// dropped and the collected tree stays balanced.
+	if (head - tail + buffer.OpenScopes + 2 > EventCapacity)
+	{
+		buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	buffer.Events[head % EventCapacity] = { name, timeNs };
+	buffer.Head.store(head + 1, std::memory_order_release);
+	buffer.OpenScopes++;
+	return true;
+}
+
+void Profiler::PushEnd(ThreadBuffer& buffer, int64_t timeNs)
+{
+	uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+	buffer.Events[head % EventCapacity] = { nullptr, timeNs };
+	buffer.Head.store(head + 1, std::memory_order_release);
+	buffer.OpenScopes--;
+}
+
+void Profiler::Drain(ThreadBuffer& buffer)
+{
+	std::vector<ProfileNode>& nodes = m_Current.Nodes;
+	auto open = [&](const char* name, int64_t startNs)
+		{
+			ProfileNode node;
+			node.Name = name;
+			node.Thread = buffer.Index;
+			node.Parent = buffer.Open.empty() ? -1 : (int32_t)buffer.Open.back();
+			node.Depth = (uint32_t)buffer.Open.size();
+			node.StartNs = startNs;
+			node.EndNs = startNs;
+			buffer.Open.push_back((uint32_t)nodes.size());
+			nodes.push_back(node);
+		};
+
+	for (const char* name : buffer.Carried)
+		open(name, m_Current.StartNs);
+	buffer.Carried.clear();
+
+	uint64_t head = buffer.Head.load(std::memory_order_acquire);
+	uint64_t tail = buffer.Tail.load(std::memory_order_relaxed);
+	for (; tail < head; tail++)
+	{
+		const Event& event = buffer.Events[tail % EventCapacity];
+		if (event.Name)
+		{
+			open(event.Name, event.TimeNs);
+		}
+		else if (!buffer.Open.empty())
+		{
+			nodes[buffer.Open.back()].EndNs = event.TimeNs;
+			buffer.Open.pop_back();
+		}
+	}
+	buffer.Tail.store(head, std::memory_order_release);
+}
+
+void Profiler::EndFrame()
+{
+	int64_t frameEnd = NowNs();
+
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : m_Threads)
+		{
+			if (buffer->Free)
+				continue;
+
+			Drain(*buffer);
+
+			for (uint32_t node : buffer->Open)
+			{
+				ProfileNode& n = m_Current.Nodes[node];
+				n.EndNs = std::max(frameEnd, n.StartNs);
+				buffer->Carried.push_back(n.Name);
+			}
+			buffer->Open.clear();
+
+			// Its thread is gone, so scopes it left open never end.
+			if (!buffer->Owned)
+			{
+				buffer->Carried.clear();
+				buffer->Free = true;
+				m_FreeBuffers.push_back(buffer->Index);
+			}
+		}
+	}
+
+	size_t scopes = m_Current.Nodes.size();
+	m_Current.Index = m_FrameIndex++;
+	m_Current.EndNs = frameEnd;
+
+	// Swapping keeps the node storage of the oldest frame for reuse, so a steady frame
+	// does not allocate.
+	uint32_t slot;
+	if (m_HistoryCount < HistoryFrames)
+	{
+		slot = (m_HistoryStart + m_HistoryCount) % HistoryFrames;
+		m_HistoryCount++;
+	}
+	else
+	{
+		slot = m_HistoryStart;
+		m_HistoryStart = (m_HistoryStart + 1) % HistoryFrames;
+	}
+	std::swap(m_History[slot], m_Current);
+	m_Current.Nodes.clear();
+	m_Current.StartNs = frameEnd;
+
+	m_LastOverheadMs = (scopes * m_ScopeCostNs + (NowNs() - frameEnd)) / 1e6;
+}
+
+const ProfileFrame& Profiler::Frame(uint32_t index) const
+{
+	return m_History[(m_HistoryStart + index) % HistoryFrames];
+}
+
+uint64_t Profiler::DroppedScopes() const
+{
+	std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+	uint64_t dropped = 0;
+	for (const std::unique_ptr<ThreadBuffer>& buffer : m_Threads)
+		dropped += buffer->Dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+
+	// Timestamps are microseconds from the start of the oldest frame. Frames get a track of
+	// their own after the threads.
+	const uint32_t frameTrack = (uint32_t)m_Threads.size();
+	const int64_t origin = m_HistoryCount ? Frame(0).StartNs : 0;
+	bool first = true;
+
+	auto beginEvent = [&]()
+		{
+			out << (first ? "\n" : ",\n");
+			first = false;
+		};
+	auto writeSpan = [&](const char* name, uint32_t tid, int64_t startNs, int64_t endNs)
+		{
+			beginEvent();
+			out << "{\"name\":";
+			WriteJsonString(out, name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+				<< ",\"ts\":" << (startNs - origin) / 1e3
+				<< ",\"dur\":" << (endNs - startNs) / 1e3 << "}";
+		};
+	auto writeThreadName = [&](uint32_t tid, const char* name)
+		{
+			beginEvent();
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+			WriteJsonString(out, name);
+			out << "}}";
+		};
+
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+
+	for (const std::unique_ptr<ThreadBuffer>& buffer : m_Threads)
+		writeThreadName(buffer->Index, buffer->Name.c_str());
+	writeThreadName(frameTrack, "Frames");
+
+	for (uint32_t i = 0; i < m_HistoryCount; i++)
+	{
+		const ProfileFrame& frame = Frame(i);
+		std::string frameName = "Frame " + std::to_string(frame.Index);
+		writeSpan(frameName.c_str(), frameTrack, frame.StartNs, frame.EndNs);
+
+		for (const ProfileNode& node : frame.Nodes)
+			writeSpan(node.Name, node.Thread, node.StartNs, node.EndNs);
+	}
+
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	WriteChromeTrace(file);
+	return (bool)file;
+}
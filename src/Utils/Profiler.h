@@ -0,0 +1,168 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One completed scope. Nodes of a thread are stored together in pre-order, so a node's
+// descendants are the nodes right after it with a greater depth.
+struct ProfileNode
+{
+	const char* Name = nullptr;
+	uint32_t Thread = 0;
+	int32_t Parent = -1;
+	uint32_t Depth = 0;
+	int64_t StartNs = 0;
+	int64_t EndNs = 0;
+
+	double DurationMs() const { return (EndNs - StartNs) / 1e6; }
+};
+
+struct ProfileFrame
+{
+	uint64_t Index = 0;
+	int64_t StartNs = 0;
+	int64_t EndNs = 0;
+	std::vector<ProfileNode> Nodes;
+
+	double DurationMs() const { return (EndNs - StartNs) / 1e6; }
+};
+
+// Scoped CPU markers. Each thread writes begin and end timestamps into its own ring buffer
+// without locking; EndFrame(), called once per frame on the main thread, drains the buffers
+// into a tree per frame and keeps the last HistoryFrames frames for inspection and export.
+// Scopes still open at the end of a frame are closed there and continue in the next one.
+// A thread's buffer is handed back when the thread exits and reused by the next new thread,
+// on the same track, so short-lived pools do not grow the profiler.
+// Frames are only read, and traces written, on the thread that calls EndFrame().
+class Profiler
+{
+public:
+	// Events per thread between two EndFrame() calls. Scopes that do not fit are dropped.
+	static constexpr uint32_t EventCapacity = 1 << 14;
+	static constexpr uint32_t HistoryFrames = 128;
+
+	static Profiler& Get();
+	static int64_t NowNs();
+
+	Profiler(const Profiler& rhs) = delete;
+	Profiler& operator=(const Profiler& rhs) = delete;
+
+	void SetEnabled(bool enabled) { m_Enabled.store(enabled, std::memory_order_relaxed); }
+	bool IsEnabled() const { return m_Enabled.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in the UI and in exported traces.
+	void SetThreadName(const char* name);
+	std::string ThreadName(uint32_t thread) const;
+
+	// Names must outlive the profiler, string literals in practice. Returns whether the
+	// scope was recorded; EndScope() must only be called if it was.
+	bool BeginScope(const char* name);
+	void EndScope();
+
+	// A timeline that is not a CPU thread, such as GPU work, for scopes timed elsewhere. Its
+	// scopes must be added from one thread, in order, with times on the NowNs() clock.
+	uint32_t CreateTrack(const char* name);
+	void AddTrackScope(uint32_t track, const char* name, int64_t startNs, int64_t endNs);
+
+	void EndFrame();
+
+	// Frames oldest first.
+	uint32_t FrameCount() const { return m_HistoryCount; }
+	const ProfileFrame& Frame(uint32_t index) const;
+	const ProfileFrame* LastFrame() const { return m_HistoryCount ? &Frame(m_HistoryCount - 1) : nullptr; }
+
+	// Estimated cost of the scopes recorded in the last frame plus the time EndFrame() took
+	// to collect them.
+	double LastFrameOverheadMs() const { return m_LastOverheadMs; }
+	uint64_t DroppedScopes() const;
+
+	// Chrome trace event format, for chrome://tracing or Perfetto.
+	void WriteChromeTrace(std::ostream& out) const;
+	bool WriteChromeTrace(const std::string& path) const;
+
+private:
+	struct Event
+	{
+		const char* Name = nullptr; // nullptr ends the innermost open scope
+		int64_t TimeNs = 0;
+	};
+
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> Events = std::make_unique<Event[]>(EventCapacity);
+		std::atomic<uint64_t> Head{ 0 };
+		std::atomic<uint64_t> Tail{ 0 };
+		std::atomic<uint64_t> Dropped{ 0 };
+		uint32_t OpenScopes = 0;
+
+		// Only touched by EndFrame(). Open holds node indices in the frame being built, and
+		// Carried the names of scopes that were still open when the previous frame closed.
+		std::vector<uint32_t> Open;
+		std::vector<const char*> Carried;
+
+		uint32_t Index = 0;
+		std::string Name;
+
+		// Owned is cleared when the thread exits; the next EndFrame() drains what it left and
+		// moves the buffer to the free list.
+		bool Owned = true;
+		bool Free = false;
+	};
+
+	// Per-thread handle that returns the buffer when the thread exits.
+	struct BufferOwner
+	{
+		Profiler* Owner = nullptr;
+		ThreadBuffer* Buffer = nullptr;
+		~BufferOwner();
+	};
+
+	Profiler();
+
+	ThreadBuffer& CurrentBuffer();
+	ThreadBuffer& AddBuffer();
+	static bool PushBegin(ThreadBuffer& buffer, const char* name, int64_t timeNs);
+	static void PushEnd(ThreadBuffer& buffer, int64_t timeNs);
+	void Drain(ThreadBuffer& buffer);
+	double MeasureScopeCostNs();
+
+	std::atomic<bool> m_Enabled{ true };
+
+	mutable std::mutex m_ThreadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_Threads;
+	std::vector<uint32_t> m_FreeBuffers;
+
+	ProfileFrame m_Current;
+	std::vector<ProfileFrame> m_History;
+	uint32_t m_HistoryStart = 0;
+	uint32_t m_HistoryCount = 0;
+	uint64_t m_FrameIndex = 0;
+
+	double m_ScopeCostNs = 0.0;
+	double m_LastOverheadMs = 0.0;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) : m_Recorded(Profiler::Get().BeginScope(name)) {}
+	~ProfileScope()
+	{
+		if (m_Recorded)
+			Profiler::Get().EndScope();
+	}
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+private:
+	bool m_Recorded;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
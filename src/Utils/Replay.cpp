@@ -0,0 +1,239 @@
+#include "Replay.h"
+#include "Json.h"
+#include "SampleStats.h"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	const char ReplayMagic[4] = { 'A', 'Q', 'R', 'P' };
+	const uint32_t ReplayVersion = 1;
+
+	enum ReplayFrameFlags : uint8_t
+	{
+		FrameHasParameters = 1 << 0
+	};
+
+	template<typename T>
+	void Write(std::ostream& out, const T& value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool Read(std::istream& in, T& value)
+	{
+		return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	void WriteFloat3(std::ostream& out, const DirectX::XMFLOAT3& v)
+	{
+		Write(out, v.x);
+		Write(out, v.y);
+		Write(out, v.z);
+	}
+
+	bool ReadFloat3(std::istream& in, DirectX::XMFLOAT3& v)
+	{
+		return Read(in, v.x) && Read(in, v.y) && Read(in, v.z);
+	}
+
+	// Bytes left after the read position, or false if the stream cannot tell.
+	bool RemainingBytes(std::istream& in, uint64_t& bytes)
+	{
+		std::streampos position = in.tellg();
+		if (position == std::streampos(-1) || !in.seekg(0, std::ios::end))
+		{
+			in.clear();
+			return false;
+		}
+
+		std::streampos end = in.tellg();
+		in.seekg(position);
+		if (end == std::streampos(-1) || !in)
+			return false;
+
+		bytes = (uint64_t)(end - position);
+		return true;
+	}
+
+	// Visits every parameter in file order, so reading and writing cannot drift apart.
+	template<typename Params, typename Fn>
+	void VisitParameters(Params& p, Fn&& fn)
+	{
+		for (int i = 0; i < 3; i++)
+			fn(p.WaterPosition[i]);
+		for (int i = 0; i < 3; i++)
+			fn(p.WaterScale[i]);
+		fn(p.WaveSpeed);
+		fn(p.WaveAmplitude);
+		fn(p.WaveFrequency);
+		fn(p.TerrainWidth);
+		fn(p.TerrainHeight);
+		fn(p.TerrainHeightScale);
+		fn(p.NoiseFrequency);
+		fn(p.NoiseOctaves);
+		fn(p.NoisePersistence);
+		fn(p.NoiseAmplitude);
+		fn(p.NoiseValue);
+		fn(p.NoiseSeed);
+		fn(p.PropCountIndex);
+		fn(p.Wireframe);
+		fn(p.Regenerate);
+	}
+
+	void WriteStats(std::ostream& out, const char* name, const std::vector<double>& samples)
+	{
+		out << "{";
+		WriteSampleStatsJson(out, name, ComputeSampleStats(samples), samples);
+		out << "}";
+	}
+}
+
+bool ReplayParameters::operator==(const ReplayParameters& rhs) const
+{
+	return std::memcmp(WaterPosition, rhs.WaterPosition, sizeof(WaterPosition)) == 0
+		&& std::memcmp(WaterScale, rhs.WaterScale, sizeof(WaterScale)) == 0
+		&& WaveSpeed == rhs.WaveSpeed && WaveAmplitude == rhs.WaveAmplitude && WaveFrequency == rhs.WaveFrequency
+		&& TerrainWidth == rhs.TerrainWidth && TerrainHeight == rhs.TerrainHeight && TerrainHeightScale == rhs.TerrainHeightScale
+		&& NoiseFrequency == rhs.NoiseFrequency && NoiseOctaves == rhs.NoiseOctaves && NoisePersistence == rhs.NoisePersistence
+		&& NoiseAmplitude == rhs.NoiseAmplitude && NoiseValue == rhs.NoiseValue && NoiseSeed == rhs.NoiseSeed
+		&& PropCountIndex == rhs.PropCountIndex && Wireframe == rhs.Wireframe && Regenerate == rhs.Regenerate;
+}
+
+bool WriteReplay(std::ostream& out, const ReplayFile& replay)
+{
+	out.write(ReplayMagic, sizeof(ReplayMagic));
+	Write(out, ReplayVersion);
+	Write(out, replay.FixedTimeStep);
+	Write(out, (uint32_t)replay.Frames.size());
+
+	const ReplayParameters* previous = nullptr;
+	for (const ReplayFrame& frame : replay.Frames)
+	{
+		WriteFloat3(out, frame.Camera.Position);
+		WriteFloat3(out, frame.Camera.Right);
+		WriteFloat3(out, frame.Camera.Up);
+		WriteFloat3(out, frame.Camera.Look);
+		Write(out, frame.Seed);
+
+		bool changed = !previous || *previous != frame.Parameters;
+		Write(out, (uint8_t)(changed ? FrameHasParameters : 0));
+		if (changed)
+			VisitParameters(frame.Parameters, [&out](const auto& value) { Write(out, value); });
+		previous = &frame.Parameters;
+	}
+	return (bool)out;
+}
+
+bool ReadReplay(std::istream& in, ReplayFile& replay)
+{
+	char magic[sizeof(ReplayMagic)];
+	uint32_t version = 0;
+	uint32_t frameCount = 0;
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, ReplayMagic, sizeof(magic)) != 0)
+		return false;
+	if (!Read(in, version) || version != ReplayVersion)
+		return false;
+	if (!Read(in, replay.FixedTimeStep) || !(replay.FixedTimeStep > 0.0f) || !Read(in, frameCount))
+		return false;
+
+	// A frame is at least a pose, a seed and a flags byte. A count the rest of the file cannot
+	// hold means the file is corrupt, and is rejected before anything is allocated for it.
+	const uint64_t minFrameBytes = 12 * sizeof(float) + sizeof(uint32_t) + sizeof(uint8_t);
+	uint64_t remaining = 0;
+	bool sized = RemainingBytes(in, remaining);
+	if (!in || (sized && remaining < frameCount * minFrameBytes))
+		return false;
+
+	replay.Frames.clear();
+	if (sized)
+		replay.Frames.reserve(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		ReplayFrame frame;
+		uint8_t flags = 0;
+		bool ok = ReadFloat3(in, frame.Camera.Position) && ReadFloat3(in, frame.Camera.Right)
+			&& ReadFloat3(in, frame.Camera.Up) && ReadFloat3(in, frame.Camera.Look)
+			&& Read(in, frame.Seed) && Read(in, flags);
+		if (!ok)
+			return false;
+
+		if (flags & FrameHasParameters)
+		{
+			VisitParameters(frame.Parameters, [&in, &ok](auto& value) { ok = ok && Read(in, value); });
+			if (!ok)
+				return false;
+		}
+		else if (i == 0)
+		{
+			// The first frame always carries the parameters the run started from.
+			return false;
+		}
+		else
+		{
+			frame.Parameters = replay.Frames.back().Parameters;
+		}
+		replay.Frames.push_back(frame);
+	}
+	return true;
+}
+
+bool SaveReplay(const std::string& path, const ReplayFile& replay)
+{
+	std::ofstream file(path, std::ios::binary);
+	return file && WriteReplay(file, replay);
+}
+
+bool LoadReplay(const std::string& path, ReplayFile& replay)
+{
+	std::ifstream file(path, std::ios::binary);
+	return file && ReadReplay(file, replay);
+}
+
+void FrameTimeReport::Reset(size_t expectedFrames)
+{
+	m_IntervalMs.clear();
+	m_CpuMs.clear();
+	m_GpuMs.clear();
+	m_IntervalMs.reserve(expectedFrames);
+	m_CpuMs.reserve(expectedFrames);
+	m_GpuMs.reserve(expectedFrames);
+}
+
+void FrameTimeReport::AddFrame(double intervalMs, double cpuMs, double gpuMs)
+{
+	m_IntervalMs.push_back(intervalMs);
+	m_CpuMs.push_back(cpuMs);
+	m_GpuMs.push_back(gpuMs);
+}
+
+void FrameTimeReport::WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context) const
+{
+	out << std::setprecision(6) << "{\n  \"context\": {";
+	for (size_t i = 0; i < context.size(); i++)
+	{
+		out << (i ? ",\n    " : "\n    ");
+		WriteJsonString(out, context[i].first);
+		out << ": ";
+		WriteJsonString(out, context[i].second);
+	}
+	out << "\n  },\n  \"results\": [\n    ";
+	WriteStats(out, "replay/frame_interval", m_IntervalMs);
+	out << ",\n    ";
+	WriteStats(out, "replay/cpu_frame", m_CpuMs);
+	out << ",\n    ";
+	WriteStats(out, "replay/gpu_frame", m_GpuMs);
+	out << "\n  ]\n}\n";
+}
+
+bool FrameTimeReport::WriteJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& context) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	WriteJson(file, context);
+	return (bool)file;
+}
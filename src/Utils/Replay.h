@@ -0,0 +1,92 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ReplayCameraPose
+{
+	DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 Right = { 1.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 Up = { 0.0f, 1.0f, 0.0f };
+	DirectX::XMFLOAT3 Look = { 0.0f, 0.0f, 1.0f };
+};
+
+// The scene settings the UI can change, captured once per frame.
+struct ReplayParameters
+{
+	float WaterPosition[3] = {};
+	float WaterScale[3] = {};
+	float WaveSpeed = 0.0f;
+	float WaveAmplitude = 0.0f;
+	float WaveFrequency = 0.0f;
+
+	int32_t TerrainWidth = 0;
+	int32_t TerrainHeight = 0;
+	float TerrainHeightScale = 0.0f;
+	float NoiseFrequency = 0.0f;
+	float NoiseOctaves = 0.0f;
+	float NoisePersistence = 0.0f;
+	float NoiseAmplitude = 0.0f;
+	float NoiseValue = 0.0f;
+	int32_t NoiseSeed = 0;
+
+	int32_t PropCountIndex = 0;
+	bool Wireframe = false;
+
+	// The terrain was regenerated this frame.
+	bool Regenerate = false;
+
+	bool operator==(const ReplayParameters& rhs) const;
+	bool operator!=(const ReplayParameters& rhs) const { return !(*this == rhs); }
+};
+
+struct ReplayFrame
+{
+	ReplayCameraPose Camera;
+
+	// Seeds the random wave disturbances of the frame.
+	uint32_t Seed = 0;
+
+	// Parameters are only stored in the file on frames where they changed; in memory every
+	// frame carries the values in effect.
+	ReplayParameters Parameters;
+};
+
+struct ReplayFile
+{
+	// Every replayed frame advances the simulation by exactly this much.
+	float FixedTimeStep = 1.0f / 60.0f;
+	std::vector<ReplayFrame> Frames;
+};
+
+// Binary format: a header, then per frame the camera pose, the seed, a flags byte and the
+// parameters when they changed. Values are stored in host byte order.
+bool WriteReplay(std::ostream& out, const ReplayFile& replay);
+bool ReadReplay(std::istream& in, ReplayFile& replay);
+bool SaveReplay(const std::string& path, const ReplayFile& replay);
+bool LoadReplay(const std::string& path, ReplayFile& replay);
+
+// Frame times collected while a replay plays back. Written in the same JSON shape as the
+// benchmark executable, so runs can be compared with the same tools.
+class FrameTimeReport
+{
+public:
+	void Reset(size_t expectedFrames);
+
+	// intervalMs is the wall time since the previous frame began, cpuMs the update and draw
+	// work, gpuMs the most recent GPU frame time, which lags a few frames behind.
+	void AddFrame(double intervalMs, double cpuMs, double gpuMs);
+	size_t FrameCount() const { return m_IntervalMs.size(); }
+
+	void WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context) const;
+	bool WriteJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& context) const;
+
+private:
+	std::vector<double> m_IntervalMs;
+	std::vector<double> m_CpuMs;
+	std::vector<double> m_GpuMs;
+};
@@ -0,0 +1,50 @@
+#include "SampleStats.h"
+#include "Json.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+SampleStats ComputeSampleStats(const std::vector<double>& samplesMs)
+{
+	SampleStats stats;
+	size_t count = samplesMs.size();
+	if (count == 0)
+		return stats;
+
+	std::vector<double> sorted = samplesMs;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double p) { return sorted[std::min(count - 1, (size_t)(p * (count - 1) + 0.5))]; };
+
+	stats.Count = count;
+	stats.MinMs = sorted.front();
+	stats.MaxMs = sorted.back();
+	stats.MedianMs = count % 2 ? sorted[count / 2] : 0.5 * (sorted[count / 2 - 1] + sorted[count / 2]);
+	stats.MeanMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / count;
+	stats.P95Ms = percentile(0.95);
+	stats.P99Ms = percentile(0.99);
+
+	double variance = 0.0;
+	for (double sample : sorted)
+		variance += (sample - stats.MeanMs) * (sample - stats.MeanMs);
+	stats.StdDevMs = count > 1 ? std::sqrt(variance / (count - 1)) : 0.0;
+	return stats;
+}
+
+void WriteSampleStatsJson(std::ostream& out, std::string_view name, const SampleStats& stats, const std::vector<double>& samplesMs)
+{
+	out << "\"name\": ";
+	WriteJsonString(out, name);
+	out << ", \"repetitions\": " << stats.Count
+		<< ", \"min_ms\": " << stats.MinMs
+		<< ", \"median_ms\": " << stats.MedianMs
+		<< ", \"mean_ms\": " << stats.MeanMs
+		<< ", \"max_ms\": " << stats.MaxMs
+		<< ", \"stddev_ms\": " << stats.StdDevMs
+		<< ", \"p95_ms\": " << stats.P95Ms
+		<< ", \"p99_ms\": " << stats.P99Ms;
+
+	out << ", \"samples_ms\": [";
+	for (size_t i = 0; i < samplesMs.size(); i++)
+		out << (i ? ", " : "") << samplesMs[i];
+	out << "]";
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Summary of a series of timings, as the benchmark and replay results report it.
+struct SampleStats
+{
+	size_t Count = 0;
+	double MinMs = 0.0;
+	double MedianMs = 0.0;
+	double MeanMs = 0.0;
+	double MaxMs = 0.0;
+	double StdDevMs = 0.0;
+	double P95Ms = 0.0;
+	double P99Ms = 0.0;
+};
+
+// All zero for no samples. The median of an even count is the mean of the middle two; the
+// other percentiles are the nearest sample.
+SampleStats ComputeSampleStats(const std::vector<double>& samplesMs);
+
+// Writes the members of one entry of a results file, without the braces, so callers can add
+// their own: name, repetitions, the statistics and every sample in the order given.
+void WriteSampleStatsJson(std::ostream& out, std::string_view name, const SampleStats& stats, const std::vector<double>& samplesMs);
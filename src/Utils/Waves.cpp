@@ -2,16 +2,19 @@
 // Waves.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <ppl.h>
 #include <algorithm>
 #include <vector>
 #include <cassert>
 #include "Waves.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 
 using namespace DirectX;
 
-Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
+Waves::Waves(int m, int n, float dx, float dt, float speed, float damping, JobSystem& jobs)
 {
+	mJobs = &jobs;
+
 	mNumRows = m;
 	mNumCols = n;
 
@@ -87,36 +90,38 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
-	static float t = 0;
+	PROFILE_FUNCTION();
 
 	// Accumulate time.
-	t += dt;
+	mAccumulatedTime += dt;
 
 	// Only update the simulation at the specified time step.
-	if (t >= mTimeStep)
+	if (mAccumulatedTime >= mTimeStep)
 	{
 		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-			//for(int i = 1; i < mNumRows-1; ++i)
+		mJobs->ParallelFor(1, mNumRows - 1, RowGrainSize, [this](uint32_t begin, uint32_t end)
 			{
-				for (int j = 1; j < mNumCols - 1; ++j)
+				for (int i = (int)begin; i < (int)end; ++i)
 				{
-					// After this update we will be discarding the old previous
-					// buffer, so overwrite that buffer with the new update.
-					// Note how we can do this inplace (read/write to same element) 
-					// because we won't need prev_ij again and the assignment happens last.
-
-					// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-					// Moreover, our +z axis goes "down"; this is just to 
-					// keep consistent with our row indices going down.
-
-					mPrevSolution[i * mNumCols + j].y =
-						mK1 * mPrevSolution[i * mNumCols + j].y +
-						mK2 * mCurrSolution[i * mNumCols + j].y +
-						mK3 * (mCurrSolution[(i + 1) * mNumCols + j].y +
-							mCurrSolution[(i - 1) * mNumCols + j].y +
-							mCurrSolution[i * mNumCols + j + 1].y +
-							mCurrSolution[i * mNumCols + j - 1].y);
+					for (int j = 1; j < mNumCols - 1; ++j)
+					{
+						// After this update we will be discarding the old previous
+						// buffer, so overwrite that buffer with the new update.
+						// Note how we can do this inplace (read/write to same element) 
+						// because we won't need prev_ij again and the assignment happens last.
+
+						// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+						// Moreover, our +z axis goes "down"; this is just to 
+						// keep consistent with our row indices going down.
+
+						mPrevSolution[i * mNumCols + j].y =
+							mK1 * mPrevSolution[i * mNumCols + j].y +
+							mK2 * mCurrSolution[i * mNumCols + j].y +
+							mK3 * (mCurrSolution[(i + 1) * mNumCols + j].y +
+								mCurrSolution[(i - 1) * mNumCols + j].y +
+								mCurrSolution[i * mNumCols + j + 1].y +
+								mCurrSolution[i * mNumCols + j - 1].y);
+					}
 				}
 			});
 
@@ -125,30 +130,32 @@ void Waves::Update(float dt)
 		// current solution becomes the new previous solution.
 		std::swap(mPrevSolution, mCurrSolution);
 
-		t = 0.0f; // reset time
+		mAccumulatedTime = 0.0f; // reset time
 
 		//
 		// Compute normals using finite difference scheme.
 		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-			//for(int i = 1; i < mNumRows - 1; ++i)
+		mJobs->ParallelFor(1, mNumRows - 1, RowGrainSize, [this](uint32_t begin, uint32_t end)
 			{
-				for (int j = 1; j < mNumCols - 1; ++j)
+				for (int i = (int)begin; i < (int)end; ++i)
 				{
-					float l = mCurrSolution[i * mNumCols + j - 1].y;
-					float r = mCurrSolution[i * mNumCols + j + 1].y;
-					float t = mCurrSolution[(i - 1) * mNumCols + j].y;
-					float b = mCurrSolution[(i + 1) * mNumCols + j].y;
-					mNormals[i * mNumCols + j].x = -r + l;
-					mNormals[i * mNumCols + j].y = 2.0f * mSpatialStep;
-					mNormals[i * mNumCols + j].z = b - t;
-
-					XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&mNormals[i * mNumCols + j]));
-					XMStoreFloat3(&mNormals[i * mNumCols + j], n);
-
-					mTangentX[i * mNumCols + j] = XMFLOAT3(2.0f * mSpatialStep, r - l, 0.0f);
-					XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i * mNumCols + j]));
-					XMStoreFloat3(&mTangentX[i * mNumCols + j], T);
+					for (int j = 1; j < mNumCols - 1; ++j)
+					{
+						float l = mCurrSolution[i * mNumCols + j - 1].y;
+						float r = mCurrSolution[i * mNumCols + j + 1].y;
+						float t = mCurrSolution[(i - 1) * mNumCols + j].y;
+						float b = mCurrSolution[(i + 1) * mNumCols + j].y;
+						mNormals[i * mNumCols + j].x = -r + l;
+						mNormals[i * mNumCols + j].y = 2.0f * mSpatialStep;
+						mNormals[i * mNumCols + j].z = b - t;
+
+						XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&mNormals[i * mNumCols + j]));
+						XMStoreFloat3(&mNormals[i * mNumCols + j], n);
+
+						mTangentX[i * mNumCols + j] = XMFLOAT3(2.0f * mSpatialStep, r - l, 0.0f);
+						XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i * mNumCols + j]));
+						XMStoreFloat3(&mTangentX[i * mNumCols + j], T);
+					}
 				}
 			});
 	}
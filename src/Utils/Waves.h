@@ -3,10 +3,13 @@
 #include <vector>
 #include <DirectXMath.h>
 
+class JobSystem;
+
 class Waves
 {
 public:
-    Waves(int m, int n, float dx, float dt, float speed, float damping);
+    // Rows of the solver are updated in parallel on jobs.
+    Waves(int m, int n, float dx, float dt, float speed, float damping, JobSystem& jobs);
     Waves(const Waves& rhs) = delete;
     Waves& operator=(const Waves& rhs) = delete;
     ~Waves();
@@ -42,9 +45,17 @@ private:
     float mK2 = 0.0f;
     float mK3 = 0.0f;
 
+    // Rows per job in the solver and normal passes.
+    static const int RowGrainSize = 8;
+
+    JobSystem* mJobs = nullptr;
+
     float mTimeStep = 0.0f;
     float mSpatialStep = 0.0f;
 
+    // Time since the last step, per instance so a fresh simulation always starts from zero.
+    float mAccumulatedTime = 0.0f;
+
     std::vector<DirectX::XMFLOAT3> mPrevSolution;
     std::vector<DirectX::XMFLOAT3> mCurrSolution;
     std::vector<DirectX::XMFLOAT3> mNormals;
@@ -1,10 +1,117 @@
 
 #include "d3dUtil.h"
 #include <comdef.h>
+#include <atomic>
 #include <fstream>
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    // {5C6D0F3A-8E21-4B7C-9A43-1F6E2D8B7C05}
+    const GUID GpuMemoryTokenGuid = { 0x5c6d0f3a, 0x8e21, 0x4b7c, { 0x9a, 0x43, 0x1f, 0x6e, 0x2d, 0x8b, 0x7c, 0x05 } };
+
+    // Attached to a D3D12 object as private data; the object releases it when it is destroyed,
+    // which is when its memory is given back.
+    class GpuMemoryToken final : public IUnknown
+    {
+    public:
+        GpuMemoryToken(MemoryTag tag, UINT64 byteSize) :
+            mTag(tag),
+            mByteSize(byteSize)
+        {
+            MemoryTracker::Get().OnAllocate(mTag, MemoryDomain::Gpu, mByteSize);
+        }
+
+        ~GpuMemoryToken()
+        {
+            MemoryTracker::Get().OnFree(mTag, MemoryDomain::Gpu, mByteSize);
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (riid != __uuidof(IUnknown))
+            {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+            *object = this;
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            ULONG count = --mRefCount;
+            if (count == 0)
+                delete this;
+            return count;
+        }
+
+    private:
+        std::atomic<ULONG> mRefCount = 1;
+        MemoryTag mTag;
+        UINT64 mByteSize;
+    };
+
+    void AttachGpuMemoryToken(ID3D12Object* object, MemoryTag tag, UINT64 byteSize)
+    {
+        ComPtr<GpuMemoryToken> token;
+        token.Attach(new GpuMemoryToken(tag, byteSize));
+        ThrowIfFailed(object->SetPrivateDataInterface(GpuMemoryTokenGuid, token.Get()));
+    }
+
+    class TrackedBlob final : public ID3DBlob
+    {
+    public:
+        TrackedBlob(SIZE_T byteSize, MemoryTag tag) :
+            mData(new BYTE[byteSize]),
+            mByteSize(byteSize),
+            mTag(tag)
+        {
+            MemoryTracker::Get().OnAllocate(mTag, MemoryDomain::Cpu, mByteSize);
+        }
+
+        ~TrackedBlob()
+        {
+            MemoryTracker::Get().OnFree(mTag, MemoryDomain::Cpu, mByteSize);
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (riid != __uuidof(IUnknown) && riid != __uuidof(ID3DBlob))
+            {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+            *object = static_cast<ID3DBlob*>(this);
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            ULONG count = --mRefCount;
+            if (count == 0)
+                delete this;
+            return count;
+        }
+
+        LPVOID STDMETHODCALLTYPE GetBufferPointer() override { return mData.get(); }
+        SIZE_T STDMETHODCALLTYPE GetBufferSize() override { return mByteSize; }
+
+    private:
+        std::atomic<ULONG> mRefCount = 1;
+        std::unique_ptr<BYTE[]> mData;
+        SIZE_T mByteSize;
+        MemoryTag mTag;
+    };
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -40,7 +147,8 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     ID3D12GraphicsCommandList* cmdList,
     const void* initData,
     UINT64 byteSize,
-    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+    Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+    MemoryTag tag)
 {
     ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -63,6 +171,8 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
         nullptr,
         IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
 
+    TrackGpuMemory(defaultBuffer.Get(), tag);
+    TrackGpuMemory(uploadBuffer.Get(), MemoryTag::Upload);
 
     // Describe the data we want to copy into the default buffer.
     D3D12_SUBRESOURCE_DATA subResourceData = {};
@@ -87,16 +197,44 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     return defaultBuffer;
 }
 
+void d3dUtil::TrackGpuMemory(ID3D12Resource* resource, MemoryTag tag)
+{
+    ComPtr<ID3D12Device> device;
+    ThrowIfFailed(resource->GetDevice(IID_PPV_ARGS(device.GetAddressOf())));
+
+    D3D12_RESOURCE_DESC desc = resource->GetDesc();
+    D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+    AttachGpuMemoryToken(resource, tag, info.SizeInBytes);
+}
+
+void d3dUtil::TrackGpuMemory(ID3D12Heap* heap, MemoryTag tag)
+{
+    AttachGpuMemoryToken(heap, tag, heap->GetDesc().SizeInBytes);
+}
+
+ComPtr<ID3DBlob> d3dUtil::CreateTrackedBlob(SIZE_T byteSize, MemoryTag tag)
+{
+    ComPtr<ID3DBlob> blob;
+    blob.Attach(new TrackedBlob(byteSize, tag));
+    return blob;
+}
+
+UINT d3dUtil::ShaderCompileFlags()
+{
+    UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+    return compileFlags;
+}
+
 ComPtr<ID3DBlob> d3dUtil::CompileShader(
     const std::wstring& filename,
     const D3D_SHADER_MACRO* defines,
     const std::string& entrypoint,
     const std::string& target)
 {
-    UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)  
-    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+    UINT compileFlags = ShaderCompileFlags();
 
     HRESULT hr = S_OK;
 
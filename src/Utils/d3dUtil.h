@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "MemoryTracker.h"
 
 extern const int gNumFrameResources;
 
@@ -119,7 +120,19 @@ public:
         ID3D12GraphicsCommandList* cmdList,
         const void* initData,
         UINT64 byteSize,
-        Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+        Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+        MemoryTag tag = MemoryTag::Geometry);
+
+    // Counts the memory of a committed resource or a heap under tag until the object is
+    // destroyed. Tracking an object again moves it to the new tag.
+    static void TrackGpuMemory(ID3D12Resource* resource, MemoryTag tag);
+    static void TrackGpuMemory(ID3D12Heap* heap, MemoryTag tag);
+
+    // Like D3DCreateBlob, but the blob's memory is counted under tag.
+    static Microsoft::WRL::ComPtr<ID3DBlob> CreateTrackedBlob(SIZE_T byteSize, MemoryTag tag);
+
+    // Flags CompileShader passes to the compiler; part of every shader cache key.
+    static UINT ShaderCompileFlags();
 
     static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
         const std::wstring& filename,
@@ -1,11 +1,35 @@
 #include <Windows.h>
 #include "Application.h"
+#include <filesystem>
+#include <shellapi.h>
 
 int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
 	
 	try {
 		Application* app = new Application();
+
+		// --replay <file> [--report <file>] plays a recorded camera path, writes its frame-time
+		// report and exits, so runs can be scripted and compared.
+		int argc = 0;
+		LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+		std::string replayPath;
+		std::string reportPath = "replay_report.json";
+		for (int i = 1; argv && i + 1 < argc; i++)
+		{
+			if (wcscmp(argv[i], L"--replay") == 0)
+				replayPath = std::filesystem::path(argv[++i]).string();
+			else if (wcscmp(argv[i], L"--report") == 0)
+				reportPath = std::filesystem::path(argv[++i]).string();
+		}
+		LocalFree(argv);
+
+		if (!replayPath.empty() && !app->PlayReplay(replayPath, reportPath, true))
+		{
+			MessageBoxA(nullptr, ("Could not load replay " + replayPath).c_str(), "Replay", MB_OK);
+			delete app;
+			return 1;
+		}
 		app->Run();
 		delete app;
 		return 0;
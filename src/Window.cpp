@@ -101,14 +101,7 @@ void Window::OnUpdate()
 
 void Window::SetVSync(bool enabled)
 {
-	if (enabled)
-	{
-
-	}
-	else
-	{
-
-	}
+	// Application passes this on to the renderer, which applies it when presenting.
 	m_Data.VSync = enabled;
 }
 
@@ -174,10 +167,11 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		Window* const p_Wnd = reinterpret_cast<Window*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
 		WindowData& data = p_Wnd->m_Data;
 
+		// Sent rather than posted: the quit message below ends the loop before the next drain.
 		WindowCloseEvent event;
-		if (data.EventCallback != nullptr)
+		if (data.Events != nullptr)
 		{
-			data.EventCallback(event);
+			data.Events->Send(event);
 		}
 		PostQuitMessage(0);
 		break;
@@ -205,9 +199,9 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		WindowData& data = p_Wnd->m_Data;
 
 		KeyPressedEvent event((int)wParam, 0);
-		if (data.EventCallback != nullptr)
+		if (data.Events != nullptr)
 		{
-			data.EventCallback(event);
+			data.Events->Post(event);
 		}
 		break;
 	}
@@ -221,9 +215,9 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		WindowData& data = p_Wnd->m_Data;
 
 		KeyReleasedEvent event((int)wParam);
-		if (data.EventCallback != nullptr)
+		if (data.Events != nullptr)
 		{
-			data.EventCallback(event);
+			data.Events->Post(event);
 		}
 		break;
 	}
@@ -251,6 +245,10 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		return 0;
 	case WM_MOUSEMOVE:
 		OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		if (m_Data.Events != nullptr)
+		{
+			m_Data.Events->Post(MouseMovedEvent((float)GET_X_LPARAM(lParam), (float)GET_Y_LPARAM(lParam)));
+		}
 		return 0;
 	case WM_MOVE:
 	{
@@ -265,9 +263,9 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		WindowData& data = p_Wnd->m_Data;
 
 		MouseScrolledEvent event(pt.x, pt.y);
-		if (data.EventCallback != nullptr)
+		if (data.Events != nullptr)
 		{
-			data.EventCallback(event);
+			data.Events->Post(event);
 		}
 		const int delta = GET_WHEEL_DELTA_WPARAM(wParam);
 		input.OnWheelDelta(delta);
@@ -286,9 +284,9 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		data.Height = height;
 
 		WindowResizeEvent event(width, height);
-		if (data.EventCallback != nullptr)
+		if (data.Events != nullptr)
 		{
-			data.EventCallback(event);
+			data.Events->Post(event);
 		}
 		break;
 	}
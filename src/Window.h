@@ -1,7 +1,7 @@
 #pragma once
 #include <Windows.h>
 #include <optional>
-#include "Events/Event.h"
+#include "Events/EventBus.h"
 #include "Input.h"
 #include "Utils/GameTimer.h"
 #include "Camera.h"
@@ -24,9 +24,6 @@ struct WindowProps
 
 class Window
 {
-public:
-	using EventCallbackFn = std::function<void(Event&)>;
-
 private:
 	class WindowClass
 	{
@@ -52,7 +49,8 @@ public:
 	inline unsigned int GetWidth() const { return m_Data.Width; }
 	inline unsigned int GetHeight() const { return m_Data.Height; }
 
-	inline void SetEventCallback(const EventCallbackFn& callback) { m_Data.EventCallback = callback; }
+	// Input and window events go to events; most are queued until its next Drain.
+	inline void SetEventBus(EventBus* events) { m_Data.Events = events; }
 	void SetVSync(bool enabled);
 	bool IsVSync() const;
 	static std::optional<int> ProcessMessages();
@@ -69,7 +67,7 @@ private:
 		unsigned int Width, Height;
 		bool VSync;
 
-		EventCallbackFn EventCallback;
+		EventBus* Events = nullptr;
 	};
 
 	void Init(const WindowProps& props = WindowProps());
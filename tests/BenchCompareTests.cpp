@@ -0,0 +1,120 @@
+#include "TestHarness.h"
+#include "../bench/BenchCompare.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Samples around median with a little spread, so the bootstrap has noise to work with.
+	std::vector<double> Samples(double median)
+	{
+		return { median * 0.99, median * 1.01, median, median * 0.995, median * 1.005, median };
+	}
+
+	const BenchComparison* Find(const std::vector<BenchComparison>& comparisons, const std::string& name)
+	{
+		for (const BenchComparison& c : comparisons)
+		{
+			if (c.Name == name)
+				return &c;
+		}
+		return nullptr;
+	}
+}
+
+TEST_CASE(BenchCompare, VerdictsFollowThresholdAndInterval)
+{
+	BenchRun baseline;
+	baseline.SamplesMs["same"] = Samples(10.0);
+	baseline.SamplesMs["slower"] = Samples(10.0);
+	baseline.SamplesMs["faster"] = Samples(10.0);
+	baseline.SamplesMs["slightly_slower"] = Samples(10.0);
+	baseline.SamplesMs["dropped"] = Samples(10.0);
+
+	BenchRun candidate;
+	candidate.SamplesMs["same"] = Samples(10.0);
+	candidate.SamplesMs["slower"] = Samples(12.0);
+	candidate.SamplesMs["faster"] = Samples(8.0);
+	candidate.SamplesMs["slightly_slower"] = Samples(10.2);
+	candidate.SamplesMs["added"] = Samples(5.0);
+
+	std::vector<BenchComparison> comparisons = CompareRuns(baseline, candidate, CompareOptions());
+	REQUIRE(comparisons.size() == 6);
+	CHECK(Find(comparisons, "same")->Verdict == CompareVerdict::Unchanged);
+	CHECK(Find(comparisons, "slower")->Verdict == CompareVerdict::Regressed);
+	CHECK(Find(comparisons, "faster")->Verdict == CompareVerdict::Improved);
+	CHECK(Find(comparisons, "slightly_slower")->Verdict == CompareVerdict::Unchanged);
+	CHECK(Find(comparisons, "dropped")->Verdict == CompareVerdict::Missing);
+	CHECK(Find(comparisons, "added")->Verdict == CompareVerdict::New);
+	CHECK(Find(comparisons, "slower")->HasInterval);
+	CHECK_EQ(Find(comparisons, "slower")->Ratio, 1.2);
+}
+
+TEST_CASE(BenchCompare, NoisyRunIsNotARegression)
+{
+	BenchRun baseline;
+	baseline.SamplesMs["noisy"] = { 10.0, 10.0, 10.0, 30.0, 10.0 };
+	BenchRun candidate;
+	candidate.SamplesMs["noisy"] = { 10.0, 30.0, 30.0, 10.0, 12.0 };
+
+	std::vector<BenchComparison> comparisons = CompareRuns(baseline, candidate, CompareOptions());
+	REQUIRE(comparisons.size() == 1);
+	CHECK(comparisons[0].Ratio > 1.05);
+	CHECK(comparisons[0].Verdict == CompareVerdict::Unchanged);
+}
+
+TEST_CASE(BenchCompare, MissingFailsUnlessAllowed)
+{
+	BenchComparison missing;
+	missing.Verdict = CompareVerdict::Missing;
+	BenchComparison regressed;
+	regressed.Verdict = CompareVerdict::Regressed;
+	BenchComparison added;
+	added.Verdict = CompareVerdict::New;
+
+	CompareOptions options;
+	CHECK(FailsCheck(missing, options));
+	CHECK(FailsCheck(regressed, options));
+	CHECK(!FailsCheck(added, options));
+
+	options.AllowMissing = true;
+	CHECK(!FailsCheck(missing, options));
+	CHECK(FailsCheck(regressed, options));
+}
+
+TEST_CASE(BenchCompare, LoadsAndPoolsResultFiles)
+{
+	TempDirectory dir;
+	std::filesystem::path first = dir.WriteFile("run1.json",
+		"{\"context\": {\"compiler\": \"gcc\"}, \"results\": ["
+		"{\"name\": \"a\", \"median_ms\": 2, \"samples_ms\": [1, 2, 3]},"
+		"{\"name\": \"summary_only\", \"median_ms\": 7}]}");
+	std::filesystem::path second = dir.WriteFile("run2.json",
+		"{\"context\": {\"compiler\": \"clang\"}, \"results\": [{\"name\": \"a\", \"samples_ms\": [4]}]}");
+
+	BenchRun run;
+	std::string error;
+	REQUIRE(LoadBenchRun(first.string(), run, error));
+	REQUIRE(LoadBenchRun(second.string(), run, error));
+
+	REQUIRE(run.Context.size() == 1);
+	CHECK_EQ(run.Context[0].second, std::string("gcc"));
+	CHECK(run.SamplesMs["a"] == std::vector<double>({ 1.0, 2.0, 3.0, 4.0 }));
+	CHECK(run.SamplesMs["summary_only"] == std::vector<double>({ 7.0 }));
+}
+
+TEST_CASE(BenchCompare, ReportsUnreadableFiles)
+{
+	TempDirectory dir;
+	BenchRun run;
+	std::string error;
+	CHECK(!LoadBenchRun((dir.Path() / "absent.json").string(), run, error));
+	CHECK(error.find("cannot read") != std::string::npos);
+
+	std::filesystem::path broken = dir.WriteFile("broken.json", "{\"results\": [");
+	CHECK(!LoadBenchRun(broken.string(), run, error));
+	CHECK(error.find("broken.json") != std::string::npos);
+
+	std::filesystem::path empty = dir.WriteFile("empty.json", "{}");
+	CHECK(!LoadBenchRun(empty.string(), run, error));
+}
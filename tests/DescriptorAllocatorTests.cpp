@@ -0,0 +1,129 @@
+#include "TestHarness.h"
+#include "../src/Renderer/DescriptorAllocator.h"
+
+TEST_CASE(DescriptorAllocator, HandsOutLowIndicesFirst)
+{
+	DescriptorAllocator allocator(4);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		DescriptorHandle handle = allocator.Allocate();
+		REQUIRE(handle.IsValid());
+		CHECK_EQ(handle.Index, i);
+		CHECK_EQ(handle.Generation, 0u);
+		CHECK(allocator.IsAlive(handle));
+	}
+	CHECK_EQ(allocator.AllocatedCount(), 4u);
+}
+
+TEST_CASE(DescriptorAllocator, ReturnsInvalidWhenFull)
+{
+	DescriptorAllocator allocator(2);
+	allocator.Allocate();
+	allocator.Allocate();
+
+	DescriptorHandle handle = allocator.Allocate();
+	CHECK(!handle.IsValid());
+	CHECK(!allocator.IsAlive(handle));
+	CHECK_EQ(allocator.AllocatedCount(), 2u);
+}
+
+TEST_CASE(DescriptorAllocator, FreedSlotWaitsForItsFence)
+{
+	DescriptorAllocator allocator(1);
+	DescriptorHandle first = allocator.Allocate();
+	allocator.Free(first, 10);
+
+	CHECK_EQ(allocator.AllocatedCount(), 0u);
+	CHECK_EQ(allocator.PendingFreeCount(), 1u);
+	CHECK(!allocator.Allocate().IsValid());
+
+	allocator.CollectFrees(9);
+	CHECK_EQ(allocator.PendingFreeCount(), 1u);
+	CHECK(!allocator.Allocate().IsValid());
+
+	allocator.CollectFrees(10);
+	CHECK_EQ(allocator.PendingFreeCount(), 0u);
+	DescriptorHandle second = allocator.Allocate();
+	REQUIRE(second.IsValid());
+	CHECK_EQ(second.Index, first.Index);
+	CHECK_EQ(second.Generation, first.Generation + 1);
+}
+
+TEST_CASE(DescriptorAllocator, CollectsFreesInFenceOrder)
+{
+	DescriptorAllocator allocator(3);
+	DescriptorHandle a = allocator.Allocate();
+	DescriptorHandle b = allocator.Allocate();
+	DescriptorHandle c = allocator.Allocate();
+	allocator.Free(a, 1);
+	allocator.Free(b, 2);
+	allocator.Free(c, 3);
+
+	allocator.CollectFrees(2);
+	CHECK_EQ(allocator.PendingFreeCount(), 1u);
+	CHECK(allocator.Allocate().IsValid());
+	CHECK(allocator.Allocate().IsValid());
+	CHECK(!allocator.Allocate().IsValid());
+}
+
+TEST_CASE(DescriptorAllocator, RejectsStaleHandles)
+{
+	DescriptorAllocator allocator(1);
+	DescriptorHandle stale = allocator.Allocate();
+	allocator.Free(stale, 1);
+
+	// Rejected as soon as it is freed, before the slot is recycled.
+	CHECK(!allocator.IsAlive(stale));
+
+	allocator.CollectFrees(1);
+	DescriptorHandle fresh = allocator.Allocate();
+	CHECK(allocator.IsAlive(fresh));
+	CHECK(!allocator.IsAlive(stale));
+
+	// Freeing the stale handle again must not release the slot's new owner.
+	allocator.Free(stale, 2);
+	CHECK(allocator.IsAlive(fresh));
+	CHECK_EQ(allocator.PendingFreeCount(), 0u);
+	CHECK_EQ(allocator.AllocatedCount(), 1u);
+}
+
+TEST_CASE(DescriptorAllocator, IgnoresInvalidHandles)
+{
+	DescriptorAllocator allocator(2);
+	allocator.Free(DescriptorHandle(), 1);
+
+	DescriptorHandle outOfRange;
+	outOfRange.Index = 7;
+	allocator.Free(outOfRange, 1);
+
+	CHECK_EQ(allocator.PendingFreeCount(), 0u);
+	CHECK(!allocator.IsAlive(outOfRange));
+}
+
+TEST_CASE(DescriptorAllocator, HandleAtReturnsCurrentOwner)
+{
+	DescriptorAllocator allocator(2);
+	DescriptorHandle handle = allocator.Allocate();
+	CHECK(allocator.HandleAt(handle.Index) == handle);
+	CHECK(!allocator.HandleAt(1).IsValid());
+	CHECK(!allocator.HandleAt(5).IsValid());
+
+	allocator.Free(handle, 1);
+	CHECK(!allocator.HandleAt(handle.Index).IsValid());
+}
+
+TEST_CASE(DescriptorAllocator, TracksHighWaterMark)
+{
+	DescriptorAllocator allocator(4);
+	DescriptorHandle a = allocator.Allocate();
+	DescriptorHandle b = allocator.Allocate();
+	DescriptorHandle c = allocator.Allocate();
+	allocator.Free(a, 1);
+	allocator.Free(b, 1);
+	allocator.CollectFrees(1);
+	allocator.Allocate();
+
+	CHECK_EQ(allocator.HighWaterMark(), 3u);
+	CHECK_EQ(allocator.AllocatedCount(), 2u);
+	CHECK(allocator.IsAlive(c));
+}
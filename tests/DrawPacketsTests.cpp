@@ -0,0 +1,195 @@
+#include "TestHarness.h"
+#include "../src/Renderer/DrawPackets.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Deterministic 64-bit keys without pulling in <random>'s distributions.
+	uint64_t NextKey(uint64_t& state)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return state ^ (state >> 29);
+	}
+
+	bool SortsLikeStdSort(std::vector<uint64_t> keys, uint32_t firstByte = 0)
+	{
+		std::vector<uint64_t> expected = keys;
+		std::sort(expected.begin(), expected.end());
+
+		std::vector<uint64_t> scratch;
+		RadixSortKeys(keys, scratch, firstByte);
+		return keys == expected;
+	}
+
+	DrawPacket Packet(uint32_t index, uint32_t pipeline, uint32_t geometry, uint32_t material)
+	{
+		DrawPacket packet;
+		packet.Pipeline = pipeline;
+		packet.Geometry = geometry;
+		packet.MaterialConstants = material;
+		packet.ObjectConstants = index;
+		packet.IndexCount = 3 * (index + 1);
+		packet.SortKey = DrawSortKey::Make(pipeline, geometry, material, index);
+		return packet;
+	}
+
+	// Writes one letter per call: P(ipeline), G(eometry), T(opology), O(bject), M(aterial),
+	// D(raw).
+	class RecordingSink : public DrawPacketSink
+	{
+	public:
+		void SetPipeline(uint32_t) override { Calls += 'P'; }
+		void SetGeometry(uint32_t) override { Calls += 'G'; }
+		void SetTopology(uint32_t) override { Calls += 'T'; }
+		void SetObjectConstants(uint32_t) override { Calls += 'O'; }
+		void SetMaterialConstants(uint32_t) override { Calls += 'M'; }
+		void Draw(const DrawPacket&) override { Calls += 'D'; }
+
+		std::string Calls;
+	};
+}
+
+TEST_CASE(DrawPackets, RadixSortMatchesStdSort)
+{
+	uint64_t state = 12345;
+	for (size_t count : { 0, 1, 2, 3, 17, 256, 1000 })
+	{
+		std::vector<uint64_t> keys;
+		for (size_t i = 0; i < count; i++)
+			keys.push_back(NextKey(state));
+		CHECK(SortsLikeStdSort(keys));
+	}
+}
+
+TEST_CASE(DrawPackets, RadixSortSkipsUniformBytes)
+{
+	// Only byte 3 differs: one pass runs, so the result lands in scratch and has to be
+	// swapped back. With bytes 0 and 7 differing, two passes run and it does not.
+	std::vector<uint64_t> oneByte;
+	std::vector<uint64_t> twoBytes;
+	uint64_t state = 99;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		uint64_t r = NextKey(state);
+		oneByte.push_back(0x1122334400667788ull | ((r & 0xff) << 24));
+		twoBytes.push_back(0x0011223344556600ull | (r & 0xff) | ((r >> 8 & 0xff) << 56));
+	}
+	CHECK(SortsLikeStdSort(oneByte));
+	CHECK(SortsLikeStdSort(twoBytes));
+
+	// Every byte the same: nothing moves.
+	CHECK(SortsLikeStdSort(std::vector<uint64_t>(10, 0xabcdef0123456789ull)));
+}
+
+TEST_CASE(DrawPackets, RadixSortFromByteFourIsStable)
+{
+	// The upper halves collide, and the lower halves are deliberately out of order: sorting
+	// from byte 4 must order by the upper half and keep the input order within each.
+	std::vector<uint64_t> keys;
+	const uint64_t uppers[] = { 3, 1, 2, 1, 3, 2, 1 };
+	for (uint32_t i = 0; i < 7; i++)
+		keys.push_back((uppers[i] << 32) | (100 - i));
+
+	std::vector<uint64_t> scratch;
+	RadixSortKeys(keys, scratch, 4);
+
+	const uint64_t expected[] = {
+		(1ull << 32) | 99, (1ull << 32) | 97, (1ull << 32) | 94,
+		(2ull << 32) | 98, (2ull << 32) | 95,
+		(3ull << 32) | 100, (3ull << 32) | 96,
+	};
+	REQUIRE(keys.size() == 7);
+	for (uint32_t i = 0; i < 7; i++)
+		CHECK_EQ(keys[i], expected[i]);
+}
+
+TEST_CASE(DrawPackets, SortOrdersByPipelineGeometryMaterial)
+{
+	std::vector<DrawPacket> packets = {
+		Packet(0, 2, 0, 0),
+		Packet(1, 1, 5, 3),
+		Packet(2, 1, 2, 9),
+		Packet(3, 2, 0, 0),
+		Packet(4, 1, 2, 4),
+		Packet(5, 0, 7, 7),
+		Packet(6, 1, 5, 3),
+	};
+
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> scratch;
+	std::vector<DrawPacket> sorted;
+	SortDrawPackets(packets, keys, scratch, sorted);
+
+	// Equal states keep their submission order.
+	const uint32_t expected[] = { 5, 4, 2, 1, 6, 0, 3 };
+	REQUIRE(sorted.size() == packets.size());
+	for (uint32_t i = 0; i < (uint32_t)sorted.size(); i++)
+		CHECK_EQ(sorted[i].ObjectConstants, expected[i]);
+
+	// Ordered keys leave the submission order alone.
+	for (uint32_t i = 0; i < (uint32_t)packets.size(); i++)
+		packets[i].SortKey = DrawSortKey::MakeOrdered(i);
+	SortDrawPackets(packets, keys, scratch, sorted);
+	for (uint32_t i = 0; i < (uint32_t)sorted.size(); i++)
+		CHECK_EQ(sorted[i].ObjectConstants, i);
+}
+
+TEST_CASE(DrawPackets, SubmitSkipsRedundantState)
+{
+	std::vector<DrawPacket> packets = {
+		Packet(0, 1, 0, 4),
+		Packet(1, 1, 0, 4),
+		Packet(2, 1, 1, 4),
+		Packet(3, 2, 1, 5),
+	};
+
+	RecordingSink sink;
+	DrawCallStats stats;
+	SubmitDrawPackets(packets.data(), packets.size(), 1, sink, stats);
+
+	// Pipeline 1 is already bound, and a fresh list has no geometry, topology or constants.
+	// Each packet has its own object constants.
+	CHECK_EQ(sink.Calls, std::string("GTOMD" "OD" "GOD" "POMD"));
+	CHECK_EQ(stats.Draws, 4u);
+	CHECK_EQ(stats.PipelineSets, 1u);
+	CHECK_EQ(stats.VertexBufferSets, 2u);
+	CHECK_EQ(stats.IndexBufferSets, 2u);
+	CHECK_EQ(stats.TopologySets, 1u);
+	CHECK_EQ(stats.RootCbvSets, 6u);
+	CHECK_EQ(stats.Triangles, 1ull + 2 + 3 + 4);
+	CHECK_EQ(stats.UnsortedCalls, 24u);
+	CHECK_EQ(stats.TotalCalls(), 16u);
+
+	// A different bound pipeline has to be replaced first, and stats accumulate.
+	RecordingSink other;
+	SubmitDrawPackets(packets.data(), 1, 0, other, stats);
+	CHECK_EQ(other.Calls, std::string("PGTOMD"));
+	CHECK_EQ(stats.Draws, 5u);
+	CHECK_EQ(stats.PipelineSets, 2u);
+}
+
+TEST_CASE(DrawPackets, SortKeyFieldsStayInTheirBits)
+{
+	const uint32_t maxPipeline = (1u << DrawSortKey::PipelineBits) - 1;
+	const uint32_t maxGeometry = (1u << DrawSortKey::GeometryBits) - 1;
+	const uint32_t maxMaterial = (1u << DrawSortKey::MaterialBits) - 1;
+
+	uint64_t all = DrawSortKey::Make(maxPipeline, maxGeometry, maxMaterial, UINT32_MAX);
+	CHECK_EQ(all, UINT64_MAX);
+	CHECK_EQ(DrawSortKey::Index(all), UINT32_MAX);
+
+	// Each field at its limit sets exactly its own bits.
+	CHECK_EQ(DrawSortKey::Make(maxPipeline, 0, 0, 0), 0xff00000000000000ull);
+	CHECK_EQ(DrawSortKey::Make(0, maxGeometry, 0, 0), 0x00fff00000000000ull);
+	CHECK_EQ(DrawSortKey::Make(0, 0, maxMaterial, 0), 0x00000fff00000000ull);
+	CHECK_EQ(DrawSortKey::Index(DrawSortKey::Make(1, 2, 3, 42)), 42u);
+
+#ifdef NDEBUG
+	// Past the limit, a field saturates instead of spilling into the one above it.
+	CHECK_EQ(DrawSortKey::Make(0, maxGeometry + 1, 0, 0), DrawSortKey::Make(0, maxGeometry, 0, 0));
+	CHECK_EQ(DrawSortKey::Make(0, 0, maxMaterial + 5, 7), DrawSortKey::Make(0, 0, maxMaterial, 7));
+	CHECK_EQ(DrawSortKey::Make(maxPipeline + 1, 0, 0, 0), DrawSortKey::Make(maxPipeline, 0, 0, 0));
+#endif
+}
@@ -0,0 +1,183 @@
+#include "TestHarness.h"
+#include "../src/Events/EventBus.h"
+#include "../src/Events/KeyEvent.h"
+#include "../src/Events/MouseEvent.h"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	// Records the key codes it sees, in order.
+	struct KeyLog
+	{
+		std::vector<int> Keys;
+		bool Consume = false;
+
+		bool OnKey(KeyPressedEvent& event)
+		{
+			Keys.push_back(event.GetKeyCode());
+			return Consume;
+		}
+	};
+}
+
+TEST_CASE(EventBus, SendStopsAtTheHandlerThatHandles)
+{
+	auto bus = std::make_unique<EventBus>();
+	KeyLog first;
+	KeyLog second;
+	first.Consume = true;
+	bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&first);
+	bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&second);
+
+	KeyPressedEvent event(65, 0);
+	CHECK(bus->Send(event));
+	CHECK_EQ(first.Keys.size(), 1u);
+	CHECK(second.Keys.empty());
+
+	// The type is looked up from the event through the base overload too.
+	first.Consume = false;
+	KeyPressedEvent again(66, 0);
+	Event& base = again;
+	CHECK(!bus->Send(base));
+	CHECK_EQ(second.Keys.size(), 1u);
+}
+
+TEST_CASE(EventBus, TooManyHandlersThrow)
+{
+	auto bus = std::make_unique<EventBus>();
+	std::vector<KeyLog> logs(EventBus::MaxHandlersPerType + 1);
+	for (size_t i = 0; i < EventBus::MaxHandlersPerType; i++)
+		bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&logs[i]);
+
+	bool threw = false;
+	try
+	{
+		bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&logs.back());
+	}
+	catch (const std::length_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	// Other types still have room.
+	auto onMove = [](MouseMovedEvent&) { return false; };
+	bus->Subscribe<MouseMovedEvent>(onMove);
+}
+
+TEST_CASE(EventBus, DrainKeepsPostOrderAndCoalescesMoves)
+{
+	auto bus = std::make_unique<EventBus>();
+	KeyLog keys;
+	bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&keys);
+	std::vector<float> moves;
+	auto onMove = [&moves](MouseMovedEvent& event) { moves.push_back(event.GetMouseX()); return false; };
+	bus->Subscribe<MouseMovedEvent>(onMove);
+
+	bus->Post(KeyPressedEvent(1, 0));
+	bus->Post(MouseMovedEvent(10.0f, 0.0f));
+	bus->Post(MouseMovedEvent(11.0f, 0.0f));
+	bus->Post(MouseMovedEvent(12.0f, 0.0f));
+	bus->Post(KeyPressedEvent(2, 0));
+	bus->Post(MouseMovedEvent(13.0f, 0.0f));
+	CHECK_EQ(bus->Pending(), 4u);
+
+	bus->Drain();
+	CHECK_EQ(bus->Pending(), 0u);
+	CHECK(keys.Keys == std::vector<int>({ 1, 2 }));
+	CHECK(moves == std::vector<float>({ 12.0f, 13.0f }));
+}
+
+TEST_CASE(EventBus, FullQueueDrainsBeforePosting)
+{
+	auto bus = std::make_unique<EventBus>();
+	KeyLog keys;
+	bus->Subscribe<KeyPressedEvent, &KeyLog::OnKey>(&keys);
+
+	for (int i = 0; i < (int)EventBus::QueueCapacity + 10; i++)
+		bus->Post(KeyPressedEvent(i, 0));
+	CHECK_EQ(keys.Keys.size(), EventBus::QueueCapacity);
+	CHECK_EQ(bus->Pending(), 10u);
+
+	bus->Drain();
+	REQUIRE(keys.Keys.size() == EventBus::QueueCapacity + 10);
+	for (int i = 0; i < (int)keys.Keys.size(); i++)
+		CHECK_EQ(keys.Keys[i], i);
+}
+
+TEST_CASE(EventBus, EventsPostedWhileDrainingFollowInOrder)
+{
+	// Every queued key posts a follow-up, so a full queue stays full while it drains; each
+	// follow-up has to take the slot its trigger left to keep the order.
+	auto bus = std::make_unique<EventBus>();
+	std::vector<int> seen;
+	auto onKey = [&](KeyPressedEvent& event)
+		{
+			seen.push_back(event.GetKeyCode());
+			if (event.GetKeyCode() < 1000)
+				bus->Post(KeyPressedEvent(event.GetKeyCode() + 1000, 0));
+			return false;
+		};
+	bus->Subscribe<KeyPressedEvent>(onKey);
+
+	for (int i = 0; i < (int)EventBus::QueueCapacity; i++)
+		bus->Post(KeyPressedEvent(i, 0));
+	bus->Drain();
+
+	REQUIRE(seen.size() == 2 * EventBus::QueueCapacity);
+	for (int i = 0; i < (int)EventBus::QueueCapacity; i++)
+	{
+		CHECK_EQ(seen[i], i);
+		CHECK_EQ(seen[EventBus::QueueCapacity + i], 1000 + i);
+	}
+	CHECK_EQ(bus->OverflowSends(), 0u);
+	CHECK_EQ(bus->Pending(), 0u);
+}
+
+TEST_CASE(EventBus, OverflowWhileDrainingIsSentAndCounted)
+{
+	// One event whose handler posts more than the queue holds while it is being handled.
+	auto bus = std::make_unique<EventBus>();
+	std::vector<int> seen;
+	auto onKey = [&](KeyPressedEvent& event)
+		{
+			seen.push_back(event.GetKeyCode());
+			if (event.GetKeyCode() == 0)
+			{
+				for (int i = 1; i <= (int)EventBus::QueueCapacity + 1; i++)
+					bus->Post(KeyPressedEvent(i, 0));
+			}
+			return false;
+		};
+	bus->Subscribe<KeyPressedEvent>(onKey);
+
+	bus->Post(KeyPressedEvent(0, 0));
+	bus->Drain();
+
+	// The last post does not fit and is sent ahead of the queued ones.
+	CHECK_EQ(bus->OverflowSends(), 1u);
+	REQUIRE(seen.size() == EventBus::QueueCapacity + 2);
+	CHECK_EQ(seen[1], (int)EventBus::QueueCapacity + 1);
+	CHECK_EQ(seen[2], 1);
+	CHECK_EQ(bus->Pending(), 0u);
+}
+
+TEST_CASE(EventBus, DrainInsideAHandlerDoesNothing)
+{
+	auto bus = std::make_unique<EventBus>();
+	std::vector<int> seen;
+	auto onKey = [&](KeyPressedEvent& event)
+		{
+			seen.push_back(event.GetKeyCode());
+			bus->Drain();
+			return false;
+		};
+	bus->Subscribe<KeyPressedEvent>(onKey);
+
+	for (int i = 0; i < 3; i++)
+		bus->Post(KeyPressedEvent(i, 0));
+	bus->Drain();
+	CHECK(seen == std::vector<int>({ 0, 1, 2 }));
+}
@@ -0,0 +1,135 @@
+#include "TestHarness.h"
+#include "../src/Utils/FrameArena.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Counts general-heap allocations made by the test thread while counting is switched on. This
+// replaces operator new for the whole test executable, so it only counts inside the window a
+// test opens with HeapCounter.
+namespace
+{
+	thread_local bool t_CountHeap = false;
+	std::atomic<uint64_t> g_HeapAllocations{ 0 };
+
+	struct HeapCounter
+	{
+		HeapCounter() { g_HeapAllocations = 0; t_CountHeap = true; }
+		~HeapCounter() { t_CountHeap = false; }
+		uint64_t Count() const { return g_HeapAllocations.load(); }
+	};
+}
+
+void* operator new(std::size_t size)
+{
+	if (t_CountHeap)
+		g_HeapAllocations++;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+	struct Vertex
+	{
+		float Position[3];
+		float Normal[3];
+		float TexCoord[2];
+	};
+
+	// Scratch use of one frame, as the renderer does it: sized up front, filled, dropped.
+	void SimulateFrame(uint32_t vertexCount, uint32_t indexCount)
+	{
+		FrameArena::BeginFrame();
+
+		FrameVector<Vertex> vertices;
+		vertices.reserve(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+			vertices.push_back({ { (float)i, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f } });
+
+		FrameVector<uint32_t> indices(indexCount);
+		for (uint32_t i = 0; i < indexCount; i++)
+			indices[i] = i % vertexCount;
+
+		double* weights = static_cast<double*>(FrameArena::ForThread().Allocate(256 * sizeof(double), alignof(double)));
+		weights[255] = 1.0;
+	}
+}
+
+TEST_CASE(FrameArena, CounterSeesHeapAllocations)
+{
+	// Without this, a broken counter would make the steady-state test pass vacuously.
+	HeapCounter counter;
+	std::vector<int>* values = new std::vector<int>(100);
+	delete values;
+	CHECK(counter.Count() >= 2);
+}
+
+TEST_CASE(FrameArena, SteadyStateFramesDoNotTouchTheHeap)
+{
+	// Warm-up grows both halves of the arena to the largest frame.
+	for (int frame = 0; frame < 4; frame++)
+		SimulateFrame(40000, 120000);
+
+	uint64_t allocations;
+	{
+		HeapCounter counter;
+		for (int frame = 0; frame < 16; frame++)
+			SimulateFrame(20000 + frame * 1000, 60000 + frame * 3000);
+		allocations = counter.Count();
+	}
+	CHECK_EQ(allocations, 0u);
+}
+
+TEST_CASE(FrameArena, AllocationsAreAlignedAndDistinct)
+{
+	FrameArena arena(4096);
+	char* a = static_cast<char*>(arena.Allocate(3, 1));
+	char* b = static_cast<char*>(arena.Allocate(64, 64));
+	char* c = static_cast<char*>(arena.Allocate(8, 16));
+	CHECK(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+	CHECK(reinterpret_cast<uintptr_t>(c) % 16 == 0);
+	CHECK(b >= a + 3);
+	CHECK(c >= b + 64);
+	CHECK_EQ(arena.UsedBytes(), 75u);
+
+	// Larger than a block gets a block of its own.
+	arena.Allocate(10000, 8);
+	CHECK(arena.ReservedBytes() >= 4096 + 10000);
+}
+
+TEST_CASE(FrameArena, MemoryStaysValidForOneMoreFrame)
+{
+	FrameArena arena(4096);
+	FrameArena::BeginFrame();
+	int* first = static_cast<int*>(arena.Allocate(sizeof(int), alignof(int)));
+	*first = 42;
+
+	FrameArena::BeginFrame();
+	int* second = static_cast<int*>(arena.Allocate(sizeof(int), alignof(int)));
+	*second = 7;
+	CHECK(first != second);
+	CHECK_EQ(*first, 42);
+
+	// Two frames on, the first frame's memory is handed out again, without growing.
+	FrameArena::BeginFrame();
+	size_t reserved = arena.ReservedBytes();
+	int* third = static_cast<int*>(arena.Allocate(sizeof(int), alignof(int)));
+	CHECK(third == first);
+	CHECK_EQ(arena.ReservedBytes(), reserved);
+
+	arena.Trim();
+	CHECK_EQ(arena.ReservedBytes(), 0u);
+}
@@ -0,0 +1,237 @@
+#include "TestHarness.h"
+#include "../src/Renderer/FrameGraph.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Sizes a texture as width * height bytes and records what the graph submits.
+	class MockBackend : public FrameGraphBackend
+	{
+	public:
+		FgAllocationInfo GetAllocationInfo(const FgTextureDesc& desc) override
+		{
+			FgAllocationInfo info;
+			info.Size = (uint64_t)desc.Width * desc.Height;
+			info.Alignment = 256;
+			return info;
+		}
+
+		void CreateTransients(uint64_t heapSize, const std::vector<FgPlacement>& placements, std::vector<void*>& outNatives) override
+		{
+			HeapSize = heapSize;
+			for (size_t i = 0; i < placements.size(); i++)
+				outNatives.push_back(reinterpret_cast<void*>(0x1000 + i));
+		}
+
+		void SubmitBarriers(const FgBarrier* barriers, const void* const* natives, const void* const*, size_t count) override
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				Barriers.push_back(barriers[i]);
+				BarrierNatives.push_back(natives[i]);
+			}
+		}
+
+		void BeginPass(const char* name) override { Passes.push_back(name); }
+
+		uint64_t HeapSize = 0;
+		std::vector<FgBarrier> Barriers;
+		std::vector<const void*> BarrierNatives;
+		std::vector<std::string> Passes;
+	};
+
+	FgTextureDesc Texture(uint32_t width, uint32_t height)
+	{
+		FgTextureDesc desc;
+		desc.Width = width;
+		desc.Height = height;
+		desc.RenderTarget = true;
+		return desc;
+	}
+
+	size_t CountAliasing(const std::vector<FgBarrier>& barriers, FgResourceId resource, FgResourceId aliasBefore)
+	{
+		size_t count = 0;
+		for (const FgBarrier& b : barriers)
+		{
+			if (b.BarrierType == FgBarrier::Type::Aliasing && b.Resource == resource && b.AliasBefore == aliasBefore)
+				count++;
+		}
+		return count;
+	}
+
+	int g_BackBuffer = 0;
+}
+
+TEST_CASE(FrameGraph, CullsPassesWithUnusedResults)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId unused = graph.CreateTexture("Unused", Texture(16, 16));
+
+	graph.AddPass("Unused", nullptr).Write(unused, FgState::RenderTarget);
+	graph.AddPass("Scene", nullptr).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	CHECK(graph.IsCulled(0));
+	CHECK(!graph.IsCulled(1));
+	CHECK_EQ(graph.GetStats().CulledPasses, 1u);
+	CHECK(graph.Placements().empty());
+}
+
+TEST_CASE(FrameGraph, OrdersByDependencies)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId shadow = graph.CreateTexture("Shadow", Texture(16, 16));
+
+	graph.AddPass("Scene", nullptr).Read(shadow, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.AddPass("Shadow", nullptr).Write(shadow, FgState::DepthWrite);
+	graph.Compile(backend);
+
+	// Declaration order makes the shadow pass a later write, so the scene sees no producer
+	// and the shadow pass is culled.
+	REQUIRE(graph.ExecutionOrder().size() == 1);
+	CHECK_EQ(graph.ExecutionOrder()[0], 0u);
+
+	graph.Reset();
+	backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	shadow = graph.CreateTexture("Shadow", Texture(16, 16));
+	graph.AddPass("Shadow", nullptr).Write(shadow, FgState::DepthWrite);
+	graph.AddPass("Scene", nullptr).Read(shadow, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	REQUIRE(graph.ExecutionOrder().size() == 2);
+	CHECK_EQ(graph.ExecutionOrder()[0], 0u);
+	CHECK_EQ(graph.ExecutionOrder()[1], 1u);
+}
+
+TEST_CASE(FrameGraph, PlansTransitionsAndFinalState)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId color = graph.CreateTexture("Color", Texture(16, 16));
+
+	graph.AddPass("Scene", nullptr).Write(color, FgState::RenderTarget);
+	graph.AddPass("Post", nullptr).Read(color, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	const std::vector<FgBarrier>& scene = graph.PassBarriers(0);
+	REQUIRE(scene.size() == 1);
+	CHECK(scene[0].Resource == color);
+	CHECK(scene[0].Before == FgState::Undefined);
+	CHECK(scene[0].After == FgState::RenderTarget);
+
+	const std::vector<FgBarrier>& post = graph.PassBarriers(1);
+	REQUIRE(post.size() == 2);
+	CHECK(post[0].Resource == color);
+	CHECK(post[0].After == FgState::PixelShaderResource);
+	CHECK(post[1].Resource == backBuffer);
+	CHECK(post[1].Before == FgState::Present);
+	CHECK(post[1].After == FgState::RenderTarget);
+
+	REQUIRE(graph.FinalBarriers().size() == 1);
+	CHECK(graph.FinalBarriers()[0].After == FgState::Present);
+	CHECK_EQ(graph.GetStats().BarrierBatches, 3u);
+}
+
+TEST_CASE(FrameGraph, AliasesTransientsWithDisjointLifetimes)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId a = graph.CreateTexture("A", Texture(64, 64));
+	FgResourceId b = graph.CreateTexture("B", Texture(64, 64));
+	FgResourceId c = graph.CreateTexture("C", Texture(64, 64));
+
+	graph.AddPass("WriteA", nullptr).Write(a, FgState::RenderTarget);
+	graph.AddPass("AToB", nullptr).Read(a, FgState::PixelShaderResource).Write(b, FgState::RenderTarget);
+	graph.AddPass("BToC", nullptr).Read(b, FgState::PixelShaderResource).Write(c, FgState::RenderTarget);
+	graph.AddPass("Resolve", nullptr).Read(c, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	// A is dead by the time C is written, so they can share memory; B overlaps both.
+	const FrameGraph::Stats& stats = graph.GetStats();
+	CHECK_EQ(stats.TransientResources, 3u);
+	CHECK_EQ(stats.TransientBytesRequested, 3u * 64 * 64);
+	CHECK_EQ(stats.TransientHeapSize, 2u * 64 * 64);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(2), c, a), 1u);
+
+	// The aliasing barrier precedes C's first transition in the same batch.
+	const std::vector<FgBarrier>& batch = graph.PassBarriers(2);
+	REQUIRE(!batch.empty());
+	CHECK(batch[0].BarrierType == FgBarrier::Type::Aliasing);
+}
+
+TEST_CASE(FrameGraph, AliasesWhenLaterResourceIsPlacedFirst)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId small = graph.CreateTexture("Small", Texture(32, 32));
+	FgResourceId large = graph.CreateTexture("Large", Texture(128, 128));
+
+	// Small is used first, but Large is placed first because placement goes by size.
+	graph.AddPass("WriteSmall", nullptr).Write(small, FgState::RenderTarget);
+	graph.AddPass("SmallToLarge", nullptr).Read(small, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.AddPass("WriteLarge", nullptr).Write(large, FgState::RenderTarget).Read(backBuffer, FgState::PixelShaderResource);
+	graph.AddPass("Resolve", nullptr).Read(large, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	REQUIRE(graph.ExecutionOrder().size() == 4);
+	CHECK_EQ(graph.GetStats().TransientHeapSize, 128u * 128);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(2), large, small), 1u);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(0), small, large), 0u);
+}
+
+TEST_CASE(FrameGraph, AliasesEveryEarlierOccupant)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId first = graph.CreateTexture("First", Texture(32, 32));
+	FgResourceId second = graph.CreateTexture("Second", Texture(32, 32));
+	FgResourceId large = graph.CreateTexture("Large", Texture(64, 64));
+
+	graph.AddPass("First", nullptr).Write(first, FgState::RenderTarget).Write(backBuffer, FgState::RenderTarget);
+	graph.AddPass("Second", nullptr).Write(second, FgState::RenderTarget).Write(backBuffer, FgState::RenderTarget);
+	graph.AddPass("Large", nullptr).Write(large, FgState::RenderTarget).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+
+	// Each transient lives for one pass, so all three start at offset zero.
+	for (const FgPlacement& placement : graph.Placements())
+		CHECK_EQ(placement.Offset, 0u);
+
+	CHECK_EQ(CountAliasing(graph.PassBarriers(1), second, first), 1u);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(2), large, first), 1u);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(2), large, second), 1u);
+	CHECK_EQ(CountAliasing(graph.PassBarriers(0), first, large), 0u);
+}
+
+TEST_CASE(FrameGraph, ExecuteSubmitsBarriersWithNatives)
+{
+	MockBackend backend;
+	FrameGraph graph;
+	FgResourceId backBuffer = graph.ImportTexture("BackBuffer", &g_BackBuffer, FgState::Present, FgState::Present);
+	FgResourceId color = graph.CreateTexture("Color", Texture(16, 16));
+
+	void* nativeDuringPass = nullptr;
+	graph.AddPass("Scene", [&](FrameGraph& g) { nativeDuringPass = g.GetNative(color); }).Write(color, FgState::RenderTarget);
+	graph.AddPass("Post", nullptr).Read(color, FgState::PixelShaderResource).Write(backBuffer, FgState::RenderTarget);
+	graph.Compile(backend);
+	graph.Execute(backend);
+
+	REQUIRE(backend.Passes.size() == 2);
+	CHECK_EQ(backend.Passes[0], std::string("Scene"));
+	CHECK_EQ(backend.Passes[1], std::string("Post"));
+	CHECK_EQ(backend.HeapSize, graph.GetStats().TransientHeapSize);
+	CHECK(nativeDuringPass != nullptr);
+
+	REQUIRE(backend.Barriers.size() == graph.GetStats().Barriers);
+	CHECK(backend.BarrierNatives[0] == nativeDuringPass);
+	CHECK(backend.BarrierNatives.back() == &g_BackBuffer);
+}
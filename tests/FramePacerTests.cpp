@@ -0,0 +1,201 @@
+#include "TestHarness.h"
+#include "../src/Renderer/FramePacer.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// Stands in for the system clock: time only moves when the test says so, which makes
+	// pacing decisions exact and repeatable.
+	struct SimulatedClock
+	{
+		double Now = 100.0;
+
+		void Advance(double seconds) { Now += seconds; }
+	};
+
+	// One frame of the render loop as the renderer drives it: limiter wait, input sample, CPU
+	// work, present.
+	void RunFrame(FramePacer& pacer, SimulatedClock& clock, double workSeconds, double presentSeconds = 0.0)
+	{
+		clock.Advance(pacer.LimiterWait(clock.Now));
+		pacer.OnInputSampled(clock.Now);
+		clock.Advance(workSeconds);
+		clock.Advance(presentSeconds);
+		pacer.OnPresent(clock.Now);
+	}
+
+	bool Near(double a, double b, double tolerance = 1e-9)
+	{
+		return std::fabs(a - b) <= tolerance;
+	}
+}
+
+TEST_CASE(FramePacer, UnlimitedNeverWaits)
+{
+	FramePacer pacer(3);
+	SimulatedClock clock;
+	for (int i = 0; i < 10; i++)
+		CHECK_EQ(pacer.LimiterWait(clock.Now), 0.0);
+}
+
+TEST_CASE(FramePacer, LimiterHoldsTargetRate)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.TargetFps = 60.0;
+	pacer.SetSettings(settings);
+
+	SimulatedClock clock;
+	std::vector<double> starts;
+	for (int i = 0; i < 120; i++)
+	{
+		clock.Advance(pacer.LimiterWait(clock.Now));
+		starts.push_back(clock.Now);
+		clock.Advance(0.004);
+	}
+
+	for (size_t i = 1; i < starts.size(); i++)
+		CHECK(Near(starts[i] - starts[i - 1], 1.0 / 60.0));
+}
+
+TEST_CASE(FramePacer, LateFrameIsMadeUpByTheNext)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.TargetFps = 100.0;
+	pacer.SetSettings(settings);
+
+	SimulatedClock clock;
+	double first = clock.Now;
+	clock.Advance(pacer.LimiterWait(clock.Now));
+
+	// Slightly late for the second slot: no wait, and the third keeps the original schedule.
+	clock.Advance(0.013);
+	CHECK_EQ(pacer.LimiterWait(clock.Now), 0.0);
+	clock.Advance(0.002);
+	CHECK(Near(clock.Now + pacer.LimiterWait(clock.Now), first + 0.02));
+}
+
+TEST_CASE(FramePacer, LongStallRestartsSchedule)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.TargetFps = 100.0;
+	pacer.SetSettings(settings);
+
+	SimulatedClock clock;
+	clock.Advance(pacer.LimiterWait(clock.Now));
+
+	// More than an interval late: no burst of catch-up frames afterwards.
+	clock.Advance(0.5);
+	CHECK_EQ(pacer.LimiterWait(clock.Now), 0.0);
+	double restart = clock.Now;
+	clock.Advance(0.001);
+	CHECK(Near(pacer.LimiterWait(clock.Now), restart + 0.01 - clock.Now));
+}
+
+TEST_CASE(FramePacer, RecordsFrameTimeAndInputLatency)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.TargetFps = 50.0;
+	pacer.SetSettings(settings);
+
+	SimulatedClock clock;
+	for (int i = 0; i < 51; i++)
+		RunFrame(pacer, clock, 0.005, 0.003);
+
+	// The first sample only starts the clock.
+	const FrameTimeHistogram& frames = pacer.FrameTimes();
+	CHECK_EQ(frames.Count(), 50u);
+	CHECK(Near(frames.MeanMs(), 20.0, 1e-6));
+	CHECK(frames.PercentileMs(0.99) >= 20.0 && frames.PercentileMs(0.99) <= 20.5);
+	CHECK(Near(frames.MaxMs(), 20.0, 1e-6));
+
+	const FrameTimeHistogram& latency = pacer.InputLatency();
+	CHECK_EQ(latency.Count(), 51u);
+	CHECK(Near(latency.MeanMs(), 8.0, 1e-6));
+
+	pacer.ResetHistograms();
+	CHECK_EQ(pacer.FrameTimes().Count(), 0u);
+	CHECK_EQ(pacer.InputLatency().Count(), 0u);
+}
+
+TEST_CASE(FramePacer, PresentWithoutInputIsIgnored)
+{
+	FramePacer pacer(3);
+	SimulatedClock clock;
+	pacer.OnPresent(clock.Now);
+	CHECK_EQ(pacer.InputLatency().Count(), 0u);
+
+	pacer.OnInputSampled(clock.Now);
+	pacer.OnPresent(clock.Now + 0.01);
+	pacer.OnPresent(clock.Now + 0.02);
+	CHECK_EQ(pacer.InputLatency().Count(), 1u);
+}
+
+TEST_CASE(FramePacer, FramesInFlightBoundFenceWaits)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.MaxFramesInFlight = 2;
+	pacer.SetSettings(settings);
+
+	CHECK_EQ(pacer.FenceToWaitFor(), 0u);
+	pacer.OnFrameSubmitted(10);
+	CHECK_EQ(pacer.FenceToWaitFor(), 0u);
+	pacer.OnFrameSubmitted(11);
+	CHECK_EQ(pacer.FenceToWaitFor(), 10u);
+	pacer.OnFrameSubmitted(12);
+	CHECK_EQ(pacer.FenceToWaitFor(), 11u);
+
+	settings.MaxFramesInFlight = 1;
+	pacer.SetSettings(settings);
+	CHECK_EQ(pacer.FenceToWaitFor(), 12u);
+}
+
+TEST_CASE(FramePacer, FenceTrackingWrapsAround)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.MaxFramesInFlight = 3;
+	pacer.SetSettings(settings);
+
+	for (uint64_t fence = 1; fence <= 3 * FramePacer::MaxTrackedFrames; fence++)
+	{
+		pacer.OnFrameSubmitted(fence);
+		CHECK_EQ(pacer.FenceToWaitFor(), fence >= 3 ? fence - 2 : 0u);
+	}
+}
+
+TEST_CASE(FramePacer, SettingsAreClamped)
+{
+	FramePacer pacer(3);
+	FramePacingSettings settings;
+	settings.MaxFramesInFlight = 10;
+	settings.MaxFrameLatency = 0;
+	settings.TargetFps = -30.0;
+	pacer.SetSettings(settings);
+
+	CHECK_EQ(pacer.Settings().MaxFramesInFlight, 3u);
+	CHECK_EQ(pacer.Settings().MaxFrameLatency, 1u);
+	CHECK_EQ(pacer.Settings().TargetFps, 0.0);
+}
+
+TEST_CASE(FramePacer, HistogramPercentiles)
+{
+	FrameTimeHistogram histogram;
+	CHECK_EQ(histogram.PercentileMs(0.5), 0.0);
+
+	for (int i = 0; i < 90; i++)
+		histogram.Add(10.2);
+	for (int i = 0; i < 10; i++)
+		histogram.Add(33.4);
+	histogram.Add(500.0);
+
+	CHECK(Near(histogram.PercentileMs(0.5), 10.5));
+	CHECK(Near(histogram.PercentileMs(0.95), 33.5));
+	CHECK_EQ(histogram.PercentileMs(1.0), 500.0);
+	CHECK_EQ(histogram.MaxMs(), 500.0);
+}
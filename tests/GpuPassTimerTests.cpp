@@ -0,0 +1,249 @@
+#include "TestHarness.h"
+#include "../src/Renderer/GpuPassTimer.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Stands in for the GPU: a timestamp is whatever GpuTicks holds when it is written, one
+	// tick per microsecond. Queries only reach readback memory through Resolve, as on D3D12.
+	class FakeQuerySource : public TimestampQuerySource
+	{
+	public:
+		explicit FakeQuerySource(uint32_t queryCount)
+			: Queries(queryCount, 0), Written(queryCount, false), Readback(queryCount, 0) {}
+
+		void WriteTimestamp(void* list, uint32_t query) override
+		{
+			LastList = list;
+			Queries[query] = GpuTicks;
+			Written[query] = true;
+			Writes++;
+		}
+
+		void Resolve(void* list, uint32_t first, uint32_t count) override
+		{
+			LastList = list;
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				if (!Written[i])
+					UnwrittenResolved = true;
+				Readback[i] = Queries[i];
+			}
+			Resolves.push_back({ first, count });
+		}
+
+		void ReadResults(uint32_t first, uint32_t count, uint64_t* ticks) override
+		{
+			for (uint32_t i = 0; i < count; i++)
+				ticks[i] = Readback[first + i];
+		}
+
+		uint64_t TicksPerSecond() const override { return 1000000; }
+
+		bool Calibrate(uint64_t& gpuTicks, int64_t& cpuNs) override
+		{
+			gpuTicks = CalibrationTicks;
+			cpuNs = CalibrationNs;
+			return CanCalibrate;
+		}
+
+		uint64_t GpuTicks = 0;
+		bool CanCalibrate = true;
+		uint64_t CalibrationTicks = 0;
+		int64_t CalibrationNs = 0;
+
+		std::vector<uint64_t> Queries;
+		std::vector<bool> Written;
+		std::vector<uint64_t> Readback;
+		std::vector<std::pair<uint32_t, uint32_t>> Resolves;
+		void* LastList = nullptr;
+		uint32_t Writes = 0;
+		bool UnwrittenResolved = false;
+	};
+
+	int List;
+	void* const CommandList = &List;
+
+	// Records a frame with one pass of the given length in microseconds.
+	void RecordPass(GpuPassTimer& timer, FakeQuerySource& source, const char* name, uint64_t lengthUs)
+	{
+		timer.BeginPass(CommandList, name);
+		source.GpuTicks += lengthUs;
+		timer.EndPass(CommandList);
+	}
+}
+
+TEST_CASE(GpuPassTimer, ResultsArriveWhenTheSlotComesAround)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(2, 4));
+	GpuPassTimer timer(source, 2, 4);
+
+	CHECK(!timer.BeginFrame(0));
+	RecordPass(timer, source, "Scene", 500);
+	timer.EndFrame(CommandList);
+	CHECK(!timer.HasResults());
+
+	CHECK(!timer.BeginFrame(1));
+	RecordPass(timer, source, "Scene", 700);
+	timer.EndFrame(CommandList);
+
+	CHECK(timer.BeginFrame(0));
+	REQUIRE(timer.HasResults());
+	REQUIRE(timer.Results().size() == 1);
+	CHECK_EQ(std::string(timer.Results()[0].Name), std::string("Scene"));
+	CHECK_EQ(timer.Results()[0].Ms, 0.5);
+	CHECK_EQ(timer.ResultsFrame(), 0u);
+
+	timer.EndFrame(CommandList);
+	CHECK(timer.BeginFrame(1));
+	CHECK_EQ(timer.Results()[0].Ms, 0.7);
+	CHECK_EQ(timer.ResultsFrame(), 1u);
+}
+
+TEST_CASE(GpuPassTimer, NestedPassesAndFrameSpan)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 4));
+	GpuPassTimer timer(source, 1, 4);
+
+	timer.BeginFrame(0);
+	timer.BeginPass(CommandList, "Frame");
+	source.GpuTicks += 100;
+	RecordPass(timer, source, "Shadows", 200);
+	source.GpuTicks += 50;
+	RecordPass(timer, source, "Opaque", 1000);
+	timer.EndPass(CommandList);
+	timer.EndFrame(CommandList);
+	CHECK_EQ(source.Writes, 6u);
+
+	REQUIRE(timer.BeginFrame(0));
+	const std::vector<GpuPassTiming>& results = timer.Results();
+	REQUIRE(results.size() == 3);
+	CHECK_EQ(std::string(results[0].Name), std::string("Frame"));
+	CHECK_EQ(results[0].Ms, 1.35);
+	CHECK_EQ(std::string(results[1].Name), std::string("Shadows"));
+	CHECK_EQ(results[1].Ms, 0.2);
+	CHECK_EQ(std::string(results[2].Name), std::string("Opaque"));
+	CHECK_EQ(results[2].Ms, 1.0);
+	CHECK_EQ(timer.FrameMs(), 1.35);
+}
+
+TEST_CASE(GpuPassTimer, SlotsUseSeparateQueryRanges)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(3, 2));
+	GpuPassTimer timer(source, 3, 2);
+
+	for (uint32_t slot = 0; slot < 3; slot++)
+	{
+		timer.BeginFrame(slot);
+		RecordPass(timer, source, "A", 10);
+		RecordPass(timer, source, "B", 10);
+		timer.EndFrame(CommandList);
+	}
+
+	REQUIRE(source.Resolves.size() == 3);
+	for (uint32_t slot = 0; slot < 3; slot++)
+	{
+		CHECK_EQ(source.Resolves[slot].first, slot * 4);
+		CHECK_EQ(source.Resolves[slot].second, 4u);
+	}
+	CHECK(source.LastList == CommandList);
+}
+
+TEST_CASE(GpuPassTimer, ExtraPassesAreDroppedNotTimed)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 2));
+	GpuPassTimer timer(source, 1, 2);
+
+	timer.BeginFrame(0);
+	timer.BeginPass(CommandList, "Outer");
+	RecordPass(timer, source, "Inner", 10);
+	RecordPass(timer, source, "Overflow", 10);
+	timer.EndPass(CommandList);
+	timer.EndFrame(CommandList);
+
+	CHECK_EQ(timer.DroppedPasses(), 1u);
+	CHECK_EQ(source.Writes, 4u);
+
+	REQUIRE(timer.BeginFrame(0));
+	REQUIRE(timer.Results().size() == 2);
+	CHECK_EQ(std::string(timer.Results()[1].Name), std::string("Inner"));
+}
+
+TEST_CASE(GpuPassTimer, EndFrameClosesOpenPasses)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 4));
+	GpuPassTimer timer(source, 1, 4);
+
+	timer.BeginFrame(0);
+	timer.BeginPass(CommandList, "Outer");
+	timer.BeginPass(CommandList, "Inner");
+	source.GpuTicks += 30;
+	timer.EndFrame(CommandList);
+	CHECK(!source.UnwrittenResolved);
+
+	// A stray end with nothing open is ignored.
+	timer.EndPass(CommandList);
+	CHECK_EQ(source.Writes, 4u);
+
+	REQUIRE(timer.BeginFrame(0));
+	REQUIRE(timer.Results().size() == 2);
+	CHECK_EQ(timer.Results()[0].Ms, 0.03);
+}
+
+TEST_CASE(GpuPassTimer, EmptyFrameResolvesNothing)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 4));
+	GpuPassTimer timer(source, 1, 4);
+
+	timer.BeginFrame(0);
+	timer.EndFrame(CommandList);
+	CHECK(source.Resolves.empty());
+	CHECK(!timer.BeginFrame(0));
+	CHECK(!timer.HasResults());
+}
+
+TEST_CASE(GpuPassTimer, MapsTimesOntoTheCpuClock)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 1));
+	GpuPassTimer timer(source, 1, 1);
+	source.GpuTicks = 5000;
+	source.CalibrationTicks = 4000;
+	source.CalibrationNs = 1000000000;
+
+	timer.BeginFrame(0);
+	RecordPass(timer, source, "Scene", 250);
+	timer.EndFrame(CommandList);
+
+	REQUIRE(timer.BeginFrame(0));
+	CHECK_EQ(timer.Results()[0].StartNs, 1001000000);
+	CHECK_EQ(timer.Results()[0].EndNs, 1001250000);
+
+	// Without a correlation the pass is still timed, but not placed.
+	source.CanCalibrate = false;
+	RecordPass(timer, source, "Scene", 250);
+	timer.EndFrame(CommandList);
+	REQUIRE(timer.BeginFrame(0));
+	CHECK_EQ(timer.Results()[0].Ms, 0.25);
+	CHECK_EQ(timer.Results()[0].StartNs, 0);
+	CHECK_EQ(timer.Results()[0].EndNs, 0);
+}
+
+TEST_CASE(GpuPassTimer, InternsPassNames)
+{
+	FakeQuerySource source(GpuPassTimer::QueryCount(1, 2));
+	GpuPassTimer timer(source, 1, 2);
+
+	timer.BeginFrame(0);
+	{
+		std::string name = "Water";
+		RecordPass(timer, source, name.c_str(), 10);
+		name = "Overwritten";
+	}
+	RecordPass(timer, source, "Water", 10);
+	timer.EndFrame(CommandList);
+
+	REQUIRE(timer.BeginFrame(0));
+	CHECK_EQ(std::string(timer.Results()[0].Name), std::string("Water"));
+	CHECK(timer.Results()[0].Name == timer.Results()[1].Name);
+}
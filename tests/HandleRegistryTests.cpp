@@ -0,0 +1,92 @@
+#include "TestHarness.h"
+#include "../src/Renderer/HandleRegistry.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+TEST_CASE(HandleRegistry, AddAndGet)
+{
+	HandleRegistry<std::string> registry;
+	Handle<std::string> a = registry.Add("alpha");
+	Handle<std::string> b = registry.Add("beta");
+
+	REQUIRE(registry.Get(a) != nullptr);
+	REQUIRE(registry.Get(b) != nullptr);
+	CHECK_EQ(*registry.Get(a), std::string("alpha"));
+	CHECK_EQ(*registry.Get(b), std::string("beta"));
+	CHECK_EQ(registry.Size(), 2u);
+	CHECK(registry.Get(Handle<std::string>()) == nullptr);
+}
+
+TEST_CASE(HandleRegistry, RemovedHandleStaysDeadAfterSlotReuse)
+{
+	HandleRegistry<std::string> registry;
+	Handle<std::string> old = registry.Add("old");
+	CHECK(registry.Remove(old));
+	CHECK(registry.Get(old) == nullptr);
+
+	// The freed slot is handed out again with a new generation.
+	Handle<std::string> reused = registry.Add("new");
+	CHECK_EQ(reused.Index, old.Index);
+	CHECK(reused.Generation != old.Generation);
+
+	CHECK(registry.Get(old) == nullptr);
+	CHECK(!registry.IsAlive(old));
+	CHECK(!registry.Remove(old));
+	REQUIRE(registry.Get(reused) != nullptr);
+	CHECK_EQ(*registry.Get(reused), std::string("new"));
+}
+
+TEST_CASE(HandleRegistry, SwapRemoveKeepsMovedItemReachable)
+{
+	HandleRegistry<int> registry;
+	std::vector<Handle<int>> handles;
+	for (int i = 0; i < 5; i++)
+		handles.push_back(registry.Add(i * 10));
+
+	// Removing the first object moves the last one into its place in the array.
+	CHECK(registry.Remove(handles[0]));
+	CHECK(registry.Remove(handles[2]));
+	CHECK_EQ(registry.Size(), 3u);
+
+	for (int i : { 1, 3, 4 })
+	{
+		REQUIRE(registry.Get(handles[i]) != nullptr);
+		CHECK_EQ(*registry.Get(handles[i]), i * 10);
+	}
+
+	// The moved object can itself be removed through its handle.
+	CHECK(registry.Remove(handles[4]));
+	CHECK(registry.Get(handles[4]) == nullptr);
+	REQUIRE(registry.Get(handles[1]) != nullptr);
+	REQUIRE(registry.Get(handles[3]) != nullptr);
+	CHECK_EQ(*registry.Get(handles[1]), 10);
+	CHECK_EQ(*registry.Get(handles[3]), 30);
+
+	std::vector<int> live(registry.begin(), registry.end());
+	std::sort(live.begin(), live.end());
+	CHECK(live == std::vector<int>({ 10, 30 }));
+}
+
+TEST_CASE(HandleRegistry, RemoveDropsTheName)
+{
+	HandleRegistry<int> registry;
+	Handle<int> grass = registry.Add("grass", 1);
+	Handle<int> rock = registry.Add("rock", 2);
+	CHECK(registry.Find("grass") == grass);
+	CHECK(registry.Find("rock") == rock);
+
+	CHECK(registry.Remove(grass));
+	CHECK(!registry.Find("grass").IsValid());
+	CHECK(registry.Find("rock") == rock);
+
+	// The name is free again, and an unnamed object in the reused slot does not inherit it.
+	Handle<int> unnamed = registry.Add(3);
+	CHECK_EQ(unnamed.Index, grass.Index);
+	CHECK(!registry.Find("grass").IsValid());
+
+	Handle<int> again = registry.Add("grass", 4);
+	CHECK(registry.Find("grass") == again);
+	REQUIRE(registry.Get(again) != nullptr);
+	CHECK_EQ(*registry.Get(again), 4);
+}
@@ -0,0 +1,104 @@
+#include "TestHarness.h"
+#include "../src/Renderer/IndirectDraw.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	std::vector<IndirectGeometry> MakeGeometries()
+	{
+		std::vector<IndirectGeometry> geometries(2);
+		geometries[0].VertexBuffer = { 0x10000, 4096, 32 };
+		geometries[0].IndexBuffer = { 0x20000, 1024, 42 };
+		geometries[1].VertexBuffer = { 0x30000, 8192, 32 };
+		geometries[1].IndexBuffer = { 0x40000, 2048, 42 };
+		return geometries;
+	}
+
+	IndirectDrawCandidate Candidate(uint32_t geometry, uint32_t firstInstance, uint32_t instanceCount)
+	{
+		IndirectDrawCandidate candidate;
+		candidate.Geometry = geometry;
+		candidate.IndexCount = 36 + geometry;
+		candidate.StartIndexLocation = 6 * geometry;
+		candidate.BaseVertexLocation = -(int32_t)geometry;
+		candidate.FirstInstance = firstInstance;
+		candidate.InstanceCount = instanceCount;
+		return candidate;
+	}
+}
+
+TEST_CASE(IndirectDraw, SignatureMatchesCommandLayout)
+{
+	IndirectCommandSignature signature = DescribeIndirectDrawSignature(3);
+	CHECK_EQ(signature.ByteStride, (uint32_t)sizeof(IndirectDrawCommand));
+	REQUIRE(signature.Arguments.size() == 4);
+
+	CHECK(signature.Arguments[0].Type == IndirectArgumentType::VertexBufferView);
+	CHECK_EQ(signature.Arguments[0].ByteOffset, 0u);
+	CHECK(signature.Arguments[1].Type == IndirectArgumentType::IndexBufferView);
+	CHECK_EQ(signature.Arguments[1].ByteOffset, 16u);
+	CHECK(signature.Arguments[2].Type == IndirectArgumentType::Constant);
+	CHECK_EQ(signature.Arguments[2].Slot, 3u);
+	CHECK_EQ(signature.Arguments[2].Num32BitValues, 1u);
+	CHECK_EQ(signature.Arguments[2].ByteOffset, 32u);
+	CHECK(signature.Arguments[3].Type == IndirectArgumentType::DrawIndexed);
+	CHECK_EQ(signature.Arguments[3].ByteOffset, 36u);
+}
+
+TEST_CASE(IndirectDraw, CompactionDropsCulledDraws)
+{
+	std::vector<IndirectGeometry> geometries = MakeGeometries();
+	std::vector<IndirectDrawCandidate> candidates = {
+		Candidate(0, 0, 5),
+		Candidate(1, 5, 0),
+		Candidate(1, 5, 3),
+		Candidate(0, 8, 0),
+	};
+
+	std::vector<IndirectDrawCommand> commands;
+	uint32_t count = CompactIndirectDraws(candidates.data(), candidates.size(), geometries.data(), commands);
+	REQUIRE(count == 2);
+	REQUIRE(commands.size() == 2);
+
+	const IndirectDrawCommand& first = commands[0];
+	CHECK_EQ(first.VertexBuffer.BufferLocation, geometries[0].VertexBuffer.BufferLocation);
+	CHECK_EQ(first.IndexBuffer.Format, geometries[0].IndexBuffer.Format);
+	CHECK_EQ(first.InstanceOffset, 0u);
+	CHECK_EQ(first.Draw.IndexCountPerInstance, 36u);
+	CHECK_EQ(first.Draw.InstanceCount, 5u);
+
+	const IndirectDrawCommand& second = commands[1];
+	CHECK_EQ(second.VertexBuffer.BufferLocation, geometries[1].VertexBuffer.BufferLocation);
+	CHECK_EQ(second.InstanceOffset, 5u);
+	CHECK_EQ(second.Draw.StartInstanceLocation, 5u);
+	CHECK_EQ(second.Draw.StartIndexLocation, 6u);
+	CHECK_EQ(second.Draw.BaseVertexLocation, -1);
+	CHECK_EQ(second.Draw.InstanceCount, 3u);
+}
+
+TEST_CASE(IndirectDraw, CompactionOfNothingVisible)
+{
+	std::vector<IndirectGeometry> geometries = MakeGeometries();
+	std::vector<IndirectDrawCandidate> candidates = { Candidate(0, 0, 0), Candidate(1, 0, 0) };
+
+	std::vector<IndirectDrawCommand> commands(4);
+	CHECK_EQ(CompactIndirectDraws(candidates.data(), candidates.size(), geometries.data(), commands), 0u);
+	CHECK(commands.empty());
+}
+
+TEST_CASE(IndirectDraw, SameCommandsIgnoresOrder)
+{
+	std::vector<IndirectGeometry> geometries = MakeGeometries();
+	std::vector<IndirectDrawCandidate> candidates = { Candidate(0, 0, 2), Candidate(1, 2, 4), Candidate(0, 6, 1) };
+
+	std::vector<IndirectDrawCommand> reference;
+	CompactIndirectDraws(candidates.data(), candidates.size(), geometries.data(), reference);
+
+	// What a GPU pass appending with an atomic counter might produce.
+	std::vector<IndirectDrawCommand> appended(reference.rbegin(), reference.rend());
+	CHECK(SameIndirectCommands(reference.data(), appended.data(), reference.size()));
+
+	appended[1].Draw.InstanceCount++;
+	CHECK(!SameIndirectCommands(reference.data(), appended.data(), reference.size()));
+}
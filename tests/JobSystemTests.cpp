@@ -0,0 +1,237 @@
+#include "TestHarness.h"
+#include "../src/Utils/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Runs ParallelFor over [first, last) and checks every index was visited exactly once.
+	bool CoversRangeOnce(JobSystem& jobs, uint32_t first, uint32_t last, uint32_t grainSize)
+	{
+		std::vector<std::atomic<uint32_t>> visits(last);
+		std::atomic<bool> oversized{ false };
+		jobs.ParallelFor(first, last, grainSize, [&](uint32_t begin, uint32_t end)
+			{
+				if (end - begin > std::max(grainSize, 1u))
+					oversized = true;
+				for (uint32_t i = begin; i < end; i++)
+					visits[i]++;
+			});
+
+		for (uint32_t i = 0; i < last; i++)
+		{
+			if (visits[i] != (i >= first ? 1u : 0u))
+				return false;
+		}
+		return !oversized;
+	}
+}
+
+TEST_CASE(JobSystem, ParallelForCoversEveryIndexOnce)
+{
+	JobSystem jobs(3);
+	CHECK(CoversRangeOnce(jobs, 0, 1, 1));
+	CHECK(CoversRangeOnce(jobs, 0, 1000, 1));
+	CHECK(CoversRangeOnce(jobs, 0, 1000, 7));
+	CHECK(CoversRangeOnce(jobs, 0, 1000, 5000));
+	CHECK(CoversRangeOnce(jobs, 13, 1021, 64));
+	CHECK(CoversRangeOnce(jobs, 0, 100, 0));
+}
+
+TEST_CASE(JobSystem, EmptyRangeCallsNothing)
+{
+	JobSystem jobs(2);
+	bool called = false;
+	jobs.ParallelFor(5, 5, 1, [&](uint32_t, uint32_t) { called = true; });
+	jobs.ParallelFor(6, 5, 1, [&](uint32_t, uint32_t) { called = true; });
+	CHECK(!called);
+}
+
+TEST_CASE(JobSystem, RunsInlineWithoutWorkers)
+{
+	JobSystem jobs(0);
+	CHECK_EQ(jobs.ThreadCount(), 1u);
+	CHECK(CoversRangeOnce(jobs, 0, 500, 3));
+
+	std::thread::id caller = std::this_thread::get_id();
+	bool sameThread = true;
+	jobs.ParallelFor(0, 64, 1, [&](uint32_t, uint32_t) { sameThread = sameThread && std::this_thread::get_id() == caller; });
+	CHECK(sameThread);
+}
+
+TEST_CASE(JobSystem, UsesWorkerThreads)
+{
+	JobSystem jobs(3);
+	CHECK_EQ(jobs.ThreadCount(), 4u);
+
+	// Slow enough per index that idle workers steal part of the range.
+	std::thread::id caller = std::this_thread::get_id();
+	std::atomic<bool> ranElsewhere{ false };
+	jobs.ParallelFor(0, 64, 1, [&](uint32_t, uint32_t)
+		{
+			if (std::this_thread::get_id() != caller)
+				ranElsewhere = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		});
+	CHECK(ranElsewhere);
+}
+
+TEST_CASE(JobSystem, NestedParallelForWaits)
+{
+	JobSystem jobs(3);
+	const uint32_t outer = 16;
+	const uint32_t inner = 256;
+	std::vector<std::atomic<uint32_t>> sums(outer);
+
+	// Every outer job waits on its own inner loop, running other jobs meanwhile.
+	jobs.ParallelFor(0, outer, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t o = begin; o < end; o++)
+			{
+				jobs.ParallelFor(0, inner, 8, [&](uint32_t innerBegin, uint32_t innerEnd)
+					{
+						for (uint32_t i = innerBegin; i < innerEnd; i++)
+							sums[o] += i;
+					});
+				CHECK_EQ(sums[o].load(), inner * (inner - 1) / 2);
+			}
+		});
+
+	for (uint32_t o = 0; o < outer; o++)
+		CHECK_EQ(sums[o].load(), inner * (inner - 1) / 2);
+}
+
+TEST_CASE(JobSystem, WaitCoversChildJobs)
+{
+	JobSystem jobs(2);
+	JobCounter counter;
+	std::atomic<uint32_t> ran{ 0 };
+
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		jobs.Run(counter, [&]()
+			{
+				ran++;
+				for (uint32_t child = 0; child < 4; child++)
+					jobs.Run(counter, [&]() { ran++; });
+			});
+	}
+
+	jobs.Wait(counter);
+	CHECK(counter.IsDone());
+	CHECK_EQ(ran.load(), 8u * 5u);
+}
+
+TEST_CASE(JobSystem, RethrowsAfterEveryJobFinished)
+{
+	JobSystem jobs(3);
+	std::atomic<uint32_t> finished{ 0 };
+
+	bool threw = false;
+	try
+	{
+		jobs.ParallelFor(0, 100, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					if (i == 42)
+						throw std::runtime_error("job failed");
+					finished++;
+				}
+			});
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+
+	CHECK(threw);
+	CHECK_EQ(finished.load(), 99u);
+
+	// The failure does not stick to later work.
+	CHECK(CoversRangeOnce(jobs, 0, 100, 1));
+}
+
+TEST_CASE(JobSystem, OutsideThreadsShareThePool)
+{
+	JobSystem jobs(2);
+	std::atomic<bool> allCovered{ true };
+
+	std::vector<std::thread> callers;
+	for (uint32_t t = 0; t < 3; t++)
+	{
+		callers.emplace_back([&]()
+			{
+				for (uint32_t repeat = 0; repeat < 20; repeat++)
+				{
+					if (!CoversRangeOnce(jobs, 0, 300, 4))
+						allCovered = false;
+				}
+			});
+	}
+
+	for (std::thread& caller : callers)
+		caller.join();
+	CHECK(allCovered);
+}
+
+TEST_CASE(JobSystem, OutsideWaitRunsOnlyItsOwnJobs)
+{
+	// The only worker is busy with this thread's job while another thread queues its own, so
+	// this thread's wait has nothing of its own to run and must not take the other jobs.
+	JobSystem jobs(1);
+	JobCounter counter;
+	std::atomic<bool> workerBusy{ false };
+	jobs.Run(counter, [&]()
+		{
+			workerBusy = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(30));
+		});
+	while (!workerBusy)
+		std::this_thread::yield();
+
+	std::thread::id caller = std::this_thread::get_id();
+	std::vector<std::thread::id> ranOn(4);
+	std::atomic<bool> queued{ false };
+	std::atomic<bool> callerDone{ false };
+	std::thread other([&]()
+		{
+			JobCounter otherCounter;
+			for (uint32_t i = 0; i < (uint32_t)ranOn.size(); i++)
+				jobs.Run(otherCounter, [&ranOn, i]() { ranOn[i] = std::this_thread::get_id(); });
+			queued = true;
+			while (!callerDone)
+				std::this_thread::yield();
+			jobs.Wait(otherCounter);
+		});
+
+	while (!queued)
+		std::this_thread::yield();
+	jobs.Wait(counter);
+	callerDone = true;
+	other.join();
+
+	for (const std::thread::id& id : ranOn)
+		CHECK(id != caller);
+}
+
+TEST_CASE(JobSystem, ShutsDownCleanly)
+{
+	// Idle, freshly started and just-used pools all have to join without hanging.
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		JobSystem idle(4);
+	}
+
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		JobSystem jobs(4);
+		std::atomic<uint32_t> count{ 0 };
+		jobs.ParallelFor(0, 50, 1, [&](uint32_t begin, uint32_t end) { count += end - begin; });
+		CHECK_EQ(count.load(), 50u);
+	}
+}
@@ -0,0 +1,33 @@
+#include "TestHarness.h"
+#include "../src/Utils/Json.h"
+#include <string>
+
+namespace
+{
+	std::string Quoted(std::string_view text)
+	{
+		std::ostringstream out;
+		WriteJsonString(out, text);
+		return out.str();
+	}
+}
+
+TEST_CASE(Json, CopiesPlainText)
+{
+	CHECK_EQ(Quoted(""), std::string("\"\""));
+	CHECK_EQ(Quoted("Frame 12"), std::string("\"Frame 12\""));
+	CHECK_EQ(Quoted("caf\xc3\xa9"), std::string("\"caf\xc3\xa9\""));
+}
+
+TEST_CASE(Json, EscapesQuotesAndBackslashes)
+{
+	CHECK_EQ(Quoted("say \"hi\""), std::string("\"say \\\"hi\\\"\""));
+	CHECK_EQ(Quoted("C:\\Shaders"), std::string("\"C:\\\\Shaders\""));
+}
+
+TEST_CASE(Json, EscapesControlCharacters)
+{
+	CHECK_EQ(Quoted("a\nb\tc\r"), std::string("\"a\\nb\\tc\\r\""));
+	CHECK_EQ(Quoted("\b\f"), std::string("\"\\b\\f\""));
+	CHECK_EQ(Quoted(std::string_view("\x01\x1f\0", 3)), std::string("\"\\u0001\\u001f\\u0000\""));
+}
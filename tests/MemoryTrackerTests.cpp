@@ -0,0 +1,141 @@
+#include "TestHarness.h"
+#include "../src/Utils/MemoryTracker.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+// The tracker is process-wide, so every check is against the usage it had before the case.
+
+TEST_CASE(MemoryTracker, CountsAllocationsAndFrees)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	MemoryUsage before = tracker.Usage(MemoryTag::Textures, MemoryDomain::Gpu);
+
+	tracker.OnAllocate(MemoryTag::Textures, MemoryDomain::Gpu, 1024);
+	tracker.OnAllocate(MemoryTag::Textures, MemoryDomain::Gpu, 4096);
+	MemoryUsage during = tracker.Usage(MemoryTag::Textures, MemoryDomain::Gpu);
+	CHECK_EQ(during.CurrentBytes - before.CurrentBytes, 5120);
+	CHECK_EQ(during.Allocations - before.Allocations, 2);
+	CHECK_EQ(during.TotalAllocations - before.TotalAllocations, 2);
+
+	tracker.OnFree(MemoryTag::Textures, MemoryDomain::Gpu, 1024);
+	tracker.OnFree(MemoryTag::Textures, MemoryDomain::Gpu, 4096);
+	MemoryUsage after = tracker.Usage(MemoryTag::Textures, MemoryDomain::Gpu);
+	CHECK_EQ(after.CurrentBytes, before.CurrentBytes);
+	CHECK_EQ(after.Allocations, before.Allocations);
+	CHECK_EQ(after.TotalAllocations - before.TotalAllocations, 2);
+}
+
+TEST_CASE(MemoryTracker, KeepsTagsAndDomainsApart)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	int64_t cpuBefore = tracker.TotalBytes(MemoryDomain::Cpu);
+	int64_t gpuBefore = tracker.TotalBytes(MemoryDomain::Gpu);
+	MemoryUsage uploadCpu = tracker.Usage(MemoryTag::Upload, MemoryDomain::Cpu);
+
+	tracker.OnAllocate(MemoryTag::Upload, MemoryDomain::Gpu, 256);
+	tracker.OnAllocate(MemoryTag::RenderTargets, MemoryDomain::Gpu, 512);
+	CHECK_EQ(tracker.TotalBytes(MemoryDomain::Gpu) - gpuBefore, 768);
+	CHECK_EQ(tracker.TotalBytes(MemoryDomain::Cpu), cpuBefore);
+	CHECK_EQ(tracker.Usage(MemoryTag::Upload, MemoryDomain::Cpu).CurrentBytes, uploadCpu.CurrentBytes);
+
+	tracker.OnFree(MemoryTag::Upload, MemoryDomain::Gpu, 256);
+	tracker.OnFree(MemoryTag::RenderTargets, MemoryDomain::Gpu, 512);
+	CHECK_EQ(tracker.TotalBytes(MemoryDomain::Gpu), gpuBefore);
+}
+
+TEST_CASE(MemoryTracker, PeakHoldsUntilReset)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	int64_t base = tracker.Usage(MemoryTag::Geometry, MemoryDomain::Gpu).CurrentBytes;
+
+	tracker.OnAllocate(MemoryTag::Geometry, MemoryDomain::Gpu, 1000);
+	tracker.OnAllocate(MemoryTag::Geometry, MemoryDomain::Gpu, 3000);
+	tracker.OnFree(MemoryTag::Geometry, MemoryDomain::Gpu, 3000);
+	MemoryUsage usage = tracker.Usage(MemoryTag::Geometry, MemoryDomain::Gpu);
+	CHECK_EQ(usage.CurrentBytes, base + 1000);
+	CHECK(usage.PeakBytes >= base + 4000);
+
+	// The peak restarts from what is alive now.
+	tracker.ResetPeaks();
+	CHECK_EQ(tracker.Usage(MemoryTag::Geometry, MemoryDomain::Gpu).PeakBytes, base + 1000);
+	tracker.OnAllocate(MemoryTag::Geometry, MemoryDomain::Gpu, 500);
+	CHECK_EQ(tracker.Usage(MemoryTag::Geometry, MemoryDomain::Gpu).PeakBytes, base + 1500);
+
+	tracker.OnFree(MemoryTag::Geometry, MemoryDomain::Gpu, 500);
+	tracker.OnFree(MemoryTag::Geometry, MemoryDomain::Gpu, 1000);
+}
+
+TEST_CASE(MemoryTracker, CountsFromManyThreads)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	MemoryUsage before = tracker.Usage(MemoryTag::ConstantBuffers, MemoryDomain::Gpu);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&tracker]()
+			{
+				for (int i = 0; i < 10000; i++)
+				{
+					tracker.OnAllocate(MemoryTag::ConstantBuffers, MemoryDomain::Gpu, 16);
+					tracker.OnFree(MemoryTag::ConstantBuffers, MemoryDomain::Gpu, 16);
+				}
+			});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	MemoryUsage after = tracker.Usage(MemoryTag::ConstantBuffers, MemoryDomain::Gpu);
+	CHECK_EQ(after.CurrentBytes, before.CurrentBytes);
+	CHECK_EQ(after.Allocations, before.Allocations);
+	CHECK_EQ(after.TotalAllocations - before.TotalAllocations, 40000);
+	CHECK(after.PeakBytes - before.CurrentBytes <= 4 * 16);
+}
+
+TEST_CASE(MemoryTracker, TrackedVectorCountsItsStorage)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	MemoryUsage before = tracker.Usage(MemoryTag::Terrain, MemoryDomain::Cpu);
+	{
+		TrackedVector<float, MemoryTag::Terrain> heights;
+		heights.reserve(256);
+		MemoryUsage during = tracker.Usage(MemoryTag::Terrain, MemoryDomain::Cpu);
+		CHECK_EQ(during.CurrentBytes - before.CurrentBytes, (int64_t)(256 * sizeof(float)));
+		CHECK_EQ(during.Allocations - before.Allocations, 1);
+
+		// A copy counts its own storage under the same tag.
+		TrackedVector<float, MemoryTag::Terrain> copy = heights;
+		copy.resize(16);
+		CHECK_EQ(tracker.Usage(MemoryTag::Terrain, MemoryDomain::Cpu).Allocations - before.Allocations, 2);
+	}
+	MemoryUsage after = tracker.Usage(MemoryTag::Terrain, MemoryDomain::Cpu);
+	CHECK_EQ(after.CurrentBytes, before.CurrentBytes);
+	CHECK_EQ(after.Allocations, before.Allocations);
+}
+
+TEST_CASE(MemoryTracker, LeakReportNamesLiveTags)
+{
+	MemoryTracker& tracker = MemoryTracker::Get();
+	std::ostringstream quiet;
+	uint32_t baseline = tracker.WriteLeakReport(quiet);
+	bool alreadyLive = quiet.str().find("GPU Profiling") != std::string::npos;
+
+	tracker.OnAllocate(MemoryTag::Profiling, MemoryDomain::Gpu, 2048);
+	std::ostringstream report;
+	uint32_t leaks = tracker.WriteLeakReport(report);
+	CHECK_EQ(leaks, baseline + (alreadyLive ? 0u : 1u));
+	CHECK(report.str().find("GPU Profiling: ") != std::string::npos);
+	CHECK(report.str().find("allocations still alive\n") != std::string::npos);
+
+	tracker.OnFree(MemoryTag::Profiling, MemoryDomain::Gpu, 2048);
+	std::ostringstream cleared;
+	CHECK_EQ(tracker.WriteLeakReport(cleared), baseline);
+}
+
+TEST_CASE(MemoryTracker, EveryTagHasAName)
+{
+	for (size_t tag = 0; tag < (size_t)MemoryTag::Count; tag++)
+		CHECK(std::string(MemoryTagName((MemoryTag)tag)) != "Unknown");
+	CHECK_EQ(std::string(MemoryTagName(MemoryTag::Count)), std::string("Unknown"));
+}
@@ -0,0 +1,133 @@
+#include "TestHarness.h"
+#include "../src/Renderer/ParallelRecorder.h"
+#include "../src/Utils/JobSystem.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A command list is just the index it was acquired at; the recorder never looks inside.
+	struct MockList
+	{
+		uint32_t Index = 0;
+		std::vector<DrawBatch> Recorded;
+		bool Closed = false;
+	};
+
+	class MockListSource : public CommandListSource
+	{
+	public:
+		explicit MockListSource(size_t capacity) { Lists.reserve(capacity); }
+
+		void* Acquire() override
+		{
+			CHECK(std::this_thread::get_id() == Owner);
+			Lists.push_back(MockList());
+			Lists.back().Index = (uint32_t)Lists.size() - 1;
+			return &Lists.back();
+		}
+
+		void Close(void* list) override
+		{
+			static_cast<MockList*>(list)->Closed = true;
+			Closes++;
+		}
+
+		std::thread::id Owner = std::this_thread::get_id();
+		std::vector<MockList> Lists;
+		std::atomic<uint32_t> Closes{ 0 };
+	};
+}
+
+TEST_CASE(ParallelRecorder, PartitionsEvenly)
+{
+	std::vector<DrawBatch> batches = PartitionDraws(10, 3, 1);
+	REQUIRE(batches.size() == 3);
+	CHECK_EQ(batches[0].Begin, 0u);
+	CHECK_EQ(batches[0].End, 4u);
+	CHECK_EQ(batches[1].End, 7u);
+	CHECK_EQ(batches[2].End, 10u);
+}
+
+TEST_CASE(ParallelRecorder, PartitionRespectsMinimumBatchSize)
+{
+	CHECK_EQ(PartitionDraws(100, 8, 64).size(), 1u);
+	CHECK_EQ(PartitionDraws(200, 8, 64).size(), 3u);
+	CHECK_EQ(PartitionDraws(10, 8, 64).size(), 1u);
+	CHECK(PartitionDraws(0, 8, 64).empty());
+}
+
+TEST_CASE(ParallelRecorder, RecordsEachBatchIntoItsOwnList)
+{
+	JobSystem jobs(3);
+	ParallelRecorder recorder(jobs, 8);
+	CHECK_EQ(recorder.ThreadCount(), 4u);
+
+	std::vector<DrawBatch> batches = PartitionDraws(1000, 16, 10);
+	MockListSource source(batches.size());
+
+	recorder.Record(source, batches, [&](void* list, const DrawBatch& batch)
+		{
+			static_cast<MockList*>(list)->Recorded.push_back(batch);
+		});
+
+	// Lists come out in batch order no matter which thread recorded them.
+	REQUIRE(source.Lists.size() == batches.size());
+	CHECK_EQ(source.Closes.load(), (uint32_t)batches.size());
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		const MockList& list = source.Lists[i];
+		CHECK(list.Closed);
+		REQUIRE(list.Recorded.size() == 1);
+		CHECK_EQ(list.Recorded[0].Begin, batches[i].Begin);
+		CHECK_EQ(list.Recorded[0].End, batches[i].End);
+	}
+}
+
+TEST_CASE(ParallelRecorder, CapsThreadCount)
+{
+	JobSystem jobs(7);
+	ParallelRecorder recorder(jobs, 2);
+	CHECK_EQ(recorder.ThreadCount(), 2u);
+
+	JobSystem single(0);
+	ParallelRecorder serial(single, 8);
+	CHECK_EQ(serial.ThreadCount(), 1u);
+
+	std::vector<DrawBatch> batches = PartitionDraws(8, 4, 1);
+	MockListSource source(batches.size());
+	serial.Record(source, batches, [&](void* list, const DrawBatch&)
+		{
+			CHECK(static_cast<MockList*>(list)->Index < batches.size());
+			CHECK(std::this_thread::get_id() == source.Owner);
+		});
+	CHECK_EQ(source.Closes.load(), 4u);
+}
+
+TEST_CASE(ParallelRecorder, RethrowsAfterOtherBatchesFinish)
+{
+	JobSystem jobs(3);
+	ParallelRecorder recorder(jobs, 4);
+	std::vector<DrawBatch> batches = PartitionDraws(64, 8, 1);
+	MockListSource source(batches.size());
+
+	bool threw = false;
+	try
+	{
+		recorder.Record(source, batches, [&](void* list, const DrawBatch&)
+			{
+				if (static_cast<MockList*>(list)->Index == 3)
+					throw std::runtime_error("record failed");
+			});
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+
+	CHECK(threw);
+	CHECK_EQ(source.Closes.load(), (uint32_t)batches.size() - 1);
+	CHECK(!source.Lists[3].Closed);
+}
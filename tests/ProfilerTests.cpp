@@ -0,0 +1,94 @@
+#include "TestHarness.h"
+#include "../src/Utils/Profiler.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	// Records one scope on a thread that exits straight after.
+	void ScopeOnThread(const char* name, const char* threadName = nullptr)
+	{
+		std::thread([=]()
+			{
+				if (threadName)
+					Profiler::Get().SetThreadName(threadName);
+				PROFILE_SCOPE(name);
+			}).join();
+	}
+
+	const ProfileNode* FindNode(const char* name)
+	{
+		const ProfileFrame* frame = Profiler::Get().LastFrame();
+		if (!frame)
+			return nullptr;
+
+		for (const ProfileNode& node : frame->Nodes)
+		{
+			if (std::strcmp(node.Name, name) == 0)
+				return &node;
+		}
+		return nullptr;
+	}
+}
+
+TEST_CASE(Profiler, CollectsScopesOfExitedThreads)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.EndFrame();
+
+	ScopeOnThread("ExitedScope");
+	profiler.EndFrame();
+	CHECK(FindNode("ExitedScope") != nullptr);
+}
+
+TEST_CASE(Profiler, ReusesBuffersOfExitedThreads)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.EndFrame();
+
+	ScopeOnThread("FirstThread", "Named worker");
+	profiler.EndFrame();
+	const ProfileNode* first = FindNode("FirstThread");
+	REQUIRE(first);
+	uint32_t track = first->Thread;
+
+	// Every later short-lived thread lands on the same track, under a fresh name.
+	for (int i = 0; i < 8; i++)
+	{
+		ScopeOnThread("LaterThread");
+		profiler.EndFrame();
+		const ProfileNode* later = FindNode("LaterThread");
+		REQUIRE(later);
+		CHECK_EQ(later->Thread, track);
+	}
+	CHECK_EQ(profiler.ThreadName(track), "Thread " + std::to_string(track));
+}
+
+TEST_CASE(Profiler, LiveThreadsKeepTheirOwnBuffers)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.EndFrame();
+
+	// Both threads hold their buffer until the other has recorded too.
+	std::atomic<int> recorded{ 0 };
+	auto record = [&](const char* name)
+		{
+			{
+				PROFILE_SCOPE(name);
+			}
+			recorded++;
+			while (recorded < 2)
+				std::this_thread::yield();
+		};
+	std::thread a(record, "LiveA");
+	std::thread b(record, "LiveB");
+	a.join();
+	b.join();
+	profiler.EndFrame();
+
+	const ProfileNode* nodeA = FindNode("LiveA");
+	const ProfileNode* nodeB = FindNode("LiveB");
+	REQUIRE(nodeA && nodeB);
+	CHECK(nodeA->Thread != nodeB->Thread);
+}
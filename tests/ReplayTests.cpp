@@ -0,0 +1,105 @@
+#include "TestHarness.h"
+#include "../src/Utils/Replay.h"
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	ReplayFile MakeReplay(uint32_t frames)
+	{
+		ReplayFile replay;
+		replay.FixedTimeStep = 1.0f / 30.0f;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			ReplayFrame frame;
+			frame.Camera.Position = { (float)i, 2.0f, -3.0f };
+			frame.Seed = 1000 + i;
+			frame.Parameters.WaveSpeed = 1.5f;
+			frame.Parameters.NoiseSeed = 7;
+			frame.Parameters.Regenerate = i == 2;
+			replay.Frames.push_back(frame);
+		}
+		return replay;
+	}
+
+	std::string Serialize(const ReplayFile& replay)
+	{
+		std::ostringstream out(std::ios::binary);
+		WriteReplay(out, replay);
+		return out.str();
+	}
+
+	bool Parse(const std::string& bytes, ReplayFile& replay)
+	{
+		std::istringstream in(bytes, std::ios::binary);
+		return ReadReplay(in, replay);
+	}
+
+	// Byte offset of the frame count: magic, version and time step come first.
+	const size_t FrameCountOffset = 4 + sizeof(uint32_t) + sizeof(float);
+}
+
+TEST_CASE(Replay, RoundTripsFramesAndParameters)
+{
+	ReplayFile original = MakeReplay(5);
+	ReplayFile loaded;
+	REQUIRE(Parse(Serialize(original), loaded));
+
+	CHECK_EQ(loaded.FixedTimeStep, original.FixedTimeStep);
+	REQUIRE(loaded.Frames.size() == 5);
+	for (size_t i = 0; i < 5; i++)
+	{
+		CHECK_EQ(loaded.Frames[i].Seed, original.Frames[i].Seed);
+		CHECK_EQ(loaded.Frames[i].Camera.Position.x, original.Frames[i].Camera.Position.x);
+		CHECK(loaded.Frames[i].Parameters == original.Frames[i].Parameters);
+	}
+}
+
+TEST_CASE(Replay, RejectsTruncatedFile)
+{
+	std::string bytes = Serialize(MakeReplay(4));
+	ReplayFile loaded;
+	for (size_t length : { (size_t)0, (size_t)3, FrameCountOffset + 2, bytes.size() / 2, bytes.size() - 1 })
+		CHECK(!Parse(bytes.substr(0, length), loaded));
+}
+
+TEST_CASE(Replay, RejectsFrameCountLargerThanTheFile)
+{
+	std::string bytes = Serialize(MakeReplay(2));
+	uint32_t frameCount = 0xffffffffu;
+	std::memcpy(&bytes[FrameCountOffset], &frameCount, sizeof(frameCount));
+
+	ReplayFile loaded;
+	CHECK(!Parse(bytes, loaded));
+	CHECK(loaded.Frames.capacity() < 1000);
+}
+
+TEST_CASE(Replay, RejectsWrongMagicAndVersion)
+{
+	std::string bytes = Serialize(MakeReplay(1));
+	ReplayFile loaded;
+
+	std::string badMagic = bytes;
+	badMagic[0] = 'X';
+	CHECK(!Parse(badMagic, loaded));
+
+	std::string badVersion = bytes;
+	badVersion[4]++;
+	CHECK(!Parse(badVersion, loaded));
+}
+
+TEST_CASE(Replay, FrameReportUsesResultShape)
+{
+	FrameTimeReport report;
+	report.Reset(3);
+	report.AddFrame(16.0, 4.0, 8.0);
+	report.AddFrame(17.0, 5.0, 9.0);
+
+	std::ostringstream out;
+	report.WriteJson(out, { { "scene", "default" } });
+	std::string json = out.str();
+	CHECK(json.find("\"scene\": \"default\"") != std::string::npos);
+	CHECK(json.find("\"name\": \"replay/cpu_frame\", \"repetitions\": 2") != std::string::npos);
+	CHECK(json.find("\"median_ms\": 16.5") != std::string::npos);
+}
@@ -0,0 +1,53 @@
+#include "TestHarness.h"
+#include "../src/Utils/SampleStats.h"
+#include <cmath>
+#include <string>
+
+TEST_CASE(SampleStats, EmptySeriesIsAllZero)
+{
+	SampleStats stats = ComputeSampleStats({});
+	CHECK_EQ(stats.Count, 0u);
+	CHECK_EQ(stats.MedianMs, 0.0);
+	CHECK_EQ(stats.MaxMs, 0.0);
+}
+
+TEST_CASE(SampleStats, SummarisesUnsortedSamples)
+{
+	SampleStats stats = ComputeSampleStats({ 4.0, 1.0, 3.0, 2.0 });
+	CHECK_EQ(stats.Count, 4u);
+	CHECK_EQ(stats.MinMs, 1.0);
+	CHECK_EQ(stats.MaxMs, 4.0);
+	CHECK_EQ(stats.MedianMs, 2.5);
+	CHECK_EQ(stats.MeanMs, 2.5);
+	CHECK(std::fabs(stats.StdDevMs - std::sqrt(5.0 / 3.0)) < 1e-12);
+	CHECK_EQ(stats.P95Ms, 4.0);
+
+	SampleStats single = ComputeSampleStats({ 7.0 });
+	CHECK_EQ(single.MedianMs, 7.0);
+	CHECK_EQ(single.StdDevMs, 0.0);
+}
+
+TEST_CASE(SampleStats, PercentilesPickTheNearestSample)
+{
+	std::vector<double> samples;
+	for (int i = 100; i >= 1; i--)
+		samples.push_back(i);
+
+	SampleStats stats = ComputeSampleStats(samples);
+	CHECK_EQ(stats.MedianMs, 50.5);
+	CHECK_EQ(stats.P95Ms, 95.0);
+	CHECK_EQ(stats.P99Ms, 99.0);
+}
+
+TEST_CASE(SampleStats, WritesResultMembers)
+{
+	std::vector<double> samples = { 2.0, 1.0 };
+	std::ostringstream out;
+	WriteSampleStatsJson(out, "suite/\"case\"", ComputeSampleStats(samples), samples);
+
+	std::string json = out.str();
+	CHECK_EQ(json.find("\"name\": \"suite/\\\"case\\\"\", \"repetitions\": 2"), 0u);
+	CHECK(json.find("\"median_ms\": 1.5") != std::string::npos);
+	CHECK(json.find("\"samples_ms\": [2, 1]") != std::string::npos);
+	CHECK(json.front() != '{' && json.back() == ']');
+}
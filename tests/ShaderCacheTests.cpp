@@ -0,0 +1,201 @@
+#include "TestHarness.h"
+#include "../src/Renderer/ShaderCache.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const std::vector<uint8_t> Bytecode = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+
+	std::string ReadText(const std::filesystem::path& path)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		std::ostringstream contents;
+		contents << fin.rdbuf();
+		return contents.str();
+	}
+
+	// Index line for Bytecode stored under key, as Save() writes it.
+	std::string IndexLine(uint64_t key)
+	{
+		CacheHasher checksum;
+		checksum.Add(Bytecode.data(), Bytecode.size());
+		return CacheKeyToString(key) + " " + std::to_string(Bytecode.size()) + " " + CacheKeyToString(checksum.Value()) + "\n";
+	}
+}
+
+TEST_CASE(ShaderCache, HasherIsStableAndSeparatesStrings)
+{
+	CacheHasher empty;
+	CHECK_EQ(empty.Value(), 14695981039346656037ull);
+
+	CacheHasher a;
+	a.Add(std::string("ab"));
+	a.Add(std::string("c"));
+	CacheHasher b;
+	b.Add(std::string("a"));
+	b.Add(std::string("bc"));
+	CHECK(a.Value() != b.Value());
+
+	CHECK_EQ(CacheKeyToString(0x1234), std::string("0000000000001234"));
+}
+
+TEST_CASE(ShaderCache, ParsesQuotedIncludes)
+{
+	std::vector<std::string> includes = ParseShaderIncludes(
+		"#include \"LightingUtil.hlsl\"\n"
+		"  \t#include \"Common/InstanceData.hlsl\"\n"
+		"#include <system.hlsl>\n"
+		"// #include \"Commented.hlsl\"\n"
+		"float4 main() : SV_Target { return 0; }\n");
+
+	REQUIRE(includes.size() == 2);
+	CHECK_EQ(includes[0], std::string("LightingUtil.hlsl"));
+	CHECK_EQ(includes[1], std::string("Common/InstanceData.hlsl"));
+}
+
+TEST_CASE(ShaderCache, KeyCoversIncludesAndOptions)
+{
+	TempDirectory dir;
+	std::filesystem::path shader = dir.WriteFile("pixel.hlsl", "#include \"LightingUtil.hlsl\"\nfloat4 main() : SV_Target { return Light(); }\n");
+	dir.WriteFile("LightingUtil.hlsl", "float4 Light() { return 1; }\n");
+
+	const std::vector<std::pair<std::string, std::string>> noDefines;
+	uint64_t key = MakeShaderCacheKey(shader, noDefines, "main", "ps_5_1", 0);
+	CHECK_EQ(MakeShaderCacheKey(shader, noDefines, "main", "ps_5_1", 0), key);
+	CHECK(MakeShaderCacheKey(shader, { { "FOG", "1" } }, "main", "ps_5_1", 0) != key);
+	CHECK(MakeShaderCacheKey(shader, noDefines, "other", "ps_5_1", 0) != key);
+	CHECK(MakeShaderCacheKey(shader, noDefines, "main", "ps_6_0", 0) != key);
+	CHECK(MakeShaderCacheKey(shader, noDefines, "main", "ps_5_1", 1) != key);
+
+	// Editing only the included file changes the key.
+	dir.WriteFile("LightingUtil.hlsl", "float4 Light() { return 0.5; }\n");
+	CHECK(MakeShaderCacheKey(shader, noDefines, "main", "ps_5_1", 0) != key);
+}
+
+TEST_CASE(ShaderCache, HashFailsOnMissingInclude)
+{
+	TempDirectory dir;
+	std::filesystem::path shader = dir.WriteFile("pixel.hlsl", "#include \"Missing.hlsl\"\n");
+	CacheHasher hasher;
+	CHECK(!HashShaderSource(shader, hasher));
+}
+
+TEST_CASE(ShaderCache, IncludeCyclesAreHashedOnce)
+{
+	TempDirectory dir;
+	std::filesystem::path a = dir.WriteFile("a.hlsl", "#include \"b.hlsl\"\n");
+	dir.WriteFile("b.hlsl", "#include \"a.hlsl\"\n");
+	CacheHasher hasher;
+	CHECK(HashShaderSource(a, hasher));
+}
+
+TEST_CASE(ShaderCache, StoresAndLoadsAcrossRuns)
+{
+	TempDirectory dir;
+	{
+		ShaderCacheIndex index(dir.Path());
+		index.Store(42, Bytecode.data(), Bytecode.size());
+		index.Save();
+	}
+
+	ShaderCacheIndex index(dir.Path());
+	std::vector<uint8_t> loaded;
+	REQUIRE(index.Load(42, loaded));
+	CHECK(loaded == Bytecode);
+	CHECK(!index.Load(43, loaded));
+	CHECK_EQ(index.Hits(), 1u);
+	CHECK_EQ(index.Misses(), 1u);
+}
+
+TEST_CASE(ShaderCache, RejectsCorruptBlob)
+{
+	TempDirectory dir;
+	{
+		ShaderCacheIndex index(dir.Path());
+		index.Store(7, Bytecode.data(), Bytecode.size());
+		index.Save();
+	}
+
+	std::string blob = ReadText(dir.Path() / (CacheKeyToString(7) + ".bin"));
+	blob[0] ^= 0xff;
+	dir.WriteFile(CacheKeyToString(7) + ".bin", blob);
+
+	ShaderCacheIndex index(dir.Path());
+	std::vector<uint8_t> loaded;
+	CHECK(!index.Load(7, loaded));
+	CHECK_EQ(index.Rejected(), 1u);
+	CHECK(!index.Load(7, loaded));
+	CHECK_EQ(index.Rejected(), 1u);
+}
+
+TEST_CASE(ShaderCache, DropsMalformedIndexLines)
+{
+	TempDirectory dir;
+	{
+		ShaderCacheIndex index(dir.Path());
+		index.Store(1, Bytecode.data(), Bytecode.size());
+		index.Store(2, Bytecode.data(), Bytecode.size());
+		index.Save();
+	}
+
+	std::string valid = IndexLine(1) + IndexLine(2);
+	dir.WriteFile("index.txt", "ShaderCacheIndex 1\n"
+		"not-hex 8 0000000000000001\n"
+		"ffffffffffffffffff 8 0000000000000001\n"
+		"0000000000000003 -8 0000000000000001\n"
+		"0000000000000004 8\n"
+		"0000000000000005 8 0000000000000001 extra\n"
+		"0000000000000006 8 zz\n"
+		+ valid);
+
+	ShaderCacheIndex index(dir.Path());
+	std::vector<uint8_t> loaded;
+	CHECK(index.Load(1, loaded));
+	CHECK(index.Load(2, loaded));
+	for (uint64_t key = 3; key <= 6; key++)
+		CHECK(!index.Load(key, loaded));
+	CHECK_EQ(index.Rejected(), 0u);
+
+	// The index is rewritten with only the good entries.
+	index.Save();
+	std::string rewritten = ReadText(dir.Path() / "index.txt");
+	CHECK(rewritten.find("not-hex") == std::string::npos);
+	CHECK(rewritten.find(CacheKeyToString(1)) != std::string::npos);
+	CHECK(rewritten.find(CacheKeyToString(5)) == std::string::npos);
+}
+
+TEST_CASE(ShaderCache, IgnoresUnknownIndexFormat)
+{
+	TempDirectory dir;
+	dir.WriteFile("index.txt", "ShaderCacheIndex 0\n" + IndexLine(1));
+	dir.WriteFile(CacheKeyToString(1) + ".bin", std::string(Bytecode.begin(), Bytecode.end()));
+
+	ShaderCacheIndex index(dir.Path());
+	std::vector<uint8_t> loaded;
+	CHECK(!index.Load(1, loaded));
+
+	index.Save();
+	CHECK_EQ(ReadText(dir.Path() / "index.txt"), std::string("ShaderCacheIndex 1\n"));
+}
+
+TEST_CASE(ShaderCache, SavePrunesUnusedEntries)
+{
+	TempDirectory dir;
+	{
+		ShaderCacheIndex index(dir.Path());
+		index.Store(1, Bytecode.data(), Bytecode.size());
+		index.Store(2, Bytecode.data(), Bytecode.size());
+		index.Save();
+	}
+	{
+		ShaderCacheIndex index(dir.Path());
+		std::vector<uint8_t> loaded;
+		CHECK(index.Load(1, loaded));
+		index.Save();
+	}
+
+	CHECK(std::filesystem::exists(dir.Path() / (CacheKeyToString(1) + ".bin")));
+	CHECK(!std::filesystem::exists(dir.Path() / (CacheKeyToString(2) + ".bin")));
+}
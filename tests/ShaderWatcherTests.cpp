@@ -0,0 +1,145 @@
+#include "TestHarness.h"
+#include "../src/Renderer/ShaderWatcher.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Moves the write time forward explicitly: file systems with coarse timestamps would
+	// otherwise miss an edit made within the same tick as the previous poll.
+	void Touch(const std::filesystem::path& path)
+	{
+		std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(2));
+	}
+
+	bool Contains(const std::vector<std::filesystem::path>& paths, const std::filesystem::path& path)
+	{
+		return std::find(paths.begin(), paths.end(), path) != paths.end();
+	}
+
+	struct ShaderTree
+	{
+		TempDirectory Dir;
+		std::filesystem::path Lighting = Dir.WriteFile("LightingUtil.hlsl", "float4 Light() { return 1; }\n");
+		std::filesystem::path Pixel = Dir.WriteFile("pixel.hlsl", "#include \"LightingUtil.hlsl\"\n");
+		std::filesystem::path Water = Dir.WriteFile("pixel_water.hlsl", "#include \"LightingUtil.hlsl\"\n");
+		std::filesystem::path Sky = Dir.WriteFile("pixel_sky.hlsl", "float4 main() : SV_Target { return 0; }\n");
+	};
+}
+
+TEST_CASE(ShaderWatcher, NothingChangedReportsNothing)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Pixel);
+	watcher.Watch(tree.Sky);
+
+	CHECK(watcher.Poll().empty());
+	CHECK(watcher.Poll().empty());
+}
+
+TEST_CASE(ShaderWatcher, CountsSharedIncludesOnce)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Pixel);
+	watcher.Watch(tree.Water);
+	watcher.Watch(tree.Sky);
+	watcher.Watch(tree.Pixel);
+
+	// pixel, pixel_water, pixel_sky and the shared LightingUtil.
+	CHECK_EQ(watcher.WatchedFileCount(), 4u);
+}
+
+TEST_CASE(ShaderWatcher, EditedShaderIsReportedOnce)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Pixel);
+	watcher.Watch(tree.Sky);
+
+	Touch(tree.Sky);
+	std::vector<std::filesystem::path> changed = watcher.Poll();
+	REQUIRE(changed.size() == 1);
+	CHECK(changed[0] == tree.Sky);
+	CHECK(watcher.Poll().empty());
+}
+
+TEST_CASE(ShaderWatcher, EditedIncludeReportsEveryUser)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Pixel);
+	watcher.Watch(tree.Water);
+	watcher.Watch(tree.Sky);
+
+	Touch(tree.Lighting);
+	std::vector<std::filesystem::path> changed = watcher.Poll();
+	CHECK_EQ(changed.size(), 2u);
+	CHECK(Contains(changed, tree.Pixel));
+	CHECK(Contains(changed, tree.Water));
+	CHECK(!Contains(changed, tree.Sky));
+}
+
+TEST_CASE(ShaderWatcher, FollowsIncludesAddedByAnEdit)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Sky);
+	CHECK_EQ(watcher.WatchedFileCount(), 1u);
+
+	tree.Dir.WriteFile("pixel_sky.hlsl", "#include \"LightingUtil.hlsl\"\n");
+	Touch(tree.Sky);
+	CHECK_EQ(watcher.Poll().size(), 1u);
+	CHECK_EQ(watcher.WatchedFileCount(), 2u);
+
+	Touch(tree.Lighting);
+	std::vector<std::filesystem::path> changed = watcher.Poll();
+	REQUIRE(changed.size() == 1);
+	CHECK(changed[0] == tree.Sky);
+}
+
+TEST_CASE(ShaderWatcher, FollowsNestedIncludes)
+{
+	ShaderTree tree;
+	std::filesystem::path common = tree.Dir.WriteFile("Common/Fog.hlsl", "#include \"../LightingUtil.hlsl\"\n");
+	std::filesystem::path fogged = tree.Dir.WriteFile("pixel_fog.hlsl", "#include \"Common/Fog.hlsl\"\n");
+
+	ShaderWatcher watcher;
+	watcher.Watch(fogged);
+	CHECK_EQ(watcher.WatchedFileCount(), 3u);
+
+	Touch(tree.Lighting);
+	std::vector<std::filesystem::path> changed = watcher.Poll();
+	REQUIRE(changed.size() == 1);
+	CHECK(changed[0] == fogged);
+
+	Touch(common);
+	CHECK_EQ(watcher.Poll().size(), 1u);
+}
+
+TEST_CASE(ShaderWatcher, MissingIncludeReportsWhenItAppears)
+{
+	ShaderTree tree;
+	std::filesystem::path shader = tree.Dir.WriteFile("pixel_new.hlsl", "#include \"NotYet.hlsl\"\n");
+
+	ShaderWatcher watcher;
+	watcher.Watch(shader);
+	CHECK(watcher.Poll().empty());
+
+	tree.Dir.WriteFile("NotYet.hlsl", "float Value() { return 1; }\n");
+	std::vector<std::filesystem::path> changed = watcher.Poll();
+	REQUIRE(changed.size() == 1);
+	CHECK(changed[0] == shader);
+}
+
+TEST_CASE(ShaderWatcher, DeletedShaderIsReported)
+{
+	ShaderTree tree;
+	ShaderWatcher watcher;
+	watcher.Watch(tree.Sky);
+
+	std::filesystem::remove(tree.Sky);
+	CHECK_EQ(watcher.Poll().size(), 1u);
+	CHECK(watcher.Poll().empty());
+}
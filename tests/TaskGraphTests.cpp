@@ -0,0 +1,159 @@
+#include "TestHarness.h"
+#include "../src/Renderer/TaskGraph.h"
+#include "../src/Utils/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	bool DependsOn(const TaskGraph& graph, uint32_t task, uint32_t dependency)
+	{
+		const std::vector<uint32_t>& dependencies = graph.TaskDependencies(task);
+		return std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end();
+	}
+
+	void Sleep(int ms)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+	}
+}
+
+TEST_CASE(TaskGraph, ReadWaitsForLatestWrite)
+{
+	JobSystem jobs(2);
+	TaskGraph graph;
+	TaskDataId data = graph.DeclareData("data");
+
+	std::atomic<bool> written{ false };
+	std::atomic<bool> readAfterWrite{ false };
+	uint32_t writer = 0;
+	uint32_t reader = 1;
+	graph.AddTask("Write", [&]() { Sleep(5); written = true; }).Write(data);
+	graph.AddTask("Read", [&]() { readAfterWrite = written.load(); }).Read(data);
+	graph.Execute(jobs);
+
+	CHECK(DependsOn(graph, reader, writer));
+	CHECK(graph.TaskDependencies(writer).empty());
+	CHECK(readAfterWrite);
+}
+
+TEST_CASE(TaskGraph, WriteWaitsForEarlierReads)
+{
+	JobSystem jobs(3);
+	TaskGraph graph;
+	TaskDataId data = graph.DeclareData("data");
+
+	std::atomic<uint32_t> readsDone{ 0 };
+	std::atomic<uint32_t> readsSeenByWriter{ 0 };
+	graph.AddTask("First write", []() {}).Write(data);
+	graph.AddTask("Read A", [&]() { Sleep(5); readsDone++; }).Read(data);
+	graph.AddTask("Read B", [&]() { Sleep(5); readsDone++; }).Read(data);
+	graph.AddTask("Second write", [&]() { readsSeenByWriter = readsDone.load(); }).Write(data);
+	graph.Execute(jobs);
+
+	// The second write waits for both reads and the write before them, and the reads only
+	// for the first write, not for each other.
+	CHECK(DependsOn(graph, 3, 0));
+	CHECK(DependsOn(graph, 3, 1));
+	CHECK(DependsOn(graph, 3, 2));
+	CHECK(!DependsOn(graph, 2, 1));
+	CHECK_EQ(readsSeenByWriter.load(), 2u);
+}
+
+TEST_CASE(TaskGraph, ReadWriteBySameTask)
+{
+	JobSystem jobs(2);
+	TaskGraph graph;
+	TaskDataId data = graph.DeclareData("data");
+
+	graph.AddTask("Producer", []() {}).Write(data);
+	graph.AddTask("Reader", []() {}).Read(data);
+	graph.AddTask("Update", []() {}).Read(data).Write(data);
+	graph.AddTask("Consumer", []() {}).Read(data);
+	graph.Execute(jobs);
+
+	// The read-modify-write task orders after the producer and the reader without depending
+	// on itself, and the next reader sees its write rather than the producer's.
+	CHECK(!DependsOn(graph, 2, 2));
+	CHECK(DependsOn(graph, 2, 0));
+	CHECK(DependsOn(graph, 2, 1));
+	CHECK(DependsOn(graph, 3, 2));
+	CHECK(!DependsOn(graph, 3, 0));
+}
+
+TEST_CASE(TaskGraph, SkipsSuccessorsOfAThrowingTask)
+{
+	JobSystem jobs(2);
+	TaskGraph graph;
+	TaskDataId failed = graph.DeclareData("failed");
+	TaskDataId other = graph.DeclareData("other");
+
+	std::atomic<bool> successorRan{ false };
+	std::atomic<bool> independentRan{ false };
+	graph.AddTask("Throws", []() { throw std::runtime_error("task failed"); }).Write(failed);
+	graph.AddTask("Successor", [&]() { successorRan = true; }).Read(failed);
+	graph.AddTask("Independent", [&]() { Sleep(5); independentRan = true; }).Write(other);
+
+	bool threw = false;
+	try
+	{
+		graph.Execute(jobs);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+
+	// Execute only rethrows once the unrelated task has finished too.
+	CHECK(threw);
+	CHECK(!successorRan);
+	CHECK(independentRan);
+
+	// The graph runs normally again afterwards.
+	graph.Reset();
+	std::atomic<uint32_t> ran{ 0 };
+	TaskDataId data = graph.DeclareData("data");
+	graph.AddTask("A", [&]() { ran++; }).Write(data);
+	graph.AddTask("B", [&]() { ran++; }).Read(data);
+	graph.Execute(jobs);
+	CHECK_EQ(ran.load(), 2u);
+}
+
+TEST_CASE(TaskGraph, FindsCriticalPath)
+{
+	JobSystem jobs(3);
+	TaskGraph graph;
+	TaskDataId chain = graph.DeclareData("chain");
+	TaskDataId side = graph.DeclareData("side");
+
+	// Two 20 ms tasks in a chain outweigh a 5 ms task that runs beside them.
+	graph.AddTask("Chain start", []() { Sleep(20); }).Write(chain);
+	graph.AddTask("Side", []() { Sleep(5); }).Write(side);
+	graph.AddTask("Chain end", []() { Sleep(20); }).Read(chain);
+	graph.Execute(jobs);
+
+	const std::vector<uint32_t>& path = graph.CriticalPath();
+	REQUIRE(path.size() == 2);
+	CHECK_EQ(path[0], 0u);
+	CHECK_EQ(path[1], 2u);
+	CHECK(graph.CriticalPathMs() >= 40.0);
+	CHECK(graph.CriticalPathMs() <= graph.TotalTaskMs());
+
+	// The chain's tasks cannot overlap; the side task is not on the path.
+	CHECK(graph.Timing(2).StartMs >= graph.Timing(0).EndMs);
+	CHECK(graph.WallMs() >= graph.CriticalPathMs() - 1.0);
+}
+
+TEST_CASE(TaskGraph, EmptyGraph)
+{
+	JobSystem jobs(1);
+	TaskGraph graph;
+	graph.Execute(jobs);
+	CHECK_EQ(graph.TaskCount(), 0u);
+	CHECK(graph.CriticalPath().empty());
+	CHECK_EQ(graph.CriticalPathMs(), 0.0);
+}
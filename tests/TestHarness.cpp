@@ -0,0 +1,118 @@
+#include "TestHarness.h"
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct TestCase
+	{
+		const char* Suite;
+		const char* Name;
+		TestFn Fn;
+	};
+
+	std::vector<TestCase>& Registry()
+	{
+		static std::vector<TestCase> cases;
+		return cases;
+	}
+
+	// Checks may fail on job threads.
+	std::atomic<int> g_Failures{ 0 };
+	std::mutex g_ReportMutex;
+}
+
+TestRegistrar::TestRegistrar(const char* suite, const char* name, TestFn fn)
+{
+	Registry().push_back({ suite, name, fn });
+}
+
+void ReportFailure(const char* file, int line, const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(g_ReportMutex);
+	std::cerr << file << '(' << line << "): " << message << '\n';
+	g_Failures++;
+}
+
+TempDirectory::TempDirectory()
+{
+	std::random_device random;
+	std::filesystem::path base = std::filesystem::temp_directory_path();
+	do
+	{
+		m_Path = base / ("AquaTerrainTests-" + std::to_string(random()));
+	} while (!std::filesystem::create_directory(m_Path));
+}
+
+TempDirectory::~TempDirectory()
+{
+	std::error_code ec;
+	std::filesystem::remove_all(m_Path, ec);
+}
+
+std::filesystem::path TempDirectory::WriteFile(const std::string& name, const std::string& contents) const
+{
+	std::filesystem::path path = m_Path / name;
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+	fout << contents;
+	return path;
+}
+
+int main(int argc, char** argv)
+{
+	const char* suite = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--suite") == 0 && i + 1 < argc)
+		{
+			suite = argv[++i];
+		}
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--suite NAME]\n";
+			return 2;
+		}
+	}
+
+	int run = 0;
+	int failedCases = 0;
+	for (const TestCase& test : Registry())
+	{
+		if (suite && std::strcmp(suite, test.Suite) != 0)
+			continue;
+
+		int failuresBefore = g_Failures;
+		try
+		{
+			test.Fn();
+		}
+		catch (const TestAbort&)
+		{
+		}
+		catch (const std::exception& e)
+		{
+			ReportFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+		}
+
+		run++;
+		bool failed = g_Failures != failuresBefore;
+		failedCases += failed;
+		std::cout << (failed ? "FAIL " : "ok   ") << test.Suite << '.' << test.Name << '\n';
+	}
+
+	if (run == 0)
+	{
+		std::cerr << "no tests matched\n";
+		return 2;
+	}
+
+	std::cout << run - failedCases << '/' << run << " passed\n";
+	return failedCases ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+// A minimal test runner for the platform-neutral modules. Cases register themselves at static
+// initialisation; AquaTerrainTests runs every case, or only one suite with --suite NAME, and
+// exits non-zero if any check failed.
+
+using TestFn = void(*)();
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* suite, const char* name, TestFn fn);
+};
+
+// Records a failed check and carries on with the case.
+void ReportFailure(const char* file, int line, const std::string& message);
+
+// Thrown by REQUIRE to abandon the current case.
+struct TestAbort {};
+
+// Empty directory under the system temp directory, removed with everything in it.
+class TempDirectory
+{
+public:
+	TempDirectory();
+	~TempDirectory();
+
+	TempDirectory(const TempDirectory& rhs) = delete;
+	TempDirectory& operator=(const TempDirectory& rhs) = delete;
+
+	const std::filesystem::path& Path() const { return m_Path; }
+
+	// Writes contents to name inside the directory and returns its path.
+	std::filesystem::path WriteFile(const std::string& name, const std::string& contents) const;
+
+private:
+	std::filesystem::path m_Path;
+};
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+
+#define TEST_CASE(suite, name) \
+	static void TEST_CONCAT(suite##_, name)(); \
+	static TestRegistrar TEST_CONCAT(suite##_##name, _Registrar)(#suite, #name, &TEST_CONCAT(suite##_, name)); \
+	static void TEST_CONCAT(suite##_, name)()
+
+#define CHECK(condition) \
+	do { if (!(condition)) ReportFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); } while (0)
+
+#define CHECK_EQ(actual, expected) \
+	do \
+	{ \
+		const auto& actualValue_ = (actual); \
+		const auto& expectedValue_ = (expected); \
+		if (!(actualValue_ == expectedValue_)) \
+		{ \
+			std::ostringstream message_; \
+			message_ << "CHECK_EQ(" #actual ", " #expected "): " << actualValue_ << " != " << expectedValue_; \
+			ReportFailure(__FILE__, __LINE__, message_.str()); \
+		} \
+	} while (0)
+
+#define REQUIRE(condition) \
+	do { if (!(condition)) { ReportFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")"); throw TestAbort(); } } while (0)
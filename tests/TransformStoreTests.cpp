@@ -0,0 +1,196 @@
+#include "TestHarness.h"
+#include "../src/Renderer/TransformStore.h"
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A different, non-trivial transform per slot, with a unit rotation quaternion.
+	Transform MakeTransform(uint32_t i)
+	{
+		float angle = 0.37f + 0.61f * (float)i;
+		float axis[3] = { 0.3f + 0.1f * (float)i, -0.8f, 0.5f - 0.2f * (float)i };
+		float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+		Transform transform;
+		transform.Position[0] = 10.0f * (float)i - 3.0f;
+		transform.Position[1] = 2.5f;
+		transform.Position[2] = -7.0f + (float)i;
+		for (int c = 0; c < 3; c++)
+			transform.Rotation[c] = axis[c] / length * std::sin(angle * 0.5f);
+		transform.Rotation[3] = std::cos(angle * 0.5f);
+		transform.Scale[0] = 1.0f + 0.5f * (float)i;
+		transform.Scale[1] = 0.75f;
+		transform.Scale[2] = 2.0f - 0.1f * (float)i;
+		return transform;
+	}
+
+	XMFLOAT4X4 ReferenceMatrix(const Transform& transform, bool transpose)
+	{
+		XMFLOAT4 rotation(transform.Rotation[0], transform.Rotation[1], transform.Rotation[2], transform.Rotation[3]);
+		XMMATRIX world = XMMatrixScaling(transform.Scale[0], transform.Scale[1], transform.Scale[2]) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) *
+			XMMatrixTranslation(transform.Position[0], transform.Position[1], transform.Position[2]);
+
+		XMFLOAT4X4 result;
+		XMStoreFloat4x4(&result, transpose ? XMMatrixTranspose(world) : world);
+		return result;
+	}
+
+	// Computes slots [first, first + count) into a buffer with stride-byte elements and checks
+	// each matrix against DirectXMath and that the padding between them is left alone.
+	bool MatchesDirectXMath(const TransformStore& store, uint32_t first, uint32_t count, size_t stride, bool transpose)
+	{
+		const uint8_t fill = 0xCD;
+		std::vector<uint8_t> buffer(count * stride, fill);
+		ComputeWorldMatrices(store, first, count, buffer.data(), stride, transpose);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float actual[16];
+			memcpy(actual, buffer.data() + i * stride, sizeof(actual));
+			XMFLOAT4X4 expected = ReferenceMatrix(store.Get(first + i), transpose);
+
+			for (int e = 0; e < 16; e++)
+			{
+				if (std::fabs(actual[e] - expected.m[e / 4][e % 4]) > 1e-4f)
+					return false;
+			}
+			for (size_t b = sizeof(actual); b < stride; b++)
+			{
+				if (buffer[i * stride + b] != fill)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<TransformRange> Take(TransformStore& store)
+	{
+		std::vector<TransformRange> ranges;
+		store.TakeDirtyRanges(ranges);
+		return ranges;
+	}
+
+	bool IsRange(const TransformRange& range, uint32_t first, uint32_t count)
+	{
+		return range.First == first && range.Count == count;
+	}
+}
+
+TEST_CASE(TransformStore, MatchesDirectXMathForEveryCount)
+{
+	TransformStore store(1);
+	for (uint32_t i = 0; i < 12; i++)
+		store.Add(MakeTransform(i));
+
+	// Counts 1-9 cover the scalar tail alone, one and two four-wide groups, and groups with a
+	// tail; starting at slot 3 puts the groups off the stream alignment.
+	for (uint32_t count = 1; count <= 9; count++)
+	{
+		for (bool transpose : { false, true })
+		{
+			CHECK(MatchesDirectXMath(store, 0, count, sizeof(float) * 16, transpose));
+			CHECK(MatchesDirectXMath(store, 3, count, sizeof(float) * 16, transpose));
+		}
+	}
+}
+
+TEST_CASE(TransformStore, WritesStridedOutput)
+{
+	TransformStore store(1);
+	for (uint32_t i = 0; i < 9; i++)
+		store.Add(MakeTransform(i));
+
+	// The stride of a constant buffer element that holds more than the world matrix.
+	const size_t stride = 256;
+	for (uint32_t count = 1; count <= 9; count++)
+	{
+		CHECK(MatchesDirectXMath(store, 0, count, stride, false));
+		CHECK(MatchesDirectXMath(store, 0, count, stride, true));
+	}
+}
+
+TEST_CASE(TransformStore, GetReturnsWhatWasSet)
+{
+	TransformStore store(1);
+	uint32_t slot = store.Add(MakeTransform(0));
+	store.Set(slot, MakeTransform(5));
+
+	Transform expected = MakeTransform(5);
+	Transform actual = store.Get(slot);
+	CHECK(memcmp(&actual, &expected, sizeof(Transform)) == 0);
+	CHECK_EQ(store.Size(), 1u);
+}
+
+TEST_CASE(TransformStore, DirtyRangesLastForEveryFrameResource)
+{
+	const uint32_t frameCount = 3;
+	TransformStore store(frameCount);
+	for (uint32_t i = 0; i < 10; i++)
+		store.Add(MakeTransform(i));
+
+	// New slots are dirty until each frame resource has taken them.
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		std::vector<TransformRange> ranges = Take(store);
+		REQUIRE(ranges.size() == 1);
+		CHECK(IsRange(ranges[0], 0, 10));
+	}
+	CHECK(Take(store).empty());
+
+	store.Set(2, MakeTransform(1));
+	store.Set(3, MakeTransform(1));
+	store.Set(7, MakeTransform(1));
+	std::vector<TransformRange> ranges = Take(store);
+	REQUIRE(ranges.size() == 2);
+	CHECK(IsRange(ranges[0], 2, 2));
+	CHECK(IsRange(ranges[1], 7, 1));
+
+	// A slot changed part way through joins its neighbours' run and outlives them by a frame.
+	store.Set(4, MakeTransform(1));
+	for (uint32_t frame = 1; frame < frameCount; frame++)
+	{
+		ranges = Take(store);
+		REQUIRE(ranges.size() == 2);
+		CHECK(IsRange(ranges[0], 2, 3));
+		CHECK(IsRange(ranges[1], 7, 1));
+	}
+
+	ranges = Take(store);
+	REQUIRE(ranges.size() == 1);
+	CHECK(IsRange(ranges[0], 4, 1));
+	CHECK(Take(store).empty());
+}
+
+TEST_CASE(TransformStore, SettingADirtySlotRestartsItsCount)
+{
+	TransformStore store(2);
+	store.Add(MakeTransform(0));
+	CHECK_EQ(Take(store).size(), 1u);
+
+	// Changed again before every frame resource took it: both have to see the new value.
+	store.Set(0, MakeTransform(1));
+	CHECK_EQ(Take(store).size(), 1u);
+	CHECK_EQ(Take(store).size(), 1u);
+	CHECK(Take(store).empty());
+}
+
+TEST_CASE(TransformStore, ClearDropsSlotsAndDirtyState)
+{
+	TransformStore store(3);
+	store.Add(MakeTransform(0));
+	store.Add(MakeTransform(1));
+	store.Clear();
+	CHECK_EQ(store.Size(), 0u);
+	CHECK(Take(store).empty());
+
+	store.Add(MakeTransform(2));
+	std::vector<TransformRange> ranges = Take(store);
+	REQUIRE(ranges.size() == 1);
+	CHECK(IsRange(ranges[0], 0, 1));
+}